@@ -18,6 +18,8 @@
 #define POSTER_THUMB_WIDTH 150
 #define POSTER_THUMB_HEIGHT 225
 #define POSTER_FULL_WIDTH 500
+#define POSTER_DETAIL_WIDTH 375
+#define POSTER_DETAIL_HEIGHT 562
 
 /* Theme preferences */
 typedef enum {
@@ -64,6 +66,8 @@ struct _Film {
   gint runtime_minutes;
   gchar *plot;
   gchar *poster_path;
+  gchar *poster_remote; /* TMDB image path of the poster, e.g. "/abc.jpg";
+                           other sizes are fetched from it */
   gint tmdb_id;
   gchar *imdb_id;
   gdouble rating;
@@ -71,6 +75,11 @@ struct _Film {
   MatchStatus match_status;
   MediaType media_type;
   gint season_number; /* For TV seasons only */
+  gint64 show_id;     /* shows.id of a matched TV season, 0 otherwise */
+
+  /* Set on grid tiles that stand for a whole show (FilterState.group_seasons) */
+  gchar *show_name;
+  gint season_count;
 
   /* Cached data */
   GdkPixbuf *poster_pixbuf;
@@ -87,6 +96,8 @@ struct _FilterState {
   gchar *plot_text;
   gchar *sort_by;
   gboolean sort_ascending;
+  gboolean duplicates_only; /* Films with an identical copy elsewhere */
+  gboolean group_seasons;   /* One tile per TV show instead of per season */
 };
 
 /* Main application state */
@@ -110,6 +121,13 @@ struct _ReelApp {
   gchar *player_command;
   gchar **library_paths;
   gint library_paths_count;
+  gint missing_grace_days; /* Keep unseen files this long before removing */
+  gchar **strip_tags;      /* Custom release tags, NULL for built-in */
+  gint io_timeout_seconds; /* Longest wait on one filesystem call in a scan */
+  gint scrape_concurrency; /* TMDB transfers in flight at once */
+  gint scrape_rate;        /* TMDB API requests per second, 0 for no limit */
+  gint tmdb_cache_mb;      /* Size cap of cached API replies, 0 disables */
+  gint poster_memory_mb;   /* Decoded posters kept for the grid, 0 disables */
 
   /* State */
   FilterState filter;
@@ -132,6 +150,7 @@ struct _ReelApp {
 
   /* Async */
   GThreadPool *thread_pool;
+  GThreadPool *poster_fetch_pool; /* Grid-sized posters being downloaded */
   GAsyncQueue *ui_queue;
   guint ui_update_source;
 
@@ -140,8 +159,6 @@ struct _ReelApp {
   gboolean films_loading;
   gint films_next_offset;
   gboolean films_end_reached;
-  GList *grid_pending; /* List of Film* (nodes owned by grid) */
-  guint grid_idle_source;
   gboolean genres_dirty;
 
   /* Debug/metrics */
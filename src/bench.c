@@ -0,0 +1,1346 @@
+/*
+ * ReelGTK - Scanner Benchmark
+ * Synthetic library generator and scan throughput measurement
+ */
+
+#include "bench.h"
+#include "cli.h"
+#include "db.h"
+#include "scanner.h"
+#include "scraper.h"
+#include "tmdbjson.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <json-c/json.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define MIB (1024 * 1024)
+
+static const gchar *TITLE_WORDS[] = {
+    "The",     "Last",    "Night",   "City",   "Dark",     "River",
+    "Dead",    "Star",    "Black",   "Lost",   "King",     "Red",
+    "Silent",  "House",   "Road",    "Blood",  "Winter",   "Summer",
+    "Iron",    "Ghost",   "Love",    "War",    "Secret",   "Empire",
+    "Island",  "Hunter",  "Shadow",  "Fire",   "Ocean",    "Storm",
+    "Moon",    "Wolf",    "Dragon",  "Glass",  "Stone",    "Golden",
+    "Broken",  "Wild",    "Hidden",  "Edge",   "Heart",    "Machine",
+    "Garden",  "Kingdom", "Legacy",  "Signal", "Echo",     "Paradise",
+    "Frontier", "Zero"};
+
+static const gchar *QUALITY_TAGS[] = {
+    "1080p.BluRay.x264",        "720p.BluRay.x264",
+    "2160p.UHD.BluRay.x265.HDR", "1080p.WEB-DL.DDP5.1.H.264",
+    "720p.WEBRip.x264",         "DVDRip.XviD",
+    "1080p.BluRay.REMUX.AVC.DTS-HD.MA.5.1", "BRRip.x264.AAC"};
+
+static const gchar *GROUPS[] = {"SPARKS",  "GECKOS", "FGT", "NTb",
+                                "AMIABLE", "CiNEFiLE", "DON", "EVO"};
+
+/* Weighted towards Matroska like most real libraries */
+static const gchar *VIDEO_EXTS[] = {"mkv", "mkv", "mkv", "mkv", "mkv", "mkv",
+                                    "mp4", "mp4", "mp4", "avi", "m4v"};
+
+#define BENCH_PICK(gen, arr)                                                   \
+  (arr)[g_rand_int_range((gen)->rand, 0, G_N_ELEMENTS(arr))]
+
+typedef struct {
+  GRand *rand;
+  gint target;
+  gint files;
+  gint videos;
+  gint dirs;
+  gboolean failed;
+} BenchGen;
+
+static gboolean bench_chance(BenchGen *gen, gint percent) {
+  return g_rand_int_range(gen->rand, 0, 100) < percent;
+}
+
+static gchar *bench_title(BenchGen *gen, const gchar *sep) {
+  GString *title = g_string_new(NULL);
+  gint words = g_rand_int_range(gen->rand, 1, 5);
+  for (gint i = 0; i < words; i++) {
+    if (i > 0)
+      g_string_append(title, sep);
+    g_string_append(title, BENCH_PICK(gen, TITLE_WORDS));
+  }
+  return g_string_free(title, FALSE);
+}
+
+/* Film names in the styles seen in the wild: scene releases, Plex-style
+   "Title (Year)", underscores, and bracketed quality */
+static gchar *bench_film_name(BenchGen *gen, gint year) {
+  gchar *title = NULL;
+  gchar *name = NULL;
+  switch (g_rand_int_range(gen->rand, 0, 4)) {
+  case 0:
+    title = bench_title(gen, ".");
+    name = g_strdup_printf("%s.%d.%s-%s", title, year,
+                           BENCH_PICK(gen, QUALITY_TAGS),
+                           BENCH_PICK(gen, GROUPS));
+    break;
+  case 1:
+    title = bench_title(gen, " ");
+    name = g_strdup_printf("%s (%d)", title, year);
+    break;
+  case 2:
+    title = bench_title(gen, "_");
+    name = g_ascii_strdown(title, -1);
+    g_free(title);
+    title = name;
+    name = g_strdup_printf("%s_%d_720p", title, year);
+    break;
+  default:
+    title = bench_title(gen, " ");
+    name = g_strdup_printf("%s %d [1080p]", title, year);
+    break;
+  }
+  g_free(title);
+  return name;
+}
+
+static void bench_mkdir(BenchGen *gen, const gchar *path) {
+  if (g_mkdir_with_parents(path, 0755) != 0) {
+    g_printerr("Cannot create %s\n", path);
+    gen->failed = TRUE;
+    return;
+  }
+  gen->dirs++;
+}
+
+/* Files are sparse: only the size matters to the scanner. */
+static void bench_file(BenchGen *gen, const gchar *dir, const gchar *name,
+                       gint64 size, gboolean video) {
+  if (gen->failed)
+    return;
+
+  gchar *path = g_build_filename(dir, name, NULL);
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0 || ftruncate(fd, size) != 0) {
+    g_printerr("Cannot create %s\n", path);
+    gen->failed = TRUE;
+  }
+  if (fd >= 0)
+    close(fd);
+  g_free(path);
+
+  gen->files++;
+  if (video)
+    gen->videos++;
+}
+
+static gint64 bench_video_size(BenchGen *gen) {
+  return (gint64)g_rand_int_range(gen->rand, 700, 8000) * MIB +
+         g_rand_int_range(gen->rand, 0, MIB);
+}
+
+static void bench_video(BenchGen *gen, const gchar *dir, const gchar *base) {
+  gchar *name =
+      g_strdup_printf("%s.%s", base, BENCH_PICK(gen, VIDEO_EXTS));
+  bench_file(gen, dir, name, bench_video_size(gen), TRUE);
+  g_free(name);
+}
+
+/* Movies/<release>/ with the usual side files */
+static void bench_gen_film(BenchGen *gen, const gchar *parent) {
+  gint year = g_rand_int_range(gen->rand, 1950, 2025);
+  gchar *name = bench_film_name(gen, year);
+  gchar *dir = g_build_filename(parent, name, NULL);
+  bench_mkdir(gen, dir);
+
+  bench_video(gen, dir, name);
+
+  gchar *side = NULL;
+  if (bench_chance(gen, 50)) {
+    side = g_strdup_printf("%s.nfo", name);
+    bench_file(gen, dir, side, 2048, FALSE);
+    g_free(side);
+  }
+  if (bench_chance(gen, 40)) {
+    side = g_strdup_printf("%s.en.srt", name);
+    bench_file(gen, dir, side, 90 * 1024, FALSE);
+    g_free(side);
+  }
+  if (bench_chance(gen, 30))
+    bench_file(gen, dir, "poster.jpg", 300 * 1024, FALSE);
+  if (bench_chance(gen, 10)) {
+    gchar *sample_dir = g_build_filename(dir, "Sample", NULL);
+    gchar *sample = g_strdup_printf("%s-sample.mkv", name);
+    bench_mkdir(gen, sample_dir);
+    bench_file(gen, sample_dir, sample, 40 * MIB, TRUE);
+    g_free(sample);
+    g_free(sample_dir);
+  }
+  if (bench_chance(gen, 5)) {
+    gchar *extras = g_build_filename(dir, "Extras", NULL);
+    bench_mkdir(gen, extras);
+    gint count = g_rand_int_range(gen->rand, 2, 5);
+    for (gint i = 1; i <= count; i++) {
+      gchar *extra = g_strdup_printf("Featurette %d.mp4", i);
+      bench_file(gen, extras, extra, 200 * MIB, TRUE);
+      g_free(extra);
+    }
+    g_free(extras);
+  }
+
+  g_free(dir);
+  g_free(name);
+}
+
+/* Loose files in one big folder */
+static void bench_gen_loose_film(BenchGen *gen, const gchar *parent) {
+  gchar *name = bench_film_name(gen, g_rand_int_range(gen->rand, 1950, 2025));
+  bench_video(gen, parent, name);
+  g_free(name);
+}
+
+static void bench_gen_episodes(BenchGen *gen, const gchar *dir,
+                               const gchar *show, gint season, gint count) {
+  const gchar *tag = BENCH_PICK(gen, QUALITY_TAGS);
+  const gchar *group = BENCH_PICK(gen, GROUPS);
+  gboolean subs = bench_chance(gen, 30);
+  for (gint ep = 1; ep <= count; ep++) {
+    gchar *base =
+        g_strdup_printf("%s.S%02dE%02d.%s-%s", show, season, ep, tag, group);
+    bench_video(gen, dir, base);
+    if (subs) {
+      gchar *srt = g_strdup_printf("%s.srt", base);
+      bench_file(gen, dir, srt, 40 * 1024, FALSE);
+      g_free(srt);
+    }
+    g_free(base);
+  }
+}
+
+/* TV/<Show>/Season NN/ plus Specials */
+static void bench_gen_show(BenchGen *gen, const gchar *parent) {
+  gchar *show = bench_title(gen, " ");
+  gchar *dotted = g_strdelimit(g_strdup(show), " ", '.');
+  gchar *show_dir = g_build_filename(parent, show, NULL);
+  bench_mkdir(gen, show_dir);
+
+  gint seasons = g_rand_int_range(gen->rand, 1, 9);
+  for (gint s = 1; s <= seasons && !gen->failed; s++) {
+    gchar *season_name;
+    switch (g_rand_int_range(gen->rand, 0, 3)) {
+    case 0:
+      season_name = g_strdup_printf("Season %02d", s);
+      break;
+    case 1:
+      season_name = g_strdup_printf("Season %d", s);
+      break;
+    default:
+      season_name = g_strdup_printf("S%02d", s);
+      break;
+    }
+    gchar *season_dir = g_build_filename(show_dir, season_name, NULL);
+    bench_mkdir(gen, season_dir);
+    bench_gen_episodes(gen, season_dir, dotted, s,
+                       g_rand_int_range(gen->rand, 6, 14));
+    g_free(season_dir);
+    g_free(season_name);
+  }
+
+  if (bench_chance(gen, 30)) {
+    gchar *specials = g_build_filename(show_dir, "Specials", NULL);
+    bench_mkdir(gen, specials);
+    bench_gen_episodes(gen, specials, dotted, 0,
+                       g_rand_int_range(gen->rand, 1, 5));
+    g_free(specials);
+  }
+
+  g_free(show_dir);
+  g_free(dotted);
+  g_free(show);
+}
+
+/* TV/Show.Name.S02.1080p.WEB-DL-GRP/ with episodes directly inside */
+static void bench_gen_season_pack(BenchGen *gen, const gchar *parent) {
+  gchar *show = bench_title(gen, ".");
+  gint season = g_rand_int_range(gen->rand, 1, 10);
+  gchar *name = g_strdup_printf("%s.S%02d.%s-%s", show, season,
+                                BENCH_PICK(gen, QUALITY_TAGS),
+                                BENCH_PICK(gen, GROUPS));
+  gchar *dir = g_build_filename(parent, name, NULL);
+  bench_mkdir(gen, dir);
+  bench_gen_episodes(gen, dir, show, season,
+                     g_rand_int_range(gen->rand, 6, 14));
+  g_free(dir);
+  g_free(name);
+  g_free(show);
+}
+
+/* TV/Show.Name.S01-S04.Complete/ either flat or with per-season folders */
+static void bench_gen_multi_pack(BenchGen *gen, const gchar *parent) {
+  gchar *show = bench_title(gen, ".");
+  gint seasons = g_rand_int_range(gen->rand, 2, 6);
+  gchar *name = g_strdup_printf("%s.S01-S%02d.Complete.720p", show, seasons);
+  gchar *dir = g_build_filename(parent, name, NULL);
+  bench_mkdir(gen, dir);
+
+  gboolean flat = bench_chance(gen, 50);
+  for (gint s = 1; s <= seasons && !gen->failed; s++) {
+    gint episodes = g_rand_int_range(gen->rand, 6, 14);
+    if (flat) {
+      bench_gen_episodes(gen, dir, show, s, episodes);
+      continue;
+    }
+    gchar *sub_name = g_strdup_printf("%s.S%02d.720p", show, s);
+    gchar *sub = g_build_filename(dir, sub_name, NULL);
+    bench_mkdir(gen, sub);
+    bench_gen_episodes(gen, sub, show, s, episodes);
+    g_free(sub);
+    g_free(sub_name);
+  }
+
+  g_free(dir);
+  g_free(name);
+  g_free(show);
+}
+
+/* Disc/<Title (Year)>/BDMV/... : many files, none the scanner picks up */
+static void bench_gen_bdmv(BenchGen *gen, const gchar *parent) {
+  gchar *title = bench_title(gen, " ");
+  gchar *name = g_strdup_printf("%s (%d)", title,
+                                g_rand_int_range(gen->rand, 1990, 2025));
+  gchar *dir = g_build_filename(parent, name, NULL);
+  gchar *bdmv = g_build_filename(dir, "BDMV", NULL);
+  gchar *stream = g_build_filename(bdmv, "STREAM", NULL);
+  gchar *playlist = g_build_filename(bdmv, "PLAYLIST", NULL);
+  gchar *cert = g_build_filename(dir, "CERTIFICATE", NULL);
+
+  bench_mkdir(gen, dir);
+  bench_mkdir(gen, bdmv);
+  bench_mkdir(gen, stream);
+  bench_mkdir(gen, playlist);
+  bench_mkdir(gen, cert);
+
+  bench_file(gen, bdmv, "index.bdmv", 512, FALSE);
+  bench_file(gen, bdmv, "MovieObject.bdmv", 4096, FALSE);
+  bench_file(gen, cert, "id.bdmv", 512, FALSE);
+  gint streams = g_rand_int_range(gen->rand, 3, 9);
+  for (gint i = 0; i < streams; i++) {
+    gchar *m2ts = g_strdup_printf("%05d.m2ts", i);
+    gchar *mpls = g_strdup_printf("%05d.mpls", i);
+    bench_file(gen, stream, m2ts, bench_video_size(gen), FALSE);
+    bench_file(gen, playlist, mpls, 1024, FALSE);
+    g_free(mpls);
+    g_free(m2ts);
+  }
+
+  g_free(cert);
+  g_free(playlist);
+  g_free(stream);
+  g_free(bdmv);
+  g_free(dir);
+  g_free(name);
+  g_free(title);
+}
+
+static gboolean bench_generate(BenchGen *gen, const gchar *root) {
+  gchar *movies = g_build_filename(root, "Movies", NULL);
+  gchar *loose = g_build_filename(root, "Movies", "Unsorted", NULL);
+  gchar *tv = g_build_filename(root, "TV", NULL);
+  gchar *disc = g_build_filename(root, "Disc", NULL);
+  bench_mkdir(gen, movies);
+  bench_mkdir(gen, loose);
+  bench_mkdir(gen, tv);
+  bench_mkdir(gen, disc);
+
+  while (gen->files < gen->target && !gen->failed) {
+    gint kind = g_rand_int_range(gen->rand, 0, 100);
+    if (kind < 60)
+      bench_gen_film(gen, movies);
+    else if (kind < 70)
+      bench_gen_loose_film(gen, loose);
+    else if (kind < 82)
+      bench_gen_show(gen, tv);
+    else if (kind < 90)
+      bench_gen_season_pack(gen, tv);
+    else if (kind < 94)
+      bench_gen_multi_pack(gen, tv);
+    else
+      bench_gen_bdmv(gen, disc);
+  }
+
+  g_free(disc);
+  g_free(tv);
+  g_free(loose);
+  g_free(movies);
+  return !gen->failed;
+}
+
+/* Count (or delete) an existing tree */
+static void bench_walk_tree(const gchar *path, gint *files, gint *dirs,
+                            gboolean remove) {
+  GDir *dir = g_dir_open(path, 0, NULL);
+  if (!dir)
+    return;
+
+  const gchar *name;
+  while ((name = g_dir_read_name(dir)) != NULL) {
+    gchar *child = g_build_filename(path, name, NULL);
+    if (g_file_test(child, G_FILE_TEST_IS_DIR) &&
+        !g_file_test(child, G_FILE_TEST_IS_SYMLINK)) {
+      (*dirs)++;
+      bench_walk_tree(child, files, dirs, remove);
+      if (remove)
+        g_rmdir(child);
+    } else {
+      (*files)++;
+      if (remove)
+        g_unlink(child);
+    }
+    g_free(child);
+  }
+  g_dir_close(dir);
+}
+
+/* Needs root; without it the "cold" run is just another rescan */
+static gboolean bench_drop_caches(void) {
+  sync();
+  FILE *f = fopen("/proc/sys/vm/drop_caches", "w");
+  if (!f)
+    return FALSE;
+  gboolean ok = fputs("3\n", f) >= 0;
+  return fclose(f) == 0 && ok;
+}
+
+typedef struct {
+  gint64 wall_us;
+  gint64 syscr; /* read(2)-class calls, not directory or stat calls */
+  gint64 syscw; /* write(2)-class calls */
+  gint64 rchar;
+  struct rusage usage;
+} BenchSample;
+
+static void bench_sample(BenchSample *sample) {
+  memset(sample, 0, sizeof(*sample));
+
+  gchar *io = NULL;
+  if (g_file_get_contents("/proc/self/io", &io, NULL, NULL)) {
+    gchar **lines = g_strsplit(io, "\n", -1);
+    for (gint i = 0; lines[i] != NULL; i++) {
+      gint64 value = 0;
+      if (sscanf(lines[i], "syscr: %" G_GINT64_FORMAT, &value) == 1)
+        sample->syscr = value;
+      else if (sscanf(lines[i], "syscw: %" G_GINT64_FORMAT, &value) == 1)
+        sample->syscw = value;
+      else if (sscanf(lines[i], "rchar: %" G_GINT64_FORMAT, &value) == 1)
+        sample->rchar = value;
+    }
+    g_strfreev(lines);
+    g_free(io);
+  }
+
+  getrusage(RUSAGE_SELF, &sample->usage);
+  sample->wall_us = g_get_monotonic_time();
+}
+
+static int bench_profile_cb(unsigned type, void *ctx, void *stmt, void *ns) {
+  (void)stmt;
+  if (type == SQLITE_TRACE_PROFILE)
+    *(gint64 *)ctx += *(sqlite3_int64 *)ns;
+  return 0;
+}
+
+static json_object *bench_run(ReelApp *app, const gchar *name,
+                              const gchar *root, gint files, gboolean cold) {
+  gboolean dropped = cold && bench_drop_caches();
+
+  gint64 db_ns = 0;
+  sqlite3_trace_v2(app->db, SQLITE_TRACE_PROFILE, bench_profile_cb, &db_ns);
+
+  BenchSample before, after;
+  bench_sample(&before);
+  gint added = scanner_scan_directory(app, root);
+  bench_sample(&after);
+
+  sqlite3_trace_v2(app->db, 0, NULL, NULL);
+
+  gint64 wall_us = MAX(after.wall_us - before.wall_us, 1);
+  json_object *run = json_object_new_object();
+  json_object_object_add(run, "name", json_object_new_string(name));
+  if (cold)
+    json_object_object_add(run, "cache_dropped",
+                           json_object_new_boolean(dropped));
+  json_object_object_add(run, "added", json_object_new_int(added));
+  json_object_object_add(run, "elapsed_ms",
+                         json_object_new_int64(wall_us / 1000));
+  json_object_object_add(
+      run, "files_per_sec",
+      json_object_new_double((gdouble)files * 1000000.0 / (gdouble)wall_us));
+  json_object_object_add(run, "db_ms", json_object_new_int64(db_ns / 1000000));
+  json_object_object_add(run, "read_calls",
+                         json_object_new_int64(after.syscr - before.syscr));
+  json_object_object_add(run, "write_calls",
+                         json_object_new_int64(after.syscw - before.syscw));
+  json_object_object_add(run, "read_bytes",
+                         json_object_new_int64(after.rchar - before.rchar));
+  json_object_object_add(
+      run, "minor_faults",
+      json_object_new_int64(after.usage.ru_minflt - before.usage.ru_minflt));
+  json_object_object_add(
+      run, "major_faults",
+      json_object_new_int64(after.usage.ru_majflt - before.usage.ru_majflt));
+  json_object_object_add(
+      run, "blocks_in",
+      json_object_new_int64(after.usage.ru_inblock - before.usage.ru_inblock));
+  return run;
+}
+
+static void bench_silent_print(const gchar *string) {
+  (void)string;
+}
+
+/* The given work directory, or a new temporary one */
+static gchar *bench_work_dir(const gchar *dir, gboolean *temp_dir) {
+  gchar *work_dir = NULL;
+  *temp_dir = FALSE;
+  if (dir) {
+    work_dir = g_strdup(dir);
+    g_mkdir_with_parents(work_dir, 0755);
+  } else {
+    work_dir = g_dir_make_tmp("reelvault-bench-XXXXXX", NULL);
+    *temp_dir = TRUE;
+  }
+  if (!work_dir || !g_file_test(work_dir, G_FILE_TEST_IS_DIR)) {
+    g_printerr("Cannot create a benchmark directory\n");
+    g_free(work_dir);
+    return NULL;
+  }
+  return work_dir;
+}
+
+int bench_scan(ReelApp *app, const BenchScanOptions *opts) {
+  gboolean temp_dir = FALSE;
+  gchar *work_dir = bench_work_dir(opts->dir, &temp_dir);
+  if (!work_dir)
+    return CLI_EXIT_FAILURE;
+
+  gchar *root = g_build_filename(work_dir, "library", NULL);
+  gchar *db_path = g_build_filename(work_dir, "bench.db", NULL);
+
+  /* "Added: ..." lines for every file would dominate the timings. */
+  GPrintFunc old_print = g_set_print_handler(bench_silent_print);
+
+  json_object *report = json_object_new_object();
+  json_object_object_add(report, "benchmark", json_object_new_string("scan"));
+  json_object_object_add(report, "dir", json_object_new_string(work_dir));
+
+  /* Makes the scanner treat the tree as a network share */
+  if (opts->io_delay_ms > 0) {
+    gchar *delay = g_strdup_printf("%d", opts->io_delay_ms);
+    g_setenv("REELVAULT_SCAN_IO_DELAY_MS", delay, TRUE);
+    g_free(delay);
+    json_object_object_add(report, "io_delay_ms",
+                           json_object_new_int(opts->io_delay_ms));
+  }
+
+  int status = CLI_EXIT_OK;
+  gboolean generated = !g_file_test(root, G_FILE_TEST_IS_DIR);
+  gint files = 0;
+  gint dirs = 0;
+
+  if (generated) {
+    BenchGen gen = {0};
+    gen.rand = g_rand_new_with_seed(opts->seed);
+    gen.target = opts->files;
+
+    gint64 t0 = g_get_monotonic_time();
+    if (!bench_generate(&gen, root))
+      status = CLI_EXIT_FAILURE;
+    gint64 gen_ms = (g_get_monotonic_time() - t0) / 1000;
+
+    files = gen.files;
+    dirs = gen.dirs;
+    json_object_object_add(report, "seed", json_object_new_int64(opts->seed));
+    json_object_object_add(report, "videos", json_object_new_int(gen.videos));
+    json_object_object_add(report, "generate_ms",
+                           json_object_new_int64(gen_ms));
+    g_rand_free(gen.rand);
+  } else {
+    bench_walk_tree(root, &files, &dirs, FALSE);
+  }
+  json_object_object_add(report, "generated",
+                         json_object_new_boolean(generated));
+  json_object_object_add(report, "files", json_object_new_int(files));
+  json_object_object_add(report, "dirs", json_object_new_int(dirs));
+
+  if (status == CLI_EXIT_OK) {
+    /* Always start from an empty database so the first run inserts
+       everything. The cold and warm runs are then both pure rescans, so
+       they differ only in the page cache. */
+    g_unlink(db_path);
+    g_free(app->db_path);
+    app->db_path = g_strdup(db_path);
+
+    if (db_init(app)) {
+      json_object *runs = json_object_new_array();
+      json_object_array_add(runs,
+                            bench_run(app, "initial", root, files, FALSE));
+      json_object_array_add(runs, bench_run(app, "cold", root, files, TRUE));
+      json_object_array_add(runs, bench_run(app, "warm", root, files, FALSE));
+      json_object_object_add(report, "runs", runs);
+      db_close(app);
+    } else {
+      g_printerr("Cannot create benchmark database %s\n", db_path);
+      status = CLI_EXIT_FAILURE;
+    }
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  json_object_object_add(report, "peak_rss_kb",
+                         json_object_new_int64(usage.ru_maxrss));
+
+  g_set_print_handler(old_print);
+
+  if (status == CLI_EXIT_OK) {
+    fputs(json_object_to_json_string_ext(report, JSON_C_TO_STRING_PLAIN),
+          stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+  }
+  json_object_put(report);
+
+  if (!opts->keep) {
+    gint unused_files = 0, unused_dirs = 0;
+    g_unlink(db_path);
+    if (generated) {
+      bench_walk_tree(root, &unused_files, &unused_dirs, TRUE);
+      g_rmdir(root);
+    }
+    if (temp_dir)
+      g_rmdir(work_dir);
+  }
+
+  g_free(db_path);
+  g_free(root);
+  g_free(work_dir);
+  return status;
+}
+
+/* Scraping */
+
+typedef struct {
+  GMainLoop *loop;
+  gint looked_up;
+} BenchScrapeRun;
+
+static void bench_scrape_progress(ReelApp *app, gint done, gint total,
+                                  const gchar *title, gpointer user_data) {
+  (void)app;
+  (void)total;
+  (void)title;
+  ((BenchScrapeRun *)user_data)->looked_up = done;
+}
+
+static void bench_scrape_done(ReelApp *app, gboolean canceled,
+                              gpointer user_data) {
+  (void)app;
+  (void)canceled;
+  g_main_loop_quit(((BenchScrapeRun *)user_data)->loop);
+}
+
+/* FALSE if the scraper would not start */
+static gboolean bench_scrape_run(ReelApp *app, TmdbMock *mock,
+                                 const BenchScrapeOptions *opts,
+                                 json_object *report) {
+  gint queued = db_films_count_unmatched(app);
+  ScraperNetStats before, after;
+  scraper_net_stats(&before);
+
+  g_setenv("REELVAULT_TMDB_API_BASE", tmdb_mock_api_base(mock), TRUE);
+  g_setenv("REELVAULT_TMDB_IMAGE_BASE", tmdb_mock_image_base(mock), TRUE);
+  BenchScrapeRun run = {g_main_loop_new(NULL, FALSE), 0};
+  gint64 t0 = g_get_monotonic_time();
+  gboolean started = scraper_start_background_with_progress(
+      app, bench_scrape_progress, bench_scrape_done, &run);
+  if (started)
+    g_main_loop_run(run.loop);
+  gint64 wall_us = MAX(g_get_monotonic_time() - t0, 1);
+  g_main_loop_unref(run.loop);
+  g_unsetenv("REELVAULT_TMDB_API_BASE");
+  g_unsetenv("REELVAULT_TMDB_IMAGE_BASE");
+  if (!started)
+    return FALSE;
+
+  scraper_net_stats(&after);
+  gint unmatched = db_films_count_unmatched(app);
+  TmdbMockStats served;
+  tmdb_mock_stats(mock, &served);
+
+  json_object_object_add(report, "concurrency",
+                         json_object_new_int(opts->concurrency));
+  json_object_object_add(report, "rate", json_object_new_int(opts->rate));
+  json_object_object_add(report, "latency_ms",
+                         json_object_new_int(opts->mock.latency_ms));
+  json_object_object_add(report, "error_percent",
+                         json_object_new_int(opts->mock.error_percent));
+  json_object_object_add(report, "throttle_percent",
+                         json_object_new_int(opts->mock.throttle_percent));
+  json_object_object_add(report, "miss_percent",
+                         json_object_new_int(opts->mock.miss_percent));
+  json_object_object_add(report, "queued", json_object_new_int(queued));
+  json_object_object_add(report, "looked_up",
+                         json_object_new_int(run.looked_up));
+  json_object_object_add(report, "matched",
+                         json_object_new_int(MAX(queued - unmatched, 0)));
+  json_object_object_add(report, "unmatched", json_object_new_int(unmatched));
+  json_object_object_add(report, "elapsed_ms",
+                         json_object_new_int64(wall_us / 1000));
+  json_object_object_add(
+      report, "films_per_minute",
+      json_object_new_double(run.looked_up * 60e6 / (gdouble)wall_us));
+  json_object_object_add(
+      report, "requests",
+      json_object_new_int(after.requests - before.requests));
+  json_object_object_add(
+      report, "connections",
+      json_object_new_int(after.connections - before.connections));
+
+  json_object *server = json_object_new_object();
+  json_object_object_add(server, "requests",
+                         json_object_new_int(served.requests));
+  json_object_object_add(server, "images", json_object_new_int(served.images));
+  json_object_object_add(server, "errors", json_object_new_int(served.errors));
+  json_object_object_add(server, "throttled",
+                         json_object_new_int(served.throttled));
+  json_object_object_add(server, "not_modified",
+                         json_object_new_int(served.not_modified));
+  json_object_object_add(server, "recorded",
+                         json_object_new_int(served.recorded));
+  json_object_object_add(report, "server", server);
+  return TRUE;
+}
+
+int bench_scrape(ReelApp *app, const BenchScrapeOptions *opts) {
+  gboolean temp_dir = FALSE;
+  gchar *work_dir = bench_work_dir(opts->dir, &temp_dir);
+  if (!work_dir)
+    return CLI_EXIT_FAILURE;
+
+  gchar *root = g_build_filename(work_dir, "library", NULL);
+  gchar *db_path = g_build_filename(work_dir, "bench-scrape.db", NULL);
+  gchar *cache = g_build_filename(work_dir, "cache", NULL);
+  gchar *posters = g_build_filename(cache, "posters", NULL);
+
+  /* The scraper logs every film */
+  GPrintFunc old_print = g_set_print_handler(bench_silent_print);
+
+  json_object *report = json_object_new_object();
+  json_object_object_add(report, "benchmark", json_object_new_string("scrape"));
+  json_object_object_add(report, "dir", json_object_new_string(work_dir));
+
+  int status = CLI_EXIT_OK;
+  gboolean generated = !g_file_test(root, G_FILE_TEST_IS_DIR);
+  if (generated) {
+    BenchGen gen = {0};
+    gen.rand = g_rand_new_with_seed(opts->seed);
+    gen.target = opts->files;
+    if (!bench_generate(&gen, root))
+      status = CLI_EXIT_FAILURE;
+    json_object_object_add(report, "seed", json_object_new_int64(opts->seed));
+    json_object_object_add(report, "videos", json_object_new_int(gen.videos));
+    g_rand_free(gen.rand);
+  }
+  json_object_object_add(report, "generated",
+                         json_object_new_boolean(generated));
+
+  /* A fresh database and caches, so every entry goes over the wire */
+  gint unused_files = 0, unused_dirs = 0;
+  g_unlink(db_path);
+  bench_walk_tree(cache, &unused_files, &unused_dirs, TRUE);
+  g_mkdir_with_parents(posters, 0755);
+  g_free(app->db_path);
+  app->db_path = g_strdup(db_path);
+  g_free(app->cache_path);
+  app->cache_path = g_strdup(cache);
+  g_free(app->poster_cache_path);
+  app->poster_cache_path = g_strdup(posters);
+  g_free(app->tmdb_api_key);
+  app->tmdb_api_key = g_strdup("bench");
+  app->scrape_concurrency = opts->concurrency;
+  app->scrape_rate = opts->rate;
+
+  gboolean opened = status == CLI_EXIT_OK && db_init(app);
+  TmdbMock *mock = NULL;
+  if (status == CLI_EXIT_OK && !opened) {
+    g_printerr("Cannot create benchmark database %s\n", db_path);
+    status = CLI_EXIT_FAILURE;
+  }
+  if (status == CLI_EXIT_OK) {
+    gint64 t0 = g_get_monotonic_time();
+    scanner_scan_directory(app, root);
+    json_object_object_add(
+        report, "scan_ms",
+        json_object_new_int64((g_get_monotonic_time() - t0) / 1000));
+    mock = tmdb_mock_start(&opts->mock);
+    if (!mock)
+      status = CLI_EXIT_FAILURE;
+  }
+  if (status == CLI_EXIT_OK && !bench_scrape_run(app, mock, opts, report)) {
+    g_printerr("The scraper is already running\n");
+    status = CLI_EXIT_FAILURE;
+  }
+
+  tmdb_mock_stop(mock);
+  if (opened)
+    db_close(app);
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  json_object_object_add(report, "peak_rss_kb",
+                         json_object_new_int64(usage.ru_maxrss));
+
+  g_set_print_handler(old_print);
+
+  if (status == CLI_EXIT_OK) {
+    fputs(json_object_to_json_string_ext(report, JSON_C_TO_STRING_PLAIN),
+          stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+  }
+  json_object_put(report);
+
+  if (!opts->keep) {
+    g_unlink(db_path);
+    bench_walk_tree(cache, &unused_files, &unused_dirs, TRUE);
+    g_rmdir(cache);
+    if (generated) {
+      bench_walk_tree(root, &unused_files, &unused_dirs, TRUE);
+      g_rmdir(root);
+    }
+    if (temp_dir)
+      g_rmdir(work_dir);
+  }
+
+  g_free(posters);
+  g_free(cache);
+  g_free(db_path);
+  g_free(root);
+  g_free(work_dir);
+  return status;
+}
+
+/* Release names and the title they must normalize to. Several of these
+   contain a tag inside an ordinary word ("Havoc", "Climax", "Atmosphere"),
+   which the old substring search cut short. */
+static const struct {
+  const gchar *raw;
+  const gchar *expected;
+} NORMALIZE_GOLDEN[] = {
+    {"Havoc", "Havoc"},
+    {"The.Binding.of.Isaac", "The Binding Of Isaac"},
+    {"Climax", "Climax"},
+    {"Improper.Channels", "Improper Channels"},
+    {"The.Property", "The Property"},
+    {"Atmosphere", "Atmosphere"},
+    {"Movie.Name.1080p.BluRay.x264-GROUP", "Movie Name"},
+    {"Another_Movie_720p_WEB-DL", "Another Movie"},
+    {"Film Title [1080p]", "Film Title"},
+    {"Some.Film.REMUX.2160p.UHD", "Some Film"},
+    {"Some.Film.Directors.Cut.1080p", "Some Film"},
+    {"Heat.EXTENDED.720p", "Heat"},
+    {"Dune.Part.Two.2160p.WEB-DL.DDP5.1.Atmos.DV.HDR.H.265-FLUX", "Dune Part Two"},
+    {"Blue.Ruin.BRRip.XviD", "Blue Ruin"},
+    {"Top.Gun.Maverick.IMAX.2160p", "Top Gun Maverick"},
+    {"Scanners.HEVC", "Scanners"},
+    {"Whiplash.YIFY", "Whiplash"},
+    {"Mad.Max.Fury.Road.4K.HDR", "Mad Max Fury Road"},
+    {"Revenge.of.the.Nerds.UNRATED.DVDRip", "Revenge Of The Nerds"},
+    {"Vhs.Proper", "Vhs"},
+    {"Chaac.Legend", "Chaac Legend"},
+    {"WALL-E.720p", "WALL-E"},
+    {"Spider-Man.Far.From.Home.1080p", "Spider-Man Far From Home"},
+    {"Film (Blu-Ray)", "Film"},
+    {"Show.Name.S01E02.720p.HDTV.x264", "Show Name S01E02"},
+    {"aacx avc", "Aacx"},
+};
+
+/* The substring search utils_normalize_title() used before the tag
+   automaton, kept to compare against */
+static gchar *bench_normalize_legacy(const gchar *const *tags,
+                                     const gchar *raw) {
+  gchar *result = g_strdup(raw);
+  for (gchar *p = result; *p; p++) {
+    if (*p == '.' || *p == '_')
+      *p = ' ';
+  }
+
+  gchar *lower = g_ascii_strdown(result, -1);
+  for (gint i = 0; tags[i] != NULL; i++) {
+    gchar *pos = strstr(lower, tags[i]);
+    if (pos) {
+      gsize offset = pos - lower;
+      result[offset] = '\0';
+      lower[offset] = '\0';
+    }
+  }
+  g_free(lower);
+
+  g_strstrip(result);
+  gsize len = strlen(result);
+  while (len > 0 && (result[len - 1] == '-' || result[len - 1] == ' '))
+    result[--len] = '\0';
+
+  gboolean cap_next = TRUE;
+  for (gchar *p = result; *p; p++) {
+    if (cap_next && *p >= 'a' && *p <= 'z')
+      *p = *p - 'a' + 'A';
+    cap_next = (*p == ' ');
+  }
+  return result;
+}
+
+/* Titles per second over names, and a checksum of the output lengths so
+   the work cannot be optimized away */
+static gdouble bench_normalize_rate(const UtilsTagMatcher *matcher,
+                                    const gchar *const *tags, GPtrArray *names,
+                                    gsize *checksum) {
+  gint64 t0 = g_get_monotonic_time();
+  for (guint i = 0; i < names->len; i++) {
+    const gchar *raw = g_ptr_array_index(names, i);
+    gchar *title = matcher ? utils_normalize_title_with(matcher, raw)
+                           : bench_normalize_legacy(tags, raw);
+    *checksum += strlen(title);
+    g_free(title);
+  }
+  gint64 elapsed = MAX(g_get_monotonic_time() - t0, 1);
+  return names->len * (G_USEC_PER_SEC / (gdouble)elapsed);
+}
+
+int bench_normalize(gint titles, guint32 seed) {
+  const gchar *const *tags = utils_default_strip_tags();
+  UtilsTagMatcher *matcher = utils_tag_matcher_new(tags);
+
+  json_object *report = json_object_new_object();
+  json_object_object_add(report, "benchmark",
+                         json_object_new_string("normalize"));
+
+  /* Correctness first: every golden case must pass */
+  json_object *failures = json_object_new_array();
+  gint legacy_wrong = 0;
+  for (gsize i = 0; i < G_N_ELEMENTS(NORMALIZE_GOLDEN); i++) {
+    gchar *title = utils_normalize_title_with(matcher, NORMALIZE_GOLDEN[i].raw);
+    if (g_strcmp0(title, NORMALIZE_GOLDEN[i].expected) != 0) {
+      json_object *failure = json_object_new_object();
+      json_object_object_add(failure, "raw",
+                             json_object_new_string(NORMALIZE_GOLDEN[i].raw));
+      json_object_object_add(
+          failure, "expected",
+          json_object_new_string(NORMALIZE_GOLDEN[i].expected));
+      json_object_object_add(failure, "got", json_object_new_string(title));
+      json_object_array_add(failures, failure);
+    }
+    g_free(title);
+
+    gchar *legacy = bench_normalize_legacy(tags, NORMALIZE_GOLDEN[i].raw);
+    if (g_strcmp0(legacy, NORMALIZE_GOLDEN[i].expected) != 0)
+      legacy_wrong++;
+    g_free(legacy);
+  }
+  gint failed = (gint)json_object_array_length(failures);
+  json_object_object_add(report, "golden",
+                         json_object_new_int(G_N_ELEMENTS(NORMALIZE_GOLDEN)));
+  json_object_object_add(report, "golden_failures", failures);
+  json_object_object_add(report, "legacy_wrong",
+                         json_object_new_int(legacy_wrong));
+
+  /* Throughput on generated release names */
+  BenchGen gen = {0};
+  gen.rand = g_rand_new_with_seed(seed);
+  GPtrArray *names = g_ptr_array_new_with_free_func(g_free);
+  for (gint i = 0; i < titles; i++)
+    g_ptr_array_add(names,
+                    bench_film_name(&gen, g_rand_int_range(gen.rand, 1950, 2026)));
+  g_rand_free(gen.rand);
+
+  gsize checksum = 0;
+  gdouble legacy_rate = bench_normalize_rate(NULL, tags, names, &checksum);
+  gdouble rate = bench_normalize_rate(matcher, tags, names, &checksum);
+
+  json_object_object_add(report, "seed", json_object_new_int64(seed));
+  json_object_object_add(report, "titles", json_object_new_int(titles));
+  json_object_object_add(report, "legacy_titles_per_sec",
+                         json_object_new_int64((gint64)legacy_rate));
+  json_object_object_add(report, "titles_per_sec",
+                         json_object_new_int64((gint64)rate));
+  json_object_object_add(report, "checksum", json_object_new_int64(checksum));
+
+  fputs(json_object_to_json_string_ext(report, JSON_C_TO_STRING_PLAIN), stdout);
+  fputc('\n', stdout);
+  fflush(stdout);
+
+  json_object_put(report);
+  g_ptr_array_free(names, TRUE);
+  utils_tag_matcher_free(matcher);
+  return failed > 0 ? CLI_EXIT_FAILURE : CLI_EXIT_OK;
+}
+
+/* Replies are fed in pieces of this size, as curl hands them over */
+#define BENCH_JSON_CHUNK (16 * 1024)
+#define BENCH_JSON_MIN_US (50 * 1000)
+#define BENCH_JSON_MAX_RUNS 1000
+
+/* __GLIBC_PREREQ is only defined, and only parses, on glibc */
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 33)
+#define BENCH_HAVE_MALLINFO2 1
+#endif
+#endif
+
+/* Heap in use, or -1 where the C library can't tell */
+static gint64 bench_heap_bytes(void) {
+#ifdef BENCH_HAVE_MALLINFO2
+  struct mallinfo2 info = mallinfo2();
+  return (gint64)info.uordblks;
+#else
+  return -1;
+#endif
+}
+
+/* Values in a parsed tree; each took at least one allocation */
+static gint bench_json_count(struct json_object *value) {
+  gint count = value ? 1 : 0;
+  if (json_object_is_type(value, json_type_object)) {
+    json_object_object_foreach(value, key, member) {
+      (void)key;
+      count += bench_json_count(member);
+    }
+  } else if (json_object_is_type(value, json_type_array)) {
+    size_t len = json_object_array_length(value);
+    for (size_t i = 0; i < len; i++)
+      count += bench_json_count(json_object_array_get_idx(value, i));
+  }
+  return count;
+}
+
+/* The previous way: grow one buffer with every piece, then parse it whole */
+static struct json_object *bench_json_full(const gchar *data, gsize length) {
+  gchar *buf = NULL;
+  gsize size = 0;
+  for (gsize offset = 0; offset < length; offset += BENCH_JSON_CHUNK) {
+    gsize n = MIN(BENCH_JSON_CHUNK, length - offset);
+    buf = g_realloc(buf, size + n + 1);
+    memcpy(buf + size, data + offset, n);
+    size += n;
+    buf[size] = '\0';
+  }
+  struct json_object *root = buf ? json_tokener_parse(buf) : NULL;
+  g_free(buf);
+  return root;
+}
+
+static struct json_object *bench_json_stream(const TmdbJsonSchema *schema,
+                                             const gchar *data, gsize length,
+                                             TmdbJsonStats *stats) {
+  TmdbJsonParser *parser = tmdb_json_parser_new(schema);
+  for (gsize offset = 0; offset < length; offset += BENCH_JSON_CHUNK)
+    tmdb_json_parser_feed(parser, data + offset,
+                          MIN(BENCH_JSON_CHUNK, length - offset));
+  struct json_object *root = tmdb_json_parser_finish(parser, stats);
+  tmdb_json_parser_free(parser);
+  return root;
+}
+
+/* Parse a reply one way (schema NULL for the full parse): once to see what
+   the result holds on to, then repeatedly for the time */
+static json_object *bench_json_measure(const TmdbJsonSchema *schema,
+                                       gboolean stream, const gchar *data,
+                                       gsize length, gboolean *parsed) {
+  TmdbJsonStats stats = {0};
+  gint64 heap = bench_heap_bytes();
+  struct json_object *root =
+      stream ? bench_json_stream(schema, data, length, &stats)
+             : bench_json_full(data, length);
+  gint64 retained = heap >= 0 ? bench_heap_bytes() - heap : -1;
+  gint objects = stream ? stats.values : bench_json_count(root);
+  *parsed = root != NULL;
+  if (root)
+    json_object_put(root);
+
+  gint runs = 0;
+  gint64 t0 = g_get_monotonic_time();
+  gint64 elapsed;
+  do {
+    root = stream ? bench_json_stream(schema, data, length, NULL)
+                  : bench_json_full(data, length);
+    if (root)
+      json_object_put(root);
+    runs++;
+    elapsed = g_get_monotonic_time() - t0;
+  } while (elapsed < BENCH_JSON_MIN_US && runs < BENCH_JSON_MAX_RUNS);
+
+  json_object *report = json_object_new_object();
+  json_object_object_add(report, "objects", json_object_new_int(objects));
+  if (stream)
+    json_object_object_add(report, "skipped",
+                           json_object_new_int(stats.skipped));
+  json_object_object_add(report, "retained_bytes",
+                         json_object_new_int64(retained));
+  json_object_object_add(report, "parse_us",
+                         json_object_new_double((gdouble)elapsed / runs));
+  return report;
+}
+
+static gint bench_json_compare_names(gconstpointer a, gconstpointer b) {
+  return strcmp(*(const gchar *const *)a, *(const gchar *const *)b);
+}
+
+int bench_json(const gchar *dir_path) {
+  GDir *dir = g_dir_open(dir_path, 0, NULL);
+  if (!dir) {
+    g_printerr("Cannot open %s\n", dir_path);
+    return CLI_EXIT_USAGE;
+  }
+  GPtrArray *names = g_ptr_array_new_with_free_func(g_free);
+  const gchar *name;
+  while ((name = g_dir_read_name(dir)))
+    if (g_str_has_suffix(name, ".json"))
+      g_ptr_array_add(names, g_strdup(name));
+  g_dir_close(dir);
+  g_ptr_array_sort(names, bench_json_compare_names);
+
+  json_object *report = json_object_new_object();
+  json_object_object_add(report, "benchmark", json_object_new_string("json"));
+  json_object_object_add(report, "chunk_bytes",
+                         json_object_new_int(BENCH_JSON_CHUNK));
+  json_object *responses = json_object_new_array();
+  gint failed = 0;
+
+  for (guint i = 0; i < names->len; i++) {
+    name = g_ptr_array_index(names, i);
+    gchar *path = g_build_filename(dir_path, name, NULL);
+    gchar *data = NULL;
+    gsize length = 0;
+    if (!g_file_get_contents(path, &data, &length, NULL)) {
+      g_printerr("Cannot read %s\n", path);
+      g_free(path);
+      failed++;
+      continue;
+    }
+    g_free(path);
+
+    /* The name says which reply it is: "movie-550.json", "tv-1399.json",
+       "search-alien.json" */
+    gchar *endpoint =
+        g_strdup_printf("/%.*s/", (int)strcspn(name, "-_."), name);
+    const TmdbJsonSchema *schema = tmdb_json_schema_for_url(endpoint);
+    g_free(endpoint);
+
+    gboolean full_ok, stream_ok;
+    json_object *response = json_object_new_object();
+    json_object_object_add(response, "name", json_object_new_string(name));
+    json_object_object_add(response, "bytes", json_object_new_int64(length));
+    json_object_object_add(response, "schema",
+                           json_object_new_boolean(schema != NULL));
+    json_object_object_add(
+        response, "full",
+        bench_json_measure(NULL, FALSE, data, length, &full_ok));
+    json_object_object_add(
+        response, "streaming",
+        bench_json_measure(schema, TRUE, data, length, &stream_ok));
+    json_object_array_add(responses, response);
+    if (full_ok != stream_ok)
+      failed++;
+    g_free(data);
+  }
+
+  json_object_object_add(report, "responses", responses);
+  json_object_object_add(report, "failures", json_object_new_int(failed));
+  fputs(json_object_to_json_string_ext(report, JSON_C_TO_STRING_PLAIN), stdout);
+  fputc('\n', stdout);
+  fflush(stdout);
+
+  json_object_put(report);
+  gboolean empty = names->len == 0;
+  g_ptr_array_free(names, TRUE);
+  if (empty)
+    g_printerr("No .json replies in %s\n", dir_path);
+  return failed > 0 || empty ? CLI_EXIT_FAILURE : CLI_EXIT_OK;
+}
+
+/* Thumbnails */
+
+#define BENCH_THUMBS_MAX 500
+#define BENCH_THUMBS_MIN_US (1000 * 1000)
+
+typedef enum {
+  BENCH_THUMB_LEGACY_DECODE,
+  BENCH_THUMB_DECODE,
+  BENCH_THUMB_LEGACY_ENCODE,
+  BENCH_THUMB_ENCODE
+} BenchThumbStep;
+
+/* The thumb size a poster is scaled to fit */
+static void bench_thumb_size(GdkPixbuf *full, gint *width, gint *height) {
+  gint ow = gdk_pixbuf_get_width(full);
+  gint oh = gdk_pixbuf_get_height(full);
+  gdouble s = MIN((gdouble)POSTER_THUMB_WIDTH / ow,
+                  (gdouble)POSTER_THUMB_HEIGHT / oh);
+  *width = MAX((gint)(ow * s + 0.5), 1);
+  *height = MAX((gint)(oh * s + 0.5), 1);
+}
+
+/* One step of making a thumb; returns FALSE if it failed. The legacy steps
+   are what the scraper did before: decode at full size with the accurate
+   DCT and scale, then encode with gdk-pixbuf. */
+static gboolean bench_thumb_step(BenchThumbStep step, GBytes *poster,
+                                 GdkPixbuf *thumb, gsize *bytes) {
+  gsize length = 0;
+  const guchar *data = g_bytes_get_data(poster, &length);
+  GdkPixbuf *pixbuf = NULL;
+  gchar *jpeg = NULL;
+  gboolean ok = FALSE;
+
+  switch (step) {
+  case BENCH_THUMB_LEGACY_DECODE: {
+    GdkPixbuf *full =
+        utils_pixbuf_new_from_data_at_scale(data, length, 0, 0, TRUE, NULL);
+    if (full) {
+      gint width, height;
+      bench_thumb_size(full, &width, &height);
+      pixbuf = gdk_pixbuf_scale_simple(full, width, height,
+                                       GDK_INTERP_BILINEAR);
+      g_object_unref(full);
+    }
+    break;
+  }
+  case BENCH_THUMB_DECODE:
+    pixbuf = utils_pixbuf_new_from_data_at_scale(
+        data, length, POSTER_THUMB_WIDTH, POSTER_THUMB_HEIGHT, TRUE, NULL);
+    break;
+  case BENCH_THUMB_LEGACY_ENCODE:
+    ok = gdk_pixbuf_save_to_buffer(thumb, &jpeg, &length, "jpeg", NULL,
+                                   "quality", "85", NULL);
+    break;
+  case BENCH_THUMB_ENCODE:
+    ok = utils_pixbuf_save_jpeg_to_buffer(thumb, 85, &jpeg, &length, NULL);
+    break;
+  }
+
+  if (pixbuf) {
+    ok = TRUE;
+    g_object_unref(pixbuf);
+  }
+  if (jpeg && bytes)
+    *bytes += length;
+  g_free(jpeg);
+  return ok;
+}
+
+/* Run a step over every poster until a second has passed; returns the
+   rate per second */
+static gdouble bench_thumb_rate(BenchThumbStep step, GPtrArray *posters,
+                                GPtrArray *thumbs, gint *failed,
+                                gsize *bytes) {
+  gint64 runs = 0;
+  gint64 t0 = g_get_monotonic_time();
+  gint64 elapsed;
+  gboolean first = TRUE;
+  do {
+    for (guint i = 0; i < posters->len; i++) {
+      gboolean ok = bench_thumb_step(step, g_ptr_array_index(posters, i),
+                                     g_ptr_array_index(thumbs, i),
+                                     first ? bytes : NULL);
+      if (first && !ok)
+        (*failed)++;
+      runs++;
+    }
+    first = FALSE;
+    elapsed = g_get_monotonic_time() - t0;
+  } while (elapsed < BENCH_THUMBS_MIN_US);
+  return runs * (G_USEC_PER_SEC / (gdouble)MAX(elapsed, 1));
+}
+
+int bench_thumbs(const gchar *dir_path) {
+  GDir *dir = g_dir_open(dir_path, 0, NULL);
+  if (!dir) {
+    g_printerr("Cannot open %s\n", dir_path);
+    return CLI_EXIT_USAGE;
+  }
+
+  /* Posters are read up front so only decoding and encoding are timed */
+  GPtrArray *posters = g_ptr_array_new_with_free_func(
+      (GDestroyNotify)g_bytes_unref);
+  GPtrArray *thumbs = g_ptr_array_new_with_free_func(g_object_unref);
+  const gchar *name;
+  while ((name = g_dir_read_name(dir)) && posters->len < BENCH_THUMBS_MAX) {
+    if (!g_str_has_suffix(name, ".jpg") || g_str_has_suffix(name, "_thumb.jpg"))
+      continue;
+    gchar *path = g_build_filename(dir_path, name, NULL);
+    gchar *data = NULL;
+    gsize length = 0;
+    if (g_file_get_contents(path, &data, &length, NULL)) {
+      GdkPixbuf *thumb = utils_pixbuf_new_from_data_at_scale(
+          (const guchar *)data, length, POSTER_THUMB_WIDTH,
+          POSTER_THUMB_HEIGHT, TRUE, NULL);
+      if (thumb) {
+        g_ptr_array_add(posters, g_bytes_new_take(data, length));
+        g_ptr_array_add(thumbs, thumb);
+        data = NULL;
+      }
+    }
+    g_free(data);
+    g_free(path);
+  }
+  g_dir_close(dir);
+
+  if (posters->len == 0) {
+    g_printerr("No JPEG posters in %s\n", dir_path);
+    g_ptr_array_free(posters, TRUE);
+    g_ptr_array_free(thumbs, TRUE);
+    return CLI_EXIT_FAILURE;
+  }
+
+  gint failed = 0;
+  gsize legacy_bytes = 0;
+  gsize bytes = 0;
+  gdouble legacy_decode = bench_thumb_rate(BENCH_THUMB_LEGACY_DECODE, posters,
+                                           thumbs, &failed, NULL);
+  gdouble decode =
+      bench_thumb_rate(BENCH_THUMB_DECODE, posters, thumbs, &failed, NULL);
+  gdouble legacy_encode = bench_thumb_rate(BENCH_THUMB_LEGACY_ENCODE, posters,
+                                           thumbs, &failed, &legacy_bytes);
+  gdouble encode = bench_thumb_rate(BENCH_THUMB_ENCODE, posters, thumbs,
+                                    &failed, &bytes);
+
+  json_object *report = json_object_new_object();
+  json_object_object_add(report, "benchmark",
+                         json_object_new_string("thumbs"));
+  json_object_object_add(report, "posters", json_object_new_int(posters->len));
+  json_object_object_add(report, "thumb_width",
+                         json_object_new_int(POSTER_THUMB_WIDTH));
+  json_object_object_add(report, "thumb_height",
+                         json_object_new_int(POSTER_THUMB_HEIGHT));
+  json_object_object_add(report, "legacy_decodes_per_sec",
+                         json_object_new_int64((gint64)legacy_decode));
+  json_object_object_add(report, "decodes_per_sec",
+                         json_object_new_int64((gint64)decode));
+  json_object_object_add(report, "legacy_encodes_per_sec",
+                         json_object_new_int64((gint64)legacy_encode));
+  json_object_object_add(report, "encodes_per_sec",
+                         json_object_new_int64((gint64)encode));
+  json_object_object_add(
+      report, "legacy_thumb_bytes",
+      json_object_new_int64((gint64)(legacy_bytes / posters->len)));
+  json_object_object_add(report, "thumb_bytes",
+                         json_object_new_int64((gint64)(bytes / posters->len)));
+  json_object_object_add(report, "failures", json_object_new_int(failed));
+
+  fputs(json_object_to_json_string_ext(report, JSON_C_TO_STRING_PLAIN), stdout);
+  fputc('\n', stdout);
+  fflush(stdout);
+
+  json_object_put(report);
+  g_ptr_array_free(posters, TRUE);
+  g_ptr_array_free(thumbs, TRUE);
+  return failed > 0 ? CLI_EXIT_FAILURE : CLI_EXIT_OK;
+}
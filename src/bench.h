@@ -0,0 +1,57 @@
+#ifndef REELGTK_BENCH_H
+#define REELGTK_BENCH_H
+
+#include "app.h"
+#include "tmdbmock.h"
+
+/* The benchmarks are only built into reelvault-bench (make bench), with
+   REELVAULT_BENCH defined; the installed binary has none of them */
+
+typedef struct {
+  gint files;        /* Files to generate, videos and extras together */
+  guint32 seed;      /* Same seed, same tree */
+  const gchar *dir;  /* Work directory; a temporary one when NULL */
+  gboolean keep;     /* Leave the tree and database behind */
+  gint io_delay_ms;  /* Added to each scanner I/O call, like a slow share */
+} BenchScanOptions;
+
+/* Generate a synthetic library, scan it into a scratch database with cold
+   and then warm caches, and print one JSON report line on stdout. An
+   existing tree in opts->dir is reused so runs can be compared. Returns a
+   CLI_EXIT_* code. */
+int bench_scan(ReelApp *app, const BenchScanOptions *opts);
+
+typedef struct {
+  gint files;            /* As for the scan benchmark */
+  guint32 seed;
+  const gchar *dir;
+  gboolean keep;
+  gint concurrency;      /* TMDB transfers in flight, as in the config */
+  gint rate;             /* API requests per second, 0 for no limit */
+  TmdbMockOptions mock;  /* Latency, failures and recorded replies */
+} BenchScrapeOptions;
+
+/* Generate a synthetic library, scan it into a scratch database and
+   scrape it against the mock TMDB server, then print one JSON report line
+   with films per minute and what the server saw. Returns a CLI_EXIT_*
+   code. */
+int bench_scrape(ReelApp *app, const BenchScrapeOptions *opts);
+
+/* Check utils_normalize_title() against a built-in corpus of release names
+   and compare its speed with the old substring search on generated names.
+   Prints one JSON report line; fails if any corpus entry is wrong. */
+int bench_normalize(gint titles, guint32 seed);
+
+/* Parse each TMDB reply saved in dir (named after its endpoint, e.g.
+   "movie-550.json") the old way, whole with json-c, and with the streaming
+   parser the scraper uses. Prints one JSON report line with the objects
+   built, heap retained and parse time of each. */
+int bench_json(const gchar *dir);
+
+/* Make thumbnails of the JPEG posters in dir on one thread, the old way
+   (full-size decode, gdk-pixbuf encoder) and the current one (reduced DCT
+   decode, libjpeg-turbo encoder). Prints one JSON report line with the
+   decodes and encodes per second of each. */
+int bench_thumbs(const gchar *dir);
+
+#endif /* REELGTK_BENCH_H */
@@ -0,0 +1,795 @@
+/*
+ * ReelGTK - Headless Commands
+ * Scan, scrape and query the library without a display (cron, NAS boxes)
+ */
+
+#include "cli.h"
+#ifdef REELVAULT_BENCH
+#include "bench.h"
+#endif
+#include "config.h"
+#include "db.h"
+#include "filter.h"
+#include "scanner.h"
+#include "scraper.h"
+#include "titleindex.h"
+#include "tmdbcache.h"
+#ifdef REELVAULT_BENCH
+#include "tmdbmock.h"
+#endif
+#include <glib-unix.h>
+#include <json-c/json.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+  ReelApp *app;
+  GMainLoop *loop;
+  const gchar *command; /* Command currently running */
+  gint64 started;       /* Monotonic start of that command */
+  ScanJob *scan_job;
+  gboolean scraping;
+  gboolean interrupted;
+
+  /* Results reported by the background jobs */
+  gint added;
+  gint removed;
+  gint looked_up; /* Films the scraper searched for */
+  gboolean canceled;
+  gchar **offline; /* Roots the scan could not read */
+} CliContext;
+
+static const gchar *CLI_COMMANDS[] = {
+    "--scan", "--scrape", "--stats", "--query", "--import-titles",
+#ifdef REELVAULT_BENCH
+    "--bench-scan", "--bench-normalize", "--bench-json", "--bench-thumbs",
+    "--bench-scrape", "--mock-tmdb",
+#endif
+    NULL};
+
+gboolean cli_is_headless(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    for (int c = 0; CLI_COMMANDS[c] != NULL; c++) {
+      gsize len = strlen(CLI_COMMANDS[c]);
+      if (strncmp(argv[i], CLI_COMMANDS[c], len) == 0 &&
+          (argv[i][len] == '\0' || argv[i][len] == '='))
+        return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/* Keep stdout for JSON: everything printed with g_print goes to stderr */
+static void cli_print_handler(const gchar *string) {
+  fputs(string, stderr);
+}
+
+static void cli_begin(CliContext *ctx, const gchar *command) {
+  ctx->command = command;
+  ctx->started = g_get_monotonic_time();
+  ctx->added = 0;
+  ctx->removed = 0;
+  ctx->canceled = FALSE;
+}
+
+static json_object *cli_event_new(CliContext *ctx, const gchar *event) {
+  json_object *obj = json_object_new_object();
+  json_object_object_add(obj, "event", json_object_new_string(event));
+  json_object_object_add(obj, "command", json_object_new_string(ctx->command));
+  return obj;
+}
+
+static void cli_add_elapsed(CliContext *ctx, json_object *obj) {
+  json_object_object_add(
+      obj, "elapsed_ms",
+      json_object_new_int64((g_get_monotonic_time() - ctx->started) / 1000));
+}
+
+/* Print one event as a line on stdout and release it */
+static void cli_emit(json_object *obj) {
+  fputs(json_object_to_json_string_ext(obj, JSON_C_TO_STRING_PLAIN), stdout);
+  fputc('\n', stdout);
+  fflush(stdout);
+  json_object_put(obj);
+}
+
+static void cli_emit_error(CliContext *ctx, const gchar *message) {
+  json_object *obj = cli_event_new(ctx, "error");
+  json_object_object_add(obj, "message", json_object_new_string(message));
+  cli_emit(obj);
+}
+
+static void cli_add_film(json_object *obj, const Film *film) {
+  json_object_object_add(obj, "id", json_object_new_int64(film->id));
+  json_object_object_add(
+      obj, "type",
+      json_object_new_string(film->media_type == MEDIA_TV_SEASON ? "season"
+                                                                 : "film"));
+  json_object_object_add(obj, "title",
+                         json_object_new_string(film->title ? film->title : ""));
+  json_object_object_add(obj, "year", json_object_new_int(film->year));
+  if (film->media_type == MEDIA_TV_SEASON) {
+    json_object_object_add(obj, "season",
+                           json_object_new_int(film->season_number));
+  }
+  json_object_object_add(obj, "path",
+                         json_object_new_string(film->file_path));
+}
+
+static gboolean cli_on_signal(gpointer data) {
+  CliContext *ctx = (CliContext *)data;
+  ctx->interrupted = TRUE;
+  if (ctx->scan_job)
+    scanner_job_cancel(ctx->scan_job);
+  if (ctx->scraping)
+    scraper_stop(ctx->app);
+  return G_SOURCE_CONTINUE;
+}
+
+/* Run the main loop until a background job quits it. SIGINT/SIGTERM cancel
+   the job cleanly instead of killing it mid-transaction. */
+static void cli_run_loop(CliContext *ctx) {
+  guint sigint = g_unix_signal_add(SIGINT, cli_on_signal, ctx);
+  guint sigterm = g_unix_signal_add(SIGTERM, cli_on_signal, ctx);
+  g_main_loop_run(ctx->loop);
+  g_source_remove(sigint);
+  g_source_remove(sigterm);
+}
+
+/* --scan */
+
+static void cli_scan_progress_cb(ReelApp *app, const gchar *current_dir,
+                                 gint dirs_scanned, gint films_found,
+                                 gpointer user_data) {
+  (void)app;
+  CliContext *ctx = (CliContext *)user_data;
+  json_object *obj = cli_event_new(ctx, "progress");
+  json_object_object_add(obj, "dirs", json_object_new_int(dirs_scanned));
+  json_object_object_add(obj, "found", json_object_new_int(films_found));
+  json_object_object_add(obj, "dir",
+                         json_object_new_string(current_dir ? current_dir
+                                                            : ""));
+  cli_add_elapsed(ctx, obj);
+  cli_emit(obj);
+}
+
+static void cli_scan_films_cb(ReelApp *app, GList *films,
+                              gpointer user_data) {
+  (void)app;
+  CliContext *ctx = (CliContext *)user_data;
+  for (GList *l = films; l != NULL; l = l->next) {
+    json_object *obj = cli_event_new(ctx, "added");
+    cli_add_film(obj, (Film *)l->data);
+    cli_emit(obj);
+  }
+  g_list_free_full(films, (GDestroyNotify)film_free);
+}
+
+static void cli_scan_done_cb(ReelApp *app, gint added, gint removed,
+                             gboolean canceled, gpointer user_data) {
+  (void)app;
+  CliContext *ctx = (CliContext *)user_data;
+  g_strfreev(ctx->offline);
+  ctx->offline =
+      g_strdupv((gchar **)scanner_job_offline_roots(ctx->scan_job));
+  ctx->scan_job = NULL;
+  ctx->added = added;
+  ctx->removed = removed;
+  ctx->canceled = canceled;
+  g_main_loop_quit(ctx->loop);
+}
+
+static int cli_scan(CliContext *ctx, gchar **paths, gint paths_count) {
+  cli_begin(ctx, "scan");
+  if (!paths || paths_count <= 0) {
+    cli_emit_error(ctx, "No library paths configured");
+    return CLI_EXIT_CONFIG;
+  }
+
+  ctx->scan_job = scanner_start_background(
+      ctx->app, paths, paths_count, cli_scan_progress_cb, cli_scan_films_cb,
+      cli_scan_done_cb, ctx);
+  if (!ctx->scan_job) {
+    cli_emit_error(ctx, "Could not start the scan");
+    return CLI_EXIT_FAILURE;
+  }
+  cli_run_loop(ctx);
+
+  /* An offline share is reported, not treated as an empty library: the
+     scanner keeps its entries. */
+  int status = CLI_EXIT_OK;
+  for (gint i = 0; ctx->offline && ctx->offline[i]; i++) {
+    json_object *obj = cli_event_new(ctx, "warning");
+    json_object_object_add(obj, "message",
+                           json_object_new_string("Library root unavailable"));
+    json_object_object_add(obj, "path",
+                           json_object_new_string(ctx->offline[i]));
+    cli_emit(obj);
+    status = CLI_EXIT_PARTIAL;
+  }
+  g_strfreev(ctx->offline);
+  ctx->offline = NULL;
+
+  json_object *obj = cli_event_new(ctx, "done");
+  json_object_object_add(obj, "added", json_object_new_int(ctx->added));
+  json_object_object_add(obj, "removed", json_object_new_int(ctx->removed));
+  json_object_object_add(obj, "canceled",
+                         json_object_new_boolean(ctx->canceled));
+  cli_add_elapsed(ctx, obj);
+  cli_emit(obj);
+
+  return ctx->interrupted ? CLI_EXIT_INTERRUPTED : status;
+}
+
+/* --scrape */
+
+static void cli_scrape_progress_cb(ReelApp *app, gint done, gint total,
+                                   const gchar *current_title,
+                                   gpointer user_data) {
+  (void)app;
+  CliContext *ctx = (CliContext *)user_data;
+  ctx->looked_up = done;
+  json_object *obj = cli_event_new(ctx, "progress");
+  json_object_object_add(obj, "done", json_object_new_int(done));
+  json_object_object_add(obj, "total", json_object_new_int(total));
+  json_object_object_add(obj, "title",
+                         json_object_new_string(current_title ? current_title
+                                                              : ""));
+  cli_add_elapsed(ctx, obj);
+  cli_emit(obj);
+}
+
+static void cli_scrape_done_cb(ReelApp *app, gboolean canceled,
+                               gpointer user_data) {
+  (void)app;
+  CliContext *ctx = (CliContext *)user_data;
+  ctx->scraping = FALSE;
+  ctx->canceled = canceled;
+  g_main_loop_quit(ctx->loop);
+}
+
+static int cli_scrape(CliContext *ctx) {
+  cli_begin(ctx, "scrape");
+  if (!ctx->app->tmdb_api_key || !*ctx->app->tmdb_api_key) {
+    cli_emit_error(ctx, "No TMDB API key configured");
+    return CLI_EXIT_CONFIG;
+  }
+
+  gint before = db_films_count_unmatched(ctx->app);
+  ScraperNetStats net_before, net_after;
+  TmdbCacheStats cache_before, cache_after;
+  scraper_net_stats(&net_before);
+  tmdb_cache_stats(&cache_before);
+  ctx->scraping = TRUE;
+  if (!scraper_start_background_with_progress(
+          ctx->app, cli_scrape_progress_cb, cli_scrape_done_cb, ctx)) {
+    ctx->scraping = FALSE;
+    cli_emit_error(ctx, "A scrape is already running");
+    return CLI_EXIT_FAILURE;
+  }
+  cli_run_loop(ctx);
+  gint after = db_films_count_unmatched(ctx->app);
+  scraper_net_stats(&net_after);
+  tmdb_cache_stats(&cache_after);
+
+  json_object *obj = cli_event_new(ctx, "done");
+  json_object_object_add(obj, "matched",
+                         json_object_new_int(MAX(before - after, 0)));
+  json_object_object_add(obj, "unmatched", json_object_new_int(after));
+  json_object_object_add(obj, "looked_up", json_object_new_int(ctx->looked_up));
+  gdouble minutes = (g_get_monotonic_time() - ctx->started) / 60e6;
+  json_object_object_add(
+      obj, "films_per_minute",
+      json_object_new_double(minutes > 0 ? ctx->looked_up / minutes : 0));
+  json_object_object_add(
+      obj, "requests",
+      json_object_new_int(net_after.requests - net_before.requests));
+  json_object_object_add(
+      obj, "connections",
+      json_object_new_int(net_after.connections - net_before.connections));
+  json_object_object_add(obj, "tls_connections",
+                         json_object_new_int(net_after.tls_connections -
+                                             net_before.tls_connections));
+  json_object_object_add(
+      obj, "tls_handshake_ms",
+      json_object_new_int64(
+          (net_after.tls_setup_us - net_before.tls_setup_us) / 1000));
+  json_object_object_add(obj, "searches_skipped",
+                         json_object_new_int(net_after.searches_skipped -
+                                             net_before.searches_skipped));
+  json_object_object_add(obj, "local_matches",
+                         json_object_new_int(net_after.local_matches -
+                                             net_before.local_matches));
+  json_object_object_add(obj, "local_rejected",
+                         json_object_new_int(net_after.local_rejected -
+                                             net_before.local_rejected));
+  gint hits = cache_after.hits - cache_before.hits;
+  gint revalidated = cache_after.revalidated - cache_before.revalidated;
+  gint misses = cache_after.misses - cache_before.misses;
+  gint lookups = hits + revalidated + misses;
+  json_object_object_add(obj, "cache_hits", json_object_new_int(hits));
+  json_object_object_add(obj, "cache_revalidated",
+                         json_object_new_int(revalidated));
+  json_object_object_add(obj, "cache_misses", json_object_new_int(misses));
+  json_object_object_add(
+      obj, "cache_hit_rate",
+      json_object_new_double(lookups > 0 ? (gdouble)(hits + revalidated) /
+                                               lookups
+                                         : 0));
+  json_object_object_add(obj, "canceled",
+                         json_object_new_boolean(ctx->canceled));
+  cli_add_elapsed(ctx, obj);
+  cli_emit(obj);
+
+  return ctx->interrupted ? CLI_EXIT_INTERRUPTED : CLI_EXIT_OK;
+}
+
+/* --stats */
+
+static int cli_stats(CliContext *ctx) {
+  cli_begin(ctx, "stats");
+  LibraryStats stats;
+  if (!db_library_stats(ctx->app, &stats)) {
+    cli_emit_error(ctx, "Could not read library statistics");
+    return CLI_EXIT_FAILURE;
+  }
+
+  json_object *obj = cli_event_new(ctx, "stats");
+  json_object_object_add(obj, "films", json_object_new_int(stats.films));
+  json_object_object_add(obj, "seasons", json_object_new_int(stats.seasons));
+  json_object_object_add(obj, "episodes", json_object_new_int(stats.episodes));
+  json_object_object_add(obj, "unmatched",
+                         json_object_new_int(stats.unmatched));
+  json_object_object_add(obj, "files_hashed",
+                         json_object_new_int(stats.files_hashed));
+  json_object_object_add(obj, "duplicates",
+                         json_object_new_int(stats.duplicates));
+  ScrapeQueueStats queue;
+  if (db_scrape_queue_stats(ctx->app, g_get_real_time() / G_USEC_PER_SEC,
+                            &queue)) {
+    json_object_object_add(obj, "scrape_queued",
+                           json_object_new_int(queue.queued));
+    json_object_object_add(obj, "scrape_due", json_object_new_int(queue.due));
+    json_object_object_add(obj, "scrape_retrying",
+                           json_object_new_int(queue.retrying));
+  }
+  gint misses, saved;
+  if (db_tmdb_miss_stats(ctx->app, &misses, &saved)) {
+    json_object_object_add(obj, "tmdb_misses", json_object_new_int(misses));
+    json_object_object_add(obj, "searches_saved", json_object_new_int(saved));
+  }
+  json_object_object_add(obj, "tmdb_titles",
+                         json_object_new_int(db_tmdb_titles_count(ctx->app)));
+  cli_add_elapsed(ctx, obj);
+  cli_emit(obj);
+  return CLI_EXIT_OK;
+}
+
+/* --import-titles */
+
+static void cli_import_progress_cb(const TitleIndexImportStats *stats,
+                                   gpointer user_data) {
+  CliContext *ctx = (CliContext *)user_data;
+  json_object *obj = cli_event_new(ctx, "progress");
+  json_object_object_add(obj, "lines", json_object_new_int(stats->lines));
+  json_object_object_add(obj, "films", json_object_new_int(stats->films));
+  json_object_object_add(obj, "shows", json_object_new_int(stats->shows));
+  cli_emit(obj);
+}
+
+/* Load TMDB's daily ID exports into the local title index */
+static int cli_import_titles(CliContext *ctx, gchar **paths) {
+  int status = CLI_EXIT_OK;
+  for (gint i = 0; paths[i] != NULL; i++) {
+    cli_begin(ctx, "import-titles");
+    TitleIndexImportStats stats;
+    GError *error = NULL;
+    if (!title_index_import(ctx->app, paths[i], cli_import_progress_cb, ctx,
+                            &stats, &error)) {
+      gchar *message = g_strdup_printf("%s: %s", paths[i], error->message);
+      cli_emit_error(ctx, message);
+      g_free(message);
+      g_error_free(error);
+      status = CLI_EXIT_FAILURE;
+      continue;
+    }
+
+    json_object *obj = cli_event_new(ctx, "done");
+    json_object_object_add(obj, "path", json_object_new_string(paths[i]));
+    json_object_object_add(obj, "lines", json_object_new_int(stats.lines));
+    json_object_object_add(obj, "films", json_object_new_int(stats.films));
+    json_object_object_add(obj, "shows", json_object_new_int(stats.shows));
+    json_object_object_add(obj, "skipped", json_object_new_int(stats.skipped));
+    json_object_object_add(obj, "removed", json_object_new_int(stats.removed));
+    cli_add_elapsed(ctx, obj);
+    cli_emit(obj);
+  }
+  return status;
+}
+
+#ifdef REELVAULT_BENCH
+/* --mock-tmdb */
+
+static gboolean cli_mock_quit(gpointer data) {
+  g_main_loop_quit((GMainLoop *)data);
+  return G_SOURCE_REMOVE;
+}
+
+/* Serve the mock TMDB API until interrupted, for pointing a normal scrape
+   or the window at it */
+static int cli_mock_tmdb(CliContext *ctx, const TmdbMockOptions *opts) {
+  cli_begin(ctx, "mock-tmdb");
+  TmdbMock *mock = tmdb_mock_start(opts);
+  if (!mock) {
+    cli_emit_error(ctx, "Could not start the mock TMDB server");
+    return CLI_EXIT_FAILURE;
+  }
+
+  json_object *obj = cli_event_new(ctx, "listening");
+  json_object_object_add(obj, "api_base",
+                         json_object_new_string(tmdb_mock_api_base(mock)));
+  json_object_object_add(obj, "image_base",
+                         json_object_new_string(tmdb_mock_image_base(mock)));
+  cli_emit(obj);
+
+  GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+  guint sigint = g_unix_signal_add(SIGINT, cli_mock_quit, loop);
+  guint sigterm = g_unix_signal_add(SIGTERM, cli_mock_quit, loop);
+  g_main_loop_run(loop);
+  g_source_remove(sigint);
+  g_source_remove(sigterm);
+  g_main_loop_unref(loop);
+
+  TmdbMockStats stats;
+  tmdb_mock_stats(mock, &stats);
+  tmdb_mock_stop(mock);
+
+  obj = cli_event_new(ctx, "done");
+  json_object_object_add(obj, "requests", json_object_new_int(stats.requests));
+  json_object_object_add(obj, "images", json_object_new_int(stats.images));
+  json_object_object_add(obj, "errors", json_object_new_int(stats.errors));
+  json_object_object_add(obj, "throttled",
+                         json_object_new_int(stats.throttled));
+  json_object_object_add(obj, "not_modified",
+                         json_object_new_int(stats.not_modified));
+  json_object_object_add(obj, "recorded", json_object_new_int(stats.recorded));
+  cli_add_elapsed(ctx, obj);
+  cli_emit(obj);
+  return CLI_EXIT_OK;
+}
+#endif /* REELVAULT_BENCH */
+
+/* --query */
+
+typedef struct {
+  const gchar *text;
+  const gchar *genre;
+  const gchar *year;
+  const gchar *sort;
+  gboolean descending;
+  gint limit;
+} CliQuery;
+
+static int cli_query(CliContext *ctx, const CliQuery *query) {
+  cli_begin(ctx, "query");
+
+  FilterState filter;
+  filter_state_init(&filter);
+  filter_state_parse_search(&filter, query->text);
+  filter.sort_ascending = !query->descending;
+
+  int status = CLI_EXIT_OK;
+  if (query->genre && *query->genre)
+    filter.genre = g_strdup(query->genre);
+
+  if (query->year && *query->year) {
+    gint from = 0, to = 0;
+    gint n = sscanf(query->year, "%d-%d", &from, &to);
+    if (n == 1) {
+      filter.year_from = filter.year_to = from;
+    } else if (n == 2) {
+      filter.year_from = from;
+      filter.year_to = to;
+    } else {
+      cli_emit_error(ctx, "--year expects YEAR or YEAR-YEAR");
+      status = CLI_EXIT_USAGE;
+    }
+  }
+
+  if (query->sort) {
+    if (g_strcmp0(query->sort, "title") == 0 ||
+        g_strcmp0(query->sort, "year") == 0 ||
+        g_strcmp0(query->sort, "rating") == 0 ||
+        g_strcmp0(query->sort, "added") == 0) {
+      g_free(filter.sort_by);
+      filter.sort_by = g_strdup(query->sort);
+    } else {
+      cli_emit_error(ctx, "--sort expects title, year, rating or added");
+      status = CLI_EXIT_USAGE;
+    }
+  }
+
+  if (status != CLI_EXIT_OK) {
+    filter_state_clear(&filter);
+    return status;
+  }
+
+  GList *films = query->limit > 0
+                     ? db_films_get_page_db(ctx->app->db, &filter,
+                                            query->limit, 0)
+                     : db_films_get_all(ctx->app, &filter);
+  gint count = 0;
+  for (GList *l = films; l != NULL; l = l->next) {
+    const Film *film = (const Film *)l->data;
+    json_object *obj = cli_event_new(ctx, "film");
+    cli_add_film(obj, film);
+    json_object_object_add(obj, "tmdb_id", json_object_new_int(film->tmdb_id));
+    json_object_object_add(obj, "rating", json_object_new_double(film->rating));
+    json_object_object_add(obj, "matched",
+                           json_object_new_boolean(film->match_status !=
+                                                   MATCH_STATUS_UNMATCHED));
+    json_object_object_add(obj, "added_date",
+                           json_object_new_int64(film->added_date));
+    cli_emit(obj);
+    count++;
+  }
+  g_list_free_full(films, (GDestroyNotify)film_free);
+
+  json_object *obj = cli_event_new(ctx, "done");
+  json_object_object_add(obj, "count", json_object_new_int(count));
+  cli_add_elapsed(ctx, obj);
+  cli_emit(obj);
+
+  filter_state_clear(&filter);
+  return CLI_EXIT_OK;
+}
+
+int cli_run(ReelApp *app, int argc, char **argv) {
+  gboolean do_scan = FALSE;
+  gboolean do_scrape = FALSE;
+  gboolean do_stats = FALSE;
+  gchar *query_text = NULL;
+  gchar *genre = NULL;
+  gchar *year = NULL;
+  gchar *sort = NULL;
+  gboolean descending = FALSE;
+  gint limit = 0;
+  gchar **roots = NULL;
+#ifdef REELVAULT_BENCH
+  gboolean do_bench = FALSE;
+  gint bench_files = 10000;
+  gint64 bench_seed = 1;
+  gchar *bench_dir = NULL;
+  gboolean bench_keep = FALSE;
+  gint bench_io_delay = 0;
+  gboolean do_bench_normalize = FALSE;
+  gint bench_titles = 200000;
+  gchar *bench_json_dir = NULL;
+  gchar *bench_thumbs_dir = NULL;
+  gboolean do_bench_scrape = FALSE;
+  gint bench_concurrency = 8;
+  gint bench_rate = 0;
+  gint mock_port = -1;
+  TmdbMockOptions mock = {0};
+  gchar *mock_fixtures = NULL;
+#endif
+  gchar **title_exports = NULL;
+
+  GOptionEntry entries[] = {
+      {"scan", 0, 0, G_OPTION_ARG_NONE, &do_scan,
+       "Scan the library folders (or the given PATHs)", NULL},
+      {"scrape", 0, 0, G_OPTION_ARG_NONE, &do_scrape,
+       "Fetch TMDB metadata for unmatched entries", NULL},
+      {"stats", 0, 0, G_OPTION_ARG_NONE, &do_stats, "Print library totals",
+       NULL},
+      {"query", 0, 0, G_OPTION_ARG_STRING, &query_text,
+       "List entries matching a search, as typed in the search box", "FILTER"},
+      {"genre", 0, 0, G_OPTION_ARG_STRING, &genre, "Only list this genre",
+       "GENRE"},
+      {"year", 0, 0, G_OPTION_ARG_STRING, &year, "Only list these years",
+       "YEAR[-YEAR]"},
+      {"sort", 0, 0, G_OPTION_ARG_STRING, &sort,
+       "Sort by title, year, rating or added", "KEY"},
+      {"desc", 0, 0, G_OPTION_ARG_NONE, &descending, "Sort descending", NULL},
+      {"limit", 0, 0, G_OPTION_ARG_INT, &limit, "List at most N entries", "N"},
+#ifdef REELVAULT_BENCH
+      {"bench-scan", 0, 0, G_OPTION_ARG_NONE, &do_bench,
+       "Benchmark the scanner on a generated library", NULL},
+      {"bench-files", 0, 0, G_OPTION_ARG_INT, &bench_files,
+       "Files in the generated library (default 10000)", "N"},
+      {"bench-seed", 0, 0, G_OPTION_ARG_INT64, &bench_seed,
+       "Seed for the generated library (default 1)", "SEED"},
+      {"bench-dir", 0, 0, G_OPTION_ARG_FILENAME, &bench_dir,
+       "Work directory; an existing library there is reused", "DIR"},
+      {"bench-keep", 0, 0, G_OPTION_ARG_NONE, &bench_keep,
+       "Keep the generated library and database", NULL},
+      {"bench-io-delay", 0, 0, G_OPTION_ARG_INT, &bench_io_delay,
+       "Delay each scanner I/O call, like a slow share", "MS"},
+      {"bench-normalize", 0, 0, G_OPTION_ARG_NONE, &do_bench_normalize,
+       "Check and time title normalization", NULL},
+      {"bench-titles", 0, 0, G_OPTION_ARG_INT, &bench_titles,
+       "Generated names to normalize (default 200000)", "N"},
+      {"bench-json", 0, 0, G_OPTION_ARG_FILENAME, &bench_json_dir,
+       "Time full and streaming parsing of the TMDB replies in DIR", "DIR"},
+      {"bench-thumbs", 0, 0, G_OPTION_ARG_FILENAME, &bench_thumbs_dir,
+       "Time making thumbnails of the posters in DIR", "DIR"},
+      {"bench-scrape", 0, 0, G_OPTION_ARG_NONE, &do_bench_scrape,
+       "Benchmark scraping a generated library against a mock TMDB", NULL},
+      {"bench-concurrency", 0, 0, G_OPTION_ARG_INT, &bench_concurrency,
+       "TMDB transfers in flight while scraping (default 8)", "N"},
+      {"bench-rate", 0, 0, G_OPTION_ARG_INT, &bench_rate,
+       "API requests per second while scraping (default 0, no limit)", "N"},
+      {"mock-tmdb", 0, 0, G_OPTION_ARG_INT, &mock_port,
+       "Serve a mock TMDB API on PORT (0 for any) until interrupted", "PORT"},
+      {"mock-latency", 0, 0, G_OPTION_ARG_INT, &mock.latency_ms,
+       "Delay each mock TMDB reply", "MS"},
+      {"mock-errors", 0, 0, G_OPTION_ARG_INT, &mock.error_percent,
+       "Percent of mock TMDB replies that fail with 500", "PCT"},
+      {"mock-throttle", 0, 0, G_OPTION_ARG_INT, &mock.throttle_percent,
+       "Percent of mock TMDB API replies refused with 429", "PCT"},
+      {"mock-misses", 0, 0, G_OPTION_ARG_INT, &mock.miss_percent,
+       "Percent of mock TMDB searches that find nothing", "PCT"},
+      {"mock-fixtures", 0, 0, G_OPTION_ARG_FILENAME, &mock_fixtures,
+       "Serve the recorded TMDB replies in DIR where present", "DIR"},
+#endif
+      {"import-titles", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &title_exports,
+       "Load a TMDB daily ID export (.json.gz) into the title index; may be "
+       "repeated",
+       "FILE"},
+      {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &roots, NULL,
+       NULL},
+      {NULL, 0, 0, 0, NULL, NULL, NULL}};
+
+  GOptionContext *options = g_option_context_new("[PATH...]");
+  g_option_context_set_summary(
+      options, "Headless library maintenance. Output is one JSON object per "
+               "line on stdout.");
+  g_option_context_add_main_entries(options, entries, NULL);
+
+  GError *error = NULL;
+  gboolean parsed = g_option_context_parse(options, &argc, &argv, &error);
+  g_option_context_free(options);
+
+  CliContext ctx = {0};
+  ctx.app = app;
+  ctx.command = "cli";
+
+  if (!parsed) {
+    cli_emit_error(&ctx, error->message);
+    g_error_free(error);
+    return CLI_EXIT_USAGE;
+  }
+  if (roots && !do_scan) {
+    cli_emit_error(&ctx, "Paths are only accepted with --scan");
+    g_strfreev(roots);
+    return CLI_EXIT_USAGE;
+  }
+
+  g_set_print_handler(cli_print_handler);
+
+#ifdef REELVAULT_BENCH
+  /* The benchmarks use their own scratch database, never the library. */
+  if (do_bench || do_bench_normalize || bench_json_dir || bench_thumbs_dir ||
+      do_bench_scrape || mock_port >= 0) {
+    int status = CLI_EXIT_OK;
+    if (do_bench_normalize) {
+      if (bench_titles > 0)
+        status = bench_normalize(bench_titles, (guint32)bench_seed);
+      else {
+        cli_emit_error(&ctx, "--bench-titles must be positive");
+        status = CLI_EXIT_USAGE;
+      }
+    }
+    if (bench_json_dir && status == CLI_EXIT_OK)
+      status = bench_json(bench_json_dir);
+    if (bench_thumbs_dir && status == CLI_EXIT_OK)
+      status = bench_thumbs(bench_thumbs_dir);
+    if (do_bench && status == CLI_EXIT_OK) {
+      if (bench_files > 0) {
+        BenchScanOptions bench = {bench_files, (guint32)bench_seed, bench_dir,
+                                  bench_keep, MAX(bench_io_delay, 0)};
+        status = bench_scan(app, &bench);
+      } else {
+        cli_emit_error(&ctx, "--bench-files must be positive");
+        status = CLI_EXIT_USAGE;
+      }
+    }
+    mock.fixtures = mock_fixtures;
+    mock.latency_ms = MAX(mock.latency_ms, 0);
+    if (do_bench_scrape && status == CLI_EXIT_OK) {
+      if (bench_files > 0 && bench_concurrency > 0) {
+        BenchScrapeOptions bench = {bench_files,       (guint32)bench_seed,
+                                    bench_dir,         bench_keep,
+                                    bench_concurrency, MAX(bench_rate, 0),
+                                    mock};
+        status = bench_scrape(app, &bench);
+      } else {
+        cli_emit_error(&ctx,
+                       "--bench-files and --bench-concurrency must be positive");
+        status = CLI_EXIT_USAGE;
+      }
+    }
+    if (mock_port >= 0 && status == CLI_EXIT_OK) {
+      mock.port = mock_port;
+      status = cli_mock_tmdb(&ctx, &mock);
+    }
+    g_free(mock_fixtures);
+    g_free(bench_dir);
+    g_free(bench_json_dir);
+    g_free(bench_thumbs_dir);
+    g_strfreev(title_exports);
+    g_free(query_text);
+    g_free(genre);
+    g_free(year);
+    g_free(sort);
+    g_strfreev(roots);
+    return status;
+  }
+#endif
+
+  int status = CLI_EXIT_OK;
+  if (!reel_app_init_paths(app)) {
+    cli_emit_error(&ctx, "Failed to initialize application paths");
+    status = CLI_EXIT_FAILURE;
+  } else {
+    config_load(app);
+    if (!db_init(app)) {
+      cli_emit_error(&ctx, "Failed to open the library database");
+      status = CLI_EXIT_FAILURE;
+    }
+  }
+
+  if (status == CLI_EXIT_OK) {
+    ctx.loop = g_main_loop_new(NULL, FALSE);
+    int rc = CLI_EXIT_OK;
+
+    /* Commands run in a fixed order so "--scan --scrape --stats" works as a
+       single nightly job. The first failure decides the exit code. */
+    if (title_exports) {
+      rc = cli_import_titles(&ctx, title_exports);
+      status = rc;
+    }
+    if (do_scan && !ctx.interrupted) {
+      if (roots)
+        rc = cli_scan(&ctx, roots, (gint)g_strv_length(roots));
+      else
+        rc = cli_scan(&ctx, app->library_paths, app->library_paths_count);
+      if (status == CLI_EXIT_OK)
+        status = rc;
+    }
+    if (do_scrape && !ctx.interrupted) {
+      rc = cli_scrape(&ctx);
+      if (status == CLI_EXIT_OK)
+        status = rc;
+    }
+    if (do_stats && !ctx.interrupted) {
+      rc = cli_stats(&ctx);
+      if (status == CLI_EXIT_OK)
+        status = rc;
+    }
+    if (query_text && !ctx.interrupted) {
+      CliQuery query = {query_text, genre, year, sort, descending, limit};
+      rc = cli_query(&ctx, &query);
+      if (status == CLI_EXIT_OK)
+        status = rc;
+    }
+
+    g_main_loop_unref(ctx.loop);
+    db_close(app);
+  }
+
+  g_free(query_text);
+  g_free(genre);
+  g_free(year);
+  g_free(sort);
+#ifdef REELVAULT_BENCH
+  g_free(bench_dir);
+  g_free(bench_json_dir);
+  g_free(bench_thumbs_dir);
+  g_free(mock_fixtures);
+#endif
+  g_strfreev(title_exports);
+  g_strfreev(roots);
+  return status;
+}
@@ -0,0 +1,23 @@
+#ifndef REELGTK_CLI_H
+#define REELGTK_CLI_H
+
+#include "app.h"
+
+/* Exit codes of the headless commands */
+#define CLI_EXIT_OK 0
+#define CLI_EXIT_FAILURE 1     /* Database or I/O error */
+#define CLI_EXIT_USAGE 2       /* Bad command line */
+#define CLI_EXIT_PARTIAL 3     /* Ran, but a library root was unavailable */
+#define CLI_EXIT_CONFIG 4      /* Missing library paths or API key */
+#define CLI_EXIT_INTERRUPTED 130
+
+/* Whether the command line asks for a headless command (--scan, --scrape,
+   --stats, --query) instead of the window */
+gboolean cli_is_headless(int argc, char **argv);
+
+/* Run the headless commands without creating any widgets. Results and
+   progress are written to stdout as JSON lines; log output goes to stderr.
+   Returns one of the CLI_EXIT_* codes. */
+int cli_run(ReelApp *app, int argc, char **argv);
+
+#endif /* REELGTK_CLI_H */
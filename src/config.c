@@ -4,6 +4,7 @@
  */
 
 #include "config.h"
+#include "utils.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -26,6 +27,27 @@ gboolean config_load(ReelApp *app) {
     app->tmdb_api_key = api_key;
   }
 
+  /* Scraper limits */
+  if (g_key_file_has_key(keyfile, "tmdb", "concurrency", NULL)) {
+    gint n = g_key_file_get_integer(keyfile, "tmdb", "concurrency", NULL);
+    if (n > 0) {
+      app->scrape_concurrency = n;
+    }
+  }
+  if (g_key_file_has_key(keyfile, "tmdb", "requests_per_second", NULL)) {
+    gint rate =
+        g_key_file_get_integer(keyfile, "tmdb", "requests_per_second", NULL);
+    if (rate >= 0) {
+      app->scrape_rate = rate;
+    }
+  }
+  if (g_key_file_has_key(keyfile, "tmdb", "cache_mb", NULL)) {
+    gint mb = g_key_file_get_integer(keyfile, "tmdb", "cache_mb", NULL);
+    if (mb >= 0) {
+      app->tmdb_cache_mb = mb;
+    }
+  }
+
   /* Player command */
   gchar *player = g_key_file_get_string(keyfile, "player", "command", NULL);
   if (player) {
@@ -44,6 +66,43 @@ gboolean config_load(ReelApp *app) {
     g_free(paths_str);
   }
 
+  /* Grace period before missing files are dropped from the library */
+  if (g_key_file_has_key(keyfile, "library", "missing_grace_days", NULL)) {
+    gint days =
+        g_key_file_get_integer(keyfile, "library", "missing_grace_days", NULL);
+    if (days >= 0) {
+      app->missing_grace_days = days;
+    }
+  }
+
+  /* After this long without an answer a library folder counts as offline */
+  if (g_key_file_has_key(keyfile, "library", "io_timeout_seconds", NULL)) {
+    gint seconds =
+        g_key_file_get_integer(keyfile, "library", "io_timeout_seconds", NULL);
+    if (seconds > 0) {
+      app->io_timeout_seconds = seconds;
+    }
+  }
+
+  /* Release tags cut from filenames, replacing the built-in list */
+  gchar *tags_str = g_key_file_get_string(keyfile, "library", "strip_tags", NULL);
+  if (tags_str && strlen(tags_str) > 0) {
+    gchar **tags = g_strsplit(tags_str, ";", -1);
+    GPtrArray *clean = g_ptr_array_new();
+    for (gint i = 0; tags[i] != NULL; i++) {
+      g_strstrip(tags[i]);
+      if (*tags[i])
+        g_ptr_array_add(clean, g_ascii_strdown(tags[i], -1));
+    }
+    g_ptr_array_add(clean, NULL);
+    g_strfreev(tags);
+
+    g_strfreev(app->strip_tags);
+    app->strip_tags = (gchar **)g_ptr_array_free(clean, FALSE);
+    utils_set_strip_tags((const gchar *const *)app->strip_tags);
+  }
+  g_free(tags_str);
+
   /* UI theme preference */
   if (g_key_file_has_key(keyfile, "ui", "theme", NULL)) {
     gint theme = g_key_file_get_integer(keyfile, "ui", "theme", NULL);
@@ -88,6 +147,19 @@ gboolean config_load(ReelApp *app) {
         g_key_file_get_boolean(keyfile, "ui", "window_maximized", NULL);
   }
 
+  /* Memory for decoded posters kept after they scroll out of view */
+  if (g_key_file_has_key(keyfile, "ui", "poster_memory_mb", NULL)) {
+    gint mb = g_key_file_get_integer(keyfile, "ui", "poster_memory_mb", NULL);
+    if (mb >= 0) {
+      app->poster_memory_mb = mb;
+    }
+  }
+
+  if (g_key_file_has_key(keyfile, "ui", "group_seasons", NULL)) {
+    app->filter.group_seasons =
+        g_key_file_get_boolean(keyfile, "ui", "group_seasons", NULL);
+  }
+
   g_key_file_free(keyfile);
   g_print("Configuration loaded from: %s\n", app->config_path);
   return TRUE;
@@ -100,6 +172,11 @@ gboolean config_save(ReelApp *app) {
   if (app->tmdb_api_key) {
     g_key_file_set_string(keyfile, "tmdb", "api_key", app->tmdb_api_key);
   }
+  g_key_file_set_integer(keyfile, "tmdb", "concurrency",
+                         app->scrape_concurrency);
+  g_key_file_set_integer(keyfile, "tmdb", "requests_per_second",
+                         app->scrape_rate);
+  g_key_file_set_integer(keyfile, "tmdb", "cache_mb", app->tmdb_cache_mb);
 
   /* Player command */
   if (app->player_command) {
@@ -112,6 +189,15 @@ gboolean config_save(ReelApp *app) {
     g_key_file_set_string(keyfile, "library", "paths", paths_str);
     g_free(paths_str);
   }
+  g_key_file_set_integer(keyfile, "library", "missing_grace_days",
+                         app->missing_grace_days);
+  g_key_file_set_integer(keyfile, "library", "io_timeout_seconds",
+                         app->io_timeout_seconds);
+  if (app->strip_tags) {
+    gchar *tags_str = g_strjoinv(";", app->strip_tags);
+    g_key_file_set_string(keyfile, "library", "strip_tags", tags_str);
+    g_free(tags_str);
+  }
 
   /* UI theme preference */
   g_key_file_set_integer(keyfile, "ui", "theme", (gint)app->theme_preference);
@@ -133,6 +219,10 @@ gboolean config_save(ReelApp *app) {
   }
   g_key_file_set_boolean(keyfile, "ui", "window_maximized",
                          app->window_maximized);
+  g_key_file_set_boolean(keyfile, "ui", "group_seasons",
+                         app->filter.group_seasons);
+  g_key_file_set_integer(keyfile, "ui", "poster_memory_mb",
+                         app->poster_memory_mb);
 
   /* Write to file */
   GError *error = NULL;
@@ -23,7 +23,21 @@ static const char *SCHEMA_SQL =
     "    added_date INTEGER,"
     "    match_status INTEGER DEFAULT 0,"
     "    media_type INTEGER DEFAULT 0,"
-    "    season_number INTEGER DEFAULT 0"
+    "    season_number INTEGER DEFAULT 0,"
+    "    seen_gen INTEGER DEFAULT 0,"
+    "    last_seen INTEGER DEFAULT 0,"
+    "    show_id INTEGER REFERENCES shows(id) ON DELETE SET NULL,"
+    "    poster_remote TEXT"
+    ");"
+
+    /* Show-level metadata shared by all seasons of a TV series */
+    "CREATE TABLE IF NOT EXISTS shows ("
+    "    id INTEGER PRIMARY KEY,"
+    "    tmdb_id INTEGER UNIQUE NOT NULL,"
+    "    name TEXT,"
+    "    overview TEXT,"
+    "    poster_path TEXT,"
+    "    year INTEGER"
     ");"
 
     "CREATE TABLE IF NOT EXISTS film_files ("
@@ -31,7 +45,9 @@ static const char *SCHEMA_SQL =
     "    film_id INTEGER REFERENCES films(id) ON DELETE CASCADE,"
     "    file_path TEXT UNIQUE NOT NULL,"
     "    label TEXT,"
-    "    sort_order INTEGER DEFAULT 0"
+    "    sort_order INTEGER DEFAULT 0,"
+    "    seen_gen INTEGER DEFAULT 0,"
+    "    last_seen INTEGER DEFAULT 0"
     ");"
 
     "CREATE TABLE IF NOT EXISTS episodes ("
@@ -43,7 +59,78 @@ static const char *SCHEMA_SQL =
     "    runtime_minutes INTEGER,"
     "    plot TEXT,"
     "    tmdb_id INTEGER,"
-    "    air_date TEXT"
+    "    air_date TEXT,"
+    "    seen_gen INTEGER DEFAULT 0,"
+    "    last_seen INTEGER DEFAULT 0"
+    ");"
+
+    "CREATE TABLE IF NOT EXISTS file_ids ("
+    "    file_path TEXT PRIMARY KEY,"
+    "    dev INTEGER,"
+    "    ino INTEGER,"
+    "    size INTEGER,"
+    "    mtime INTEGER,"
+    "    fingerprint TEXT,"
+    "    oshash TEXT"
+    ");"
+
+    /* Container probe results; files that are not Matroska/MP4 get an
+       empty row so they are not probed again */
+    "CREATE TABLE IF NOT EXISTS media_info ("
+    "    dev INTEGER,"
+    "    ino INTEGER,"
+    "    mtime INTEGER,"
+    "    size INTEGER,"
+    "    duration_ms INTEGER,"
+    "    width INTEGER,"
+    "    height INTEGER,"
+    "    video_codec TEXT,"
+    "    audio_codecs TEXT,"
+    "    audio_languages TEXT,"
+    "    PRIMARY KEY (dev, ino)"
+    ");"
+
+    /* Films waiting for TMDB metadata. A run leases the jobs it works on
+       until lease_until, so another run or a restart after a crash picks
+       them up once the lease runs out; failed jobs wait for next_attempt. */
+    "CREATE TABLE IF NOT EXISTS scrape_jobs ("
+    "    film_id INTEGER PRIMARY KEY REFERENCES films(id) ON DELETE CASCADE,"
+    "    enqueued INTEGER DEFAULT 0,"
+    "    attempts INTEGER DEFAULT 0,"
+    "    next_attempt INTEGER DEFAULT 0,"
+    "    lease_owner TEXT,"
+    "    lease_until INTEGER DEFAULT 0,"
+    "    last_error TEXT"
+    ");"
+
+    /* TMDB searches that found nothing to match, by cleaned-up query, so
+       they are not repeated before recheck_at */
+    "CREATE TABLE IF NOT EXISTS tmdb_misses ("
+    "    query TEXT NOT NULL,"
+    "    year INTEGER NOT NULL,"
+    "    tv INTEGER NOT NULL,"
+    "    misses INTEGER DEFAULT 1,"
+    "    checked INTEGER,"
+    "    recheck_at INTEGER,"
+    "    saved INTEGER DEFAULT 0,"
+    "    PRIMARY KEY (query, year, tv)"
+    ");"
+
+    /* Titles from TMDB's daily ID exports, by folded title, so films can
+       be matched without a search. year is 0 until details show it. */
+    "CREATE TABLE IF NOT EXISTS tmdb_titles ("
+    "    tv INTEGER NOT NULL,"
+    "    tmdb_id INTEGER NOT NULL,"
+    "    title_key TEXT NOT NULL,"
+    "    popularity REAL DEFAULT 0,"
+    "    year INTEGER DEFAULT 0,"
+    "    imported INTEGER DEFAULT 0,"
+    "    PRIMARY KEY (tv, tmdb_id)"
+    ") WITHOUT ROWID;"
+
+    "CREATE TABLE IF NOT EXISTS meta ("
+    "    key TEXT PRIMARY KEY,"
+    "    value TEXT"
     ");"
 
     "CREATE TABLE IF NOT EXISTS genres ("
@@ -57,6 +144,12 @@ static const char *SCHEMA_SQL =
     "    PRIMARY KEY (film_id, genre_id)"
     ");"
 
+    "CREATE TABLE IF NOT EXISTS show_genres ("
+    "    show_id INTEGER REFERENCES shows(id) ON DELETE CASCADE,"
+    "    genre_id INTEGER REFERENCES genres(id) ON DELETE CASCADE,"
+    "    PRIMARY KEY (show_id, genre_id)"
+    ");"
+
     "CREATE TABLE IF NOT EXISTS actors ("
     "    id INTEGER PRIMARY KEY,"
     "    name TEXT UNIQUE,"
@@ -89,7 +182,24 @@ static const char *SCHEMA_SQL =
     "CREATE INDEX IF NOT EXISTS idx_films_tmdb_id ON films(tmdb_id);"
     "CREATE INDEX IF NOT EXISTS idx_films_rating ON films(rating);"
     "CREATE INDEX IF NOT EXISTS idx_films_added_date ON films(added_date);"
-    "CREATE INDEX IF NOT EXISTS idx_film_files_film_id ON film_files(film_id);";
+    "CREATE INDEX IF NOT EXISTS idx_film_files_film_id ON film_files(film_id);"
+    "CREATE INDEX IF NOT EXISTS idx_file_ids_inode ON file_ids(dev, ino);"
+    "CREATE INDEX IF NOT EXISTS idx_file_ids_fingerprint ON file_ids(size, "
+    "fingerprint);"
+    "CREATE INDEX IF NOT EXISTS idx_scrape_jobs_due ON scrape_jobs("
+    "next_attempt);"
+    "CREATE INDEX IF NOT EXISTS idx_tmdb_titles_key ON tmdb_titles(tv, "
+    "title_key, popularity);"
+
+    /* Content hash of every film file, main or attached */
+    "CREATE VIEW IF NOT EXISTS film_hashes AS"
+    "    SELECT f.id AS film_id, i.file_path, i.oshash FROM films f"
+    "    JOIN file_ids i ON i.file_path = f.file_path"
+    "    WHERE i.oshash IS NOT NULL"
+    "    UNION ALL"
+    "    SELECT ff.film_id, i.file_path, i.oshash FROM film_files ff"
+    "    JOIN file_ids i ON i.file_path = ff.file_path"
+    "    WHERE i.oshash IS NOT NULL;";
 
 gboolean db_init(ReelApp *app) {
   int rc = sqlite3_open(app->db_path, &app->db);
@@ -125,6 +235,61 @@ gboolean db_init(ReelApp *app) {
                "ALTER TABLE films ADD COLUMN season_number INTEGER DEFAULT 0",
                NULL, NULL, NULL);
 
+  /* Scan bookkeeping for mark-and-sweep. Rows that predate it count as seen
+     now, so the first sweep after upgrading cannot remove anything before the
+     grace period has elapsed. */
+  static const char *SEEN_TABLES[] = {"films", "film_files", "episodes", NULL};
+  for (int i = 0; SEEN_TABLES[i] != NULL; i++) {
+    gchar *sql = g_strdup_printf(
+        "ALTER TABLE %s ADD COLUMN seen_gen INTEGER DEFAULT 0", SEEN_TABLES[i]);
+    sqlite3_exec(app->db, sql, NULL, NULL, NULL);
+    g_free(sql);
+
+    sql = g_strdup_printf(
+        "ALTER TABLE %s ADD COLUMN last_seen INTEGER DEFAULT 0", SEEN_TABLES[i]);
+    if (sqlite3_exec(app->db, sql, NULL, NULL, NULL) == SQLITE_OK) {
+      g_free(sql);
+      sql = g_strdup_printf("UPDATE %s SET last_seen = %" G_GINT64_FORMAT,
+                            SEEN_TABLES[i], g_get_real_time() / 1000000);
+      sqlite3_exec(app->db, sql, NULL, NULL, NULL);
+    }
+    g_free(sql);
+  }
+
+  /* Seasons link to their show; existing seasons get linked when they are
+     next scraped */
+  sqlite3_exec(app->db,
+               "ALTER TABLE films ADD COLUMN show_id INTEGER "
+               "REFERENCES shows(id) ON DELETE SET NULL",
+               NULL, NULL, NULL);
+  /* Where the poster came from on TMDB, to fetch other sizes. Posters
+     downloaded before have none and are only shown at their one size. */
+  sqlite3_exec(app->db, "ALTER TABLE films ADD COLUMN poster_remote TEXT",
+               NULL, NULL, NULL);
+  sqlite3_exec(app->db,
+               "CREATE INDEX IF NOT EXISTS idx_films_show_id ON "
+               "films(show_id);",
+               NULL, NULL, NULL);
+  sqlite3_exec(app->db,
+               "CREATE INDEX IF NOT EXISTS idx_file_ids_oshash ON "
+               "file_ids(oshash);",
+               NULL, NULL, NULL);
+
+  /* Queue whatever was left unmatched before the scrape queue existed */
+  if (sqlite3_exec(app->db,
+                   "INSERT INTO meta (key, value) VALUES ('scrape_jobs', '1') "
+                   "ON CONFLICT(key) DO NOTHING",
+                   NULL, NULL, NULL) == SQLITE_OK &&
+      sqlite3_changes(app->db) > 0) {
+    sqlite3_exec(app->db,
+                 "INSERT OR IGNORE INTO scrape_jobs (film_id, enqueued) "
+                 "SELECT id, added_date FROM films WHERE match_status = 0",
+                 NULL, NULL, NULL);
+  }
+
+  /* Scans hold a write transaction; let other connections wait for it. */
+  sqlite3_busy_timeout(app->db, 5000);
+
   /* Additional indexes (ignore errors if already exist) */
   sqlite3_exec(app->db, "CREATE INDEX IF NOT EXISTS idx_films_rating ON films(rating);",
                NULL, NULL, NULL);
@@ -149,8 +314,8 @@ gboolean db_film_insert(ReelApp *app, Film *film) {
   const char *sql =
       "INSERT INTO films (file_path, title, year, runtime_minutes, plot, "
       "poster_path, tmdb_id, imdb_id, rating, added_date, match_status, "
-      "media_type, season_number) "
-      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+      "media_type, season_number, show_id, poster_remote) "
+      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
 
   sqlite3_stmt *stmt;
   int rc = sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL);
@@ -172,6 +337,11 @@ gboolean db_film_insert(ReelApp *app, Film *film) {
   sqlite3_bind_int(stmt, 11, film->match_status);
   sqlite3_bind_int(stmt, 12, film->media_type);
   sqlite3_bind_int(stmt, 13, film->season_number);
+  if (film->show_id > 0)
+    sqlite3_bind_int64(stmt, 14, film->show_id);
+  else
+    sqlite3_bind_null(stmt, 14);
+  sqlite3_bind_text(stmt, 15, film->poster_remote, -1, SQLITE_STATIC);
 
   rc = sqlite3_step(stmt);
   if (rc != SQLITE_DONE) {
@@ -189,7 +359,7 @@ gboolean db_film_update(ReelApp *app, const Film *film) {
   const char *sql =
       "UPDATE films SET title=?, year=?, runtime_minutes=?, plot=?, "
       "poster_path=?, tmdb_id=?, imdb_id=?, rating=?, match_status=?, "
-      "media_type=?, season_number=? "
+      "media_type=?, season_number=?, show_id=?, poster_remote=? "
       "WHERE id=?";
 
   sqlite3_stmt *stmt;
@@ -210,7 +380,12 @@ gboolean db_film_update(ReelApp *app, const Film *film) {
   sqlite3_bind_int(stmt, 9, film->match_status);
   sqlite3_bind_int(stmt, 10, film->media_type);
   sqlite3_bind_int(stmt, 11, film->season_number);
-  sqlite3_bind_int64(stmt, 12, film->id);
+  if (film->show_id > 0)
+    sqlite3_bind_int64(stmt, 12, film->show_id);
+  else
+    sqlite3_bind_null(stmt, 12);
+  sqlite3_bind_text(stmt, 13, film->poster_remote, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 14, film->id);
 
   rc = sqlite3_step(stmt);
   sqlite3_finalize(stmt);
@@ -283,6 +458,18 @@ static Film *film_from_row(sqlite3_stmt *stmt) {
     film->season_number = sqlite3_column_int(stmt, 13);
   }
 
+  /* show_id and poster_remote follow seen_gen and last_seen; grouped
+     queries add the show name and season count after the table columns */
+  if (sqlite3_column_count(stmt) > 17) {
+    film->show_id = sqlite3_column_int64(stmt, 16);
+    film->poster_remote =
+        g_strdup((const gchar *)sqlite3_column_text(stmt, 17));
+  }
+  if (sqlite3_column_count(stmt) > 19) {
+    film->show_name = g_strdup((const gchar *)sqlite3_column_text(stmt, 18));
+    film->season_count = sqlite3_column_int(stmt, 19);
+  }
+
   return film;
 }
 
@@ -303,13 +490,31 @@ void db_close_handle(sqlite3 *db) {
 
 static GString *build_films_query(const FilterState *filter, gboolean paged,
                                   gint limit, gint offset) {
-  GString *sql = g_string_new("SELECT f.* FROM films f");
+  gboolean grouped = filter && filter->group_seasons;
+  GString *sql = g_string_new(NULL);
   gboolean has_where = FALSE;
 
+  if (grouped) {
+    /* One row per show: the remaining columns come from the row with the
+       min() value, i.e. its first regular season (Specials last) */
+    g_string_append(sql,
+                    "SELECT f.*, sh.name, COUNT(*),"
+                    " MIN(CASE WHEN f.season_number > 0 THEN f.season_number"
+                    " ELSE 1 << 30 END)"
+                    " FROM films f LEFT JOIN shows sh ON sh.id = f.show_id");
+  } else {
+    g_string_append(sql, "SELECT f.* FROM films f");
+  }
+
   if (filter && filter->genre && strlen(filter->genre) > 0) {
-    g_string_append(sql, " JOIN film_genres fg ON f.id = fg.film_id"
-                         " JOIN genres g ON fg.genre_id = g.id");
-    g_string_append_printf(sql, " WHERE g.name = '%s'", filter->genre);
+    /* TV seasons carry their genres on the show */
+    g_string_append_printf(
+        sql,
+        " WHERE (f.id IN (SELECT fg.film_id FROM film_genres fg"
+        " JOIN genres g ON fg.genre_id = g.id WHERE g.name = '%s')"
+        " OR f.show_id IN (SELECT sg.show_id FROM show_genres sg"
+        " JOIN genres g ON sg.genre_id = g.id WHERE g.name = '%s'))",
+        filter->genre, filter->genre);
     has_where = TRUE;
   }
 
@@ -351,6 +556,21 @@ static GString *build_films_query(const FilterState *filter, gboolean paged,
     has_where = TRUE;
   }
 
+  if (filter && filter->duplicates_only) {
+    g_string_append_printf(
+        sql,
+        " %s f.id IN (SELECT h1.film_id FROM film_hashes h1"
+        " JOIN film_hashes h2 ON h2.oshash = h1.oshash"
+        " AND h2.film_id <> h1.film_id)",
+        has_where ? "AND" : "WHERE");
+    has_where = TRUE;
+  }
+
+  if (grouped) {
+    g_string_append(sql, " GROUP BY CASE WHEN f.show_id IS NULL"
+                         " THEN -f.id ELSE f.show_id END");
+  }
+
   if (filter && filter->sort_by) {
     if (g_strcmp0(filter->sort_by, "year") == 0) {
       g_string_append(sql, " ORDER BY f.year");
@@ -516,241 +736,1142 @@ gboolean db_is_file_tracked(ReelApp *app, const gchar *file_path) {
   return exists;
 }
 
-Film *db_film_get_by_id(ReelApp *app, gint64 film_id) {
-  const char *sql = "SELECT * FROM films WHERE id=?";
+/* File identities (move/rename detection) */
+
+void file_id_clear(FileId *id) {
+  if (!id)
+    return;
+  g_free(id->fingerprint);
+  id->fingerprint = NULL;
+}
+
+gboolean db_file_id_get(ReelApp *app, const gchar *file_path, FileId *id) {
+  const char *sql = "SELECT dev, ino, size, mtime, fingerprint FROM file_ids "
+                    "WHERE file_path=?";
 
   sqlite3_stmt *stmt;
-  int rc = sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL);
-  if (rc != SQLITE_OK)
-    return NULL;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
 
-  sqlite3_bind_int64(stmt, 1, film_id);
+  sqlite3_bind_text(stmt, 1, file_path, -1, SQLITE_STATIC);
 
-  Film *film = NULL;
+  gboolean found = FALSE;
   if (sqlite3_step(stmt) == SQLITE_ROW) {
-    film = film_from_row(stmt);
+    id->dev = sqlite3_column_int64(stmt, 0);
+    id->ino = sqlite3_column_int64(stmt, 1);
+    id->size = sqlite3_column_int64(stmt, 2);
+    id->mtime = sqlite3_column_int64(stmt, 3);
+    id->fingerprint = g_strdup((const gchar *)sqlite3_column_text(stmt, 4));
+    found = TRUE;
   }
 
   sqlite3_finalize(stmt);
-  return film;
+  return found;
 }
 
-Film *db_film_get_by_path(ReelApp *app, const gchar *file_path) {
-  const char *sql = "SELECT * FROM films WHERE file_path=?";
+gboolean db_file_id_put(ReelApp *app, const gchar *file_path,
+                        const FileId *id) {
+  /* The content hash survives as long as size and mtime are unchanged. */
+  const char *sql =
+      "INSERT INTO file_ids (file_path, dev, ino, size, mtime, fingerprint) "
+      "VALUES (?, ?, ?, ?, ?, ?) "
+      "ON CONFLICT(file_path) DO UPDATE SET dev=excluded.dev, "
+      "ino=excluded.ino, size=excluded.size, mtime=excluded.mtime, "
+      "fingerprint=excluded.fingerprint, "
+      "oshash=CASE WHEN size=excluded.size AND mtime=excluded.mtime "
+      "THEN oshash END";
 
   sqlite3_stmt *stmt;
-  int rc = sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL);
-  if (rc != SQLITE_OK)
-    return NULL;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
 
   sqlite3_bind_text(stmt, 1, file_path, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, id->dev);
+  sqlite3_bind_int64(stmt, 3, id->ino);
+  sqlite3_bind_int64(stmt, 4, id->size);
+  sqlite3_bind_int64(stmt, 5, id->mtime);
+  sqlite3_bind_text(stmt, 6, id->fingerprint, -1, SQLITE_STATIC);
 
-  Film *film = NULL;
-  if (sqlite3_step(stmt) == SQLITE_ROW) {
-    film = film_from_row(stmt);
-  }
-
+  int rc = sqlite3_step(stmt);
   sqlite3_finalize(stmt);
-  return film;
+  return rc == SQLITE_DONE;
 }
 
-GList *db_films_get_all(ReelApp *app, const FilterState *filter) {
-  GString *sql = g_string_new("SELECT f.* FROM films f");
-  GList *films = NULL;
+GList *db_file_ids_find(ReelApp *app, const FileId *id, gboolean by_inode) {
+  const char *sql =
+      by_inode ? "SELECT file_path FROM file_ids WHERE dev=? AND ino=? "
+                 "AND size=?"
+               : "SELECT file_path FROM file_ids WHERE size=? "
+                 "AND fingerprint=?";
 
-  /* Build WHERE clause based on filter */
-  gboolean has_where = FALSE;
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return NULL;
 
-  if (filter && filter->genre && strlen(filter->genre) > 0) {
-    g_string_append(sql, " JOIN film_genres fg ON f.id = fg.film_id"
-                         " JOIN genres g ON fg.genre_id = g.id");
-    g_string_append_printf(sql, " WHERE g.name = '%s'", filter->genre);
-    has_where = TRUE;
+  if (by_inode) {
+    sqlite3_bind_int64(stmt, 1, id->dev);
+    sqlite3_bind_int64(stmt, 2, id->ino);
+    sqlite3_bind_int64(stmt, 3, id->size);
+  } else {
+    sqlite3_bind_int64(stmt, 1, id->size);
+    sqlite3_bind_text(stmt, 2, id->fingerprint, -1, SQLITE_STATIC);
   }
 
-  if (filter && filter->year_from > 0) {
-    g_string_append_printf(sql, " %s f.year >= %d", has_where ? "AND" : "WHERE",
-                           filter->year_from);
-    has_where = TRUE;
+  GList *paths = NULL;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    paths = g_list_append(
+        paths, g_strdup((const gchar *)sqlite3_column_text(stmt, 0)));
   }
 
-  if (filter && filter->year_to > 0) {
-    g_string_append_printf(sql, " %s f.year <= %d", has_where ? "AND" : "WHERE",
-                           filter->year_to);
-    has_where = TRUE;
-  }
+  sqlite3_finalize(stmt);
+  return paths;
+}
 
-  if (filter && filter->search_text && strlen(filter->search_text) > 0) {
-    g_string_append_printf(sql, " %s f.title LIKE '%%%s%%'",
-                           has_where ? "AND" : "WHERE", filter->search_text);
-    has_where = TRUE;
-  }
+gboolean db_file_relink(ReelApp *app, const gchar *old_path,
+                        const gchar *new_path) {
+  const char *sqls[] = {
+      "UPDATE films SET file_path=?2 WHERE file_path=?1",
+      "UPDATE film_files SET file_path=?2 WHERE file_path=?1",
+      NULL,
+  };
 
-  if (filter && filter->actor && strlen(filter->actor) > 0) {
-    if (!has_where) {
-      g_string_append(sql, " WHERE");
-    } else {
-      g_string_append(sql, " AND");
-    }
-    g_string_append(sql, " f.id IN (SELECT fa.film_id FROM film_actors fa"
-                         " JOIN actors a ON fa.actor_id = a.id"
-                         " WHERE a.name LIKE '%");
-    g_string_append(sql, filter->actor);
-    g_string_append(sql, "%')");
-    has_where = TRUE;
+  gboolean relinked = FALSE;
+  for (int i = 0; sqls[i] != NULL; i++) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(app->db, sqls[i], -1, &stmt, NULL) != SQLITE_OK)
+      continue;
+
+    sqlite3_bind_text(stmt, 1, old_path, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, new_path, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(app->db) > 0)
+      relinked = TRUE;
+    sqlite3_finalize(stmt);
   }
 
-  /* Add ORDER BY */
-  if (filter && filter->sort_by) {
-    if (g_strcmp0(filter->sort_by, "year") == 0) {
-      g_string_append(sql, " ORDER BY f.year");
-    } else if (g_strcmp0(filter->sort_by, "rating") == 0) {
-      g_string_append(sql, " ORDER BY f.rating");
-    } else if (g_strcmp0(filter->sort_by, "added") == 0) {
-      g_string_append(sql, " ORDER BY f.added_date");
-    } else {
-      g_string_append(sql, " ORDER BY f.title COLLATE NOCASE");
+  if (relinked) {
+    /* Carry the stored identity (and content hash) over to the new path. */
+    const char *ids_sqls[] = {
+        "DELETE FROM file_ids WHERE file_path=?2",
+        "UPDATE file_ids SET file_path=?2 WHERE file_path=?1",
+        NULL,
+    };
+    for (int i = 0; ids_sqls[i] != NULL; i++) {
+      sqlite3_stmt *stmt;
+      if (sqlite3_prepare_v2(app->db, ids_sqls[i], -1, &stmt, NULL) !=
+          SQLITE_OK)
+        continue;
+      sqlite3_bind_text(stmt, 1, old_path, -1, SQLITE_STATIC);
+      sqlite3_bind_text(stmt, 2, new_path, -1, SQLITE_STATIC);
+      sqlite3_step(stmt);
+      sqlite3_finalize(stmt);
     }
-    g_string_append(sql, filter->sort_ascending ? " ASC" : " DESC");
-  } else {
-    g_string_append(sql, " ORDER BY f.title COLLATE NOCASE ASC");
   }
+  return relinked;
+}
 
-  sqlite3_stmt *stmt;
-  int rc = sqlite3_prepare_v2(app->db, sql->str, -1, &stmt, NULL);
-  g_string_free(sql, TRUE);
+GList *db_film_paths_without_oshash(ReelApp *app) {
+  const char *sql =
+      "SELECT p.file_path FROM ("
+      "  SELECT file_path FROM films WHERE media_type = 0"
+      "  UNION SELECT file_path FROM film_files) p "
+      "LEFT JOIN file_ids i ON i.file_path = p.file_path "
+      "WHERE i.oshash IS NULL";
 
-  if (rc != SQLITE_OK) {
-    g_printerr("Failed to query films: %s\n", sqlite3_errmsg(app->db));
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
     return NULL;
-  }
 
+  GList *paths = NULL;
   while (sqlite3_step(stmt) == SQLITE_ROW) {
-    Film *film = film_from_row(stmt);
-    films = g_list_append(films, film);
+    paths = g_list_prepend(
+        paths, g_strdup((const gchar *)sqlite3_column_text(stmt, 0)));
   }
 
   sqlite3_finalize(stmt);
-  return films;
+  return g_list_reverse(paths);
 }
 
-GList *db_films_get_unmatched(ReelApp *app) {
+gboolean db_file_id_set_oshash(ReelApp *app, const gchar *file_path,
+                               const FileId *id, const gchar *oshash) {
+  /* If the file changed since the scanner last saw it, drop the stale
+     fingerprint so the next scan recomputes it. */
   const char *sql =
-      "SELECT * FROM films WHERE match_status = 0 ORDER BY file_path";
+      "INSERT INTO file_ids (file_path, dev, ino, size, mtime, oshash) "
+      "VALUES (?, ?, ?, ?, ?, ?) "
+      "ON CONFLICT(file_path) DO UPDATE SET oshash=excluded.oshash, "
+      "fingerprint=CASE WHEN size=excluded.size AND mtime=excluded.mtime "
+      "THEN fingerprint END, "
+      "dev=excluded.dev, ino=excluded.ino, size=excluded.size, "
+      "mtime=excluded.mtime";
 
   sqlite3_stmt *stmt;
-  int rc = sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL);
-  if (rc != SQLITE_OK)
-    return NULL;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
 
-  GList *films = NULL;
-  while (sqlite3_step(stmt) == SQLITE_ROW) {
-    Film *film = film_from_row(stmt);
-    films = g_list_append(films, film);
-  }
+  sqlite3_bind_text(stmt, 1, file_path, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, id->dev);
+  sqlite3_bind_int64(stmt, 3, id->ino);
+  sqlite3_bind_int64(stmt, 4, id->size);
+  sqlite3_bind_int64(stmt, 5, id->mtime);
+  sqlite3_bind_text(stmt, 6, oshash, -1, SQLITE_STATIC);
 
+  int rc = sqlite3_step(stmt);
   sqlite3_finalize(stmt);
-  return films;
+  return rc == SQLITE_DONE;
 }
 
-gint db_films_count(ReelApp *app) {
-  const char *sql = "SELECT COUNT(*) FROM films";
+GList *db_film_paths_without_media_info(ReelApp *app) {
+  const char *sql =
+      "SELECT p.file_path FROM ("
+      "  SELECT file_path FROM films WHERE media_type = 0"
+      "  UNION SELECT file_path FROM film_files) p "
+      "LEFT JOIN file_ids i ON i.file_path = p.file_path "
+      "LEFT JOIN media_info m ON m.dev = i.dev AND m.ino = i.ino "
+      "AND m.mtime = i.mtime "
+      "WHERE m.dev IS NULL";
+
   sqlite3_stmt *stmt;
-  int count = 0;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return NULL;
 
-  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-      count = sqlite3_column_int(stmt, 0);
-    }
-    sqlite3_finalize(stmt);
+  GList *paths = NULL;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    paths = g_list_prepend(
+        paths, g_strdup((const gchar *)sqlite3_column_text(stmt, 0)));
   }
 
-  return count;
+  sqlite3_finalize(stmt);
+  return g_list_reverse(paths);
 }
 
-gint db_films_count_unmatched(ReelApp *app) {
-  const char *sql = "SELECT COUNT(*) FROM films WHERE match_status = 0";
-  sqlite3_stmt *stmt;
-  int count = 0;
+gboolean db_media_info_put(ReelApp *app, const gchar *file_path,
+                           const FileId *id, const MediaInfo *info) {
+  /* The path needs a current identity row for the lookup to find it */
+  const char *id_sql =
+      "INSERT INTO file_ids (file_path, dev, ino, size, mtime) "
+      "VALUES (?, ?, ?, ?, ?) "
+      "ON CONFLICT(file_path) DO UPDATE SET "
+      "fingerprint=CASE WHEN size=excluded.size AND mtime=excluded.mtime "
+      "THEN fingerprint END, "
+      "oshash=CASE WHEN size=excluded.size AND mtime=excluded.mtime "
+      "THEN oshash END, "
+      "dev=excluded.dev, ino=excluded.ino, size=excluded.size, "
+      "mtime=excluded.mtime";
+  const char *sql =
+      "INSERT OR REPLACE INTO media_info (dev, ino, mtime, size, "
+      "duration_ms, width, height, video_codec, audio_codecs, "
+      "audio_languages) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
 
-  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-      count = sqlite3_column_int(stmt, 0);
-    }
-    sqlite3_finalize(stmt);
-  }
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, id_sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+  sqlite3_bind_text(stmt, 1, file_path, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, id->dev);
+  sqlite3_bind_int64(stmt, 3, id->ino);
+  sqlite3_bind_int64(stmt, 4, id->size);
+  sqlite3_bind_int64(stmt, 5, id->mtime);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_DONE)
+    return FALSE;
 
-  return count;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+  sqlite3_bind_int64(stmt, 1, id->dev);
+  sqlite3_bind_int64(stmt, 2, id->ino);
+  sqlite3_bind_int64(stmt, 3, id->mtime);
+  sqlite3_bind_int64(stmt, 4, id->size);
+  sqlite3_bind_int64(stmt, 5, info->duration_ms);
+  sqlite3_bind_int(stmt, 6, info->width);
+  sqlite3_bind_int(stmt, 7, info->height);
+  sqlite3_bind_text(stmt, 8, info->video_codec, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 9, info->audio_codecs, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 10, info->audio_languages, -1, SQLITE_STATIC);
+  rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rc == SQLITE_DONE;
 }
 
-/* Genre operations */
+gboolean db_media_info_get(ReelApp *app, const gchar *file_path,
+                           MediaInfo *info) {
+  const char *sql =
+      "SELECT m.duration_ms, m.width, m.height, m.video_codec, "
+      "m.audio_codecs, m.audio_languages FROM file_ids i "
+      "JOIN media_info m ON m.dev = i.dev AND m.ino = i.ino "
+      "AND m.mtime = i.mtime WHERE i.file_path = ?";
 
-static gint db_get_or_create_genre(ReelApp *app, const gchar *name) {
-  /* Try to find existing */
-  const char *sql_find = "SELECT id FROM genres WHERE name = ?";
   sqlite3_stmt *stmt;
-  gint id = -1;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+  sqlite3_bind_text(stmt, 1, file_path, -1, SQLITE_STATIC);
 
-  if (sqlite3_prepare_v2(app->db, sql_find, -1, &stmt, NULL) == SQLITE_OK) {
-    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-      id = sqlite3_column_int(stmt, 0);
-    }
-    sqlite3_finalize(stmt);
+  gboolean found = FALSE;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    info->duration_ms = sqlite3_column_int64(stmt, 0);
+    info->width = sqlite3_column_int(stmt, 1);
+    info->height = sqlite3_column_int(stmt, 2);
+    info->video_codec = g_strdup((const gchar *)sqlite3_column_text(stmt, 3));
+    info->audio_codecs = g_strdup((const gchar *)sqlite3_column_text(stmt, 4));
+    info->audio_languages =
+        g_strdup((const gchar *)sqlite3_column_text(stmt, 5));
+    found = TRUE;
   }
 
-  if (id >= 0)
-    return id;
-
-  /* Create new */
-  const char *sql_insert = "INSERT INTO genres (name) VALUES (?)";
-  if (sqlite3_prepare_v2(app->db, sql_insert, -1, &stmt, NULL) == SQLITE_OK) {
-    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
-    if (sqlite3_step(stmt) == SQLITE_DONE) {
-      id = sqlite3_last_insert_rowid(app->db);
-    }
-    sqlite3_finalize(stmt);
-  }
+  sqlite3_finalize(stmt);
+  return found;
+}
 
-  return id;
+void media_info_clear(MediaInfo *info) {
+  if (!info)
+    return;
+  g_free(info->video_codec);
+  g_free(info->audio_codecs);
+  g_free(info->audio_languages);
+  info->video_codec = NULL;
+  info->audio_codecs = NULL;
+  info->audio_languages = NULL;
 }
 
-gboolean db_genre_add_to_film(ReelApp *app, gint64 film_id,
-                              const gchar *genre) {
-  gint genre_id = db_get_or_create_genre(app, genre);
-  if (genre_id < 0)
-    return FALSE;
+void film_version_free(FilmVersion *version) {
+  if (!version)
+    return;
+  g_free(version->title);
+  g_free(version->file_path);
+  g_free(version);
+}
 
+GList *db_film_versions_get(ReelApp *app, gint64 film_id) {
+  /* Other entries holding a byte-identical copy of one of this film's files,
+     then other entries matched to the same TMDB title. */
   const char *sql =
-      "INSERT OR IGNORE INTO film_genres (film_id, genre_id) VALUES (?, ?)";
-  sqlite3_stmt *stmt;
+      "SELECT f.id, f.title, f.year, h2.file_path, 1 FROM film_hashes h1 "
+      "JOIN film_hashes h2 ON h2.oshash = h1.oshash AND h2.film_id <> h1.film_id "
+      "JOIN films f ON f.id = h2.film_id "
+      "WHERE h1.film_id = ?1 "
+      "UNION "
+      "SELECT f.id, f.title, f.year, f.file_path, 0 FROM films f "
+      "JOIN films me ON me.id = ?1 "
+      "WHERE f.id <> me.id AND me.tmdb_id > 0 AND f.tmdb_id = me.tmdb_id "
+      "AND f.media_type = me.media_type "
+      "AND f.season_number = me.season_number "
+      "AND f.id NOT IN (SELECT h2.film_id FROM film_hashes h1 "
+      "  JOIN film_hashes h2 ON h2.oshash = h1.oshash "
+      "  WHERE h1.film_id = ?1) "
+      "ORDER BY 5 DESC, 4";
 
+  sqlite3_stmt *stmt;
   if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
-    return FALSE;
+    return NULL;
 
   sqlite3_bind_int64(stmt, 1, film_id);
-  sqlite3_bind_int(stmt, 2, genre_id);
 
-  int rc = sqlite3_step(stmt);
-  sqlite3_finalize(stmt);
+  GList *versions = NULL;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    FilmVersion *version = g_new0(FilmVersion, 1);
+    version->film_id = sqlite3_column_int64(stmt, 0);
+    version->title = g_strdup((const gchar *)sqlite3_column_text(stmt, 1));
+    version->year = sqlite3_column_int(stmt, 2);
+    version->file_path = g_strdup((const gchar *)sqlite3_column_text(stmt, 3));
+    version->identical = sqlite3_column_int(stmt, 4) != 0;
+    versions = g_list_append(versions, version);
+  }
 
-  return rc == SQLITE_DONE;
+  sqlite3_finalize(stmt);
+  return versions;
 }
 
-GList *db_genres_get_for_film(ReelApp *app, gint64 film_id) {
-  const char *sql = "SELECT g.name FROM genres g"
-                    " JOIN film_genres fg ON g.id = fg.genre_id"
-                    " WHERE fg.film_id = ?"
-                    " ORDER BY g.name";
+/* Scan bookkeeping (mark-and-sweep) */
 
-  sqlite3_stmt *stmt;
-  GList *genres = NULL;
+gboolean db_begin(ReelApp *app) {
+  return sqlite3_exec(app->db, "BEGIN IMMEDIATE", NULL, NULL, NULL) ==
+         SQLITE_OK;
+}
 
-  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-    sqlite3_bind_int64(stmt, 1, film_id);
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-      genres = g_list_append(
-          genres, g_strdup((const gchar *)sqlite3_column_text(stmt, 0)));
+gboolean db_commit(ReelApp *app) {
+  char *err_msg = NULL;
+  if (sqlite3_exec(app->db, "COMMIT", NULL, NULL, &err_msg) != SQLITE_OK) {
+    g_printerr("Failed to commit: %s\n", err_msg);
+    sqlite3_free(err_msg);
+    sqlite3_exec(app->db, "ROLLBACK", NULL, NULL, NULL);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+gint64 db_scan_generation_next(ReelApp *app) {
+  const char *sql =
+      "INSERT INTO meta (key, value) VALUES ('scan_gen', '1') "
+      "ON CONFLICT(key) DO UPDATE SET value = CAST(value AS INTEGER) + 1";
+  if (sqlite3_exec(app->db, sql, NULL, NULL, NULL) != SQLITE_OK)
+    return 0;
+
+  gint64 gen = 0;
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db,
+                         "SELECT CAST(value AS INTEGER) FROM meta "
+                         "WHERE key = 'scan_gen'",
+                         -1, &stmt, NULL) == SQLITE_OK) {
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      gen = sqlite3_column_int64(stmt, 0);
+    sqlite3_finalize(stmt);
+  }
+  return gen;
+}
+
+gboolean db_file_mark_seen(ReelApp *app, const gchar *file_path,
+                           gint64 scan_gen, gint64 now) {
+  const char *sqls[] = {
+      "UPDATE films SET seen_gen=?, last_seen=? WHERE file_path=?",
+      "UPDATE film_files SET seen_gen=?, last_seen=? WHERE file_path=?",
+      "UPDATE episodes SET seen_gen=?, last_seen=? WHERE file_path=?",
+      NULL,
+  };
+
+  gboolean tracked = FALSE;
+  for (int i = 0; sqls[i] != NULL; i++) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(app->db, sqls[i], -1, &stmt, NULL) != SQLITE_OK)
+      continue;
+
+    sqlite3_bind_int64(stmt, 1, scan_gen);
+    sqlite3_bind_int64(stmt, 2, now);
+    sqlite3_bind_text(stmt, 3, file_path, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_DONE && sqlite3_changes(app->db) > 0)
+      tracked = TRUE;
+    sqlite3_finalize(stmt);
+  }
+  return tracked;
+}
+
+gint db_sweep_unseen(ReelApp *app, const gchar *root, gint64 scan_gen,
+                     gint64 cutoff) {
+  /* Episodes and attachments go first so their rows are counted; deleting a
+     film cascades to whatever is left of its children. The prefix test uses
+     substr() rather than LIKE so '%' and '_' in paths are not wildcards. */
+  const char *sqls[] = {
+      "DELETE FROM episodes WHERE seen_gen<>? AND last_seen<? "
+      "AND (file_path=? OR substr(file_path, 1, length(?4))=?4)",
+      "DELETE FROM film_files WHERE seen_gen<>? AND last_seen<? "
+      "AND (file_path=? OR substr(file_path, 1, length(?4))=?4)",
+      "DELETE FROM films WHERE seen_gen<>? AND last_seen<? "
+      "AND (file_path=? OR substr(file_path, 1, length(?4))=?4)",
+      NULL,
+  };
+
+  gchar *prefix = g_str_has_suffix(root, G_DIR_SEPARATOR_S)
+                      ? g_strdup(root)
+                      : g_strconcat(root, G_DIR_SEPARATOR_S, NULL);
+
+  if (!db_begin(app)) {
+    g_free(prefix);
+    return 0;
+  }
+
+  gint removed = 0;
+  for (int i = 0; sqls[i] != NULL; i++) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(app->db, sqls[i], -1, &stmt, NULL) != SQLITE_OK) {
+      g_printerr("Failed to prepare sweep: %s\n", sqlite3_errmsg(app->db));
+      continue;
+    }
+
+    sqlite3_bind_int64(stmt, 1, scan_gen);
+    sqlite3_bind_int64(stmt, 2, cutoff);
+    sqlite3_bind_text(stmt, 3, root, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 4, prefix, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_DONE)
+      removed += sqlite3_changes(app->db);
+    sqlite3_finalize(stmt);
+  }
+
+  /* Drop identities of files that are no longer tracked anywhere, and the
+     probe results of their inodes unless another tracked path shares one. */
+  const char *ids_sqls[] = {
+      "DELETE FROM media_info WHERE EXISTS (SELECT 1 FROM file_ids i "
+      "WHERE i.dev=media_info.dev AND i.ino=media_info.ino "
+      "AND (i.file_path=?1 OR substr(i.file_path, 1, length(?2))=?2) "
+      "AND i.file_path NOT IN (SELECT file_path FROM films) "
+      "AND i.file_path NOT IN (SELECT file_path FROM film_files)) "
+      "AND NOT EXISTS (SELECT 1 FROM file_ids k "
+      "WHERE k.dev=media_info.dev AND k.ino=media_info.ino "
+      "AND (k.file_path IN (SELECT file_path FROM films) "
+      "OR k.file_path IN (SELECT file_path FROM film_files)))",
+      "DELETE FROM file_ids WHERE (file_path=? OR substr(file_path, 1, "
+      "length(?2))=?2) "
+      "AND file_path NOT IN (SELECT file_path FROM films) "
+      "AND file_path NOT IN (SELECT file_path FROM film_files)",
+      NULL,
+  };
+  for (int i = 0; ids_sqls[i] != NULL; i++) {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(app->db, ids_sqls[i], -1, &stmt, NULL) !=
+        SQLITE_OK) {
+      g_printerr("Failed to prepare sweep: %s\n", sqlite3_errmsg(app->db));
+      continue;
+    }
+    sqlite3_bind_text(stmt, 1, root, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, prefix, -1, SQLITE_STATIC);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+  }
+
+  /* Shows none of whose seasons are left */
+  db_shows_delete_orphans(app);
+  db_commit(app);
+  g_free(prefix);
+  return removed;
+}
+
+Film *db_film_get_by_id(ReelApp *app, gint64 film_id) {
+  const char *sql = "SELECT * FROM films WHERE id=?";
+
+  sqlite3_stmt *stmt;
+  int rc = sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL);
+  if (rc != SQLITE_OK)
+    return NULL;
+
+  sqlite3_bind_int64(stmt, 1, film_id);
+
+  Film *film = NULL;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    film = film_from_row(stmt);
+  }
+
+  sqlite3_finalize(stmt);
+  return film;
+}
+
+Film *db_film_get_by_path(ReelApp *app, const gchar *file_path) {
+  const char *sql = "SELECT * FROM films WHERE file_path=?";
+
+  sqlite3_stmt *stmt;
+  int rc = sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL);
+  if (rc != SQLITE_OK)
+    return NULL;
+
+  sqlite3_bind_text(stmt, 1, file_path, -1, SQLITE_STATIC);
+
+  Film *film = NULL;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    film = film_from_row(stmt);
+  }
+
+  sqlite3_finalize(stmt);
+  return film;
+}
+
+GList *db_films_get_all(ReelApp *app, const FilterState *filter) {
+  GString *sql = build_films_query(filter, FALSE, 0, 0);
+  GList *films = NULL;
+
+  sqlite3_stmt *stmt;
+  int rc = sqlite3_prepare_v2(app->db, sql->str, -1, &stmt, NULL);
+  g_string_free(sql, TRUE);
+
+  if (rc != SQLITE_OK) {
+    g_printerr("Failed to query films: %s\n", sqlite3_errmsg(app->db));
+    return NULL;
+  }
+
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    Film *film = film_from_row(stmt);
+    films = g_list_append(films, film);
+  }
+
+  sqlite3_finalize(stmt);
+  return films;
+}
+
+gboolean db_library_stats(ReelApp *app, LibraryStats *stats) {
+  const char *sql =
+      "SELECT "
+      "(SELECT COUNT(*) FROM films WHERE media_type = 0), "
+      "(SELECT COUNT(*) FROM films WHERE media_type = 1), "
+      "(SELECT COUNT(*) FROM episodes), "
+      "(SELECT COUNT(*) FROM films WHERE match_status = 0), "
+      "(SELECT COUNT(*) FROM file_ids WHERE oshash IS NOT NULL), "
+      "(SELECT COUNT(DISTINCT h1.film_id) FROM film_hashes h1 "
+      " JOIN film_hashes h2 ON h2.oshash = h1.oshash "
+      " AND h2.film_id <> h1.film_id)";
+  sqlite3_stmt *stmt;
+  memset(stats, 0, sizeof(*stats));
+
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    g_printerr("Failed to prepare stats: %s\n", sqlite3_errmsg(app->db));
+    return FALSE;
+  }
+
+  gboolean ok = FALSE;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    stats->films = sqlite3_column_int(stmt, 0);
+    stats->seasons = sqlite3_column_int(stmt, 1);
+    stats->episodes = sqlite3_column_int(stmt, 2);
+    stats->unmatched = sqlite3_column_int(stmt, 3);
+    stats->files_hashed = sqlite3_column_int(stmt, 4);
+    stats->duplicates = sqlite3_column_int(stmt, 5);
+    ok = TRUE;
+  }
+
+  sqlite3_finalize(stmt);
+  return ok;
+}
+
+gint db_films_count(ReelApp *app) {
+  const char *sql = "SELECT COUNT(*) FROM films";
+  sqlite3_stmt *stmt;
+  int count = 0;
+
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      count = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+  }
+
+  return count;
+}
+
+gint db_films_count_unmatched(ReelApp *app) {
+  const char *sql = "SELECT COUNT(*) FROM films WHERE match_status = 0";
+  sqlite3_stmt *stmt;
+  int count = 0;
+
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      count = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+  }
+
+  return count;
+}
+
+/* Scrape queue */
+
+gboolean db_scrape_job_enqueue(ReelApp *app, gint64 film_id) {
+  /* Queuing a film again gives it a fresh start */
+  const char *sql =
+      "INSERT INTO scrape_jobs (film_id, enqueued) VALUES (?, ?) "
+      "ON CONFLICT(film_id) DO UPDATE SET attempts=0, next_attempt=0, "
+      "last_error=NULL";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  sqlite3_bind_int64(stmt, 1, film_id);
+  sqlite3_bind_int64(stmt, 2, g_get_real_time() / G_USEC_PER_SEC);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rc == SQLITE_DONE;
+}
+
+GList *db_scrape_jobs_claim(ReelApp *app, const gchar *owner, gint64 now,
+                            gint64 lease_until, gint limit) {
+  /* Sorted by path so a show's seasons are claimed together. The write
+     lock is taken up front so two runs can't claim the same job. */
+  const char *sql =
+      "SELECT f.* FROM scrape_jobs j JOIN films f ON f.id = j.film_id "
+      "WHERE j.next_attempt <= ?1 AND j.lease_until <= ?1 "
+      "AND f.match_status = 0 ORDER BY f.file_path LIMIT ?2";
+  const char *lease_sql =
+      "UPDATE scrape_jobs SET lease_owner=?, lease_until=? WHERE film_id=?";
+
+  if (!db_begin(app))
+    return NULL;
+
+  sqlite3_stmt *stmt;
+  sqlite3_stmt *lease;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    g_printerr("Failed to prepare claim: %s\n", sqlite3_errmsg(app->db));
+    sqlite3_exec(app->db, "ROLLBACK", NULL, NULL, NULL);
+    return NULL;
+  }
+  if (sqlite3_prepare_v2(app->db, lease_sql, -1, &lease, NULL) != SQLITE_OK) {
+    g_printerr("Failed to prepare claim: %s\n", sqlite3_errmsg(app->db));
+    sqlite3_finalize(stmt);
+    sqlite3_exec(app->db, "ROLLBACK", NULL, NULL, NULL);
+    return NULL;
+  }
+
+  sqlite3_bind_int64(stmt, 1, now);
+  sqlite3_bind_int(stmt, 2, limit);
+  sqlite3_bind_text(lease, 1, owner, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(lease, 2, lease_until);
+
+  GList *films = NULL;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    Film *film = film_from_row(stmt);
+    sqlite3_bind_int64(lease, 3, film->id);
+    sqlite3_step(lease);
+    sqlite3_reset(lease);
+    films = g_list_prepend(films, film);
+  }
+  sqlite3_finalize(lease);
+  sqlite3_finalize(stmt);
+
+  if (!db_commit(app)) {
+    g_list_free_full(films, (GDestroyNotify)film_free);
+    return NULL;
+  }
+  return g_list_reverse(films);
+}
+
+static gboolean db_scrape_jobs_lease(ReelApp *app, const gchar *owner,
+                                     gint64 lease_until) {
+  const char *sql = lease_until > 0
+                        ? "UPDATE scrape_jobs SET lease_until=?2 "
+                          "WHERE lease_owner=?1"
+                        : "UPDATE scrape_jobs SET lease_owner=NULL, "
+                          "lease_until=0 WHERE lease_owner=?1";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  sqlite3_bind_text(stmt, 1, owner, -1, SQLITE_STATIC);
+  if (lease_until > 0)
+    sqlite3_bind_int64(stmt, 2, lease_until);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rc == SQLITE_DONE;
+}
+
+gboolean db_scrape_jobs_renew(ReelApp *app, const gchar *owner,
+                              gint64 lease_until) {
+  return db_scrape_jobs_lease(app, owner, lease_until);
+}
+
+gboolean db_scrape_jobs_release(ReelApp *app, const gchar *owner) {
+  return db_scrape_jobs_lease(app, owner, 0);
+}
+
+GList *db_scrape_jobs_owners(ReelApp *app) {
+  const char *sql = "SELECT DISTINCT lease_owner FROM scrape_jobs "
+                    "WHERE lease_owner IS NOT NULL";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return NULL;
+
+  GList *owners = NULL;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    owners = g_list_prepend(
+        owners, g_strdup((const gchar *)sqlite3_column_text(stmt, 0)));
+  }
+
+  sqlite3_finalize(stmt);
+  return owners;
+}
+
+gboolean db_scrape_job_done(ReelApp *app, gint64 film_id) {
+  const char *sql = "DELETE FROM scrape_jobs WHERE film_id=?";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  sqlite3_bind_int64(stmt, 1, film_id);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rc == SQLITE_DONE;
+}
+
+gboolean db_scrape_job_failed(ReelApp *app, gint64 film_id,
+                              const gchar *error, gint64 now,
+                              gint64 retry_base, gint64 retry_max) {
+  /* The wait doubles with every attempt */
+  const char *sql =
+      "UPDATE scrape_jobs SET attempts=attempts+1, last_error=?2, "
+      "next_attempt=?3 + MIN(?4 << MIN(attempts, 20), ?5), "
+      "lease_owner=NULL, lease_until=0 WHERE film_id=?1";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  sqlite3_bind_int64(stmt, 1, film_id);
+  sqlite3_bind_text(stmt, 2, error, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 3, now);
+  sqlite3_bind_int64(stmt, 4, retry_base);
+  sqlite3_bind_int64(stmt, 5, retry_max);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rc == SQLITE_DONE;
+}
+
+gboolean db_scrape_queue_stats(ReelApp *app, gint64 now,
+                               ScrapeQueueStats *stats) {
+  const char *sql =
+      "SELECT COUNT(*), "
+      "COALESCE(SUM(next_attempt <= ?1 AND lease_until <= ?1), 0), "
+      "COALESCE(SUM(attempts > 0), 0), "
+      "COALESCE(SUM(lease_owner IS NOT NULL), 0) "
+      "FROM scrape_jobs";
+  memset(stats, 0, sizeof(*stats));
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  sqlite3_bind_int64(stmt, 1, now);
+  gboolean ok = FALSE;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    stats->queued = sqlite3_column_int(stmt, 0);
+    stats->due = sqlite3_column_int(stmt, 1);
+    stats->retrying = sqlite3_column_int(stmt, 2);
+    stats->leased = sqlite3_column_int(stmt, 3);
+    ok = TRUE;
+  }
+  sqlite3_finalize(stmt);
+  return ok;
+}
+
+/* TMDB misses */
+
+static sqlite3_stmt *db_tmdb_miss_prepare(ReelApp *app, const char *sql,
+                                          const gchar *query, gint year,
+                                          gboolean tv) {
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return NULL;
+
+  sqlite3_bind_text(stmt, 1, query, -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 2, year);
+  sqlite3_bind_int(stmt, 3, tv ? 1 : 0);
+  return stmt;
+}
+
+gboolean db_tmdb_miss_get(ReelApp *app, const gchar *query, gint year,
+                          gboolean tv, TmdbMiss *miss) {
+  sqlite3_stmt *stmt = db_tmdb_miss_prepare(
+      app,
+      "SELECT misses, checked, recheck_at, saved FROM tmdb_misses "
+      "WHERE query=? AND year=? AND tv=?",
+      query, year, tv);
+  if (!stmt)
+    return FALSE;
+
+  gboolean found = FALSE;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    miss->misses = sqlite3_column_int(stmt, 0);
+    miss->checked = sqlite3_column_int64(stmt, 1);
+    miss->recheck_at = sqlite3_column_int64(stmt, 2);
+    miss->saved = sqlite3_column_int(stmt, 3);
+    found = TRUE;
+  }
+
+  sqlite3_finalize(stmt);
+  return found;
+}
+
+gboolean db_tmdb_miss_put(ReelApp *app, const gchar *query, gint year,
+                          gboolean tv, gint64 now, gint64 recheck_base,
+                          gint64 recheck_max) {
+  /* Only a miss found after the re-check time counts again, so films
+     sharing one search don't each double the wait */
+  sqlite3_stmt *stmt = db_tmdb_miss_prepare(
+      app,
+      "INSERT INTO tmdb_misses (query, year, tv, checked, recheck_at) "
+      "VALUES (?1, ?2, ?3, ?4, ?4 + ?5) "
+      "ON CONFLICT(query, year, tv) DO UPDATE SET misses=misses+1, "
+      "checked=?4, recheck_at=?4 + MIN(?5 << MIN(misses, 20), ?6) "
+      "WHERE recheck_at <= ?4",
+      query, year, tv);
+  if (!stmt)
+    return FALSE;
+
+  sqlite3_bind_int64(stmt, 4, now);
+  sqlite3_bind_int64(stmt, 5, recheck_base);
+  sqlite3_bind_int64(stmt, 6, recheck_max);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rc == SQLITE_DONE;
+}
+
+gboolean db_tmdb_miss_saved(ReelApp *app, const gchar *query, gint year,
+                            gboolean tv) {
+  sqlite3_stmt *stmt = db_tmdb_miss_prepare(
+      app,
+      "UPDATE tmdb_misses SET saved=saved+1 "
+      "WHERE query=? AND year=? AND tv=?",
+      query, year, tv);
+  if (!stmt)
+    return FALSE;
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rc == SQLITE_DONE;
+}
+
+gboolean db_tmdb_miss_clear(ReelApp *app, const gchar *query, gint year,
+                            gboolean tv) {
+  sqlite3_stmt *stmt = db_tmdb_miss_prepare(
+      app, "DELETE FROM tmdb_misses WHERE query=? AND year=? AND tv=?", query,
+      year, tv);
+  if (!stmt)
+    return FALSE;
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rc == SQLITE_DONE;
+}
+
+gboolean db_tmdb_miss_stats(ReelApp *app, gint *entries, gint *saved) {
+  const char *sql =
+      "SELECT COUNT(*), COALESCE(SUM(saved), 0) FROM tmdb_misses";
+  *entries = 0;
+  *saved = 0;
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  gboolean ok = FALSE;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    *entries = sqlite3_column_int(stmt, 0);
+    *saved = sqlite3_column_int(stmt, 1);
+    ok = TRUE;
+  }
+  sqlite3_finalize(stmt);
+  return ok;
+}
+
+/* TMDB title index */
+
+/* Rows written per transaction while importing, so other connections
+   aren't locked out for the whole file */
+#define TITLE_IMPORT_BATCH 20000
+
+struct _TmdbTitleImport {
+  ReelApp *app;
+  sqlite3_stmt *upsert;
+  gint64 stamp;      /* Marks the rows this import has seen */
+  gint pending;      /* Rows since the last commit */
+  gboolean kinds[2]; /* Films and shows were in the file */
+};
+
+TmdbTitleImport *db_tmdb_titles_import_begin(ReelApp *app) {
+  /* Titles keep the year learned from their details across imports */
+  const char *sql =
+      "INSERT INTO tmdb_titles (tv, tmdb_id, title_key, popularity, imported) "
+      "VALUES (?, ?, ?, ?, ?) "
+      "ON CONFLICT(tv, tmdb_id) DO UPDATE SET title_key=excluded.title_key, "
+      "popularity=excluded.popularity, imported=excluded.imported";
+
+  TmdbTitleImport *import = g_new0(TmdbTitleImport, 1);
+  import->app = app;
+  import->stamp = g_get_real_time() / G_USEC_PER_SEC;
+
+  /* Two imports in the same second still need different stamps */
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, "SELECT MAX(imported) FROM tmdb_titles", -1,
+                         &stmt, NULL) == SQLITE_OK) {
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+      import->stamp = MAX(import->stamp, sqlite3_column_int64(stmt, 0) + 1);
+    sqlite3_finalize(stmt);
+  }
+
+  if (sqlite3_prepare_v2(app->db, sql, -1, &import->upsert, NULL) !=
+      SQLITE_OK) {
+    g_printerr("Failed to prepare title import: %s\n",
+               sqlite3_errmsg(app->db));
+    g_free(import);
+    return NULL;
+  }
+  if (!db_begin(app)) {
+    g_printerr("Failed to start title import: %s\n", sqlite3_errmsg(app->db));
+    sqlite3_finalize(import->upsert);
+    g_free(import);
+    return NULL;
+  }
+  return import;
+}
+
+gboolean db_tmdb_titles_import_add(TmdbTitleImport *import, gboolean tv,
+                                   gint tmdb_id, const gchar *title_key,
+                                   gdouble popularity) {
+  sqlite3_stmt *stmt = import->upsert;
+  sqlite3_bind_int(stmt, 1, tv ? 1 : 0);
+  sqlite3_bind_int(stmt, 2, tmdb_id);
+  sqlite3_bind_text(stmt, 3, title_key, -1, SQLITE_STATIC);
+  sqlite3_bind_double(stmt, 4, popularity);
+  sqlite3_bind_int64(stmt, 5, import->stamp);
+  int rc = sqlite3_step(stmt);
+  sqlite3_reset(stmt);
+  if (rc != SQLITE_DONE) {
+    g_printerr("Failed to import title %d: %s\n", tmdb_id,
+               sqlite3_errmsg(import->app->db));
+    return FALSE;
+  }
+
+  import->kinds[tv ? 1 : 0] = TRUE;
+  if (++import->pending >= TITLE_IMPORT_BATCH) {
+    import->pending = 0;
+    if (!db_commit(import->app) || !db_begin(import->app))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+gint db_tmdb_titles_import_end(TmdbTitleImport *import, gboolean complete) {
+  ReelApp *app = import->app;
+  gint removed = 0;
+
+  /* A full export lists every title of its kind; the rest were removed
+     from TMDB. A partial import only adds. */
+  for (gint tv = 0; complete && tv < 2; tv++) {
+    if (!import->kinds[tv])
+      continue;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(app->db,
+                           "DELETE FROM tmdb_titles WHERE tv=? AND imported<?",
+                           -1, &stmt, NULL) != SQLITE_OK)
+      continue;
+    sqlite3_bind_int(stmt, 1, tv);
+    sqlite3_bind_int64(stmt, 2, import->stamp);
+    if (sqlite3_step(stmt) == SQLITE_DONE)
+      removed += sqlite3_changes(app->db);
+    sqlite3_finalize(stmt);
+  }
+
+  sqlite3_finalize(import->upsert);
+  gboolean ok = db_commit(app);
+  g_free(import);
+  return ok ? removed : -1;
+}
+
+GList *db_tmdb_titles_find(ReelApp *app, const gchar *title_key, gboolean tv,
+                           gint limit) {
+  const char *sql = "SELECT tmdb_id, year, popularity FROM tmdb_titles "
+                    "WHERE tv=? AND title_key=? "
+                    "ORDER BY popularity DESC LIMIT ?";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return NULL;
+
+  sqlite3_bind_int(stmt, 1, tv ? 1 : 0);
+  sqlite3_bind_text(stmt, 2, title_key, -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 3, limit);
+
+  GList *titles = NULL;
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    TmdbTitle *title = g_new0(TmdbTitle, 1);
+    title->tmdb_id = sqlite3_column_int(stmt, 0);
+    title->year = sqlite3_column_int(stmt, 1);
+    title->popularity = sqlite3_column_double(stmt, 2);
+    titles = g_list_prepend(titles, title);
+  }
+  sqlite3_finalize(stmt);
+  return g_list_reverse(titles);
+}
+
+gboolean db_tmdb_title_set_year(ReelApp *app, gboolean tv, gint tmdb_id,
+                                gint year) {
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db,
+                         "UPDATE tmdb_titles SET year=? "
+                         "WHERE tv=? AND tmdb_id=? AND year!=?",
+                         -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  sqlite3_bind_int(stmt, 1, year);
+  sqlite3_bind_int(stmt, 2, tv ? 1 : 0);
+  sqlite3_bind_int(stmt, 3, tmdb_id);
+  sqlite3_bind_int(stmt, 4, year);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  return rc == SQLITE_DONE;
+}
+
+gint db_tmdb_titles_count(ReelApp *app) {
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, "SELECT COUNT(*) FROM tmdb_titles", -1,
+                         &stmt, NULL) != SQLITE_OK)
+    return 0;
+
+  gint count = 0;
+  if (sqlite3_step(stmt) == SQLITE_ROW)
+    count = sqlite3_column_int(stmt, 0);
+  sqlite3_finalize(stmt);
+  return count;
+}
+
+/* Genre operations */
+
+static gint db_get_or_create_genre(ReelApp *app, const gchar *name) {
+  /* Try to find existing */
+  const char *sql_find = "SELECT id FROM genres WHERE name = ?";
+  sqlite3_stmt *stmt;
+  gint id = -1;
+
+  if (sqlite3_prepare_v2(app->db, sql_find, -1, &stmt, NULL) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      id = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+  }
+
+  if (id >= 0)
+    return id;
+
+  /* Create new */
+  const char *sql_insert = "INSERT INTO genres (name) VALUES (?)";
+  if (sqlite3_prepare_v2(app->db, sql_insert, -1, &stmt, NULL) == SQLITE_OK) {
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) == SQLITE_DONE) {
+      id = sqlite3_last_insert_rowid(app->db);
+    }
+    sqlite3_finalize(stmt);
+  }
+
+  return id;
+}
+
+gboolean db_genre_add_to_film(ReelApp *app, gint64 film_id,
+                              const gchar *genre) {
+  gint genre_id = db_get_or_create_genre(app, genre);
+  if (genre_id < 0)
+    return FALSE;
+
+  const char *sql =
+      "INSERT OR IGNORE INTO film_genres (film_id, genre_id) VALUES (?, ?)";
+  sqlite3_stmt *stmt;
+
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  sqlite3_bind_int64(stmt, 1, film_id);
+  sqlite3_bind_int(stmt, 2, genre_id);
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+
+  return rc == SQLITE_DONE;
+}
+
+GList *db_genres_get_for_film(ReelApp *app, gint64 film_id) {
+  /* A season's genres are its show's */
+  const char *sql = "SELECT g.name FROM genres g"
+                    " JOIN film_genres fg ON g.id = fg.genre_id"
+                    " WHERE fg.film_id = ?1"
+                    " UNION"
+                    " SELECT g.name FROM genres g"
+                    " JOIN show_genres sg ON g.id = sg.genre_id"
+                    " JOIN films f ON f.show_id = sg.show_id"
+                    " WHERE f.id = ?1"
+                    " ORDER BY 1";
+
+  sqlite3_stmt *stmt;
+  GList *genres = NULL;
+
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+    sqlite3_bind_int64(stmt, 1, film_id);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      genres = g_list_append(
+          genres, g_strdup((const gchar *)sqlite3_column_text(stmt, 0)));
     }
     sqlite3_finalize(stmt);
   }
@@ -775,6 +1896,119 @@ GList *db_genres_get_all(ReelApp *app) {
   return genres;
 }
 
+/* Show operations */
+
+gint64 db_show_upsert(ReelApp *app, const Show *show) {
+  const char *sql =
+      "INSERT INTO shows (tmdb_id, name, overview, poster_path, year) "
+      "VALUES (?, ?, ?, ?, ?) "
+      "ON CONFLICT(tmdb_id) DO UPDATE SET name=excluded.name, "
+      "overview=excluded.overview, poster_path=excluded.poster_path, "
+      "year=excluded.year";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    g_printerr("Failed to prepare show upsert: %s\n", sqlite3_errmsg(app->db));
+    return 0;
+  }
+
+  sqlite3_bind_int(stmt, 1, show->tmdb_id);
+  sqlite3_bind_text(stmt, 2, show->name, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 3, show->overview, -1, SQLITE_STATIC);
+  sqlite3_bind_text(stmt, 4, show->poster_path, -1, SQLITE_STATIC);
+  sqlite3_bind_int(stmt, 5, show->year);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+  if (rc != SQLITE_DONE) {
+    g_printerr("Failed to store show: %s\n", sqlite3_errmsg(app->db));
+    return 0;
+  }
+
+  /* last_insert_rowid() is not set when the row already existed */
+  Show *stored = db_show_get_by_tmdb(app, show->tmdb_id);
+  gint64 id = stored ? stored->id : 0;
+  show_free(stored);
+  return id;
+}
+
+Show *db_show_get_by_tmdb(ReelApp *app, gint tmdb_id) {
+  const char *sql = "SELECT id, tmdb_id, name, overview, poster_path, year "
+                    "FROM shows WHERE tmdb_id = ?";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return NULL;
+
+  sqlite3_bind_int(stmt, 1, tmdb_id);
+
+  Show *show = NULL;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    show = g_new0(Show, 1);
+    show->id = sqlite3_column_int64(stmt, 0);
+    show->tmdb_id = sqlite3_column_int(stmt, 1);
+    show->name = g_strdup((const gchar *)sqlite3_column_text(stmt, 2));
+    show->overview = g_strdup((const gchar *)sqlite3_column_text(stmt, 3));
+    show->poster_path = g_strdup((const gchar *)sqlite3_column_text(stmt, 4));
+    show->year = sqlite3_column_int(stmt, 5);
+  }
+
+  sqlite3_finalize(stmt);
+  return show;
+}
+
+gboolean db_show_clear_genres(ReelApp *app, gint64 show_id) {
+  const char *sql = "DELETE FROM show_genres WHERE show_id = ?";
+
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  sqlite3_bind_int64(stmt, 1, show_id);
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+
+  return rc == SQLITE_DONE;
+}
+
+gboolean db_genre_add_to_show(ReelApp *app, gint64 show_id,
+                              const gchar *genre) {
+  gint genre_id = db_get_or_create_genre(app, genre);
+  if (genre_id < 0)
+    return FALSE;
+
+  const char *sql =
+      "INSERT OR IGNORE INTO show_genres (show_id, genre_id) VALUES (?, ?)";
+  sqlite3_stmt *stmt;
+
+  if (sqlite3_prepare_v2(app->db, sql, -1, &stmt, NULL) != SQLITE_OK)
+    return FALSE;
+
+  sqlite3_bind_int64(stmt, 1, show_id);
+  sqlite3_bind_int(stmt, 2, genre_id);
+
+  int rc = sqlite3_step(stmt);
+  sqlite3_finalize(stmt);
+
+  return rc == SQLITE_DONE;
+}
+
+gint db_shows_delete_orphans(ReelApp *app) {
+  const char *sql = "DELETE FROM shows WHERE NOT EXISTS "
+                    "(SELECT 1 FROM films f WHERE f.show_id = shows.id)";
+  if (sqlite3_exec(app->db, sql, NULL, NULL, NULL) != SQLITE_OK)
+    return 0;
+  return sqlite3_changes(app->db);
+}
+
+void show_free(Show *show) {
+  if (!show)
+    return;
+  g_free(show->name);
+  g_free(show->overview);
+  g_free(show->poster_path);
+  g_free(show);
+}
+
 /* Actor operations */
 
 static gint db_get_or_create_actor(ReelApp *app, const gchar *name,
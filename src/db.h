@@ -13,6 +13,15 @@ typedef struct {
   gint sort_order;
 } FilmFile;
 
+/* Identity of a tracked film file, used to follow moves and renames */
+typedef struct {
+  gint64 dev;
+  gint64 ino;
+  gint64 size;
+  gint64 mtime;
+  gchar *fingerprint; /* Hash of size + first/last blocks */
+} FileId;
+
 /* Database initialization */
 gboolean db_init(ReelApp *app);
 void db_close(ReelApp *app);
@@ -29,10 +38,96 @@ Film *db_film_get_by_path(ReelApp *app, const gchar *file_path);
 
 /* Film queries */
 GList *db_films_get_all(ReelApp *app, const FilterState *filter);
-GList *db_films_get_unmatched(ReelApp *app);
 gint db_films_count(ReelApp *app);
 gint db_films_count_unmatched(ReelApp *app);
 
+/* Scrape queue: a job per film that still needs TMDB metadata. Runs claim
+   jobs under a lease (unix seconds) that they renew while working and
+   release when they stop. A job is claimed again once its lease runs out,
+   e.g. because the app was closed mid-run, or once its owner releases it.
+   A failed job is retried retry_base seconds later, doubling per attempt
+   up to retry_max. db_scrape_jobs_claim() returns the films (Film*) of the
+   jobs it leased. */
+typedef struct {
+  gint queued;   /* Every job */
+  gint due;      /* Ready to be claimed now */
+  gint retrying; /* Failed at least once */
+  gint leased;   /* Held by a run, or left behind by one that was cut off */
+} ScrapeQueueStats;
+
+gboolean db_scrape_job_enqueue(ReelApp *app, gint64 film_id);
+GList *db_scrape_jobs_claim(ReelApp *app, const gchar *owner, gint64 now,
+                            gint64 lease_until, gint limit);
+gboolean db_scrape_jobs_renew(ReelApp *app, const gchar *owner,
+                              gint64 lease_until);
+gboolean db_scrape_jobs_release(ReelApp *app, const gchar *owner);
+GList *db_scrape_jobs_owners(ReelApp *app); /* gchar* holding leases */
+gboolean db_scrape_job_done(ReelApp *app, gint64 film_id);
+gboolean db_scrape_job_failed(ReelApp *app, gint64 film_id,
+                              const gchar *error, gint64 now,
+                              gint64 retry_base, gint64 retry_max);
+gboolean db_scrape_queue_stats(ReelApp *app, gint64 now,
+                               ScrapeQueueStats *stats);
+
+/* TMDB searches that found no match, keyed by the cleaned-up query, year
+   and kind (film or TV). A search is not sent again before recheck_at; each
+   miss after that doubles the wait from recheck_base up to recheck_max.
+   saved counts the searches skipped because of it. */
+typedef struct {
+  gint misses;
+  gint64 checked;    /* Unix time of the last search */
+  gint64 recheck_at;
+  gint saved;
+} TmdbMiss;
+
+gboolean db_tmdb_miss_get(ReelApp *app, const gchar *query, gint year,
+                          gboolean tv, TmdbMiss *miss);
+gboolean db_tmdb_miss_put(ReelApp *app, const gchar *query, gint year,
+                          gboolean tv, gint64 now, gint64 recheck_base,
+                          gint64 recheck_max);
+gboolean db_tmdb_miss_saved(ReelApp *app, const gchar *query, gint year,
+                            gboolean tv);
+gboolean db_tmdb_miss_clear(ReelApp *app, const gchar *query, gint year,
+                            gboolean tv);
+gboolean db_tmdb_miss_stats(ReelApp *app, gint *entries, gint *saved);
+
+/* Titles from TMDB's daily ID exports, keyed by title_index_key(). An
+   import replaces the titles of each kind it contains; year is learned from
+   details later, as the exports don't carry it. */
+typedef struct {
+  gint tmdb_id;
+  gint year; /* 0 until known */
+  gdouble popularity;
+} TmdbTitle;
+
+typedef struct _TmdbTitleImport TmdbTitleImport;
+
+TmdbTitleImport *db_tmdb_titles_import_begin(ReelApp *app);
+gboolean db_tmdb_titles_import_add(TmdbTitleImport *import, gboolean tv,
+                                   gint tmdb_id, const gchar *title_key,
+                                   gdouble popularity);
+/* Commit the import; if complete, titles it didn't list are removed.
+   Returns how many, or -1 on failure. */
+gint db_tmdb_titles_import_end(TmdbTitleImport *import, gboolean complete);
+/* TmdbTitle* with title_key, most popular first */
+GList *db_tmdb_titles_find(ReelApp *app, const gchar *title_key, gboolean tv,
+                           gint limit);
+gboolean db_tmdb_title_set_year(ReelApp *app, gboolean tv, gint tmdb_id,
+                                gint year);
+gint db_tmdb_titles_count(ReelApp *app);
+
+/* Library totals for reporting */
+typedef struct {
+  gint films;
+  gint seasons;
+  gint episodes;
+  gint unmatched;
+  gint files_hashed;
+  gint duplicates; /* Entries with an identical copy elsewhere */
+} LibraryStats;
+
+gboolean db_library_stats(ReelApp *app, LibraryStats *stats);
+
 /* Read-only helpers for background loading */
 sqlite3 *db_open_readonly(const gchar *db_path);
 void db_close_handle(sqlite3 *db);
@@ -52,6 +147,64 @@ void film_file_free(FilmFile *file);
 /* Fast check for any tracked path */
 gboolean db_is_file_tracked(ReelApp *app, const gchar *file_path);
 
+/* File identities. db_file_ids_find() returns the tracked paths (gchar*)
+   sharing dev/ino/size, or size/fingerprint when by_inode is FALSE.
+   db_file_relink() moves a film or attachment to a new path. */
+gboolean db_file_id_get(ReelApp *app, const gchar *file_path, FileId *id);
+gboolean db_file_id_put(ReelApp *app, const gchar *file_path,
+                        const FileId *id);
+GList *db_file_ids_find(ReelApp *app, const FileId *id, gboolean by_inode);
+gboolean db_file_relink(ReelApp *app, const gchar *old_path,
+                        const gchar *new_path);
+void file_id_clear(FileId *id);
+
+/* Content hashes for duplicate detection */
+GList *db_film_paths_without_oshash(ReelApp *app);
+gboolean db_file_id_set_oshash(ReelApp *app, const gchar *file_path,
+                               const FileId *id, const gchar *oshash);
+
+/* Stream details read from a file's container headers, cached by inode and
+   mtime so a probe survives renames and moves */
+typedef struct {
+  gint64 duration_ms;
+  gint width;
+  gint height;
+  gchar *video_codec;     /* "h264", "hevc", ... */
+  gchar *audio_codecs;    /* Comma-separated, in track order */
+  gchar *audio_languages; /* Comma-separated ISO 639-2 codes */
+} MediaInfo;
+
+GList *db_film_paths_without_media_info(ReelApp *app);
+gboolean db_media_info_put(ReelApp *app, const gchar *file_path,
+                           const FileId *id, const MediaInfo *info);
+gboolean db_media_info_get(ReelApp *app, const gchar *file_path,
+                           MediaInfo *info);
+void media_info_clear(MediaInfo *info);
+
+/* Other library entries that are versions of the same film: identical
+   copies (same content hash) first, then entries with the same TMDB match. */
+typedef struct {
+  gint64 film_id;
+  gchar *title;
+  gint year;
+  gchar *file_path;
+  gboolean identical;
+} FilmVersion;
+
+GList *db_film_versions_get(ReelApp *app, gint64 film_id);
+void film_version_free(FilmVersion *version);
+
+/* Scan bookkeeping: each scan stamps the rows it sees with a new generation,
+   then removes unseen rows under the scanned root that have not been seen
+   since cutoff (unix seconds). */
+gboolean db_begin(ReelApp *app);
+gboolean db_commit(ReelApp *app);
+gint64 db_scan_generation_next(ReelApp *app);
+gboolean db_file_mark_seen(ReelApp *app, const gchar *file_path,
+                           gint64 scan_gen, gint64 now);
+gint db_sweep_unseen(ReelApp *app, const gchar *root, gint64 scan_gen,
+                     gint64 cutoff);
+
 /* Episode CRUD operations (for TV seasons) */
 gboolean db_episode_insert(ReelApp *app, Episode *episode);
 gboolean db_episode_update(ReelApp *app, const Episode *episode);
@@ -64,6 +217,25 @@ gboolean db_genre_add_to_film(ReelApp *app, gint64 film_id, const gchar *genre);
 GList *db_genres_get_for_film(ReelApp *app, gint64 film_id);
 GList *db_genres_get_all(ReelApp *app);
 
+/* TV shows: metadata shared by every season, fetched once per show.
+   db_show_upsert() returns the row id, or 0 on failure. */
+typedef struct {
+  gint64 id;
+  gint tmdb_id;
+  gchar *name;
+  gchar *overview;
+  gchar *poster_path; /* TMDB image path, not a local file */
+  gint year;          /* First air year */
+} Show;
+
+gint64 db_show_upsert(ReelApp *app, const Show *show);
+Show *db_show_get_by_tmdb(ReelApp *app, gint tmdb_id);
+gboolean db_show_clear_genres(ReelApp *app, gint64 show_id);
+gboolean db_genre_add_to_show(ReelApp *app, gint64 show_id, const gchar *genre);
+/* Delete shows none of whose seasons are left; returns how many */
+gint db_shows_delete_orphans(ReelApp *app);
+void show_free(Show *show);
+
 /* Actor operations */
 gboolean db_actor_add_to_film(ReelApp *app, gint64 film_id, const gchar *name,
                               const gchar *role, gint cast_order, gint tmdb_id);
@@ -7,6 +7,7 @@
 #include "db.h"
 #include "match.h"
 #include "player.h"
+#include "scraper.h"
 #include "utils.h"
 #include "window.h"
 #include <string.h>
@@ -29,6 +30,79 @@ static void on_play_clicked(GtkButton *btn, gpointer data) {
   player_launch(app, path);
 }
 
+/* "1080p" style label from the probed frame size */
+static gchar *resolution_label(gint width, gint height) {
+  if (width >= 3800 || height >= 2100)
+    return g_strdup("2160p");
+  if (width >= 1900 || height >= 1000)
+    return g_strdup("1080p");
+  if (width >= 1260 || height >= 700)
+    return g_strdup("720p");
+  return g_strdup_printf("%dp", height);
+}
+
+/* "1080p HEVC · EAC3, AAC · eng, fre" for a probed file, or NULL */
+static gchar *media_summary(ReelApp *app, const gchar *path) {
+  MediaInfo media = {0};
+  if (!path || !db_media_info_get(app, path, &media))
+    return NULL;
+
+  GString *text = g_string_new(NULL);
+  if (media.height > 0) {
+    gchar *res = resolution_label(media.width, media.height);
+    g_string_append(text, res);
+    g_free(res);
+  }
+  if (media.video_codec) {
+    gchar *codec = g_ascii_strup(media.video_codec, -1);
+    g_string_append_printf(text, "%s%s", text->len > 0 ? " " : "", codec);
+    g_free(codec);
+  }
+  const gchar *lists[] = {media.audio_codecs, media.audio_languages};
+  for (gsize i = 0; i < G_N_ELEMENTS(lists); i++) {
+    if (!lists[i])
+      continue;
+    gchar **items = g_strsplit(lists[i], ",", -1);
+    gchar *joined = g_strjoinv(", ", items);
+    if (i == 0) {
+      gchar *upper = g_ascii_strup(joined, -1);
+      g_free(joined);
+      joined = upper;
+    }
+    g_string_append_printf(text, "%s%s", text->len > 0 ? "  ·  " : "", joined);
+    g_free(joined);
+    g_strfreev(items);
+  }
+  media_info_clear(&media);
+
+  if (text->len == 0) {
+    g_string_free(text, TRUE);
+    return NULL;
+  }
+  return g_string_free(text, FALSE);
+}
+
+/* Stream details after a file name, when the file has been probed */
+static void add_media_label(GtkWidget *row, ReelApp *app, const gchar *path) {
+  gchar *summary = media_summary(app, path);
+  if (!summary)
+    return;
+  GtkWidget *lbl = gtk_label_new(summary);
+  gtk_style_context_add_class(gtk_widget_get_style_context(lbl), "dim-label");
+  gtk_box_pack_start(GTK_BOX(row), lbl, FALSE, FALSE, 0);
+  g_free(summary);
+}
+
+/* Callback for a row in the versions list */
+static void on_open_version_clicked(GtkButton *btn, gpointer data) {
+  (void)data;
+  ReelApp *app = g_object_get_data(G_OBJECT(btn), "app");
+  gint64 film_id = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(btn), "film_id"));
+  GtkWidget *parent = g_object_get_data(G_OBJECT(btn), "dialog");
+  gtk_widget_destroy(parent);
+  detail_show(app, film_id);
+}
+
 static void refresh_detail(ReelApp *app, GtkWidget *dialog, gint64 film_id) {
   gtk_widget_destroy(dialog);
   window_refresh_films(app);
@@ -194,6 +268,102 @@ static void on_add_file_clicked(GtkButton *btn, gpointer data) {
   refresh_detail(app, dialog, film_id);
 }
 
+/* Decode a poster for the detail pane at the display's device scale */
+static cairo_surface_t *detail_poster_surface(const gchar *path, gint scale) {
+  GdkPixbuf *pixbuf = utils_pixbuf_new_from_file_at_scale_safe(
+      path, POSTER_DETAIL_WIDTH * scale, POSTER_DETAIL_HEIGHT * scale, TRUE,
+      NULL);
+  if (!pixbuf)
+    return NULL;
+  cairo_surface_t *surface =
+      gdk_cairo_surface_create_from_pixbuf(pixbuf, scale, NULL);
+  g_object_unref(pixbuf);
+  return surface;
+}
+
+/* A larger poster size being fetched while the dialog shows the grid one */
+typedef struct {
+  GWeakRef image_ref;
+  gchar *poster_path;
+  gchar *remote;
+  const gchar *size;
+  gint scale;
+  cairo_surface_t *surface;
+} DetailPosterFetch;
+
+static gboolean detail_poster_apply_idle(gpointer data) {
+  DetailPosterFetch *fetch = (DetailPosterFetch *)data;
+  GtkWidget *image = g_weak_ref_get(&fetch->image_ref);
+  if (image) {
+    if (fetch->surface)
+      gtk_image_set_from_surface(GTK_IMAGE(image), fetch->surface);
+    g_object_unref(image);
+  }
+  if (fetch->surface)
+    cairo_surface_destroy(fetch->surface);
+  g_weak_ref_clear(&fetch->image_ref);
+  g_free(fetch->poster_path);
+  g_free(fetch->remote);
+  g_free(fetch);
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer detail_poster_fetch_thread(gpointer data) {
+  DetailPosterFetch *fetch = (DetailPosterFetch *)data;
+  gchar *path = scraper_fetch_poster_variant(fetch->poster_path,
+                                             fetch->remote, fetch->size);
+  if (path)
+    fetch->surface = detail_poster_surface(path, fetch->scale);
+  g_free(path);
+  g_idle_add(detail_poster_apply_idle, fetch);
+  return NULL;
+}
+
+/* The poster image. The grid only downloads a small size; the detail size
+   is fetched the first time a film is opened and cached from then on. */
+static GtkWidget *detail_poster_new(ReelApp *app, Film *film) {
+  if (!film->poster_path || !g_file_test(film->poster_path, G_FILE_TEST_EXISTS)) {
+    GtkWidget *image =
+        gtk_image_new_from_icon_name("video-x-generic", GTK_ICON_SIZE_DIALOG);
+    gtk_image_set_pixel_size(GTK_IMAGE(image), 300);
+    return image;
+  }
+
+  gint scale = MAX(gtk_widget_get_scale_factor(app->window), 1);
+  const gchar *size =
+      scraper_poster_size(SCRAPER_POSTER_DETAIL, POSTER_DETAIL_WIDTH * scale);
+  gchar *variant = film->poster_remote
+                       ? scraper_poster_variant_path(film->poster_path, size)
+                       : NULL;
+  gboolean have_variant = variant && g_file_test(variant, G_FILE_TEST_EXISTS);
+
+  /* Show what is on disk now, sharpened once the detail size arrives */
+  cairo_surface_t *surface = detail_poster_surface(
+      have_variant ? variant : film->poster_path, scale);
+  g_free(variant);
+  GtkWidget *image;
+  if (surface) {
+    image = gtk_image_new_from_surface(surface);
+    cairo_surface_destroy(surface);
+  } else {
+    image =
+        gtk_image_new_from_icon_name("video-x-generic", GTK_ICON_SIZE_DIALOG);
+    gtk_image_set_pixel_size(GTK_IMAGE(image), 300);
+  }
+
+  if (film->poster_remote && !have_variant) {
+    DetailPosterFetch *fetch = g_new0(DetailPosterFetch, 1);
+    g_weak_ref_init(&fetch->image_ref, image);
+    fetch->poster_path = g_strdup(film->poster_path);
+    fetch->remote = g_strdup(film->poster_remote);
+    fetch->size = size;
+    fetch->scale = scale;
+    g_thread_unref(
+        g_thread_new("detail-poster", detail_poster_fetch_thread, fetch));
+  }
+  return image;
+}
+
 void detail_show(ReelApp *app, gint64 film_id) {
   Film *film = db_film_get_by_id(app, film_id);
   if (film == NULL) {
@@ -227,23 +397,7 @@ void detail_show(ReelApp *app, gint64 film_id) {
   GtkWidget *poster_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 8);
   gtk_box_pack_start(GTK_BOX(hbox), poster_box, FALSE, FALSE, 0);
 
-  GtkWidget *poster_image;
-  if (film->poster_path && g_file_test(film->poster_path, G_FILE_TEST_EXISTS)) {
-    GdkPixbuf *pixbuf = utils_pixbuf_new_from_file_at_scale_safe(
-        film->poster_path, 375, 562, TRUE, NULL);
-    if (pixbuf) {
-      poster_image = gtk_image_new_from_pixbuf(pixbuf);
-      g_object_unref(pixbuf);
-    } else {
-      poster_image =
-          gtk_image_new_from_icon_name("video-x-generic", GTK_ICON_SIZE_DIALOG);
-      gtk_image_set_pixel_size(GTK_IMAGE(poster_image), 300);
-    }
-  } else {
-    poster_image =
-        gtk_image_new_from_icon_name("video-x-generic", GTK_ICON_SIZE_DIALOG);
-    gtk_image_set_pixel_size(GTK_IMAGE(poster_image), 300);
-  }
+  GtkWidget *poster_image = detail_poster_new(app, film);
   gtk_box_pack_start(GTK_BOX(poster_box), poster_image, FALSE, FALSE, 0);
 
   /* Info section */
@@ -278,11 +432,19 @@ void detail_show(ReelApp *app, gint64 film_id) {
     g_string_append_printf(meta, "★ %.1f/10", film->rating);
   }
 
-  if (film->runtime_minutes > 0) {
+  /* Unmatched files still have the duration from their container */
+  gint runtime = film->runtime_minutes;
+  MediaInfo media = {0};
+  if (runtime <= 0 && db_media_info_get(app, film->file_path, &media)) {
+    runtime = (gint)((media.duration_ms + 30000) / 60000);
+    media_info_clear(&media);
+  }
+
+  if (runtime > 0) {
     if (meta->len > 0)
       g_string_append(meta, "  │  ");
-    int hours = film->runtime_minutes / 60;
-    int mins = film->runtime_minutes % 60;
+    int hours = runtime / 60;
+    int mins = runtime % 60;
     if (hours > 0) {
       g_string_append_printf(meta, "%dh %dm", hours, mins);
     } else {
@@ -452,6 +614,7 @@ void detail_show(ReelApp *app, gint64 film_id) {
   gtk_label_set_ellipsize(GTK_LABEL(file_label), PANGO_ELLIPSIZE_MIDDLE);
   gtk_label_set_xalign(GTK_LABEL(file_label), 0);
   gtk_box_pack_start(GTK_BOX(primary_row), file_label, TRUE, TRUE, 0);
+  add_media_label(primary_row, app, film->file_path);
 
   if (film->media_type == MEDIA_FILM) {
     GtkWidget *play_primary = gtk_button_new_from_icon_name(
@@ -479,6 +642,7 @@ void detail_show(ReelApp *app, gint64 film_id) {
     gtk_label_set_ellipsize(GTK_LABEL(lbl), PANGO_ELLIPSIZE_MIDDLE);
     gtk_label_set_xalign(GTK_LABEL(lbl), 0);
     gtk_box_pack_start(GTK_BOX(row), lbl, TRUE, TRUE, 0);
+    add_media_label(row, app, ff->file_path);
 
     GtkWidget *play_btn = gtk_button_new_from_icon_name(
         "media-playback-start-symbolic", GTK_ICON_SIZE_BUTTON);
@@ -500,6 +664,46 @@ void detail_show(ReelApp *app, gint64 film_id) {
   }
   g_list_free_full(files, (GDestroyNotify)film_file_free);
 
+  /* Other versions of the same film elsewhere in the library */
+  GList *versions = db_film_versions_get(app, film_id);
+  if (versions) {
+    GtkWidget *versions_frame = gtk_frame_new("Versions");
+    gtk_container_set_border_width(GTK_CONTAINER(versions_frame), 6);
+    gtk_box_pack_start(GTK_BOX(content), versions_frame, FALSE, FALSE, 0);
+
+    GtkWidget *versions_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 6);
+    gtk_container_add(GTK_CONTAINER(versions_frame), versions_box);
+
+    for (GList *l = versions; l != NULL; l = l->next) {
+      FilmVersion *version = (FilmVersion *)l->data;
+
+      GtkWidget *row = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
+      gtk_box_pack_start(GTK_BOX(versions_box), row, FALSE, FALSE, 0);
+
+      gchar *text = g_strdup_printf(
+          "%s%s", version->identical ? "Identical copy: " : "",
+          version->file_path ? version->file_path : "");
+      GtkWidget *lbl = gtk_label_new(text);
+      gtk_label_set_selectable(GTK_LABEL(lbl), TRUE);
+      gtk_label_set_ellipsize(GTK_LABEL(lbl), PANGO_ELLIPSIZE_MIDDLE);
+      gtk_label_set_xalign(GTK_LABEL(lbl), 0);
+      gtk_box_pack_start(GTK_BOX(row), lbl, TRUE, TRUE, 0);
+      g_free(text);
+      add_media_label(row, app, version->file_path);
+
+      GtkWidget *open_btn = gtk_button_new_with_label("Show");
+      gtk_widget_set_tooltip_text(open_btn, version->title);
+      g_object_set_data(G_OBJECT(open_btn), "app", app);
+      g_object_set_data(G_OBJECT(open_btn), "dialog", dialog);
+      g_object_set_data(G_OBJECT(open_btn), "film_id",
+                        GINT_TO_POINTER(version->film_id));
+      g_signal_connect(open_btn, "clicked", G_CALLBACK(on_open_version_clicked),
+                       NULL);
+      gtk_box_pack_end(GTK_BOX(row), open_btn, FALSE, FALSE, 0);
+    }
+    g_list_free_full(versions, (GDestroyNotify)film_version_free);
+  }
+
   /* Button box */
   GtkWidget *btn_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
   gtk_widget_set_margin_top(btn_box, 12);
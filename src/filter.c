@@ -15,14 +15,15 @@ typedef struct {
   GtkWidget *search_entry;
   GtkWidget *sort_combo;
   GtkWidget *sort_order_btn;
+  GtkWidget *group_btn;
 } FilterWidgets;
 
 static void on_filter_changed(GtkWidget *widget, gpointer user_data);
 static void on_search_changed(GtkSearchEntry *entry, gpointer user_data);
 static void on_sort_order_clicked(GtkButton *button, gpointer user_data);
+static void on_group_toggled(GtkToggleButton *button, gpointer user_data);
 static void on_scan_clicked(GtkButton *button, gpointer user_data);
 static void on_settings_clicked(GtkButton *button, gpointer user_data);
-static void parse_search_text(ReelApp *app, const gchar *text);
 static void update_filter_state(ReelApp *app);
 
 GtkWidget *filter_bar_create(ReelApp *app) {
@@ -96,6 +97,18 @@ GtkWidget *filter_bar_create(ReelApp *app) {
   gtk_box_pack_start(GTK_BOX(left), year_combo, FALSE, FALSE, 0);
   widgets->year_combo = year_combo;
 
+  /* One tile per TV show */
+  GtkWidget *group_btn = gtk_toggle_button_new();
+  gtk_button_set_image(GTK_BUTTON(group_btn),
+                       gtk_image_new_from_icon_name("view-list-symbolic",
+                                                    GTK_ICON_SIZE_BUTTON));
+  gtk_widget_set_tooltip_text(group_btn, "Group TV seasons by show");
+  gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(group_btn),
+                               app->filter.group_seasons);
+  g_signal_connect(group_btn, "toggled", G_CALLBACK(on_group_toggled), app);
+  gtk_box_pack_start(GTK_BOX(right), group_btn, FALSE, FALSE, 0);
+  widgets->group_btn = group_btn;
+
   /* Sort controls */
   GtkWidget *sort_label = gtk_label_new("Sort:");
   gtk_box_pack_start(GTK_BOX(right), sort_label, FALSE, FALSE, 0);
@@ -201,9 +214,11 @@ void filter_bar_reset(ReelApp *app) {
   gtk_combo_box_set_active(GTK_COMBO_BOX(widgets->sort_combo), 0);
   gtk_entry_set_text(GTK_ENTRY(widgets->search_entry), "");
 
-  /* Clear filter state */
+  /* Clear filter state; grouping is a view setting and stays */
+  gboolean group_seasons = app->filter.group_seasons;
   filter_state_clear(&app->filter);
   filter_state_init(&app->filter);
+  app->filter.group_seasons = group_seasons;
 
   window_refresh_films(app);
 }
@@ -282,8 +297,8 @@ static void on_filter_changed(GtkWidget *widget, gpointer user_data) {
   FilterWidgets *widgets =
       g_object_get_data(G_OBJECT(app->filter_bar), "widgets");
   if (widgets && widgets->search_entry) {
-    parse_search_text(
-        app, gtk_entry_get_text(GTK_ENTRY(widgets->search_entry)));
+    filter_state_parse_search(
+        &app->filter, gtk_entry_get_text(GTK_ENTRY(widgets->search_entry)));
   }
   window_refresh_films(app);
 }
@@ -291,20 +306,22 @@ static void on_filter_changed(GtkWidget *widget, gpointer user_data) {
 static void on_search_changed(GtkSearchEntry *entry, gpointer user_data) {
   ReelApp *app = (ReelApp *)user_data;
   update_filter_state(app);
-  parse_search_text(app, gtk_entry_get_text(GTK_ENTRY(entry)));
+  filter_state_parse_search(&app->filter,
+                            gtk_entry_get_text(GTK_ENTRY(entry)));
   window_refresh_films(app);
 }
 
-static void parse_search_text(ReelApp *app, const gchar *text) {
-  if (!app)
+void filter_state_parse_search(FilterState *filter, const gchar *text) {
+  if (!filter)
     return;
 
-  g_free(app->filter.search_text);
-  app->filter.search_text = NULL;
-  g_free(app->filter.actor);
-  app->filter.actor = NULL;
-  g_free(app->filter.plot_text);
-  app->filter.plot_text = NULL;
+  g_free(filter->search_text);
+  filter->search_text = NULL;
+  g_free(filter->actor);
+  filter->actor = NULL;
+  g_free(filter->plot_text);
+  filter->plot_text = NULL;
+  filter->duplicates_only = FALSE;
 
   if (!text || !*text)
     return;
@@ -312,7 +329,7 @@ static void parse_search_text(ReelApp *app, const gchar *text) {
   gint argc = 0;
   gchar **argv = NULL;
   if (!g_shell_parse_argv(text, &argc, &argv, NULL) || argc <= 0) {
-    app->filter.search_text = g_strdup(text);
+    filter->search_text = g_strdup(text);
     return;
   }
 
@@ -323,6 +340,12 @@ static void parse_search_text(ReelApp *app, const gchar *text) {
     if (!tok || !*tok)
       continue;
 
+    if (g_ascii_strcasecmp(tok, "is:duplicate") == 0 ||
+        g_ascii_strcasecmp(tok, "is:dup") == 0) {
+      filter->duplicates_only = TRUE;
+      continue;
+    }
+
     const gchar *value = NULL;
     const gchar *key = NULL;
     if (g_str_has_prefix(tok, "actor:") || g_str_has_prefix(tok, "cast:") ||
@@ -339,13 +362,13 @@ static void parse_search_text(ReelApp *app, const gchar *text) {
 
     if (key && value && *value) {
       if (g_str_has_prefix(key, "actor:") || g_str_has_prefix(key, "cast:")) {
-        g_free(app->filter.actor);
-        app->filter.actor = g_strdup(value);
+        g_free(filter->actor);
+        filter->actor = g_strdup(value);
         continue;
       }
       if (g_str_has_prefix(key, "plot:")) {
-        g_free(app->filter.plot_text);
-        app->filter.plot_text = g_strdup(value);
+        g_free(filter->plot_text);
+        filter->plot_text = g_strdup(value);
         continue;
       }
       if (g_str_has_prefix(key, "title:")) {
@@ -362,7 +385,7 @@ static void parse_search_text(ReelApp *app, const gchar *text) {
   }
 
   if (title->len > 0)
-    app->filter.search_text = g_strdup(title->str);
+    filter->search_text = g_strdup(title->str);
 
   g_string_free(title, TRUE);
   g_strfreev(argv);
@@ -386,6 +409,12 @@ static void on_sort_order_clicked(GtkButton *button, gpointer user_data) {
   window_refresh_films(app);
 }
 
+static void on_group_toggled(GtkToggleButton *button, gpointer user_data) {
+  ReelApp *app = (ReelApp *)user_data;
+  app->filter.group_seasons = gtk_toggle_button_get_active(button);
+  window_refresh_films(app);
+}
+
 static void on_scan_clicked(GtkButton *button, gpointer user_data) {
   (void)button;
   ReelApp *app = (ReelApp *)user_data;
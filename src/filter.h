@@ -12,6 +12,10 @@ void filter_bar_refresh(ReelApp *app);
 /* Clear all filters */
 void filter_bar_reset(ReelApp *app);
 
+/* Set the search, actor, plot and duplicate filters from search-box text
+   such as "alien actor:Weaver is:dup" */
+void filter_state_parse_search(FilterState *filter, const gchar *text);
+
 /* Focus the search entry (for keyboard shortcuts like Ctrl+F). */
 void filter_bar_focus_search(ReelApp *app);
 
@@ -1,15 +1,17 @@
 /*
  * ReelGTK - Poster Grid
- * GtkFlowBox-based poster grid with DPI-aware sizing
+ * Virtualized poster grid with DPI-aware sizing: only the rows in view have
+ * widgets, recycled as the grid scrolls
  */
 
 #include "grid.h"
 #include "detail.h"
+#include "postercache.h"
+#include "scraper.h"
 #include "utils.h"
 #include <stdarg.h>
 #include <string.h>
 #include <glib/gstdio.h>
-#include <unistd.h>
 
 static gboolean startup_debug_enabled(void) {
   static gint inited = 0;
@@ -42,12 +44,30 @@ static void startup_log(const char *fmt, ...) {
 typedef struct {
   ReelApp *app;
   gchar *path;
+  gchar *remote; /* TMDB image path, to fetch other sizes */
+  gchar *key;    /* Poster cache key */
   gint width;
   gint height;
+  GCancellable *cancel; /* Cancelled when the cell shows another film */
+  gboolean fetch;       /* The grid size is missing; download it next */
+  gboolean cached;      /* Shown from the cache; only decoded again if the
+                           file changed since */
+  gint64 mtime;         /* Of path: the cached copy's, then the file's */
   GWeakRef widget_ref;
   GdkPixbuf *pixbuf;
 } PosterLoadTask;
 
+static void poster_load_task_free(PosterLoadTask *task) {
+  if (task->pixbuf)
+    g_object_unref(task->pixbuf);
+  g_object_unref(task->cancel);
+  g_weak_ref_clear(&task->widget_ref);
+  g_free(task->path);
+  g_free(task->remote);
+  g_free(task->key);
+  g_free(task);
+}
+
 static void poster_area_destroy(GtkWidget *widget, gpointer user_data) {
   ReelApp *app = (ReelApp *)user_data;
   if (!app)
@@ -57,50 +77,6 @@ static void poster_area_destroy(GtkWidget *widget, gpointer user_data) {
   }
 }
 
-static gchar *grid_make_tmp_path_in_dir(const gchar *dest_path) {
-  if (!dest_path)
-    return NULL;
-  gchar *dir = g_path_get_dirname(dest_path);
-  if (!dir)
-    return NULL;
-  gchar *tmpl = g_build_filename(dir, ".reelvault_tmp_XXXXXX", NULL);
-  g_free(dir);
-  return tmpl;
-}
-
-static void grid_save_pixbuf_jpeg_atomic(GdkPixbuf *pixbuf,
-                                        const gchar *dest_path) {
-  if (!pixbuf || !dest_path)
-    return;
-
-  gchar *tmp_template = grid_make_tmp_path_in_dir(dest_path);
-  if (!tmp_template)
-    return;
-
-  int fd = g_mkstemp(tmp_template);
-  if (fd < 0) {
-    g_free(tmp_template);
-    return;
-  }
-  close(fd);
-
-  GError *error = NULL;
-  gboolean ok = gdk_pixbuf_save(pixbuf, tmp_template, "jpeg", &error, "quality",
-                                "85", NULL);
-  if (error)
-    g_error_free(error);
-  if (!ok) {
-    g_unlink(tmp_template);
-    g_free(tmp_template);
-    return;
-  }
-
-  if (g_rename(tmp_template, dest_path) != 0) {
-    g_unlink(tmp_template);
-  }
-  g_free(tmp_template);
-}
-
 static gboolean poster_draw(GtkWidget *widget, cairo_t *cr, gpointer user_data) {
   (void)user_data;
   GtkAllocation alloc;
@@ -158,43 +134,158 @@ static gchar *grid_thumb_path_for_original(const gchar *poster_path) {
                          dot);
 }
 
+static void poster_area_set(ReelApp *app, GtkWidget *widget,
+                            GdkPixbuf *pixbuf) {
+  if (!g_object_get_data(G_OBJECT(widget), "poster_loaded")) {
+    g_object_set_data(G_OBJECT(widget), "poster_loaded", GINT_TO_POINTER(1));
+    if (app)
+      app->grid_posters_loaded++;
+  }
+  g_object_set_data_full(G_OBJECT(widget), "poster_pixbuf",
+                         g_object_ref(pixbuf), (GDestroyNotify)g_object_unref);
+  gtk_widget_queue_draw(widget);
+}
+
+/* Threads downloading grid-sized posters; a slow server must not hold up
+   decoding */
+#define GRID_FETCH_THREADS 2
+
+/* Remote posters whose grid size could not be fetched this session; the
+   size we have is shown instead of asking again */
+static GMutex variant_failed_lock;
+static GHashTable *variant_failed;
+
+static void poster_fetch_worker(gpointer data, gpointer user_data);
+
 static gboolean poster_apply_idle(gpointer data) {
   PosterLoadTask *task = (PosterLoadTask *)data;
+  /* Cached even if the cell moved on, for when the film comes back; a
+     stand-in isn't, so the grid size is asked for again */
+  if (task->pixbuf && !task->fetch)
+    poster_cache_store(task->app, task->key, task->mtime, task->pixbuf);
+
+  /* The cell may show another film by now */
+  gboolean current = !g_cancellable_is_cancelled(task->cancel);
   GtkWidget *widget = g_weak_ref_get(&task->widget_ref);
-  if (widget) {
-    if (task->pixbuf) {
-      if (!g_object_get_data(G_OBJECT(widget), "poster_loaded")) {
-        g_object_set_data(G_OBJECT(widget), "poster_loaded",
-                          GINT_TO_POINTER(1));
-        if (task->app)
-          task->app->grid_posters_loaded++;
-      }
-      g_object_set_data_full(G_OBJECT(widget), "poster_pixbuf",
-                             g_object_ref(task->pixbuf),
-                             (GDestroyNotify)g_object_unref);
-      gtk_widget_queue_draw(widget);
+  if (!widget)
+    current = FALSE;
+  else if (task->pixbuf && current)
+    poster_area_set(task->app, widget, task->pixbuf);
+  g_clear_object(&widget);
+
+  /* The size shown stands in while the grid size downloads, away from the
+     decoding threads */
+  if (task->fetch && current) {
+    ReelApp *app = task->app;
+    if (!app->poster_fetch_pool) {
+      app->poster_fetch_pool = g_thread_pool_new(
+          poster_fetch_worker, NULL, GRID_FETCH_THREADS, FALSE, NULL);
     }
-    g_object_unref(widget);
+    g_clear_object(&task->pixbuf);
+    task->fetch = FALSE;
+    task->cached = FALSE;
+    g_thread_pool_push(app->poster_fetch_pool, task, NULL);
+    return G_SOURCE_REMOVE;
   }
-  if (task->pixbuf)
-    g_object_unref(task->pixbuf);
-  g_weak_ref_clear(&task->widget_ref);
-  g_free(task->path);
-  g_free(task);
+  poster_load_task_free(task);
   return G_SOURCE_REMOVE;
 }
 
+/* The grid size has been downloaded: decode it for the cell */
+static gboolean poster_fetched_idle(gpointer data) {
+  PosterLoadTask *task = (PosterLoadTask *)data;
+  if (g_cancellable_is_cancelled(task->cancel))
+    poster_load_task_free(task);
+  else
+    g_thread_pool_push(task->app->thread_pool, task, NULL);
+  return G_SOURCE_REMOVE;
+}
+
+static void poster_fetch_worker(gpointer data, gpointer user_data) {
+  (void)user_data;
+  PosterLoadTask *task = (PosterLoadTask *)data;
+  if (g_cancellable_is_cancelled(task->cancel)) {
+    poster_load_task_free(task);
+    return;
+  }
+
+  const gchar *size = scraper_poster_size(SCRAPER_POSTER_GRID, task->width);
+  gchar *variant =
+      scraper_fetch_poster_variant(task->path, task->remote, size);
+  if (!variant) {
+    g_mutex_lock(&variant_failed_lock);
+    if (!variant_failed)
+      variant_failed = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                             NULL);
+    g_hash_table_add(variant_failed, g_strdup(task->remote));
+    g_mutex_unlock(&variant_failed_lock);
+    poster_load_task_free(task);
+    return;
+  }
+  g_free(variant);
+  g_idle_add(poster_fetched_idle, task);
+}
+
+/* The cached poster sized for the cell, NULL to show task->path. If only
+   another size was downloaded (e.g. w185 by a scrape at scale 1, shown at
+   scale 2), task->fetch asks for the grid size once this one is shown. */
+static gchar *poster_grid_variant(PosterLoadTask *task) {
+  const gchar *size = scraper_poster_size(SCRAPER_POSTER_GRID, task->width);
+  /* The larger grid size serves a smaller cell as well */
+  if (g_str_has_suffix(task->path, "_w342.jpg"))
+    return NULL;
+  gchar *variant = scraper_poster_variant_path(task->path, size);
+  if (!variant || g_strcmp0(variant, task->path) == 0 ||
+      g_file_test(variant, G_FILE_TEST_EXISTS))
+    return variant;
+  g_free(variant);
+
+  g_mutex_lock(&variant_failed_lock);
+  task->fetch =
+      !variant_failed || !g_hash_table_contains(variant_failed, task->remote);
+  g_mutex_unlock(&variant_failed_lock);
+  return NULL;
+}
+
 static void poster_load_worker(gpointer data, gpointer user_data) {
   (void)user_data;
   PosterLoadTask *task = (PosterLoadTask *)data;
 
+  /* Queued for a film the cell no longer shows */
+  if (g_cancellable_is_cancelled(task->cancel)) {
+    poster_load_task_free(task);
+    return;
+  }
+
+  /* The file is only looked at here, off the main thread; a cached copy
+     stands unless the file was replaced */
+  GStatBuf st;
+  if (g_stat(task->path, &st) != 0 ||
+      (task->cached && (gint64)st.st_mtime == task->mtime)) {
+    poster_load_task_free(task);
+    return;
+  }
+  task->mtime = (gint64)st.st_mtime;
+
   static gint log_n = 0;
   if (startup_debug_enabled() && log_n < 15) {
     startup_log("poster_load_worker: start %s", task->path);
     log_n++;
   }
 
-  /* Best effort: if we were asked to load the original and the thumb doesn't
+  /* Posters downloaded at grid size are decoded straight to the cell */
+  if (task->remote) {
+    gchar *variant = poster_grid_variant(task);
+    task->pixbuf = utils_pixbuf_new_from_file_at_scale_safe(
+        variant ? variant : task->path, task->width, task->height, TRUE,
+        NULL);
+    g_free(variant);
+    g_idle_add(poster_apply_idle, task);
+    return;
+  }
+
+  /* Older posters were downloaded at w500 only.
+     Best effort: if we were asked to load the original and the thumb doesn't
      exist yet or is stale, generate it once in the background. For display,
      always prefer the thumb to keep memory bounded. */
   gchar *thumb_path = NULL;
@@ -210,7 +301,7 @@ static void poster_load_worker(gpointer data, gpointer user_data) {
         GdkPixbuf *thumb = utils_pixbuf_new_from_file_at_scale_safe(
             task->path, POSTER_THUMB_WIDTH, POSTER_THUMB_HEIGHT, TRUE, &thumb_err);
         if (thumb) {
-          grid_save_pixbuf_jpeg_atomic(thumb, thumb_path);
+          utils_pixbuf_save_jpeg(thumb, thumb_path, 85, NULL);
           g_object_unref(thumb);
         }
         if (thumb_err)
@@ -258,11 +349,172 @@ static gint get_scaled_font_size(ReelApp *app) {
   return (gint)(11 * scale); /* Base font size 11pt */
 }
 
-/* Create a poster widget for a film */
-static GtkWidget *create_poster_widget(ReelApp *app, Film *film) {
+/* Grid layout, in pixels */
+#define GRID_MARGIN 8
+#define GRID_COLUMN_SPACING 4
+#define GRID_ROW_SPACING 8
+#define GRID_CELL_PADDING 3
+#define GRID_MIN_COLUMNS 2
+#define GRID_MAX_COLUMNS 12
+
+/* Rows kept bound above and below the visible ones, so short scrolls
+   don't wait for posters */
+#define GRID_OVERSCAN_ROWS 2
+
+typedef struct _PosterGrid PosterGrid;
+
+/* One recycled grid item; shows the film at index while bound */
+typedef struct {
+  PosterGrid *grid;
+  GtkWidget *widget; /* Event box placed in the layout */
+  GtkWidget *poster_area;
+  GtkWidget *badge;
+  GtkWidget *title_label;
+  GtkWidget *year_label;
+  const Film *film; /* NULL while unused */
+  gint64 film_id;
+  gint index;
+  gint x;
+  gint y;
+  gboolean placed;
+  GCancellable *cancel; /* Poster load of the film shown; cancelled on
+                           unbind, so a late poster is dropped */
+} PosterCell;
+
+/* The whole grid is laid out arithmetically from the film count and the
+   cell size; widgets exist only for the rows in view */
+struct _PosterGrid {
+  ReelApp *app;
+  GtkWidget *layout;
+  GPtrArray *films; /* Film*, not owned, in app->films order */
+  GPtrArray *cells; /* PosterCell*, owned */
+  gint cell_width;  /* 0 until a cell has been measured */
+  gint cell_height;
+  gint columns;
+  gint x_offset;
+  gint selected; /* Index of the selected film, or -1 */
+  gint pressed;  /* Index a button went down on, or -1 */
+  GtkAdjustment *vadj;
+  guint relayout_source;
+  gboolean in_relayout;
+};
+
+static PosterGrid *poster_grid_get(ReelApp *app) {
+  if (!app || !app->grid_view)
+    return NULL;
+  return g_object_get_data(G_OBJECT(app->grid_view), "poster-grid");
+}
+
+static void poster_grid_free(PosterGrid *grid) {
+  if (grid->relayout_source)
+    g_source_remove(grid->relayout_source);
+  if (grid->vadj)
+    g_signal_handlers_disconnect_by_data(grid->vadj, grid);
+  g_clear_object(&grid->vadj);
+  g_ptr_array_free(grid->films, TRUE);
+  g_ptr_array_free(grid->cells, TRUE);
+  g_free(grid);
+}
+
+static void poster_cell_free(PosterCell *cell) {
+  if (cell->cancel) {
+    g_cancellable_cancel(cell->cancel);
+    g_object_unref(cell->cancel);
+  }
+  g_free(cell);
+}
+
+static void poster_grid_activate(PosterGrid *grid, gint index) {
+  if (index < 0 || index >= (gint)grid->films->len)
+    return;
+  const Film *film = g_ptr_array_index(grid->films, index);
+  /* Show detail dialog */
+  detail_show(grid->app, film->id);
+}
+
+static void poster_cell_update_state(PosterCell *cell) {
+  if (cell->film && cell->index == cell->grid->selected)
+    gtk_widget_set_state_flags(cell->widget, GTK_STATE_FLAG_SELECTED, FALSE);
+  else
+    gtk_widget_unset_state_flags(cell->widget, GTK_STATE_FLAG_SELECTED);
+}
+
+static void poster_grid_scroll_to(PosterGrid *grid, gint index);
+
+static void poster_grid_select(PosterGrid *grid, gint index) {
+  if (grid->films->len == 0)
+    return;
+  grid->selected = CLAMP(index, 0, (gint)grid->films->len - 1);
+  for (guint i = 0; i < grid->cells->len; i++)
+    poster_cell_update_state(g_ptr_array_index(grid->cells, i));
+  poster_grid_scroll_to(grid, grid->selected);
+}
+
+/* Click handling: single click opens the film, like the old flow box */
+static gboolean on_cell_button_press(GtkWidget *widget, GdkEventButton *event,
+                                     gpointer user_data) {
+  (void)widget;
+  PosterCell *cell = (PosterCell *)user_data;
+  PosterGrid *grid = cell->grid;
+  if (event->type != GDK_BUTTON_PRESS || event->button != GDK_BUTTON_PRIMARY ||
+      !cell->film)
+    return GDK_EVENT_PROPAGATE;
+
+  gtk_widget_grab_focus(grid->layout);
+  grid->pressed = cell->index;
+  poster_grid_select(grid, cell->index);
+  return GDK_EVENT_STOP;
+}
+
+static gboolean on_cell_button_release(GtkWidget *widget,
+                                       GdkEventButton *event,
+                                       gpointer user_data) {
+  (void)widget;
+  PosterCell *cell = (PosterCell *)user_data;
+  PosterGrid *grid = cell->grid;
+  if (event->button != GDK_BUTTON_PRIMARY)
+    return GDK_EVENT_PROPAGATE;
+
+  gint pressed = grid->pressed;
+  grid->pressed = -1;
+  if (cell->film && pressed == cell->index)
+    poster_grid_activate(grid, cell->index);
+  return GDK_EVENT_STOP;
+}
+
+static gboolean on_cell_crossing(GtkWidget *widget, GdkEventCrossing *event,
+                                 gpointer user_data) {
+  (void)user_data;
+  if (event->detail == GDK_NOTIFY_INFERIOR)
+    return GDK_EVENT_PROPAGATE;
+  if (event->type == GDK_ENTER_NOTIFY)
+    gtk_widget_set_state_flags(widget, GTK_STATE_FLAG_PRELIGHT, FALSE);
+  else
+    gtk_widget_unset_state_flags(widget, GTK_STATE_FLAG_PRELIGHT);
+  return GDK_EVENT_PROPAGATE;
+}
+
+/* Build the widgets of a cell; they are filled in by poster_cell_bind */
+static PosterCell *poster_cell_new(PosterGrid *grid) {
+  ReelApp *app = grid->app;
   gint poster_width = get_scaled_width(app);
   gint poster_height = get_scaled_height(app);
-  gint font_size = get_scaled_font_size(app);
+
+  PosterCell *cell = g_new0(PosterCell, 1);
+  cell->grid = grid;
+  cell->index = -1;
+
+  cell->widget = gtk_event_box_new();
+  GtkStyleContext *cell_ctx = gtk_widget_get_style_context(cell->widget);
+  gtk_style_context_add_class(cell_ctx, "poster-cell");
+  g_signal_connect(cell->widget, "button-press-event",
+                   G_CALLBACK(on_cell_button_press), cell);
+  g_signal_connect(cell->widget, "button-release-event",
+                   G_CALLBACK(on_cell_button_release), cell);
+  g_signal_connect(cell->widget, "enter-notify-event",
+                   G_CALLBACK(on_cell_crossing), cell);
+  g_signal_connect(cell->widget, "leave-notify-event",
+                   G_CALLBACK(on_cell_crossing), cell);
 
   /* Outer box - tight spacing */
   GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 4);
@@ -271,6 +523,11 @@ static GtkWidget *create_poster_widget(ReelApp *app, Film *film) {
   gint extra_height =
       (gint)(52 * ((app->scale_factor > 0) ? app->scale_factor : 1.0));
   gtk_widget_set_size_request(box, poster_width, poster_height + extra_height);
+  gtk_widget_set_margin_start(box, GRID_CELL_PADDING);
+  gtk_widget_set_margin_end(box, GRID_CELL_PADDING);
+  gtk_widget_set_margin_top(box, GRID_CELL_PADDING);
+  gtk_widget_set_margin_bottom(box, GRID_CELL_PADDING);
+  gtk_container_add(GTK_CONTAINER(cell->widget), box);
 
   /* Overlay for poster + badge */
   GtkWidget *overlay = gtk_overlay_new();
@@ -278,76 +535,146 @@ static GtkWidget *create_poster_widget(ReelApp *app, Film *film) {
   gtk_box_pack_start(GTK_BOX(box), overlay, FALSE, FALSE, 0);
 
   /* Poster image */
-  GtkWidget *poster_area = gtk_drawing_area_new();
-  gtk_widget_set_size_request(poster_area, poster_width, poster_height);
-  gtk_widget_set_halign(poster_area, GTK_ALIGN_CENTER);
-  gtk_widget_set_valign(poster_area, GTK_ALIGN_START);
-  g_signal_connect(poster_area, "draw", G_CALLBACK(poster_draw), NULL);
-  g_signal_connect(poster_area, "destroy", G_CALLBACK(poster_area_destroy), app);
-  gtk_container_add(GTK_CONTAINER(overlay), poster_area);
-
-  if (film->poster_path && g_file_test(film->poster_path, G_FILE_TEST_EXISTS)) {
-    gchar *poster_path = g_strdup(film->poster_path);
-    if (poster_path) {
-      if (!app->thread_pool) {
-        app->thread_pool = g_thread_pool_new(poster_load_worker, NULL, 4, FALSE,
-                                             NULL);
-      }
-
-      PosterLoadTask *task = g_new0(PosterLoadTask, 1);
-      task->app = app;
-      task->path = poster_path;
-      task->width = poster_width;
-      task->height = poster_height;
-      g_weak_ref_init(&task->widget_ref, poster_area);
-      g_thread_pool_push(app->thread_pool, task, NULL);
-    }
-  }
+  cell->poster_area = gtk_drawing_area_new();
+  gtk_widget_set_size_request(cell->poster_area, poster_width, poster_height);
+  gtk_widget_set_halign(cell->poster_area, GTK_ALIGN_CENTER);
+  gtk_widget_set_valign(cell->poster_area, GTK_ALIGN_START);
+  g_signal_connect(cell->poster_area, "draw", G_CALLBACK(poster_draw), NULL);
+  g_signal_connect(cell->poster_area, "destroy",
+                   G_CALLBACK(poster_area_destroy), app);
+  gtk_container_add(GTK_CONTAINER(overlay), cell->poster_area);
 
   /* Unmatched badge */
-  if (film->match_status == MATCH_STATUS_UNMATCHED) {
-    GtkWidget *badge = gtk_label_new("?");
-    gtk_widget_set_halign(badge, GTK_ALIGN_END);
-    gtk_widget_set_valign(badge, GTK_ALIGN_START);
-    gtk_widget_set_margin_top(badge, 6);
-    gtk_widget_set_margin_end(badge, 6);
-
-    GtkStyleContext *ctx = gtk_widget_get_style_context(badge);
-    gtk_style_context_add_class(ctx, "unmatched-badge");
-
-    gtk_overlay_add_overlay(GTK_OVERLAY(overlay), badge);
-  }
-
-  /* Title label with DPI-aware font */
-  gchar *display_title =
-      film->title ? film->title : g_path_get_basename(film->file_path);
-  GtkWidget *title_label = gtk_label_new(NULL);
-  gtk_label_set_lines(GTK_LABEL(title_label), 1);
-
-  /* Set title with size markup */
-  gchar *title_markup = g_strdup_printf(
-      "<span size='%d' weight='bold'>%s</span>", font_size * PANGO_SCALE,
-      g_markup_escape_text(display_title, -1));
-  gtk_label_set_markup(GTK_LABEL(title_label), title_markup);
-  g_free(title_markup);
+  cell->badge = gtk_label_new("?");
+  gtk_widget_set_halign(cell->badge, GTK_ALIGN_END);
+  gtk_widget_set_valign(cell->badge, GTK_ALIGN_START);
+  gtk_widget_set_margin_top(cell->badge, 6);
+  gtk_widget_set_margin_end(cell->badge, 6);
+  GtkStyleContext *ctx = gtk_widget_get_style_context(cell->badge);
+  gtk_style_context_add_class(ctx, "unmatched-badge");
+  gtk_overlay_add_overlay(GTK_OVERLAY(overlay), cell->badge);
+
+  /* Title label; long titles are cut to the poster width */
+  cell->title_label = gtk_label_new(NULL);
+  gtk_label_set_lines(GTK_LABEL(cell->title_label), 1);
+  gtk_label_set_max_width_chars(GTK_LABEL(cell->title_label), 18);
+  gtk_label_set_ellipsize(GTK_LABEL(cell->title_label), PANGO_ELLIPSIZE_END);
+  gtk_label_set_line_wrap(GTK_LABEL(cell->title_label), FALSE);
+  gtk_label_set_xalign(GTK_LABEL(cell->title_label), 0.5); /* Center */
+  GtkStyleContext *title_ctx = gtk_widget_get_style_context(cell->title_label);
+  gtk_style_context_add_class(title_ctx, "poster-title");
+  gtk_box_pack_start(GTK_BOX(box), cell->title_label, FALSE, FALSE, 0);
+
+  /* Year label */
+  cell->year_label = gtk_label_new(NULL);
+  gtk_label_set_lines(GTK_LABEL(cell->year_label), 1);
+  gtk_label_set_xalign(GTK_LABEL(cell->year_label), 0.5); /* Center */
+  GtkStyleContext *year_ctx = gtk_widget_get_style_context(cell->year_label);
+  gtk_style_context_add_class(year_ctx, "poster-year");
+  gtk_box_pack_start(GTK_BOX(box), cell->year_label, FALSE, FALSE, 0);
 
-  gtk_label_set_max_width_chars(GTK_LABEL(title_label), 18);
-  gtk_label_set_ellipsize(GTK_LABEL(title_label), PANGO_ELLIPSIZE_END);
-  gtk_label_set_line_wrap(GTK_LABEL(title_label), FALSE);
-  gtk_label_set_xalign(GTK_LABEL(title_label), 0.5); /* Center */
+  gtk_widget_show_all(box);
+  gtk_widget_set_no_show_all(cell->widget, TRUE);
+  g_ptr_array_add(grid->cells, cell);
+  return cell;
+}
 
-  GtkStyleContext *title_ctx = gtk_widget_get_style_context(title_label);
-  gtk_style_context_add_class(title_ctx, "poster-title");
+/* Drop the film a cell showed, keeping its widgets for another one */
+static void poster_cell_unbind(PosterCell *cell) {
+  if (g_object_get_data(G_OBJECT(cell->poster_area), "poster_loaded")) {
+    g_object_set_data(G_OBJECT(cell->poster_area), "poster_loaded", NULL);
+    cell->grid->app->grid_posters_loaded--;
+  }
+  g_object_set_data(G_OBJECT(cell->poster_area), "poster_pixbuf", NULL);
+  if (cell->cancel) {
+    g_cancellable_cancel(cell->cancel);
+    g_clear_object(&cell->cancel);
+  }
+  cell->film = NULL;
+  cell->film_id = 0;
+  cell->index = -1;
+  gtk_widget_hide(cell->widget);
+  gtk_widget_unset_state_flags(cell->widget, GTK_STATE_FLAG_SELECTED |
+                                                 GTK_STATE_FLAG_PRELIGHT);
+}
+
+/* Show a film in a cell and start loading its poster */
+static void poster_cell_bind(PosterCell *cell, const Film *film) {
+  ReelApp *app = cell->grid->app;
+  gint font_size = get_scaled_font_size(app);
 
-  gtk_box_pack_start(GTK_BOX(box), title_label, FALSE, FALSE, 0);
+  cell->film = film;
+  cell->film_id = film->id;
+  if (cell->cancel) {
+    g_cancellable_cancel(cell->cancel);
+    g_clear_object(&cell->cancel);
+  }
+  gtk_widget_queue_draw(cell->poster_area);
+
+  /* Decoded posters are shared through the cache and shown at once. The
+     worker checks the file in the background: a miss is decoded, a hit
+     only if the file was replaced. The key is NULL without a poster. */
+  gint width = get_scaled_width(app);
+  gint height = get_scaled_height(app);
+  gchar *key = poster_cache_key(film->poster_path, width, height);
+  gint64 mtime = 0;
+  GdkPixbuf *cached = key ? poster_cache_lookup(app, key, &mtime) : NULL;
+  if (cached) {
+    poster_area_set(app, cell->poster_area, cached);
+    g_object_unref(cached);
+  }
+  if (key) {
+    if (!app->thread_pool) {
+      app->thread_pool = g_thread_pool_new(poster_load_worker, NULL, 4, FALSE,
+                                           NULL);
+    }
 
-  if (!film->title) {
-    g_free(display_title);
+    PosterLoadTask *task = g_new0(PosterLoadTask, 1);
+    task->app = app;
+    task->path = g_strdup(film->poster_path);
+    task->remote = g_strdup(film->poster_remote);
+    task->key = key;
+    task->width = width;
+    task->height = height;
+    task->cached = cached != NULL;
+    task->mtime = mtime;
+    cell->cancel = g_cancellable_new();
+    task->cancel = g_object_ref(cell->cancel);
+    g_weak_ref_init(&task->widget_ref, cell->poster_area);
+    g_thread_pool_push(app->thread_pool, task, NULL);
   }
 
-  /* Year label */
+  gtk_widget_set_visible(cell->badge,
+                         film->match_status == MATCH_STATUS_UNMATCHED);
+
+  /* Title label with DPI-aware font; a grouped show is labelled with its
+     name rather than its first season */
+  gchar *basename = NULL;
+  const gchar *display_title = film->show_name ? film->show_name
+                               : film->title
+                                   ? film->title
+                                   : (basename = g_path_get_basename(
+                                          film->file_path));
+  gchar *escaped = g_markup_escape_text(display_title, -1);
+  gchar *title_markup =
+      g_strdup_printf("<span size='%d' weight='bold'>%s</span>",
+                      font_size * PANGO_SCALE, escaped);
+  gtk_label_set_markup(GTK_LABEL(cell->title_label), title_markup);
+  g_free(title_markup);
+  g_free(escaped);
+  g_free(basename);
+
   gchar *year_markup = NULL;
-  if (film->year > 0) {
+  if (film->show_name && film->season_count > 1) {
+    gchar *seasons = film->year > 0
+                         ? g_strdup_printf("%d, %d seasons", film->year,
+                                           film->season_count)
+                         : g_strdup_printf("%d seasons", film->season_count);
+    year_markup = g_strdup_printf("<span size='%d'>(%s)</span>",
+                                  (gint)(font_size * 0.9 * PANGO_SCALE),
+                                  seasons);
+    g_free(seasons);
+  } else if (film->year > 0) {
     year_markup =
         g_strdup_printf("<span size='%d'>(%d)</span>",
                         (gint)(font_size * 0.9 * PANGO_SCALE), film->year);
@@ -357,152 +684,353 @@ static GtkWidget *create_poster_widget(ReelApp *app, Film *film) {
         g_strdup_printf("<span size='%d'> </span>",
                         (gint)(font_size * 0.9 * PANGO_SCALE));
   }
-
-  GtkWidget *year_label = gtk_label_new(NULL);
-  gtk_label_set_lines(GTK_LABEL(year_label), 1);
-  gtk_label_set_markup(GTK_LABEL(year_label), year_markup);
-  gtk_label_set_xalign(GTK_LABEL(year_label), 0.5); /* Center */
+  gtk_label_set_markup(GTK_LABEL(cell->year_label), year_markup);
   g_free(year_markup);
+}
 
-  GtkStyleContext *year_ctx = gtk_widget_get_style_context(year_label);
-  gtk_style_context_add_class(year_ctx, "poster-year");
+static PosterCell *poster_grid_free_cell(PosterGrid *grid) {
+  for (guint i = 0; i < grid->cells->len; i++) {
+    PosterCell *cell = g_ptr_array_index(grid->cells, i);
+    if (!cell->film)
+      return cell;
+  }
+  return poster_cell_new(grid);
+}
 
-  gtk_box_pack_start(GTK_BOX(box), year_label, FALSE, FALSE, 0);
+/* Every cell has the same size; measure one showing a real film */
+static gboolean poster_grid_measure(PosterGrid *grid) {
+  if (grid->cell_width > 0)
+    return TRUE;
+  if (grid->films->len == 0)
+    return FALSE;
 
-  /* Store film ID for click handling */
-  g_object_set_data(G_OBJECT(box), "film_id", GINT_TO_POINTER(film->id));
-  g_object_set_data(G_OBJECT(box), "app", app);
+  PosterCell *cell = poster_grid_free_cell(grid);
+  poster_cell_bind(cell, g_ptr_array_index(grid->films, 0));
+  GtkRequisition size;
+  gtk_widget_get_preferred_size(cell->widget, &size, NULL);
+  poster_cell_unbind(cell);
 
-  return box;
+  grid->cell_width = MAX(size.width, 1);
+  grid->cell_height = MAX(size.height, 1);
+  return TRUE;
 }
 
-/* Click handler for poster */
-static void on_poster_activated(GtkFlowBox *flowbox, GtkFlowBoxChild *child,
-                                gpointer user_data) {
-  (void)flowbox;
-  ReelApp *app = (ReelApp *)user_data;
-
-  GtkWidget *box = gtk_bin_get_child(GTK_BIN(child));
-  gint64 film_id = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(box), "film_id"));
+static gint poster_grid_row_pitch(PosterGrid *grid) {
+  return grid->cell_height + GRID_ROW_SPACING;
+}
 
-  /* Show detail dialog */
-  detail_show(app, film_id);
+static gint poster_grid_rows(PosterGrid *grid) {
+  return ((gint)grid->films->len + grid->columns - 1) / grid->columns;
 }
 
-GtkWidget *grid_create(ReelApp *app) {
-  GtkWidget *flowbox = gtk_flow_box_new();
-
-  /* Non-homogeneous keeps cells tight to portrait poster width, avoiding
-     wide empty gutters caused by equal-width columns on large windows. */
-  gtk_flow_box_set_homogeneous(GTK_FLOW_BOX(flowbox), FALSE);
-  /* Prevent sparse results from being vertically distributed to fill the
-     scrolled window; keep the grid anchored at the top. */
-  gtk_widget_set_valign(flowbox, GTK_ALIGN_START);
-  gtk_widget_set_vexpand(flowbox, FALSE);
-  gtk_flow_box_set_selection_mode(GTK_FLOW_BOX(flowbox), GTK_SELECTION_SINGLE);
-  gtk_flow_box_set_activate_on_single_click(GTK_FLOW_BOX(flowbox), TRUE);
-  gtk_flow_box_set_column_spacing(GTK_FLOW_BOX(flowbox), 4);
-  gtk_flow_box_set_row_spacing(GTK_FLOW_BOX(flowbox), 8);
-  gtk_widget_set_margin_start(flowbox, 8);
-  gtk_widget_set_margin_end(flowbox, 8);
-  gtk_widget_set_margin_top(flowbox, 8);
-  gtk_widget_set_margin_bottom(flowbox, 8);
-
-  /* Reasonable limits for grid columns */
-  gtk_flow_box_set_min_children_per_line(GTK_FLOW_BOX(flowbox), 2);
-  gtk_flow_box_set_max_children_per_line(GTK_FLOW_BOX(flowbox), 12);
-
-  g_signal_connect(flowbox, "child-activated", G_CALLBACK(on_poster_activated),
-                   app);
-
-  return flowbox;
+static void poster_cell_place(PosterCell *cell, gint index) {
+  PosterGrid *grid = cell->grid;
+  gint x = grid->x_offset +
+           (index % grid->columns) * (grid->cell_width + GRID_COLUMN_SPACING);
+  gint y = GRID_MARGIN + (index / grid->columns) * poster_grid_row_pitch(grid);
+
+  cell->index = index;
+  poster_cell_update_state(cell);
+  /* Moving a child queues a resize, so only move cells that changed */
+  if (!cell->placed) {
+    gtk_layout_put(GTK_LAYOUT(grid->layout), cell->widget, x, y);
+    cell->placed = TRUE;
+  } else if (cell->x != x || cell->y != y) {
+    gtk_layout_move(GTK_LAYOUT(grid->layout), cell->widget, x, y);
+  }
+  cell->x = x;
+  cell->y = y;
+  gtk_widget_show(cell->widget);
 }
 
-void grid_clear(ReelApp *app) {
-  if (app->grid_idle_source) {
-    g_source_remove(app->grid_idle_source);
-    app->grid_idle_source = 0;
+/* Size the layout for all films and bind cells to the rows in view plus
+   the overscan. Cells already showing a film in range keep it, even if it
+   moved, so inserts don't reload posters. */
+static void poster_grid_relayout(PosterGrid *grid) {
+  gint width = gtk_widget_get_allocated_width(grid->layout);
+  /* Resizing the layout can move the scroll position and come back here */
+  if (width <= 1 || !grid->vadj || grid->in_relayout)
+    return;
+  grid->in_relayout = TRUE;
+  if (!poster_grid_measure(grid)) {
+    gtk_layout_set_size(GTK_LAYOUT(grid->layout), width, 1);
+    for (guint i = 0; i < grid->cells->len; i++) {
+      PosterCell *cell = g_ptr_array_index(grid->cells, i);
+      if (cell->film)
+        poster_cell_unbind(cell);
+    }
+    grid->in_relayout = FALSE;
+    return;
   }
-  if (app->grid_pending) {
-    g_list_free(app->grid_pending);
-    app->grid_pending = NULL;
+
+  gint pitch_x = grid->cell_width + GRID_COLUMN_SPACING;
+  grid->columns = (width - 2 * GRID_MARGIN + GRID_COLUMN_SPACING) / pitch_x;
+  grid->columns = CLAMP(grid->columns, GRID_MIN_COLUMNS, GRID_MAX_COLUMNS);
+  gint used = grid->columns * pitch_x - GRID_COLUMN_SPACING;
+  grid->x_offset = MAX(GRID_MARGIN, (width - used) / 2);
+
+  gint rows = poster_grid_rows(grid);
+  gint pitch = poster_grid_row_pitch(grid);
+  gint height = 2 * GRID_MARGIN + rows * pitch - GRID_ROW_SPACING;
+  gtk_layout_set_size(GTK_LAYOUT(grid->layout), width, MAX(height, 1));
+
+  gdouble value = gtk_adjustment_get_value(grid->vadj);
+  gdouble page = gtk_adjustment_get_page_size(grid->vadj);
+  gint first_row = (gint)((value - GRID_MARGIN) / pitch) - GRID_OVERSCAN_ROWS;
+  gint last_row =
+      (gint)((value + page - GRID_MARGIN) / pitch) + GRID_OVERSCAN_ROWS;
+  gint first = MAX(first_row, 0) * grid->columns;
+  gint last = MIN((last_row + 1) * grid->columns, (gint)grid->films->len);
+
+  /* Cells showing a film that is still in range stay bound */
+  GHashTable *bound = g_hash_table_new(g_int64_hash, g_int64_equal);
+  for (guint i = 0; i < grid->cells->len; i++) {
+    PosterCell *cell = g_ptr_array_index(grid->cells, i);
+    if (!cell->film)
+      continue;
+    if (g_hash_table_contains(bound, &cell->film_id))
+      poster_cell_unbind(cell);
+    else
+      g_hash_table_insert(bound, &cell->film_id, cell);
+  }
+  GArray *unbound = g_array_new(FALSE, FALSE, sizeof(gint));
+  for (gint i = first; i < last; i++) {
+    const Film *film = g_ptr_array_index(grid->films, i);
+    PosterCell *cell = g_hash_table_lookup(bound, &film->id);
+    if (cell && cell->film == film) {
+      g_hash_table_remove(bound, &film->id);
+      poster_cell_place(cell, i);
+    } else {
+      g_array_append_val(unbound, i);
+    }
+  }
+
+  GHashTableIter iter;
+  gpointer value_ptr;
+  g_hash_table_iter_init(&iter, bound);
+  while (g_hash_table_iter_next(&iter, NULL, &value_ptr))
+    poster_cell_unbind((PosterCell *)value_ptr);
+  g_hash_table_destroy(bound);
+
+  for (guint i = 0; i < unbound->len; i++) {
+    gint index = g_array_index(unbound, gint, i);
+    PosterCell *cell = poster_grid_free_cell(grid);
+    poster_cell_bind(cell, g_ptr_array_index(grid->films, index));
+    poster_cell_place(cell, index);
   }
+  g_array_free(unbound, TRUE);
 
-  GList *children = gtk_container_get_children(GTK_CONTAINER(app->grid_view));
-  for (GList *l = children; l != NULL; l = l->next) {
-    gtk_widget_destroy(GTK_WIDGET(l->data));
+  if (startup_debug_enabled()) {
+    startup_log("poster_grid_relayout: films=%u bound=%d-%d cells=%u",
+                grid->films->len, first, last, grid->cells->len);
   }
-  g_list_free(children);
+  grid->in_relayout = FALSE;
 }
 
-static gboolean grid_append_idle(gpointer data) {
-  ReelApp *app = (ReelApp *)data;
+static void poster_grid_scroll_to(PosterGrid *grid, gint index) {
+  if (!grid->vadj || grid->cell_height == 0 || grid->columns == 0)
+    return;
+  gint top = GRID_MARGIN + (index / grid->columns) * poster_grid_row_pitch(grid);
+  gint bottom = top + grid->cell_height;
+  gdouble value = gtk_adjustment_get_value(grid->vadj);
+  gdouble page = gtk_adjustment_get_page_size(grid->vadj);
+  if (top - GRID_MARGIN < value)
+    gtk_adjustment_set_value(grid->vadj, top - GRID_MARGIN);
+  else if (bottom + GRID_MARGIN > value + page)
+    gtk_adjustment_set_value(grid->vadj, bottom + GRID_MARGIN - page);
+}
 
-  const int chunk = 40;
-  int inserted = 0;
-  while (app->grid_pending && inserted < chunk) {
-    Film *film = (Film *)app->grid_pending->data;
-    GtkWidget *poster = create_poster_widget(app, film);
-    GtkWidget *child = gtk_flow_box_child_new();
-    gtk_container_add(GTK_CONTAINER(child), poster);
-    gtk_widget_show_all(child);
-    gtk_flow_box_insert(GTK_FLOW_BOX(app->grid_view), child, -1);
+static void on_grid_scrolled(GtkAdjustment *adj, gpointer user_data) {
+  (void)adj;
+  poster_grid_relayout((PosterGrid *)user_data);
+}
 
-    GList *link = app->grid_pending;
-    app->grid_pending = app->grid_pending->next;
-    g_list_free_1(link);
-    inserted++;
+/* The scrolled window hands the layout its adjustment once it is added */
+static void on_grid_vadjustment(GObject *object, GParamSpec *pspec,
+                                gpointer user_data) {
+  (void)pspec;
+  PosterGrid *grid = (PosterGrid *)user_data;
+  GtkAdjustment *vadj = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(object));
+  if (vadj == grid->vadj)
+    return;
+  if (grid->vadj)
+    g_signal_handlers_disconnect_by_data(grid->vadj, grid);
+  g_clear_object(&grid->vadj);
+  if (vadj) {
+    grid->vadj = g_object_ref(vadj);
+    g_signal_connect(vadj, "value-changed", G_CALLBACK(on_grid_scrolled),
+                     grid);
   }
+}
 
-  if (startup_debug_enabled()) {
-    startup_log("grid_append_idle: inserted=%d pending=%s", inserted,
-                app->grid_pending ? "yes" : "no");
+static gboolean poster_grid_relayout_idle(gpointer data) {
+  PosterGrid *grid = (PosterGrid *)data;
+  grid->relayout_source = 0;
+  poster_grid_relayout(grid);
+  return G_SOURCE_REMOVE;
+}
+
+/* Cells are not added while the layout is being allocated: the relayout
+   runs after GTK's resize pass and before the next redraw */
+static void on_grid_size_allocate(GtkWidget *widget, GdkRectangle *allocation,
+                                  gpointer user_data) {
+  (void)widget;
+  (void)allocation;
+  PosterGrid *grid = (PosterGrid *)user_data;
+  if (!grid->relayout_source)
+    grid->relayout_source = g_idle_add_full(
+        G_PRIORITY_HIGH_IDLE + 15, poster_grid_relayout_idle, grid, NULL);
+}
+
+/* Keyboard navigation, as the flow box did: arrows, Home/End and Page
+   Up/Down move the selection, Enter or Space opens it */
+static gboolean on_grid_key_press(GtkWidget *widget, GdkEventKey *event,
+                                  gpointer user_data) {
+  (void)widget;
+  PosterGrid *grid = (PosterGrid *)user_data;
+  if (grid->films->len == 0 || grid->columns == 0)
+    return GDK_EVENT_PROPAGATE;
+
+  gint page_rows = 1;
+  if (grid->vadj && grid->cell_height > 0)
+    page_rows = MAX((gint)(gtk_adjustment_get_page_size(grid->vadj) /
+                           poster_grid_row_pitch(grid)),
+                    1);
+
+  gint current = grid->selected;
+  gint target;
+  switch (event->keyval) {
+  case GDK_KEY_Return:
+  case GDK_KEY_KP_Enter:
+  case GDK_KEY_ISO_Enter:
+  case GDK_KEY_space:
+  case GDK_KEY_KP_Space:
+    if (current < 0)
+      return GDK_EVENT_PROPAGATE;
+    poster_grid_activate(grid, current);
+    return GDK_EVENT_STOP;
+  case GDK_KEY_Left:
+  case GDK_KEY_KP_Left:
+    target = current - 1;
+    break;
+  case GDK_KEY_Right:
+  case GDK_KEY_KP_Right:
+    target = current + 1;
+    break;
+  case GDK_KEY_Up:
+  case GDK_KEY_KP_Up:
+    target = current - grid->columns;
+    break;
+  case GDK_KEY_Down:
+  case GDK_KEY_KP_Down:
+    target = current + grid->columns;
+    break;
+  case GDK_KEY_Page_Up:
+  case GDK_KEY_KP_Page_Up:
+    target = current - page_rows * grid->columns;
+    break;
+  case GDK_KEY_Page_Down:
+  case GDK_KEY_KP_Page_Down:
+    target = current + page_rows * grid->columns;
+    break;
+  case GDK_KEY_Home:
+  case GDK_KEY_KP_Home:
+    target = 0;
+    break;
+  case GDK_KEY_End:
+  case GDK_KEY_KP_End:
+    target = (gint)grid->films->len - 1;
+    break;
+  default:
+    return GDK_EVENT_PROPAGATE;
   }
 
-  if (!app->grid_pending) {
-    app->grid_idle_source = 0;
-    return G_SOURCE_REMOVE;
+  /* The first key press only selects the top left film in view */
+  if (current < 0) {
+    gdouble value = grid->vadj ? gtk_adjustment_get_value(grid->vadj) : 0;
+    target = (gint)(value / poster_grid_row_pitch(grid) + 0.5) * grid->columns;
   }
+  poster_grid_select(grid, target);
+  return GDK_EVENT_STOP;
+}
 
-  return G_SOURCE_CONTINUE;
+GtkWidget *grid_create(ReelApp *app) {
+  GtkWidget *layout = gtk_layout_new(NULL, NULL);
+  gtk_widget_set_can_focus(layout, TRUE);
+  gtk_widget_add_events(layout, GDK_KEY_PRESS_MASK);
+
+  PosterGrid *grid = g_new0(PosterGrid, 1);
+  grid->app = app;
+  grid->layout = layout;
+  grid->films = g_ptr_array_new();
+  grid->cells =
+      g_ptr_array_new_with_free_func((GDestroyNotify)poster_cell_free);
+  grid->selected = -1;
+  grid->pressed = -1;
+  g_object_set_data_full(G_OBJECT(layout), "poster-grid", grid,
+                         (GDestroyNotify)poster_grid_free);
+
+  g_signal_connect(layout, "notify::vadjustment",
+                   G_CALLBACK(on_grid_vadjustment), grid);
+  g_signal_connect_after(layout, "size-allocate",
+                         G_CALLBACK(on_grid_size_allocate), grid);
+  g_signal_connect(layout, "key-press-event", G_CALLBACK(on_grid_key_press),
+                   grid);
+
+  return layout;
 }
 
-void grid_append_films(ReelApp *app, GList *films) {
-  if (!films)
+void grid_clear(ReelApp *app) {
+  PosterGrid *grid = poster_grid_get(app);
+  if (!grid)
     return;
 
-  app->grid_pending = g_list_concat(app->grid_pending, g_list_copy(films));
-  if (!app->grid_idle_source) {
-    app->grid_idle_source = g_idle_add(grid_append_idle, app);
+  /* Films may already be freed: only the cells' own state is touched */
+  for (guint i = 0; i < grid->cells->len; i++) {
+    PosterCell *cell = g_ptr_array_index(grid->cells, i);
+    if (cell->film)
+      poster_cell_unbind(cell);
   }
+  g_ptr_array_set_size(grid->films, 0);
+  grid->selected = -1;
+  grid->pressed = -1;
+  poster_grid_relayout(grid);
 }
 
-void grid_update_film(ReelApp *app, const Film *film) {
-  if (!app || !app->grid_view || !film)
+void grid_append_films(ReelApp *app, GList *films) {
+  PosterGrid *grid = poster_grid_get(app);
+  if (!grid || !films)
     return;
 
-  GList *children = gtk_container_get_children(GTK_CONTAINER(app->grid_view));
-  for (GList *l = children; l != NULL; l = l->next) {
-    GtkFlowBoxChild *child = GTK_FLOW_BOX_CHILD(l->data);
-    GtkWidget *box = gtk_bin_get_child(GTK_BIN(child));
-    if (!box)
-      continue;
+  for (GList *l = films; l != NULL; l = l->next)
+    g_ptr_array_add(grid->films, l->data);
+  poster_grid_relayout(grid);
+}
 
-    gint64 id = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(box), "film_id"));
-    if (id != film->id)
-      continue;
+void grid_insert_film(ReelApp *app, Film *film, gint position) {
+  PosterGrid *grid = poster_grid_get(app);
+  if (!grid || !film)
+    return;
 
-    int index = gtk_flow_box_child_get_index(child);
-    gtk_widget_destroy(GTK_WIDGET(child));
+  position = CLAMP(position, 0, (gint)grid->films->len);
+  g_ptr_array_insert(grid->films, position, film);
+  if (grid->selected >= position)
+    grid->selected++;
+  poster_grid_relayout(grid);
+}
 
-    GtkWidget *new_box = create_poster_widget(app, (Film *)film);
-    GtkWidget *new_child = gtk_flow_box_child_new();
-    gtk_container_add(GTK_CONTAINER(new_child), new_box);
-    gtk_widget_show_all(new_child);
-    gtk_flow_box_insert(GTK_FLOW_BOX(app->grid_view), new_child, index);
-    break;
-  }
-  g_list_free(children);
+void grid_update_film(ReelApp *app, const Film *film) {
+  PosterGrid *grid = poster_grid_get(app);
+  if (!grid || !film)
+    return;
+
+  /* The grid follows app->films, where film has replaced the freed old
+     copy; its cell no longer matches and is rebound */
+  gint index = g_list_index(app->films, film);
+  if (index < 0 || index >= (gint)grid->films->len)
+    return;
+  g_ptr_array_index(grid->films, index) = (gpointer)film;
+  poster_grid_relayout(grid);
 }
 
 void grid_populate(ReelApp *app) {
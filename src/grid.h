@@ -12,6 +12,9 @@ void grid_populate(ReelApp *app);
 /* Append a batch of films to the grid (Film* list, not owned) */
 void grid_append_films(ReelApp *app, GList *films);
 
+/* Insert one film at the given index of app->films (Film*, not owned) */
+void grid_insert_film(ReelApp *app, Film *film, gint position);
+
 /* Replace a single film's grid item if present */
 void grid_update_film(ReelApp *app, const Film *film);
 
@@ -0,0 +1,277 @@
+/*
+ * ReelGTK - File Hasher
+ * Background content hashing used to find duplicate copies across roots, and
+ * container probing for duration, resolution and codecs
+ */
+
+#include "hasher.h"
+#include "db.h"
+#include "probe.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define OSHASH_CHUNK_SIZE (64 * 1024)
+
+/* Files hashed at once. Each one is only two 64 KiB reads, but on a NAS the
+   seeks dominate, so keep the number of files in flight small. */
+#define HASHER_MAX_WORKERS 3
+
+/* Hash results written per transaction */
+#define HASHER_BATCH_SIZE 64
+
+/* Read up to length bytes at offset; returns the count, or -1 */
+static gint64 read_chunk(int fd, gint64 offset, gint64 length, guchar *buf) {
+  gint64 got = 0;
+  while (got < length) {
+    ssize_t n = pread(fd, buf + got, length - got, offset + got);
+    if (n < 0)
+      return -1;
+    if (n == 0)
+      break;
+    got += n;
+  }
+  return got;
+}
+
+static void oshash_add_chunk(const guchar *buf, gint64 len, guint64 *hash) {
+  for (gint64 i = 0; i + 8 <= len; i += 8) {
+    guint64 word;
+    memcpy(&word, buf + i, sizeof(word));
+    *hash += GUINT64_FROM_LE(word);
+  }
+}
+
+/* The first and last 64 KiB of a file: all the OpenSubtitles hash reads,
+   and normally all a container probe needs */
+typedef struct {
+  guchar *head;
+  guchar *tail;
+  gint64 head_len;
+  gint64 tail_len;
+} FileEnds;
+
+static gboolean file_ends_read(int fd, gint64 size, FileEnds *ends) {
+  gint64 chunk = MIN(size, (gint64)OSHASH_CHUNK_SIZE);
+  ends->head = g_malloc(OSHASH_CHUNK_SIZE);
+  ends->tail = g_malloc(OSHASH_CHUNK_SIZE);
+  ends->head_len = read_chunk(fd, 0, chunk, ends->head);
+  ends->tail_len =
+      read_chunk(fd, MAX(size - OSHASH_CHUNK_SIZE, 0), chunk, ends->tail);
+  return ends->head_len >= 0 && ends->tail_len >= 0;
+}
+
+static void file_ends_clear(FileEnds *ends) {
+  g_free(ends->head);
+  g_free(ends->tail);
+}
+
+static guint64 oshash_ends(gint64 size, const FileEnds *ends) {
+  guint64 hash = (guint64)size;
+  oshash_add_chunk(ends->head, ends->head_len, &hash);
+  oshash_add_chunk(ends->tail, ends->tail_len, &hash);
+  return hash;
+}
+
+/* Background job */
+
+typedef struct {
+  ReelApp *app;
+  volatile gboolean running;
+  HasherDoneFunc done_cb;
+  gpointer user_data;
+  GAsyncQueue *results; /* HashResult*, produced by pool workers */
+  gint hashed;
+} HasherContext;
+
+/* One file to read: it may need a hash, a probe, or both */
+typedef struct {
+  gchar *path;
+  gboolean need_hash;
+  gboolean need_probe;
+} HashTask;
+
+typedef struct {
+  HashTask task;
+  gboolean ok;
+  FileId id;
+  gchar oshash[17];
+  MediaInfo media; /* All zero if the container was not recognised */
+} HashResult;
+
+static HasherContext *active_hasher = NULL;
+
+static void hash_result_free(HashResult *result) {
+  g_free(result->task.path);
+  media_info_clear(&result->media);
+  g_free(result);
+}
+
+static void hasher_worker(gpointer data, gpointer user_data) {
+  HasherContext *ctx = (HasherContext *)user_data;
+  HashTask *task = (HashTask *)data;
+  HashResult *result = g_new0(HashResult, 1);
+  result->task = *task;
+  g_free(task);
+
+  if (ctx->running) {
+    int fd = open(result->task.path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+      struct stat st;
+      FileEnds ends;
+      if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        gint64 size = (gint64)st.st_size;
+        if (file_ends_read(fd, size, &ends)) {
+          result->id.dev = (gint64)st.st_dev;
+          result->id.ino = (gint64)st.st_ino;
+          result->id.size = size;
+          result->id.mtime = (gint64)st.st_mtime;
+          if (result->task.need_hash)
+            g_snprintf(result->oshash, sizeof(result->oshash),
+                       "%016" G_GINT64_MODIFIER "x", oshash_ends(size, &ends));
+          /* Headers outside the two blocks are read from fd */
+          if (result->task.need_probe)
+            probe_media_fd(fd, size, ends.head, ends.head_len, ends.tail,
+                           ends.tail_len, &result->media);
+          result->ok = TRUE;
+        }
+        file_ends_clear(&ends);
+      }
+      close(fd);
+    }
+  }
+
+  g_async_queue_push(ctx->results, result);
+}
+
+static void hasher_write_batch(ReelApp *app, GPtrArray *batch) {
+  if (batch->len == 0)
+    return;
+
+  db_begin(app);
+  for (guint i = 0; i < batch->len; i++) {
+    HashResult *result = g_ptr_array_index(batch, i);
+    if (result->task.need_hash)
+      db_file_id_set_oshash(app, result->task.path, &result->id,
+                            result->oshash);
+    if (result->task.need_probe)
+      db_media_info_put(app, result->task.path, &result->id, &result->media);
+  }
+  db_commit(app);
+  g_ptr_array_set_size(batch, 0);
+}
+
+static gboolean hasher_done_idle(gpointer data) {
+  HasherContext *ctx = (HasherContext *)data;
+  if (ctx->done_cb) {
+    ctx->done_cb(ctx->app, ctx->hashed, ctx->user_data);
+  }
+  if (active_hasher == ctx)
+    active_hasher = NULL;
+  g_async_queue_unref(ctx->results);
+  g_free(ctx);
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer hasher_thread_func(gpointer data) {
+  HasherContext *ctx = (HasherContext *)data;
+  ReelApp *app = ctx->app;
+
+  sqlite3 *db = NULL;
+  if (sqlite3_open(app->db_path, &db) != SQLITE_OK) {
+    if (db)
+      sqlite3_close(db);
+    g_idle_add(hasher_done_idle, ctx);
+    return NULL;
+  }
+  sqlite3_busy_timeout(db, 5000);
+
+  ReelApp thread_app = *app;
+  thread_app.db = db;
+
+  /* Files missing a hash or a probe; each is read once for both */
+  GHashTable *tasks = g_hash_table_new(g_str_hash, g_str_equal);
+  GList *order = NULL;
+  GList *unhashed = db_film_paths_without_oshash(&thread_app);
+  GList *unprobed = db_film_paths_without_media_info(&thread_app);
+  for (gint pass = 0; pass < 2; pass++) {
+    for (GList *l = pass == 0 ? unhashed : unprobed; l != NULL; l = l->next) {
+      HashTask *task = g_hash_table_lookup(tasks, l->data);
+      if (!task) {
+        task = g_new0(HashTask, 1);
+        task->path = g_strdup(l->data);
+        g_hash_table_insert(tasks, task->path, task);
+        order = g_list_prepend(order, task);
+      }
+      if (pass == 0)
+        task->need_hash = TRUE;
+      else
+        task->need_probe = TRUE;
+    }
+  }
+  g_list_free_full(unhashed, g_free);
+  g_list_free_full(unprobed, g_free);
+  g_hash_table_destroy(tasks);
+  order = g_list_reverse(order);
+  guint total = g_list_length(order);
+
+  if (total > 0) {
+    GThreadPool *pool = g_thread_pool_new(hasher_worker, ctx,
+                                          HASHER_MAX_WORKERS, TRUE, NULL);
+    /* Workers take ownership of the tasks. */
+    for (GList *l = order; l != NULL; l = l->next)
+      g_thread_pool_push(pool, l->data, NULL);
+    g_list_free(order);
+    order = NULL;
+
+    GPtrArray *batch =
+        g_ptr_array_new_with_free_func((GDestroyNotify)hash_result_free);
+    for (guint received = 0; received < total; received++) {
+      HashResult *result = g_async_queue_pop(ctx->results);
+      if (!result->ok) {
+        hash_result_free(result);
+        continue;
+      }
+      g_ptr_array_add(batch, result);
+      if (result->task.need_hash)
+        ctx->hashed++;
+      if (batch->len >= HASHER_BATCH_SIZE)
+        hasher_write_batch(&thread_app, batch);
+    }
+    hasher_write_batch(&thread_app, batch);
+    g_ptr_array_unref(batch);
+
+    g_thread_pool_free(pool, FALSE, TRUE);
+  }
+
+  sqlite3_close(db);
+  g_print("Hashed or probed %u files, %d hashes\n", total, ctx->hashed);
+  g_idle_add(hasher_done_idle, ctx);
+  return NULL;
+}
+
+void hasher_start_background(ReelApp *app, HasherDoneFunc done_cb,
+                             gpointer user_data) {
+  if (active_hasher) {
+    g_print("Hasher already running\n");
+    return;
+  }
+
+  HasherContext *ctx = g_new0(HasherContext, 1);
+  ctx->app = app;
+  ctx->running = TRUE;
+  ctx->done_cb = done_cb;
+  ctx->user_data = user_data;
+  ctx->results = g_async_queue_new();
+  active_hasher = ctx;
+
+  g_thread_unref(g_thread_new("hasher", hasher_thread_func, ctx));
+}
+
+void hasher_stop(ReelApp *app) {
+  (void)app;
+  if (active_hasher) {
+    active_hasher->running = FALSE;
+  }
+}
@@ -0,0 +1,18 @@
+#ifndef REELGTK_HASHER_H
+#define REELGTK_HASHER_H
+
+#include "app.h"
+
+typedef void (*HasherDoneFunc)(ReelApp *app, gint hashed, gpointer user_data);
+
+/* Hash every tracked film file that has no hash yet, and probe the
+   containers of files with no media info for this inode and mtime, in the
+   background. Both use the same head and tail reads. done_cb runs on the
+   main loop once all results are stored; hashed counts new hashes only. */
+void hasher_start_background(ReelApp *app, HasherDoneFunc done_cb,
+                             gpointer user_data);
+
+/* Stop the background hash job (results computed so far are kept) */
+void hasher_stop(ReelApp *app);
+
+#endif /* REELGTK_HASHER_H */
@@ -4,8 +4,11 @@
  */
 
 #include "app.h"
+#include "cli.h"
 #include "config.h"
 #include "db.h"
+#include "hasher.h"
+#include "scanner.h"
 #include "window.h"
 #include <gtk/gtk.h>
 #include <locale.h>
@@ -48,6 +51,9 @@ static void on_activate(GtkApplication *gtk_app, gpointer user_data) {
 static void on_shutdown(GtkApplication *gtk_app, gpointer user_data) {
   ReelApp *app = (ReelApp *)user_data;
 
+  scanner_stop(app);
+  hasher_stop(app);
+
   /* Close database */
   db_close(app);
 
@@ -67,6 +73,13 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
+  /* Headless commands run without GTK */
+  if (cli_is_headless(argc, argv)) {
+    int status = cli_run(app, argc, argv);
+    reel_app_free(app);
+    return status;
+  }
+
   /* Create GTK application */
   app->app = gtk_application_new(APP_ID, G_APPLICATION_DEFAULT_FLAGS);
   g_signal_connect(app->app, "activate", G_CALLBACK(on_activate), app);
@@ -88,6 +101,12 @@ ReelApp *reel_app_new(void) {
   ReelApp *app = g_new0(ReelApp, 1);
   filter_state_init(&app->filter);
   app->player_command = g_strdup("xdg-open");
+  app->missing_grace_days = 3;
+  app->io_timeout_seconds = 10;
+  app->scrape_concurrency = 8;
+  app->scrape_rate = 20;
+  app->tmdb_cache_mb = 64;
+  app->poster_memory_mb = 64;
   return app;
 }
 
@@ -109,10 +128,14 @@ void reel_app_free(ReelApp *app) {
   if (app->library_paths) {
     g_strfreev(app->library_paths);
   }
+  g_strfreev(app->strip_tags);
 
   /* Free film list */
   g_list_free_full(app->films, (GDestroyNotify)film_free);
 
+  if (app->poster_fetch_pool) {
+    g_thread_pool_free(app->poster_fetch_pool, TRUE, FALSE);
+  }
   if (app->thread_pool) {
     g_thread_pool_free(app->thread_pool, TRUE, FALSE);
   }
@@ -217,7 +240,9 @@ void film_free(Film *film) {
   g_free(film->title);
   g_free(film->plot);
   g_free(film->poster_path);
+  g_free(film->poster_remote);
   g_free(film->imdb_id);
+  g_free(film->show_name);
 
   if (film->poster_pixbuf) {
     g_object_unref(film->poster_pixbuf);
@@ -238,6 +263,7 @@ Film *film_copy(const Film *film) {
   copy->runtime_minutes = film->runtime_minutes;
   copy->plot = g_strdup(film->plot);
   copy->poster_path = g_strdup(film->poster_path);
+  copy->poster_remote = g_strdup(film->poster_remote);
   copy->tmdb_id = film->tmdb_id;
   copy->imdb_id = g_strdup(film->imdb_id);
   copy->rating = film->rating;
@@ -245,6 +271,9 @@ Film *film_copy(const Film *film) {
   copy->match_status = film->match_status;
   copy->media_type = film->media_type;
   copy->season_number = film->season_number;
+  copy->show_id = film->show_id;
+  copy->show_name = g_strdup(film->show_name);
+  copy->season_count = film->season_count;
 
   if (film->poster_pixbuf) {
     copy->poster_pixbuf = g_object_ref(film->poster_pixbuf);
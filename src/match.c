@@ -19,6 +19,7 @@ typedef struct {
   GtkWidget *search_entry;
   GtkWidget *tv_checkbox;
   GtkWidget *results_list;
+  GtkWidget *miss_box; /* Shown while a failed lookup is remembered */
   GList *search_results;
 } MatchDialogContext;
 
@@ -94,6 +95,7 @@ static gpointer apply_match_thread(gpointer data) {
     return NULL;
   }
   sqlite3_exec(db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+  sqlite3_busy_timeout(db, 5000);
 
   ReelApp thread_app = *task->app;
   thread_app.db = db;
@@ -135,6 +137,50 @@ static gpointer apply_match_thread(gpointer data) {
   return NULL;
 }
 
+/* Forget that automatic lookup found nothing, so the next scrape searches
+   for the film again right away */
+static void on_forget_miss_clicked(GtkButton *button, gpointer user_data) {
+  (void)button;
+  MatchDialogContext *ctx = (MatchDialogContext *)user_data;
+  Film *film = db_film_get_by_id(ctx->app, ctx->film_id);
+  if (film) {
+    scraper_forget_miss(ctx->app, film);
+    if (film->match_status == MATCH_STATUS_UNMATCHED)
+      db_scrape_job_enqueue(ctx->app, film->id);
+    film_free(film);
+  }
+  gtk_widget_hide(ctx->miss_box);
+}
+
+/* A line saying when automatic lookup last failed, with a way to retry */
+static GtkWidget *miss_box_new(MatchDialogContext *ctx, const TmdbMiss *miss) {
+  GtkWidget *box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
+
+  GDateTime *checked = g_date_time_new_from_unix_local(miss->checked);
+  GDateTime *recheck = g_date_time_new_from_unix_local(miss->recheck_at);
+  gchar *checked_text = g_date_time_format(checked, "%x");
+  gchar *recheck_text = g_date_time_format(recheck, "%x");
+  gchar *text = g_strdup_printf(
+      "No automatic match (%d %s, last on %s). Next try after %s.",
+      miss->misses, miss->misses == 1 ? "search" : "searches", checked_text,
+      recheck_text);
+  GtkWidget *label = gtk_label_new(text);
+  gtk_label_set_xalign(GTK_LABEL(label), 0);
+  gtk_label_set_line_wrap(GTK_LABEL(label), TRUE);
+  gtk_widget_set_hexpand(label, TRUE);
+  gtk_box_pack_start(GTK_BOX(box), label, TRUE, TRUE, 0);
+  g_free(text);
+  g_free(recheck_text);
+  g_free(checked_text);
+  g_date_time_unref(recheck);
+  g_date_time_unref(checked);
+
+  GtkWidget *button = gtk_button_new_with_label("Retry Next Scrape");
+  g_signal_connect(button, "clicked", G_CALLBACK(on_forget_miss_clicked), ctx);
+  gtk_box_pack_start(GTK_BOX(box), button, FALSE, FALSE, 0);
+  return box;
+}
+
 /* Callback for search entry activate */
 static void on_search_entry_activate(GtkEntry *entry, gpointer user_data) {
   (void)entry;
@@ -183,6 +229,13 @@ void match_show(ReelApp *app, gint64 film_id) {
   g_free(safe_file_basename);
   g_free(file_basename);
 
+  TmdbMiss miss;
+  if (film->match_status == MATCH_STATUS_UNMATCHED &&
+      scraper_find_miss(app, film, &miss)) {
+    ctx->miss_box = miss_box_new(ctx, &miss);
+    gtk_box_pack_start(GTK_BOX(content), ctx->miss_box, FALSE, FALSE, 0);
+  }
+
   /* Search box */
   GtkWidget *search_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
   gtk_box_pack_start(GTK_BOX(content), search_box, FALSE, FALSE, 0);
@@ -414,6 +467,8 @@ static void reset_film_to_unmatched(ReelApp *app, gint64 film_id) {
   /* Reset scraped fields. */
   film->match_status = MATCH_STATUS_UNMATCHED;
   film->tmdb_id = 0;
+  gint64 old_show_id = film->show_id;
+  film->show_id = 0;
   g_free(film->imdb_id);
   film->imdb_id = NULL;
   film->rating = 0.0;
@@ -422,6 +477,8 @@ static void reset_film_to_unmatched(ReelApp *app, gint64 film_id) {
   film->plot = NULL;
   g_free(film->poster_path);
   film->poster_path = NULL;
+  g_free(film->poster_remote);
+  film->poster_remote = NULL;
 
   /* Restore a reasonable "unknown" title/year from the filename/path. */
   g_free(film->title);
@@ -465,6 +522,10 @@ static void reset_film_to_unmatched(ReelApp *app, gint64 film_id) {
     g_free(base);
   }
 
+  /* Back in the queue, so the next scrape looks it up again */
   db_film_update(app, film);
+  db_scrape_job_enqueue(app, film_id);
+  if (old_show_id > 0)
+    db_shows_delete_orphans(app);
   film_free(film);
 }
@@ -0,0 +1,99 @@
+/*
+ * ReelGTK - Decoded Poster Cache
+ * Keeps posters decoded for the grid within a memory budget
+ */
+
+#include "postercache.h"
+
+typedef struct {
+  gchar *key;
+  GdkPixbuf *pixbuf;
+  gint64 mtime;
+  gsize bytes;
+} PosterCacheEntry;
+
+/* Most recently used first; the table maps keys to their links */
+static GQueue cache_order = G_QUEUE_INIT;
+static GHashTable *cache_index;
+static gint64 cache_bytes;
+
+static gint stat_hits;
+static gint stat_misses;
+static gint stat_evictions;
+
+static gint64 cache_max_bytes(ReelApp *app) {
+  return (gint64)app->poster_memory_mb * 1024 * 1024;
+}
+
+static void cache_entry_free(PosterCacheEntry *entry) {
+  g_free(entry->key);
+  g_object_unref(entry->pixbuf);
+  g_free(entry);
+}
+
+static void cache_remove_link(GList *link) {
+  PosterCacheEntry *entry = (PosterCacheEntry *)link->data;
+  g_hash_table_remove(cache_index, entry->key);
+  g_queue_delete_link(&cache_order, link);
+  cache_bytes -= entry->bytes;
+  cache_entry_free(entry);
+}
+
+gchar *poster_cache_key(const gchar *path, gint width, gint height) {
+  if (!path || !*path)
+    return NULL;
+  return g_strdup_printf("%s@%dx%d", path, width, height);
+}
+
+GdkPixbuf *poster_cache_lookup(ReelApp *app, const gchar *key, gint64 *mtime) {
+  GList *link = cache_index && key ? g_hash_table_lookup(cache_index, key)
+                                   : NULL;
+  if (!link || app->poster_memory_mb <= 0) {
+    stat_misses++;
+    return NULL;
+  }
+
+  stat_hits++;
+  g_queue_unlink(&cache_order, link);
+  g_queue_push_head_link(&cache_order, link);
+  PosterCacheEntry *entry = (PosterCacheEntry *)link->data;
+  *mtime = entry->mtime;
+  return g_object_ref(entry->pixbuf);
+}
+
+void poster_cache_store(ReelApp *app, const gchar *key, gint64 mtime,
+                        GdkPixbuf *pixbuf) {
+  if (!key || !pixbuf || app->poster_memory_mb <= 0)
+    return;
+  if (!cache_index)
+    cache_index = g_hash_table_new(g_str_hash, g_str_equal);
+
+  GList *old = g_hash_table_lookup(cache_index, key);
+  if (old)
+    cache_remove_link(old);
+
+  PosterCacheEntry *entry = g_new0(PosterCacheEntry, 1);
+  entry->key = g_strdup(key);
+  entry->pixbuf = g_object_ref(pixbuf);
+  entry->mtime = mtime;
+  entry->bytes = gdk_pixbuf_get_byte_length(pixbuf);
+  g_queue_push_head(&cache_order, entry);
+  g_hash_table_insert(cache_index, entry->key, cache_order.head);
+  cache_bytes += entry->bytes;
+
+  /* Posters in view were used last, so these are the ones scrolled
+     furthest away; a cell still showing one keeps its own reference */
+  gint64 max_bytes = cache_max_bytes(app);
+  while (cache_bytes > max_bytes && cache_order.length > 1) {
+    cache_remove_link(cache_order.tail);
+    stat_evictions++;
+  }
+}
+
+void poster_cache_stats(PosterCacheStats *stats) {
+  stats->hits = stat_hits;
+  stats->misses = stat_misses;
+  stats->evictions = stat_evictions;
+  stats->entries = (gint)cache_order.length;
+  stats->bytes = cache_bytes;
+}
@@ -0,0 +1,35 @@
+#ifndef REELGTK_POSTERCACHE_H
+#define REELGTK_POSTERCACHE_H
+
+#include "app.h"
+
+/* Decoded posters shared by the grid's cells, so scrolling back or changing
+   the filter doesn't decode them again. The least recently shown go first
+   once the posters held take more than poster_memory_mb. Main thread only. */
+
+typedef struct {
+  gint hits;       /* Posters shown without decoding */
+  gint misses;     /* Posters that had to be decoded */
+  gint evictions;  /* Dropped to stay within the budget */
+  gint entries;    /* Held now */
+  gint64 bytes;    /* Pixel memory held now */
+} PosterCacheStats;
+
+/* Key for a poster file decoded at a size, NULL without a file. The file is
+   not looked at, so a replaced one is caught by comparing the mtime kept
+   with the entry. */
+gchar *poster_cache_key(const gchar *path, gint width, gint height);
+
+/* A new reference to the cached poster, or NULL. A hit counts as most
+   recently used; mtime is set to that of the file it was decoded from. */
+GdkPixbuf *poster_cache_lookup(ReelApp *app, const gchar *key, gint64 *mtime);
+
+/* Keep a poster decoded from a file with this mtime, evicting the least
+   recently used over the budget */
+void poster_cache_store(ReelApp *app, const gchar *key, gint64 mtime,
+                        GdkPixbuf *pixbuf);
+
+/* Counters since startup */
+void poster_cache_stats(PosterCacheStats *stats);
+
+#endif /* REELGTK_POSTERCACHE_H */
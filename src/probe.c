@@ -0,0 +1,640 @@
+/*
+ * ReelGTK - Media Probe
+ * Reads stream details from Matroska and MP4 container headers
+ */
+
+#include "probe.h"
+#include <string.h>
+#include <unistd.h>
+
+/* Reads outside the head and tail blocks allowed per file. Headers need a
+   handful; a damaged file should not turn into a full read. */
+#define PROBE_MAX_READS 64
+
+/* Largest Matroska Info or Tracks element loaded into memory */
+#define PROBE_MAX_ELEMENT (256 * 1024)
+
+typedef struct {
+  int fd;
+  gint64 size;
+  const guchar *head;
+  gsize head_len;
+  const guchar *tail;
+  gint64 tail_offset;
+  gsize tail_len;
+  gint reads;
+} ProbeReader;
+
+/* Stream details gathered while parsing */
+typedef struct {
+  gint64 duration_ms;
+  gint width;
+  gint height;
+  gchar *video_codec;
+  GPtrArray *audio_codecs;    /* gchar*, unique */
+  GPtrArray *audio_languages; /* gchar*, unique */
+} ProbeState;
+
+static gboolean probe_read(ProbeReader *r, gint64 offset, guchar *dst,
+                           gsize len) {
+  if (offset < 0 || (gint64)len > r->size - offset)
+    return FALSE;
+
+  if (r->head && offset + (gint64)len <= (gint64)r->head_len) {
+    memcpy(dst, r->head + offset, len);
+    return TRUE;
+  }
+  if (r->tail && offset >= r->tail_offset &&
+      offset + (gint64)len <= r->tail_offset + (gint64)r->tail_len) {
+    memcpy(dst, r->tail + (offset - r->tail_offset), len);
+    return TRUE;
+  }
+
+  if (++r->reads > PROBE_MAX_READS)
+    return FALSE;
+  gsize got = 0;
+  while (got < len) {
+    ssize_t n = pread(r->fd, dst + got, len - got, offset + got);
+    if (n <= 0)
+      return FALSE;
+    got += n;
+  }
+  return TRUE;
+}
+
+static guint64 read_be(const guchar *p, gsize len) {
+  guint64 value = 0;
+  for (gsize i = 0; i < len; i++)
+    value = (value << 8) | p[i];
+  return value;
+}
+
+static void probe_add_unique(GPtrArray *list, const gchar *value) {
+  if (!value || !*value)
+    return;
+  for (guint i = 0; i < list->len; i++) {
+    if (g_strcmp0(g_ptr_array_index(list, i), value) == 0)
+      return;
+  }
+  g_ptr_array_add(list, g_strdup(value));
+}
+
+/* Codec names as users know them, from Matroska CodecIDs and MP4 sample
+   entry types */
+static const struct {
+  const gchar *id;
+  const gchar *name;
+} CODEC_NAMES[] = {
+    {"V_MPEG4/ISO/AVC", "h264"}, {"V_MPEGH/ISO/HEVC", "hevc"},
+    {"V_AV1", "av1"},            {"V_VP9", "vp9"},
+    {"V_VP8", "vp8"},            {"V_MPEG4/ISO/ASP", "mpeg4"},
+    {"V_MPEG2", "mpeg2"},        {"V_MS/VFW/FOURCC", "vfw"},
+    {"A_AAC", "aac"},            {"A_AC3", "ac3"},
+    {"A_EAC3", "eac3"},          {"A_DTS", "dts"},
+    {"A_TRUEHD", "truehd"},      {"A_FLAC", "flac"},
+    {"A_OPUS", "opus"},          {"A_VORBIS", "vorbis"},
+    {"A_MPEG/L3", "mp3"},        {"A_MPEG/L2", "mp2"},
+    {"A_PCM", "pcm"},            {"avc1", "h264"},
+    {"avc3", "h264"},            {"hvc1", "hevc"},
+    {"hev1", "hevc"},            {"dvh1", "hevc"},
+    {"dvhe", "hevc"},            {"av01", "av1"},
+    {"vp09", "vp9"},             {"mp4v", "mpeg4"},
+    {"mp4a", "aac"},             {"ac-3", "ac3"},
+    {"ec-3", "eac3"},            {"dtsc", "dts"},
+    {"dtsh", "dts"},             {"dtsl", "dts"},
+    {"Opus", "opus"},            {"fLaC", "flac"},
+    {".mp3", "mp3"},             {"lpcm", "pcm"},
+    {"sowt", "pcm"},             {"twos", "pcm"},
+};
+
+/* Matroska IDs are matched by prefix ("A_AAC/MPEG4/LC", "A_PCM/INT/LIT") */
+static gchar *probe_codec_name(const gchar *id) {
+  for (gsize i = 0; i < G_N_ELEMENTS(CODEC_NAMES); i++) {
+    if (g_str_has_prefix(id, CODEC_NAMES[i].id))
+      return g_strdup(CODEC_NAMES[i].name);
+  }
+  return g_ascii_strdown(id, -1);
+}
+
+/* Matroska (EBML) */
+
+#define MKV_EBML 0x1A45DFA3
+#define MKV_SEGMENT 0x18538067
+#define MKV_SEEKHEAD 0x114D9B74
+#define MKV_SEEK 0x4DBB
+#define MKV_SEEKID 0x53AB
+#define MKV_SEEKPOSITION 0x53AC
+#define MKV_INFO 0x1549A966
+#define MKV_TIMESTAMPSCALE 0x2AD7B1
+#define MKV_DURATION 0x4489
+#define MKV_TRACKS 0x1654AE6B
+#define MKV_TRACKENTRY 0xAE
+#define MKV_TRACKTYPE 0x83
+#define MKV_CODECID 0x86
+#define MKV_LANGUAGE 0x22B59C
+#define MKV_VIDEO 0xE0
+#define MKV_PIXELWIDTH 0xB0
+#define MKV_PIXELHEIGHT 0xBA
+#define MKV_CLUSTER 0x1F43B675
+
+#define MKV_UNKNOWN_SIZE G_MAXUINT64
+
+/* Decode an element header at buf[pos]: the ID keeps its length marker, the
+   size loses it. Returns the header length, or 0 if it doesn't fit. */
+static gsize ebml_header(const guchar *buf, gsize len, gsize pos, guint32 *id,
+                         guint64 *size) {
+  if (pos >= len)
+    return 0;
+
+  guchar first = buf[pos];
+  gsize id_len = first & 0x80 ? 1 : first & 0x40 ? 2 : first & 0x20 ? 3
+               : first & 0x10 ? 4 : 0;
+  if (id_len == 0 || pos + id_len >= len)
+    return 0;
+  *id = (guint32)read_be(buf + pos, id_len);
+
+  first = buf[pos + id_len];
+  gsize size_len = 1;
+  while (size_len <= 8 && !(first & (0x80 >> (size_len - 1))))
+    size_len++;
+  if (size_len > 8 || pos + id_len + size_len > len)
+    return 0;
+
+  guint64 value = first & (0xFF >> size_len);
+  gboolean all_ones = value == (guint64)(0xFF >> size_len);
+  for (gsize i = 1; i < size_len; i++) {
+    guchar b = buf[pos + id_len + i];
+    value = (value << 8) | b;
+    all_ones = all_ones && b == 0xFF;
+  }
+  *size = all_ones ? MKV_UNKNOWN_SIZE : value;
+  return id_len + size_len;
+}
+
+/* Element header at a file offset */
+static gsize ebml_header_at(ProbeReader *r, gint64 offset, guint32 *id,
+                            guint64 *size) {
+  guchar buf[12];
+  gsize len = (gsize)MIN((gint64)sizeof(buf), r->size - offset);
+  if (offset >= r->size || !probe_read(r, offset, buf, len))
+    return 0;
+  return ebml_header(buf, len, 0, id, size);
+}
+
+static void mkv_parse_info(const guchar *buf, gsize len, ProbeState *st) {
+  guint64 scale = 1000000; /* Default: timestamps in milliseconds */
+  gdouble duration = 0;
+
+  gsize pos = 0;
+  while (pos < len) {
+    guint32 id;
+    guint64 size;
+    gsize hdr = ebml_header(buf, len, pos, &id, &size);
+    if (hdr == 0 || size > len - pos - hdr)
+      break;
+    const guchar *data = buf + pos + hdr;
+
+    if (id == MKV_TIMESTAMPSCALE && size >= 1 && size <= 8) {
+      scale = read_be(data, size);
+    } else if (id == MKV_DURATION && size == 4) {
+      guint32 bits = (guint32)read_be(data, 4);
+      gfloat f;
+      memcpy(&f, &bits, sizeof(f));
+      duration = f;
+    } else if (id == MKV_DURATION && size == 8) {
+      guint64 bits = read_be(data, 8);
+      memcpy(&duration, &bits, sizeof(duration));
+    }
+    pos += hdr + size;
+  }
+
+  if (duration > 0 && scale > 0)
+    st->duration_ms = (gint64)(duration * (gdouble)scale / 1000000.0);
+}
+
+static void mkv_parse_track(const guchar *buf, gsize len, ProbeState *st) {
+  guint64 type = 0;
+  gchar *codec = NULL;
+  gchar *language = NULL;
+  gint width = 0;
+  gint height = 0;
+
+  gsize pos = 0;
+  while (pos < len) {
+    guint32 id;
+    guint64 size;
+    gsize hdr = ebml_header(buf, len, pos, &id, &size);
+    if (hdr == 0 || size > len - pos - hdr)
+      break;
+    const guchar *data = buf + pos + hdr;
+
+    if (id == MKV_TRACKTYPE && size >= 1 && size <= 8) {
+      type = read_be(data, size);
+    } else if (id == MKV_CODECID && !codec) {
+      codec = g_strndup((const gchar *)data, size);
+    } else if (id == MKV_LANGUAGE && !language) {
+      language = g_strndup((const gchar *)data, size);
+    } else if (id == MKV_VIDEO) {
+      gsize vpos = 0;
+      while (vpos < size) {
+        guint32 vid;
+        guint64 vsize;
+        gsize vhdr = ebml_header(data, size, vpos, &vid, &vsize);
+        if (vhdr == 0 || vsize > size - vpos - vhdr || vsize > 8)
+          break;
+        if (vid == MKV_PIXELWIDTH)
+          width = (gint)read_be(data + vpos + vhdr, vsize);
+        else if (vid == MKV_PIXELHEIGHT)
+          height = (gint)read_be(data + vpos + vhdr, vsize);
+        vpos += vhdr + vsize;
+      }
+    }
+    pos += hdr + size;
+  }
+
+  if (type == 1 && !st->video_codec && codec) {
+    st->video_codec = probe_codec_name(codec);
+    st->width = width;
+    st->height = height;
+  } else if (type == 2 && codec) {
+    gchar *name = probe_codec_name(codec);
+    probe_add_unique(st->audio_codecs, name);
+    g_free(name);
+    /* Matroska's default language is English */
+    const gchar *lang = language ? language : "eng";
+    if (g_strcmp0(lang, "und") != 0)
+      probe_add_unique(st->audio_languages, lang);
+  }
+
+  g_free(codec);
+  g_free(language);
+}
+
+static void mkv_parse_tracks(const guchar *buf, gsize len, ProbeState *st) {
+  gsize pos = 0;
+  while (pos < len) {
+    guint32 id;
+    guint64 size;
+    gsize hdr = ebml_header(buf, len, pos, &id, &size);
+    if (hdr == 0 || size > len - pos - hdr)
+      break;
+    if (id == MKV_TRACKENTRY)
+      mkv_parse_track(buf + pos + hdr, size, st);
+    pos += hdr + size;
+  }
+}
+
+/* Load a top-level element's body and hand it to parse */
+static gboolean mkv_load_element(ProbeReader *r, gint64 offset, guint32 want,
+                                 void (*parse)(const guchar *, gsize,
+                                               ProbeState *),
+                                 ProbeState *st) {
+  guint32 id;
+  guint64 size;
+  gsize hdr = ebml_header_at(r, offset, &id, &size);
+  if (hdr == 0 || id != want || size > PROBE_MAX_ELEMENT)
+    return FALSE;
+
+  guchar *buf = g_malloc(size ? size : 1);
+  gboolean ok = probe_read(r, offset + hdr, buf, size);
+  if (ok)
+    parse(buf, size, st);
+  g_free(buf);
+  return ok;
+}
+
+/* Positions of Info and Tracks from the SeekHead, relative to the segment */
+static void mkv_parse_seekhead(const guchar *buf, gsize len, gint64 *info_pos,
+                               gint64 *tracks_pos) {
+  gsize pos = 0;
+  while (pos < len) {
+    guint32 id;
+    guint64 size;
+    gsize hdr = ebml_header(buf, len, pos, &id, &size);
+    if (hdr == 0 || size > len - pos - hdr)
+      break;
+
+    if (id == MKV_SEEK) {
+      const guchar *seek = buf + pos + hdr;
+      guint32 target = 0;
+      gint64 target_pos = -1;
+      gsize spos = 0;
+      while (spos < size) {
+        guint32 sid;
+        guint64 ssize;
+        gsize shdr = ebml_header(seek, size, spos, &sid, &ssize);
+        if (shdr == 0 || ssize > size - spos - shdr || ssize > 8)
+          break;
+        if (sid == MKV_SEEKID)
+          target = (guint32)read_be(seek + spos + shdr, ssize);
+        else if (sid == MKV_SEEKPOSITION)
+          target_pos = (gint64)read_be(seek + spos + shdr, ssize);
+        spos += shdr + ssize;
+      }
+      if (target == MKV_INFO)
+        *info_pos = target_pos;
+      else if (target == MKV_TRACKS)
+        *tracks_pos = target_pos;
+    }
+    pos += hdr + size;
+  }
+}
+
+static gboolean probe_matroska(ProbeReader *r, ProbeState *st) {
+  guint32 id;
+  guint64 size;
+  gsize hdr = ebml_header_at(r, 0, &id, &size);
+  if (hdr == 0 || id != MKV_EBML || size == MKV_UNKNOWN_SIZE)
+    return FALSE;
+
+  gint64 offset = hdr + (gint64)size;
+  hdr = ebml_header_at(r, offset, &id, &size);
+  if (hdr == 0 || id != MKV_SEGMENT)
+    return FALSE;
+
+  gint64 segment = offset + hdr;
+  gint64 segment_end = size == MKV_UNKNOWN_SIZE
+                           ? r->size
+                           : MIN(r->size, segment + (gint64)size);
+  gboolean have_info = FALSE;
+  gboolean have_tracks = FALSE;
+  gint64 info_pos = -1;
+  gint64 tracks_pos = -1;
+
+  /* Walk the top level up to the first cluster; Info and Tracks nearly
+     always come before it, within the head block */
+  offset = segment;
+  while (offset < segment_end && !(have_info && have_tracks)) {
+    hdr = ebml_header_at(r, offset, &id, &size);
+    if (hdr == 0 || id == MKV_CLUSTER || size == MKV_UNKNOWN_SIZE)
+      break;
+
+    if (id == MKV_INFO && !have_info)
+      have_info = mkv_load_element(r, offset, id, mkv_parse_info, st);
+    else if (id == MKV_TRACKS && !have_tracks)
+      have_tracks = mkv_load_element(r, offset, id, mkv_parse_tracks, st);
+    else if (id == MKV_SEEKHEAD && size <= PROBE_MAX_ELEMENT) {
+      guchar *buf = g_malloc(size ? size : 1);
+      if (probe_read(r, offset + hdr, buf, size))
+        mkv_parse_seekhead(buf, size, &info_pos, &tracks_pos);
+      g_free(buf);
+    }
+    offset += hdr + (gint64)size;
+  }
+
+  /* Otherwise follow the SeekHead, e.g. to Tracks written at the end */
+  if (!have_info && info_pos >= 0)
+    have_info = mkv_load_element(r, segment + info_pos, MKV_INFO,
+                                 mkv_parse_info, st);
+  if (!have_tracks && tracks_pos >= 0)
+    have_tracks = mkv_load_element(r, segment + tracks_pos, MKV_TRACKS,
+                                   mkv_parse_tracks, st);
+
+  return have_info || have_tracks;
+}
+
+/* MP4 / QuickTime */
+
+#define FOURCC(a, b, c, d)                                                     \
+  (((guint32)(a) << 24) | ((guint32)(b) << 16) | ((guint32)(c) << 8) |         \
+   (guint32)(d))
+
+/* Box header at offset within [offset, end). Returns the header length, or
+   0 if there is no valid box there. */
+static gsize mp4_box(ProbeReader *r, gint64 offset, gint64 end, guint32 *type,
+                     gint64 *size) {
+  guchar buf[16];
+  if (end - offset < 8 || !probe_read(r, offset, buf, 8))
+    return 0;
+
+  guint64 box_size = read_be(buf, 4);
+  *type = (guint32)read_be(buf + 4, 4);
+  gsize hdr = 8;
+  if (box_size == 1) {
+    if (end - offset < 16 || !probe_read(r, offset + 8, buf + 8, 8))
+      return 0;
+    box_size = read_be(buf + 8, 8);
+    hdr = 16;
+  } else if (box_size == 0) {
+    box_size = (guint64)(end - offset); /* Extends to the end */
+  }
+
+  if (box_size < hdr || box_size > (guint64)(end - offset))
+    return 0;
+  *size = (gint64)box_size;
+  return hdr;
+}
+
+/* Read the first len bytes of a box body, or fail if it is shorter */
+static gboolean mp4_read_body(ProbeReader *r, gint64 body, gint64 body_end,
+                              guchar *dst, gsize len) {
+  return body_end - body >= (gint64)len && probe_read(r, body, dst, len);
+}
+
+typedef struct {
+  guint32 handler;
+  guint32 format;
+  gint width;
+  gint height;
+  gchar language[4];
+} Mp4Track;
+
+static void mp4_parse_container(ProbeReader *r, gint64 start, gint64 end,
+                                Mp4Track *track, gint depth);
+
+static void mp4_parse_box(ProbeReader *r, guint32 type, gint64 body,
+                          gint64 end, Mp4Track *track, gint depth) {
+  guchar buf[96];
+
+  switch (type) {
+  case FOURCC('m', 'd', 'i', 'a'):
+  case FOURCC('m', 'i', 'n', 'f'):
+  case FOURCC('s', 't', 'b', 'l'):
+    mp4_parse_container(r, body, end, track, depth + 1);
+    break;
+
+  case FOURCC('t', 'k', 'h', 'd'):
+    /* Display size, 16.16 fixed point, at the end of the box */
+    if (mp4_read_body(r, body, end, buf, 1)) {
+      gsize at = buf[0] == 1 ? 88 : 76;
+      if (mp4_read_body(r, body, end, buf, at + 8) && track->width == 0) {
+        track->width = (gint)(read_be(buf + at, 4) >> 16);
+        track->height = (gint)(read_be(buf + at + 4, 4) >> 16);
+      }
+    }
+    break;
+
+  case FOURCC('m', 'd', 'h', 'd'):
+    /* Packed ISO 639-2 code: three 5-bit letters */
+    if (mp4_read_body(r, body, end, buf, 1)) {
+      gsize at = buf[0] == 1 ? 32 : 20;
+      if (mp4_read_body(r, body, end, buf, at + 2)) {
+        guint16 packed = (guint16)read_be(buf + at, 2);
+        track->language[0] = (gchar)(((packed >> 10) & 0x1F) + 0x60);
+        track->language[1] = (gchar)(((packed >> 5) & 0x1F) + 0x60);
+        track->language[2] = (gchar)((packed & 0x1F) + 0x60);
+        track->language[3] = '\0';
+        if (!g_ascii_isalpha(track->language[0]))
+          track->language[0] = '\0';
+      }
+    }
+    break;
+
+  case FOURCC('h', 'd', 'l', 'r'):
+    if (mp4_read_body(r, body, end, buf, 12))
+      track->handler = (guint32)read_be(buf + 8, 4);
+    break;
+
+  case FOURCC('s', 't', 's', 'd'):
+    /* First sample entry: its type is the codec; video entries also carry
+       the coded size */
+    if (mp4_read_body(r, body, end, buf, 16)) {
+      track->format = (guint32)read_be(buf + 12, 4);
+      if (mp4_read_body(r, body, end, buf, 44)) {
+        gint width = (gint)read_be(buf + 40, 2);
+        gint height = (gint)read_be(buf + 42, 2);
+        if (track->handler == FOURCC('v', 'i', 'd', 'e') && width > 0 &&
+            height > 0) {
+          track->width = width;
+          track->height = height;
+        }
+      }
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void mp4_parse_container(ProbeReader *r, gint64 start, gint64 end,
+                                Mp4Track *track, gint depth) {
+  if (depth > 8)
+    return;
+
+  gint64 offset = start;
+  guint32 type;
+  gint64 size;
+  gsize hdr;
+  while ((hdr = mp4_box(r, offset, end, &type, &size)) > 0) {
+    mp4_parse_box(r, type, offset + hdr, offset + size, track, depth);
+    offset += size;
+  }
+}
+
+static void mp4_add_track(const Mp4Track *track, ProbeState *st) {
+  if (!track->format)
+    return;
+
+  gchar fourcc[5];
+  for (gint i = 0; i < 4; i++) {
+    gchar c = (gchar)((track->format >> (24 - 8 * i)) & 0xFF);
+    fourcc[i] = g_ascii_isprint(c) ? c : '?';
+  }
+  fourcc[4] = '\0';
+
+  if (track->handler == FOURCC('v', 'i', 'd', 'e')) {
+    /* Cover art is stored as a one-frame JPEG/PNG video track */
+    if (st->video_codec || track->format == FOURCC('j', 'p', 'e', 'g') ||
+        track->format == FOURCC('p', 'n', 'g', ' '))
+      return;
+    st->video_codec = probe_codec_name(fourcc);
+    st->width = track->width;
+    st->height = track->height;
+  } else if (track->handler == FOURCC('s', 'o', 'u', 'n')) {
+    gchar *name = probe_codec_name(fourcc);
+    probe_add_unique(st->audio_codecs, name);
+    g_free(name);
+    if (track->language[0] && g_strcmp0(track->language, "und") != 0)
+      probe_add_unique(st->audio_languages, track->language);
+  }
+}
+
+static gboolean probe_mp4(ProbeReader *r, ProbeState *st) {
+  guchar buf[32];
+  if (!probe_read(r, 4, buf, 4))
+    return FALSE;
+  guint32 first = (guint32)read_be(buf, 4);
+  if (first != FOURCC('f', 't', 'y', 'p') &&
+      first != FOURCC('m', 'o', 'o', 'v') &&
+      first != FOURCC('w', 'i', 'd', 'e') &&
+      first != FOURCC('f', 'r', 'e', 'e') &&
+      first != FOURCC('m', 'd', 'a', 't'))
+    return FALSE;
+
+  /* Find moov: at the start for streaming files, after mdat otherwise */
+  gint64 offset = 0;
+  guint32 type;
+  gint64 size;
+  gsize hdr;
+  gboolean found = FALSE;
+  while ((hdr = mp4_box(r, offset, r->size, &type, &size)) > 0) {
+    if (type != FOURCC('m', 'o', 'o', 'v')) {
+      offset += size;
+      continue;
+    }
+
+    found = TRUE;
+    gint64 end = offset + size;
+    gint64 child = offset + hdr;
+    gint64 child_size;
+    while ((hdr = mp4_box(r, child, end, &type, &child_size)) > 0) {
+      gint64 body = child + hdr;
+      if (type == FOURCC('m', 'v', 'h', 'd') &&
+          mp4_read_body(r, body, child + child_size, buf, 1)) {
+        gboolean v1 = buf[0] == 1;
+        gsize len = v1 ? 32 : 20;
+        if (mp4_read_body(r, body, child + child_size, buf, len)) {
+          guint64 timescale = read_be(buf + (v1 ? 20 : 12), 4);
+          guint64 duration = v1 ? read_be(buf + 24, 8) : read_be(buf + 16, 4);
+          if (timescale > 0 && duration != G_MAXUINT32 &&
+              duration != G_MAXUINT64)
+            st->duration_ms = (gint64)(duration * 1000 / timescale);
+        }
+      } else if (type == FOURCC('t', 'r', 'a', 'k')) {
+        Mp4Track track = {0};
+        mp4_parse_container(r, body, child + child_size, &track, 0);
+        mp4_add_track(&track, st);
+      }
+      child += child_size;
+    }
+    break;
+  }
+
+  return found;
+}
+
+static gchar *probe_join(GPtrArray *list) {
+  if (list->len == 0)
+    return NULL;
+  g_ptr_array_add(list, NULL);
+  gchar *joined = g_strjoinv(",", (gchar **)list->pdata);
+  g_ptr_array_set_size(list, list->len - 1);
+  return joined;
+}
+
+gboolean probe_media_fd(int fd, gint64 size, const guchar *head,
+                        gsize head_len, const guchar *tail, gsize tail_len,
+                        MediaInfo *info) {
+  ProbeReader r = {fd,   size, head, head_len, tail, size - (gint64)tail_len,
+                   tail_len, 0};
+  ProbeState st = {0};
+  st.audio_codecs = g_ptr_array_new_with_free_func(g_free);
+  st.audio_languages = g_ptr_array_new_with_free_func(g_free);
+
+  gboolean ok = probe_matroska(&r, &st) || probe_mp4(&r, &st);
+  if (ok) {
+    info->duration_ms = st.duration_ms;
+    info->width = st.width;
+    info->height = st.height;
+    info->video_codec = st.video_codec;
+    info->audio_codecs = probe_join(st.audio_codecs);
+    info->audio_languages = probe_join(st.audio_languages);
+    st.video_codec = NULL;
+  }
+
+  g_free(st.video_codec);
+  g_ptr_array_unref(st.audio_codecs);
+  g_ptr_array_unref(st.audio_languages);
+  return ok;
+}
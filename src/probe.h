@@ -0,0 +1,15 @@
+#ifndef REELGTK_PROBE_H
+#define REELGTK_PROBE_H
+
+#include "db.h"
+
+/* Read duration, resolution, codecs and audio languages from the headers of
+   a Matroska/WebM or MP4/MOV file whose first and last blocks were already
+   read (tail holds the bytes from size - tail_len). Reads outside them go
+   to fd; nothing is decoded. Returns FALSE for other containers or
+   unreadable headers. */
+gboolean probe_media_fd(int fd, gint64 size, const guchar *head,
+                        gsize head_len, const guchar *tail, gsize tail_len,
+                        MediaInfo *info);
+
+#endif /* REELGTK_PROBE_H */
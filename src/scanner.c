@@ -7,7 +7,13 @@
 #include "db.h"
 #include "utils.h"
 #include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
 
 /* Supported video extensions */
 static const char *VIDEO_EXTENSIONS[] = {
@@ -98,27 +104,734 @@ static gboolean is_season_directory(const gchar *name, gint *season_number) {
   return FALSE;
 }
 
-static gboolean detect_season_from_episode_filenames(const gchar *path,
-                                                     gint *season_number) {
-  *season_number = 0;
+/* One directory entry as reported by readdir(). The file type comes from
+   d_type when the filesystem fills it in, so listing a directory costs no
+   per-entry stat() round-trips on NFS/SMB. */
+typedef struct {
+  gchar *name;
+  gboolean is_dir;
+  gboolean has_stat; /* st is filled in (remote listings only) */
+  struct stat st;
+} ScanEntry;
+
+typedef struct {
+  DIR *dir;       /* kept open so children can be opened with openat() */
+  GArray *entries; /* ScanEntry */
+} ScanDir;
+
+static void scan_entry_clear(gpointer data) {
+  ScanEntry *entry = data;
+  g_free(entry->name);
+}
+
+/* Open a directory relative to parent_fd (or AT_FDCWD for an absolute root)
+   and read all of its visible entries. Only DT_UNKNOWN and DT_LNK entries are
+   resolved with fstatat(); symlinks are followed like g_file_test() did. */
+static gboolean scan_dir_open(ScanDir *sd, int parent_fd, const gchar *name) {
+  sd->dir = NULL;
+  sd->entries = NULL;
+
+  int fd = openat(parent_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return FALSE;
+
+  sd->dir = fdopendir(fd);
+  if (!sd->dir) {
+    close(fd);
+    return FALSE;
+  }
+
+  sd->entries = g_array_new(FALSE, FALSE, sizeof(ScanEntry));
+  g_array_set_clear_func(sd->entries, scan_entry_clear);
+
+  struct dirent *de;
+  while ((de = readdir(sd->dir)) != NULL) {
+    /* Skip hidden files (and "." / "..") */
+    if (de->d_name[0] == '.')
+      continue;
+
+    gboolean is_dir;
+    switch (de->d_type) {
+    case DT_DIR:
+      is_dir = TRUE;
+      break;
+    case DT_REG:
+      is_dir = FALSE;
+      break;
+    case DT_UNKNOWN:
+    case DT_LNK: {
+      struct stat st;
+      if (fstatat(dirfd(sd->dir), de->d_name, &st, 0) != 0)
+        continue; /* Dangling symlink or vanished entry */
+      if (S_ISDIR(st.st_mode))
+        is_dir = TRUE;
+      else if (S_ISREG(st.st_mode))
+        is_dir = FALSE;
+      else
+        continue;
+      break;
+    }
+    default:
+      continue; /* Sockets, FIFOs, devices */
+    }
+
+    ScanEntry entry = {g_strdup(de->d_name), is_dir, FALSE, {0}};
+    g_array_append_val(sd->entries, entry);
+  }
+
+  return TRUE;
+}
+
+static void scan_dir_close(ScanDir *sd) {
+  if (sd->entries)
+    g_array_free(sd->entries, TRUE);
+  if (sd->dir)
+    closedir(sd->dir);
+  sd->entries = NULL;
+  sd->dir = NULL;
+}
+
+/* Stat the video files of a listing up front. On a network share this runs
+   on a pool thread, overlapped with other listings, and NFS usually answers
+   from the attributes READDIRPLUS already fetched. */
+static void scan_dir_stat_videos(ScanDir *sd) {
+  for (guint i = 0; i < sd->entries->len; i++) {
+    ScanEntry *entry = &g_array_index(sd->entries, ScanEntry, i);
+    if (!entry->is_dir && is_video_file(entry->name))
+      entry->has_stat =
+          fstatat(dirfd(sd->dir), entry->name, &entry->st, 0) == 0;
+  }
+}
+
+/* Network filesystems, where every metadata call is a round-trip and a
+   dead server blocks it indefinitely */
+static gboolean scan_fs_is_remote(int fd) {
+  struct statfs sfs;
+  if (fstatfs(fd, &sfs) != 0)
+    return FALSE;
+
+  switch ((guint32)sfs.f_type) {
+  case 0x6969:     /* NFS */
+  case 0x517B:     /* SMB */
+  case 0xFF534D42: /* CIFS */
+  case 0xFE534D42: /* SMB2 */
+  case 0x65735546: /* FUSE: sshfs, rclone, ... */
+  case 0x00C36400: /* Ceph */
+  case 0x01021997: /* 9p */
+    return TRUE;
+  default:
+    return FALSE;
+  }
+}
+
+#define FINGERPRINT_BLOCK 4096
+
+/* Hash of the size plus the first and last 4 KiB: enough to recognise the
+   same file at a new path without reading it. */
+static gchar *scan_fingerprint_at(int dir_fd, const gchar *name, gint64 size) {
+  int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+
+  GChecksum *checksum = g_checksum_new(G_CHECKSUM_SHA1);
+  gchar size_str[32];
+  g_snprintf(size_str, sizeof(size_str), "%" G_GINT64_FORMAT, size);
+  g_checksum_update(checksum, (const guchar *)size_str, -1);
+
+  guchar buf[FINGERPRINT_BLOCK];
+  ssize_t n = pread(fd, buf, sizeof(buf), 0);
+  if (n > 0)
+    g_checksum_update(checksum, buf, n);
+
+  if (size > FINGERPRINT_BLOCK) {
+    n = pread(fd, buf, sizeof(buf), size - FINGERPRINT_BLOCK);
+    if (n > 0)
+      g_checksum_update(checksum, buf, n);
+  }
+  close(fd);
+
+  gchar *fingerprint = g_strdup(g_checksum_get_string(checksum));
+  g_checksum_free(checksum);
+  return fingerprint;
+}
+
+/* Metadata I/O with a deadline. The root is always opened on a pool thread,
+   since even that hangs on a dead mount; on network filesystems listings,
+   stats and fingerprint reads go through the pool as well. The walker waits
+   for each operation at most io_timeout_seconds, then marks the root offline
+   and abandons the operation: it finishes, or stays blocked in the kernel,
+   on its own thread. */
+
+#define SCAN_IO_THREADS 8
+#define SCAN_IO_WINDOW 8              /* Subdirectory listings requested ahead */
+/* Listings requested ahead across all levels of the walk. One thread is
+   left for the walker's own calls, so an op never waits in the queue behind
+   a slow but live share. */
+#define SCAN_IO_AHEAD (SCAN_IO_THREADS - 1)
+#define SCAN_IO_POLL_US (100 * 1000)  /* Cancel check while waiting */
+
+typedef enum {
+  SCAN_IO_ROOT,
+  SCAN_IO_LIST,
+  SCAN_IO_STAT,
+  SCAN_IO_FINGERPRINT,
+  SCAN_IO_EXISTS
+} ScanIoKind;
+
+typedef struct {
+  gint refs; /* The walker and the pool thread */
+  ScanIoKind kind;
+  int dir_fd; /* Own dup() of the parent, or AT_FDCWD */
+  gchar *name;
+  gint64 size;
+  gint delay_ms;
+
+  GMutex mutex;
+  GCond cond;
+  gint64 queued;  /* Monotonic */
+  gint64 started; /* 0 until a pool thread picks it up */
+  gboolean done;
+  gboolean abandoned;
+
+  gboolean ok;
+  int err;
+  gboolean remote; /* Listing is from a network filesystem */
+  ScanDir sd;      /* SCAN_IO_ROOT, SCAN_IO_LIST */
+  struct stat st;  /* SCAN_IO_STAT */
+  gchar *fingerprint;
+} ScanIoOp;
+
+typedef struct {
+  GThreadPool *pool;
+  gint64 timeout_us;
+  gint ahead;    /* Prefetched listings not yet taken by the walker */
+  gint delay_ms; /* REELVAULT_SCAN_IO_DELAY_MS, to mimic a slow share */
+} ScanIo;
+
+static void scan_io_op_unref(ScanIoOp *op) {
+  if (!g_atomic_int_dec_and_test(&op->refs))
+    return;
+  if (op->dir_fd >= 0)
+    close(op->dir_fd);
+  scan_dir_close(&op->sd);
+  g_free(op->name);
+  g_free(op->fingerprint);
+  g_mutex_clear(&op->mutex);
+  g_cond_clear(&op->cond);
+  g_free(op);
+}
+
+/* Drop the walker's reference; a queued op is then skipped */
+static void scan_io_op_release(ScanIoOp *op) {
+  g_mutex_lock(&op->mutex);
+  op->abandoned = TRUE;
+  g_mutex_unlock(&op->mutex);
+  scan_io_op_unref(op);
+}
+
+static void scan_io_worker(gpointer data, gpointer user_data) {
+  (void)user_data;
+  ScanIoOp *op = (ScanIoOp *)data;
+
+  g_mutex_lock(&op->mutex);
+  gboolean skip = op->abandoned;
+  op->started = g_get_monotonic_time();
+  g_mutex_unlock(&op->mutex);
+
+  if (!skip) {
+    if (op->delay_ms > 0)
+      g_usleep((gulong)op->delay_ms * 1000);
+
+    switch (op->kind) {
+    case SCAN_IO_ROOT:
+    case SCAN_IO_LIST:
+      op->ok = scan_dir_open(&op->sd, op->dir_fd, op->name);
+      op->err = errno;
+      if (!op->ok)
+        break;
+      op->remote = op->kind == SCAN_IO_LIST || op->delay_ms > 0 ||
+                   scan_fs_is_remote(dirfd(op->sd.dir));
+      if (op->remote)
+        scan_dir_stat_videos(&op->sd);
+      break;
+    case SCAN_IO_STAT:
+      op->ok = fstatat(op->dir_fd, op->name, &op->st, 0) == 0;
+      op->err = errno;
+      break;
+    case SCAN_IO_FINGERPRINT:
+      op->fingerprint = scan_fingerprint_at(op->dir_fd, op->name, op->size);
+      op->ok = op->fingerprint != NULL;
+      break;
+    case SCAN_IO_EXISTS:
+      op->ok = g_file_test(op->name, G_FILE_TEST_EXISTS);
+      break;
+    }
+  }
+
+  g_mutex_lock(&op->mutex);
+  op->done = TRUE;
+  g_cond_signal(&op->cond);
+  g_mutex_unlock(&op->mutex);
+  scan_io_op_unref(op);
+}
+
+static ScanIo *scan_io_new(ReelApp *app) {
+  ScanIo *io = g_new0(ScanIo, 1);
+  io->pool = g_thread_pool_new(scan_io_worker, NULL, SCAN_IO_THREADS, FALSE,
+                               NULL);
+  io->timeout_us = (gint64)MAX(app->io_timeout_seconds, 1) * G_USEC_PER_SEC;
+
+  const gchar *delay = g_getenv("REELVAULT_SCAN_IO_DELAY_MS");
+  if (delay)
+    io->delay_ms = MAX((gint)g_ascii_strtoll(delay, NULL, 10), 0);
+  return io;
+}
+
+static void scan_io_free(ScanIo *io) {
+  /* Don't wait: threads blocked on a dead mount are left behind */
+  g_thread_pool_free(io->pool, FALSE, FALSE);
+  g_free(io);
+}
+
+static ScanIoOp *scan_io_submit(ScanIo *io, ScanIoKind kind, int parent_fd,
+                                const gchar *name, gint64 size) {
+  ScanIoOp *op = g_new0(ScanIoOp, 1);
+  op->refs = 2;
+  op->kind = kind;
+  op->name = g_strdup(name);
+  op->size = size;
+  op->delay_ms = io->delay_ms;
+  g_mutex_init(&op->mutex);
+  g_cond_init(&op->cond);
+  op->queued = g_get_monotonic_time();
+
+  /* The op may outlive the walker's handle on the parent directory */
+  op->dir_fd = parent_fd == AT_FDCWD
+                   ? AT_FDCWD
+                   : fcntl(parent_fd, F_DUPFD_CLOEXEC, 0);
+  if (op->dir_fd == -1) {
+    op->err = errno;
+    op->done = TRUE;
+    op->refs = 1;
+    return op;
+  }
+
+  g_thread_pool_push(io->pool, op, NULL);
+  return op;
+}
+
+/* Background scan job */
+struct _ScanJob {
+  ReelApp *app;
+  gchar **paths;
+  gchar **offline; /* Roots that could not be read, set when the scan ends */
+  gint canceled; /* Set atomically from the UI thread */
+  ScanProgressFunc progress_cb;
+  ScanFilmsFunc films_cb;
+  ScanDoneFunc done_cb;
+  gpointer user_data;
+
+  /* Owned by the worker until done_cb runs */
+  GList *batch;       /* Film* inserted since the last update, newest first */
+  gint64 last_update; /* Monotonic time of the last update sent */
+  gint dirs;
+  gint found;         /* Films and seasons inserted */
+  gint added;
+  gint removed;
+};
+
+typedef struct {
+  ScanJob *job;
+  gchar *dir;
+  gint dirs;
+  gint found;
+  GList *films;
+} ScanUpdate;
+
+static ScanJob *active_scan = NULL;
+
+/* State shared by one scan of a library root */
+typedef struct {
+  ReelApp *app;
+  ScanJob *job;     /* NULL for a synchronous scan */
+  gint64 scan_gen;  /* Stamped on every row seen by this scan */
+  gint64 now;
+  gint pending;     /* Writes since the last commit */
+  gint removed;
+  gboolean incomplete; /* A subdirectory could not be read */
+
+  const gchar *root;
+  GPtrArray *online_roots; /* Roots walked earlier in this run that answered */
+  ScanIo *io;
+  gboolean remote;  /* Root is on a network filesystem */
+  gboolean offline; /* Root unreadable or stopped responding */
+} ScanContext;
+
+#define SCAN_COMMIT_EVERY 500
+
+/* How often a background scan commits and reports to the UI */
+#define SCAN_UPDATE_INTERVAL_US (250 * 1000)
+
+/* Commit the running transaction every so often so other connections (the
+   scraper thread, the grid loader) are not locked out for a whole scan. */
+static void scan_note_write(ScanContext *ctx) {
+  if (++ctx->pending < SCAN_COMMIT_EVERY)
+    return;
+  db_commit(ctx->app);
+  db_begin(ctx->app);
+  ctx->pending = 0;
+}
+
+static void scan_mark_seen(ScanContext *ctx, const gchar *path) {
+  db_file_mark_seen(ctx->app, path, ctx->scan_gen, ctx->now);
+  scan_note_write(ctx);
+}
+
+static gboolean scan_job_is_canceled(ScanJob *job) {
+  return job && g_atomic_int_get(&job->canceled);
+}
+
+/* The root stopped answering: stop walking it and skip the sweep */
+static void scan_mark_offline(ScanContext *ctx) {
+  if (ctx->offline)
+    return;
+  ctx->offline = TRUE;
+  ctx->incomplete = TRUE;
+  g_printerr("Library folder %s is not responding, skipping it\n", ctx->root);
+}
+
+/* Wait for op within the I/O deadline, counted from when a pool thread
+   picked it up. Prefetching never fills the pool, so an op only sits in the
+   queue when every thread is stuck, and then the deadline runs from
+   submission. Returns FALSE on timeout or cancel, leaving the op
+   abandoned. */
+static gboolean scan_io_wait(ScanContext *ctx, ScanIoOp *op) {
+  gint64 timeout = ctx->io->timeout_us;
+
+  g_mutex_lock(&op->mutex);
+  while (!op->done) {
+    gint64 now = g_get_monotonic_time();
+    gint64 since = op->started ? op->started : op->queued;
+    if (now - since >= timeout || scan_job_is_canceled(ctx->job))
+      break;
+    g_cond_wait_until(&op->cond, &op->mutex,
+                      MIN(since + timeout, now + SCAN_IO_POLL_US));
+  }
+  gboolean finished = op->done;
+  if (!finished)
+    op->abandoned = TRUE;
+  g_mutex_unlock(&op->mutex);
+
+  if (!finished && !scan_job_is_canceled(ctx->job))
+    scan_mark_offline(ctx);
+  return finished;
+}
+
+/* Run one operation on the pool and wait for it. Returns the finished op,
+   to be released with scan_io_op_unref(), or NULL once the root is
+   offline. */
+static ScanIoOp *scan_io_run(ScanContext *ctx, ScanIoKind kind, int parent_fd,
+                             const gchar *name, gint64 size) {
+  if (ctx->offline)
+    return NULL;
+  ScanIoOp *op = scan_io_submit(ctx->io, kind, parent_fd, name, size);
+  if (scan_io_wait(ctx, op))
+    return op;
+  scan_io_op_unref(op);
+  return NULL;
+}
+
+/* Subdirectory listings of one directory requested ahead of the walk, at
+   most SCAN_IO_WINDOW at a time and SCAN_IO_AHEAD in the whole walk, so
+   round-trips to a remote share overlap */
+typedef struct {
+  ScanIoOp **ops; /* Per entry, while its listing is outstanding */
+  guint next;     /* First entry not yet considered */
+  gint pending;
+} ScanPrefetch;
+
+static void scan_prefetch_fill(ScanContext *ctx, const ScanDir *sd,
+                               ScanPrefetch *pf) {
+  while (pf->next < sd->entries->len && pf->pending < SCAN_IO_WINDOW &&
+         ctx->io->ahead < SCAN_IO_AHEAD && !ctx->offline) {
+    const ScanEntry *entry = &g_array_index(sd->entries, ScanEntry, pf->next);
+    if (entry->is_dir) {
+      pf->ops[pf->next] = scan_io_submit(ctx->io, SCAN_IO_LIST,
+                                         dirfd(sd->dir), entry->name, 0);
+      pf->pending++;
+      ctx->io->ahead++;
+    }
+    pf->next++;
+  }
+}
+
+/* Wait for the listing of subdirectory i; errno is set on failure */
+static gboolean scan_prefetch_take(ScanContext *ctx, const ScanDir *sd,
+                                   ScanPrefetch *pf, guint i, ScanDir *out) {
+  scan_prefetch_fill(ctx, sd, pf);
+  ScanIoOp *op = pf->ops[i];
+  if (op) {
+    pf->ops[i] = NULL;
+    pf->pending--;
+    ctx->io->ahead--;
+  } else if (ctx->offline) {
+    errno = EIO; /* Root went offline before it was requested */
+    return FALSE;
+  } else {
+    /* Deeper levels hold all of SCAN_IO_AHEAD: list it now */
+    const ScanEntry *entry = &g_array_index(sd->entries, ScanEntry, i);
+    op = scan_io_submit(ctx->io, SCAN_IO_LIST, dirfd(sd->dir), entry->name, 0);
+    pf->next = MAX(pf->next, i + 1);
+  }
+
+  gboolean ok = FALSE;
+  errno = EIO;
+  if (scan_io_wait(ctx, op)) {
+    ok = op->ok;
+    if (ok) {
+      *out = op->sd;
+      op->sd.dir = NULL;
+      op->sd.entries = NULL;
+    }
+    errno = op->err;
+  }
+  scan_io_op_unref(op);
+
+  /* Keep the window full while the child is walked */
+  scan_prefetch_fill(ctx, sd, pf);
+  return ok;
+}
+
+static void scan_prefetch_clear(ScanContext *ctx, ScanPrefetch *pf,
+                                guint len) {
+  if (!pf->ops)
+    return;
+  for (guint i = 0; i < len; i++) {
+    if (pf->ops[i]) {
+      scan_io_op_release(pf->ops[i]);
+      ctx->io->ahead--;
+    }
+  }
+  g_free(pf->ops);
+  pf->ops = NULL;
+}
+
+static gboolean scan_update_idle(gpointer data) {
+  ScanUpdate *update = (ScanUpdate *)data;
+  ScanJob *job = update->job;
+
+  if (update->films && job->films_cb) {
+    job->films_cb(job->app, update->films, job->user_data);
+  } else {
+    g_list_free_full(update->films, (GDestroyNotify)film_free);
+  }
+  if (job->progress_cb && !scan_job_is_canceled(job)) {
+    job->progress_cb(job->app, update->dir, update->dirs, update->found,
+                     job->user_data);
+  }
+
+  g_free(update->dir);
+  g_free(update);
+  return G_SOURCE_REMOVE;
+}
+
+/* Hand the films inserted since the last update to the UI, together with
+   the directory being scanned. */
+static void scan_send_update(ScanContext *ctx, const gchar *dir) {
+  ScanJob *job = ctx->job;
+  job->last_update = g_get_monotonic_time();
+
+  ScanUpdate *update = g_new0(ScanUpdate, 1);
+  update->job = job;
+  update->dir = g_strdup(dir);
+  update->dirs = job->dirs;
+  update->found = job->found;
+  update->films = g_list_reverse(job->batch);
+  job->batch = NULL;
+  g_idle_add(scan_update_idle, update);
+}
+
+/* Commit and report at most every SCAN_UPDATE_INTERVAL_US. The commit comes
+   first so rows the UI is told about are visible to its own connection. */
+static void scan_maybe_update(ScanContext *ctx, const gchar *dir) {
+  if (!ctx->job ||
+      g_get_monotonic_time() - ctx->job->last_update < SCAN_UPDATE_INTERVAL_US)
+    return;
+
+  db_commit(ctx->app);
+  db_begin(ctx->app);
+  ctx->pending = 0;
+  scan_send_update(ctx, dir);
+}
+
+/* A film or season row was inserted */
+static void scan_note_film(ScanContext *ctx, const Film *film,
+                           const gchar *dir) {
+  ScanJob *job = ctx->job;
+  if (!job)
+    return;
+
+  job->found++;
+  if (job->films_cb)
+    job->batch = g_list_prepend(job->batch, film_copy(film));
+  scan_maybe_update(ctx, dir);
+}
+
+/* Identity of a film file for move/rename detection. The fingerprint is only
+   computed when needed, since it costs two small reads. */
+static gboolean scan_file_identity(ScanContext *ctx, const ScanDir *sd,
+                                   const ScanEntry *entry, FileId *id) {
+  const gchar *name = entry->name;
+  struct stat st;
+  if (entry->has_stat) {
+    st = entry->st;
+  } else if (ctx->remote) {
+    ScanIoOp *op = scan_io_run(ctx, SCAN_IO_STAT, dirfd(sd->dir), name, 0);
+    gboolean ok = op && op->ok;
+    if (ok)
+      st = op->st;
+    if (op)
+      scan_io_op_unref(op);
+    if (!ok)
+      return FALSE;
+  } else if (fstatat(dirfd(sd->dir), name, &st, 0) != 0) {
+    return FALSE;
+  }
+
+  id->dev = (gint64)st.st_dev;
+  id->ino = (gint64)st.st_ino;
+  id->size = (gint64)st.st_size;
+  id->mtime = (gint64)st.st_mtime;
+  id->fingerprint = NULL;
+  return TRUE;
+}
+
+static gchar *scan_fingerprint(ScanContext *ctx, const ScanDir *sd,
+                               const gchar *name, gint64 size) {
+  if (!ctx->remote)
+    return scan_fingerprint_at(dirfd(sd->dir), name, size);
+
+  ScanIoOp *op =
+      scan_io_run(ctx, SCAN_IO_FINGERPRINT, dirfd(sd->dir), name, size);
+  if (!op)
+    return NULL;
+  gchar *fingerprint = op->fingerprint;
+  op->fingerprint = NULL;
+  scan_io_op_unref(op);
+  return fingerprint;
+}
+
+/* Refresh the stored identity of a tracked file if it changed on disk. */
+static void scan_update_identity(ScanContext *ctx, const ScanDir *sd,
+                                 const gchar *name, const gchar *full_path,
+                                 FileId *id) {
+  FileId stored = {0};
+  gboolean known = db_file_id_get(ctx->app, full_path, &stored);
+  gboolean same = known && stored.fingerprint && stored.dev == id->dev &&
+                  stored.ino == id->ino && stored.size == id->size &&
+                  stored.mtime == id->mtime;
+  file_id_clear(&stored);
+  if (same)
+    return;
+
+  g_free(id->fingerprint);
+  id->fingerprint = scan_fingerprint(ctx, sd, name, id->size);
+  db_file_id_put(ctx->app, full_path, id);
+  scan_note_write(ctx);
+}
+
+static gboolean scan_path_under(const gchar *path, const gchar *root) {
+  gsize len = strlen(root);
+  if (len > 0 && root[len - 1] == G_DIR_SEPARATOR)
+    len--;
+  return strncmp(path, root, len) == 0 && path[len] == G_DIR_SEPARATOR;
+}
+
+/* Whether a missing file at path can be trusted to be really gone: it lies
+   under the root being walked, or under one this run already walked and
+   found online. A path on an unmounted or unscanned root merely looks gone. */
+static gboolean scan_path_checked(ScanContext *ctx, const gchar *path) {
+  if (scan_path_under(path, ctx->root))
+    return TRUE;
+  for (guint i = 0; ctx->online_roots && i < ctx->online_roots->len; i++) {
+    if (scan_path_under(path, g_ptr_array_index(ctx->online_roots, i)))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* Pick a tracked path with this identity whose file is gone. A match by
+   size and fingerprint alone only counts on a root known to be online, so a
+   copy on another disk never takes over the row of one that is offline. */
+static gchar *scan_find_moved_from(ScanContext *ctx, const FileId *id,
+                                   gboolean by_inode) {
+  GList *paths = db_file_ids_find(ctx->app, id, by_inode);
+  gchar *found = NULL;
+  for (GList *l = paths; l != NULL && !found; l = l->next) {
+    const gchar *old_path = l->data;
+    gboolean exists;
+    if (!by_inode && !scan_path_checked(ctx, old_path))
+      continue;
+    if (ctx->remote) {
+      ScanIoOp *op = scan_io_run(ctx, SCAN_IO_EXISTS, AT_FDCWD, old_path, 0);
+      if (!op)
+        break;
+      exists = op->ok;
+      scan_io_op_unref(op);
+    } else {
+      exists = g_file_test(old_path, G_FILE_TEST_EXISTS);
+    }
+    if (!exists)
+      found = g_strdup(old_path);
+  }
+  g_list_free_full(paths, g_free);
+  return found;
+}
 
-  GDir *dir = g_dir_open(path, 0, NULL);
-  if (!dir)
+/* Relink an untracked file to the film row of a file that disappeared from
+   another path: same inode first (rename/move within a filesystem), then
+   same size and fingerprint (copied to another disk). */
+static gboolean scan_relink_moved(ScanContext *ctx, const ScanDir *sd,
+                                  const gchar *name, const gchar *full_path,
+                                  FileId *id) {
+  gchar *old_path = scan_find_moved_from(ctx, id, TRUE);
+  if (!old_path) {
+    if (!id->fingerprint)
+      id->fingerprint = scan_fingerprint(ctx, sd, name, id->size);
+    if (id->fingerprint)
+      old_path = scan_find_moved_from(ctx, id, FALSE);
+  }
+  if (!old_path)
     return FALSE;
 
+  gboolean relinked = db_file_relink(ctx->app, old_path, full_path);
+  if (relinked) {
+    if (!id->fingerprint)
+      id->fingerprint = scan_fingerprint(ctx, sd, name, id->size);
+    db_file_id_put(ctx->app, full_path, id);
+    scan_mark_seen(ctx, full_path);
+    g_print("Moved: %s -> %s\n", old_path, full_path);
+  }
+
+  g_free(old_path);
+  return relinked;
+}
+
+static gboolean detect_season_from_episode_filenames(const ScanDir *sd,
+                                                     gint *season_number) {
+  *season_number = 0;
+
   GRegex *re = g_regex_new("[Ss](\\d{1,2})[Ee](\\d{1,2})", 0, 0, NULL);
   gboolean found = FALSE;
   gint season = 0;
 
-  const gchar *name;
-  while ((name = g_dir_read_name(dir)) != NULL) {
-    if (name[0] == '.')
-      continue;
-    if (!is_video_file(name))
+  for (guint i = 0; i < sd->entries->len; i++) {
+    const ScanEntry *entry = &g_array_index(sd->entries, ScanEntry, i);
+    if (entry->is_dir || !is_video_file(entry->name))
       continue;
 
     GMatchInfo *match_info = NULL;
-    if (g_regex_match(re, name, 0, &match_info)) {
+    if (g_regex_match(re, entry->name, 0, &match_info)) {
       gchar *season_str = g_match_info_fetch(match_info, 1);
       gint s = atoi(season_str);
       g_free(season_str);
@@ -129,6 +842,7 @@ static gboolean detect_season_from_episode_filenames(const gchar *path,
       } else if (s != season) {
         /* Avoid mis-grouping multi-season folders for now. */
         found = FALSE;
+        g_match_info_free(match_info);
         break;
       }
     }
@@ -136,7 +850,6 @@ static gboolean detect_season_from_episode_filenames(const gchar *path,
       g_match_info_free(match_info);
   }
 
-  g_dir_close(dir);
   g_regex_unref(re);
 
   if (found && season >= 0) {
@@ -246,8 +959,10 @@ static gchar *derive_show_name_from_episode_filename(const gchar *name) {
   return normalized;
 }
 
-static gint scan_tv_season(ReelApp *app, const gchar *path, gint season_num,
+static gint scan_tv_season(ScanContext *ctx, const gchar *path,
+                           const ScanDir *sd, gint season_num,
                            const gchar *show_name) {
+  ReelApp *app = ctx->app;
   gint added = 0;
 
   /* Check if season already exists */
@@ -265,6 +980,9 @@ static gint scan_tv_season(ReelApp *app, const gchar *path, gint season_num,
 
     if (db_film_insert(app, season)) {
       g_print("Added Season: %s\n", path);
+      db_scrape_job_enqueue(app, season->id);
+      scan_note_write(ctx);
+      scan_note_film(ctx, season, path);
     } else {
       film_free(season);
       return 0;
@@ -281,92 +999,119 @@ static gint scan_tv_season(ReelApp *app, const gchar *path, gint season_num,
     }
     db_film_update(app, season);
   }
+  scan_mark_seen(ctx, path);
 
-  /* Scan episodes in season directory */
-  GDir *dir = g_dir_open(path, 0, NULL);
-  if (dir) {
-    const gchar *name;
-    while ((name = g_dir_read_name(dir)) != NULL) {
-      if (name[0] == '.')
-        continue;
+  /* Scan episodes from the listing we already have for this directory */
+  GRegex *ep_regex = g_regex_new("[Ee](\\d+)", 0, 0, NULL);
+  for (guint i = 0; i < sd->entries->len; i++) {
+    const ScanEntry *entry = &g_array_index(sd->entries, ScanEntry, i);
+    if (entry->is_dir || !is_video_file(entry->name))
+      continue;
 
-      gchar *full_path = g_build_filename(path, name, NULL);
-      if (!g_file_test(full_path, G_FILE_TEST_IS_DIR) && is_video_file(name)) {
-        /* If this episode file was previously inserted as a film, remove it so
-           episodes live only in the episodes table and don't clutter the grid. */
-        Film *wrong_film = db_film_get_by_path(app, full_path);
-        if (wrong_film) {
-          db_film_delete(app, wrong_film->id);
-          film_free(wrong_film);
-        }
+    gchar *full_path = g_build_filename(path, entry->name, NULL);
 
-        /* Check if episode exists */
-        Episode *ep = db_episode_get_by_path(app, full_path);
-        if (!ep) {
-          ep = episode_new();
-          ep->season_id = season->id;
-          ep->file_path = g_strdup(full_path);
-          ep->title = g_strdup(name);
-
-          /* Try to extract episode number SxxExx or Exx */
-          GRegex *ep_regex = g_regex_new("[Ee](\\d+)", 0, 0, NULL);
-          GMatchInfo *match_info;
-          if (g_regex_match(ep_regex, name, 0, &match_info)) {
-            gchar *ep_str = g_match_info_fetch(match_info, 1);
-            ep->episode_number = atoi(ep_str);
-            g_free(ep_str);
-          }
-          g_match_info_free(match_info);
-          g_regex_unref(ep_regex);
+    /* If this episode file was previously inserted as a film, remove it so
+       episodes live only in the episodes table and don't clutter the grid. */
+    Film *wrong_film = db_film_get_by_path(app, full_path);
+    if (wrong_film) {
+      db_film_delete(app, wrong_film->id);
+      film_free(wrong_film);
+      ctx->removed++;
+      scan_note_write(ctx);
+    }
 
-          if (db_episode_insert(app, ep)) {
-            added++;
-          }
-          episode_free(ep);
-        } else {
-          episode_free(ep);
-        }
+    /* Check if episode exists */
+    Episode *ep = db_episode_get_by_path(app, full_path);
+    if (!ep) {
+      ep = episode_new();
+      ep->season_id = season->id;
+      ep->file_path = g_strdup(full_path);
+      ep->title = g_strdup(entry->name);
+
+      /* Try to extract episode number SxxExx or Exx */
+      GMatchInfo *match_info;
+      if (g_regex_match(ep_regex, entry->name, 0, &match_info)) {
+        gchar *ep_str = g_match_info_fetch(match_info, 1);
+        ep->episode_number = atoi(ep_str);
+        g_free(ep_str);
+      }
+      g_match_info_free(match_info);
+
+      if (db_episode_insert(app, ep)) {
+        added++;
       }
-      g_free(full_path);
     }
-    g_dir_close(dir);
+    episode_free(ep);
+    scan_mark_seen(ctx, full_path);
+    g_free(full_path);
   }
+  g_regex_unref(ep_regex);
 
   film_free(season);
   return added;
 }
 
-static gint scan_directory_recursive(ReelApp *app, const gchar *path,
-                                     gint depth) {
-  if (depth > 10)
+/* Scan the directory already opened as sd. Subdirectories are opened with
+   openat() relative to it; path strings are only built for entries that end
+   up being looked up or recorded in the database. */
+static gint scan_directory_recursive(ScanContext *ctx, const gchar *path,
+                                     ScanDir *sd, gint depth) {
+  if (depth > 10) {
+    ctx->incomplete = TRUE; /* Nothing below here was seen */
     return 0; /* Prevent infinite recursion */
+  }
 
-  GDir *dir = g_dir_open(path, 0, NULL);
-  if (dir == NULL)
-    return 0;
-
+  ReelApp *app = ctx->app;
   gint added = 0;
-  const gchar *name;
+  gchar *dir_basename = g_path_get_basename(path);
 
-  while ((name = g_dir_read_name(dir)) != NULL) {
-    /* Skip hidden files */
-    if (name[0] == '.')
-      continue;
+  if (ctx->job) {
+    ctx->job->dirs++;
+    scan_maybe_update(ctx, path);
+  }
+
+  /* Whether this directory itself is a single-season folder is only worked
+     out once, and only if it contains an episodic filename. */
+  gint dir_season = 0;
+  gint dir_season_state = -1; /* -1 unknown, 0 no, 1 yes */
+  gboolean dir_season_scanned = FALSE;
+
+  ScanPrefetch prefetch = {0};
+  if (ctx->remote) {
+    prefetch.ops = g_new0(ScanIoOp *, sd->entries->len);
+    scan_prefetch_fill(ctx, sd, &prefetch);
+  }
+
+  for (guint i = 0; i < sd->entries->len; i++) {
+    const ScanEntry *entry = &g_array_index(sd->entries, ScanEntry, i);
+    const gchar *name = entry->name;
+
+    if (scan_job_is_canceled(ctx->job) || ctx->offline) {
+      ctx->incomplete = TRUE; /* Keep the sweep away from unvisited files */
+      break;
+    }
+
+    if (entry->is_dir) {
+      ScanDir child;
+      gboolean opened =
+          ctx->remote ? scan_prefetch_take(ctx, sd, &prefetch, i, &child)
+                      : scan_dir_open(&child, dirfd(sd->dir), name);
+      if (!opened) {
+        /* Don't let an unreadable subtree look like deleted files. */
+        if (errno != ENOENT)
+          ctx->incomplete = TRUE;
+        continue;
+      }
 
-    gchar *full_path = g_build_filename(path, name, NULL);
+      gchar *child_path = g_build_filename(path, name, NULL);
 
-    if (g_file_test(full_path, G_FILE_TEST_IS_DIR)) {
       /* Check for TV Season folder */
       gint season_num = 0;
       if (is_season_directory(name, &season_num)) {
         /* Parent folder name is show name */
-        gchar *parent = g_path_get_dirname(full_path);
-        gchar *show_name = g_path_get_basename(parent);
-        g_free(parent);
-
-        added += scan_tv_season(app, full_path, season_num, show_name);
-        g_free(show_name);
-      } else if (detect_season_from_episode_filenames(full_path, &season_num)) {
+        added += scan_tv_season(ctx, child_path, &child, season_num,
+                                dir_basename);
+      } else if (detect_season_from_episode_filenames(&child, &season_num)) {
         /* Some libraries put episodes directly in a season folder named like
            "Show.Name.S01.1080p..." (no "Season 1" directory). */
         gchar *show_name = derive_show_name_from_dirname(name);
@@ -375,12 +1120,16 @@ static gint scan_directory_recursive(ReelApp *app, const gchar *path,
           show_name = utils_normalize_title(name);
         }
 
-        added += scan_tv_season(app, full_path, season_num, show_name);
+        added += scan_tv_season(ctx, child_path, &child, season_num,
+                                show_name);
         g_free(show_name);
       } else {
         /* Recurse into normal subdirectory */
-        added += scan_directory_recursive(app, full_path, depth + 1);
+        added += scan_directory_recursive(ctx, child_path, &child, depth + 1);
       }
+
+      g_free(child_path);
+      scan_dir_close(&child);
     } else if (is_video_file(name)) {
       /* Only process as individual film if NOT inside a season folder
          (This is covered because we don't recurse into season folders except
@@ -392,19 +1141,25 @@ static gint scan_directory_recursive(ReelApp *app, const gchar *path,
       gint episode_num = 0;
       if (parse_sxxeyy_from_filename(name, &season_num, &episode_num)) {
         (void)episode_num;
-        gchar *dir_basename = g_path_get_basename(path);
-        gint inferred_season = 0;
-        gboolean single_season_dir =
-            is_season_directory(dir_basename, &inferred_season) ||
-            detect_season_from_episode_filenames(path, &inferred_season);
+        if (dir_season_state < 0) {
+          dir_season_state =
+              is_season_directory(dir_basename, &dir_season) ||
+              detect_season_from_episode_filenames(sd, &dir_season);
+        }
 
-        if (single_season_dir) {
-          if (inferred_season > 0)
-            season_num = inferred_season;
+        if (dir_season_state > 0) {
+          /* The whole directory is handled by one scan_tv_season() pass. */
+          if (dir_season_scanned)
+            continue;
+          dir_season_scanned = TRUE;
+
+          if (dir_season > 0)
+            season_num = dir_season;
 
           gchar *show_name = NULL;
-          if (is_season_directory(dir_basename, &inferred_season)) {
-            gchar *parent = g_path_get_dirname(full_path);
+          gint unused_season = 0;
+          if (is_season_directory(dir_basename, &unused_season)) {
+            gchar *parent = g_path_get_dirname(path);
             gchar *parent_base = g_path_get_basename(parent);
             show_name = derive_show_name_from_dirname(parent_base);
             g_free(parent_base);
@@ -422,18 +1177,34 @@ static gint scan_directory_recursive(ReelApp *app, const gchar *path,
             show_name = utils_normalize_title(dir_basename);
           }
 
-          added += scan_tv_season(app, path, season_num, show_name);
+          added += scan_tv_season(ctx, path, sd, season_num, show_name);
           g_free(show_name);
-          g_free(dir_basename);
-          g_free(full_path);
           continue;
         }
+      }
+
+      gchar *full_path = g_build_filename(path, name, NULL);
 
-        g_free(dir_basename);
+      FileId id = {0};
+      gboolean have_id = scan_file_identity(ctx, sd, entry, &id);
+      if (ctx->offline) {
+        g_free(full_path);
+        break;
+      }
+
+      /* Already in database: just record that it is still there */
+      if (db_file_mark_seen(app, full_path, ctx->scan_gen, ctx->now)) {
+        scan_note_write(ctx);
+        if (have_id)
+          scan_update_identity(ctx, sd, name, full_path, &id);
+        file_id_clear(&id);
+        g_free(full_path);
+        continue;
       }
 
-      /* Check if already in database */
-      if (db_is_file_tracked(app, full_path)) {
+      /* A tracked file that was moved or renamed keeps its film row. */
+      if (have_id && scan_relink_moved(ctx, sd, name, full_path, &id)) {
+        file_id_clear(&id);
         g_free(full_path);
         continue;
       }
@@ -455,19 +1226,187 @@ static gint scan_directory_recursive(ReelApp *app, const gchar *path,
       if (db_film_insert(app, film)) {
         added++;
         g_print("Added: %s\n", full_path);
+        db_scrape_job_enqueue(app, film->id);
+        scan_mark_seen(ctx, full_path);
+        scan_note_film(ctx, film, path);
+        if (have_id) {
+          if (!id.fingerprint)
+            id.fingerprint = scan_fingerprint(ctx, sd, name, id.size);
+          db_file_id_put(app, full_path, &id);
+        }
       }
 
       film_free(film);
+      file_id_clear(&id);
+      g_free(full_path);
     }
+  }
 
-    g_free(full_path);
+  scan_prefetch_clear(ctx, &prefetch, sd->entries->len);
+  g_free(dir_basename);
+  return added;
+}
+
+/* Scan one library root and sweep rows for files that have gone */
+static gint scan_root(ScanContext *ctx, const gchar *path) {
+  ReelApp *app = ctx->app;
+  g_print("Scanning: %s\n", path);
+
+  ctx->root = path;
+  ctx->io = scan_io_new(app);
+
+  ScanDir root = {0};
+  ScanIoOp *op = scan_io_run(ctx, SCAN_IO_ROOT, AT_FDCWD, path, 0);
+  if (op && op->ok) {
+    root = op->sd;
+    op->sd.dir = NULL;
+    op->sd.entries = NULL;
+    ctx->remote = op->remote;
+  }
+  if (op)
+    scan_io_op_unref(op);
+
+  if (!root.dir) {
+    if (!ctx->offline && !scan_job_is_canceled(ctx->job)) {
+      g_printerr("Cannot read library folder %s, skipping\n", path);
+      ctx->offline = TRUE;
+    }
+    scan_io_free(ctx->io);
+    ctx->io = NULL;
+    return 0;
   }
 
-  g_dir_close(dir);
+  ctx->now = g_get_real_time() / 1000000;
+  ctx->scan_gen = db_scan_generation_next(app);
+
+  db_begin(app);
+  gint added = scan_directory_recursive(ctx, path, &root, 0);
+  db_commit(app);
+
+  /* An empty root is most likely an unmounted share: keep everything. */
+  if (ctx->scan_gen > 0 && !ctx->incomplete && root.entries->len > 0) {
+    gint64 cutoff = ctx->now - (gint64)app->missing_grace_days * 24 * 60 * 60;
+    gint removed = db_sweep_unseen(app, path, ctx->scan_gen, cutoff);
+    if (removed > 0)
+      g_print("Removed %d missing entries under %s\n", removed, path);
+    ctx->removed += removed;
+  }
+
+  if (ctx->job)
+    scan_send_update(ctx, path);
+
+  scan_dir_close(&root);
+  scan_io_free(ctx->io);
+  ctx->io = NULL;
   return added;
 }
 
 gint scanner_scan_directory(ReelApp *app, const gchar *path) {
-  g_print("Scanning: %s\n", path);
-  return scan_directory_recursive(app, path, 0);
+  ScanContext ctx = {0};
+  ctx.app = app;
+  return scan_root(&ctx, path);
+}
+
+static gboolean scan_done_idle(gpointer data) {
+  ScanJob *job = (ScanJob *)data;
+  if (job->done_cb) {
+    job->done_cb(job->app, job->added, job->removed,
+                 scan_job_is_canceled(job), job->user_data);
+  }
+  if (active_scan == job)
+    active_scan = NULL;
+  g_strfreev(job->paths);
+  g_strfreev(job->offline);
+  g_free(job);
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer scan_thread_func(gpointer data) {
+  ScanJob *job = (ScanJob *)data;
+  ReelApp *app = job->app;
+
+  sqlite3 *db = NULL;
+  if (sqlite3_open(app->db_path, &db) != SQLITE_OK) {
+    g_printerr("Cannot open database for scanning: %s\n",
+               db ? sqlite3_errmsg(db) : "out of memory");
+    if (db)
+      sqlite3_close(db);
+    g_idle_add(scan_done_idle, job);
+    return NULL;
+  }
+  sqlite3_exec(db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+  sqlite3_busy_timeout(db, 5000);
+
+  ReelApp thread_app = *app;
+  thread_app.db = db;
+
+  GPtrArray *offline = g_ptr_array_new();
+  GPtrArray *online = g_ptr_array_new();
+  for (gint i = 0; job->paths[i] != NULL; i++) {
+    if (scan_job_is_canceled(job))
+      break;
+
+    ScanContext ctx = {0};
+    ctx.app = &thread_app;
+    ctx.job = job;
+    ctx.online_roots = online;
+    job->added += scan_root(&ctx, job->paths[i]);
+    job->removed += ctx.removed;
+    if (ctx.offline)
+      g_ptr_array_add(offline, g_strdup(job->paths[i]));
+    else
+      g_ptr_array_add(online, job->paths[i]);
+  }
+  g_ptr_array_free(online, TRUE);
+  g_ptr_array_add(offline, NULL);
+  job->offline = (gchar **)g_ptr_array_free(offline, FALSE);
+
+  sqlite3_close(db);
+  g_idle_add(scan_done_idle, job);
+  return NULL;
+}
+
+ScanJob *scanner_start_background(ReelApp *app, gchar **paths,
+                                  gint paths_count,
+                                  ScanProgressFunc progress_cb,
+                                  ScanFilmsFunc films_cb, ScanDoneFunc done_cb,
+                                  gpointer user_data) {
+  if (active_scan) {
+    g_print("Scan already running\n");
+    return NULL;
+  }
+
+  GPtrArray *copy = g_ptr_array_new();
+  for (gint i = 0; i < paths_count; i++) {
+    if (paths[i] && *paths[i])
+      g_ptr_array_add(copy, g_strdup(paths[i]));
+  }
+  g_ptr_array_add(copy, NULL);
+
+  ScanJob *job = g_new0(ScanJob, 1);
+  job->app = app;
+  job->paths = (gchar **)g_ptr_array_free(copy, FALSE);
+  job->progress_cb = progress_cb;
+  job->films_cb = films_cb;
+  job->done_cb = done_cb;
+  job->user_data = user_data;
+  job->last_update = g_get_monotonic_time();
+  active_scan = job;
+
+  g_thread_unref(g_thread_new("scanner", scan_thread_func, job));
+  return job;
+}
+
+const gchar *const *scanner_job_offline_roots(ScanJob *job) {
+  return job ? (const gchar *const *)job->offline : NULL;
+}
+
+void scanner_job_cancel(ScanJob *job) {
+  if (job)
+    g_atomic_int_set(&job->canceled, TRUE);
+}
+
+void scanner_stop(ReelApp *app) {
+  (void)app;
+  scanner_job_cancel(active_scan);
 }
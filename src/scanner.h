@@ -3,9 +3,40 @@
 
 #include "app.h"
 
+typedef struct _ScanJob ScanJob;
+
+/* Background scan callbacks, all run on the main loop */
+typedef void (*ScanProgressFunc)(ReelApp *app, const gchar *current_dir,
+                                 gint dirs_scanned, gint films_found,
+                                 gpointer user_data);
+/* films is a list of newly inserted Film*; the callback takes ownership */
+typedef void (*ScanFilmsFunc)(ReelApp *app, GList *films, gpointer user_data);
+typedef void (*ScanDoneFunc)(ReelApp *app, gint added, gint removed,
+                             gboolean canceled, gpointer user_data);
+
 /* Scan a directory for video files and add to database */
 gint scanner_scan_directory(ReelApp *app, const gchar *path);
 
+/* Scan library roots in a worker thread with its own database connection.
+   Returns NULL if a scan is already running. The job is freed after done_cb
+   returns. */
+ScanJob *scanner_start_background(ReelApp *app, gchar **paths,
+                                  gint paths_count,
+                                  ScanProgressFunc progress_cb,
+                                  ScanFilmsFunc films_cb, ScanDoneFunc done_cb,
+                                  gpointer user_data);
+
+/* Ask a running job to stop; done_cb still runs, with canceled set */
+void scanner_job_cancel(ScanJob *job);
+
+/* Library roots the job could not read or that stopped responding within
+   io_timeout_seconds: a NULL-terminated list, or NULL. Valid while done_cb
+   runs. */
+const gchar *const *scanner_job_offline_roots(ScanJob *job);
+
+/* Cancel whatever scan is running */
+void scanner_stop(ReelApp *app);
+
 /* Parse a filename to extract title and year */
 gboolean scanner_parse_filename(const gchar *filename, gchar **title,
                                 gint *year);
@@ -3,6 +3,8 @@
  * Fetches film metadata and posters from The Movie Database API
  */
 
+#include <errno.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,89 +15,373 @@
 #define CURL_DISABLE_TYPECHECK 1
 #include <curl/curl.h>
 #include <json-c/json.h>
-#include <gdk-pixbuf/gdk-pixbuf.h>
 
 /* Include our headers after curl to avoid macro conflicts */
 #include "config.h"
 #include "db.h"
 #include "scraper.h"
+#include "tmdbcache.h"
+#include "tmdbjson.h"
+#include "titleindex.h"
 #include "utils.h"
 
 #define TMDB_API_BASE "https://api.themoviedb.org/3"
 #define TMDB_IMAGE_BASE "https://image.tmdb.org/t/p"
 
-/* Curl write callback */
-typedef struct {
-  char *data;
-  size_t size;
-} CurlBuffer;
+/* Where API and image requests go. The environment can point them at
+   another server, like the mock TMDB of --bench-scrape. */
+static const gchar *tmdb_api_base(void) {
+  const gchar *base = g_getenv("REELVAULT_TMDB_API_BASE");
+  return base && *base ? base : TMDB_API_BASE;
+}
 
-static size_t my_write_callback(void *contents, size_t size, size_t nmemb,
-                                void *userp) {
-  size_t realsize = size * nmemb;
-  CurlBuffer *buf = (CurlBuffer *)userp;
+static const gchar *tmdb_image_base(void) {
+  const gchar *base = g_getenv("REELVAULT_TMDB_IMAGE_BASE");
+  return base && *base ? base : TMDB_IMAGE_BASE;
+}
 
-  buf->data = g_realloc(buf->data, buf->size + realsize + 1);
-  memcpy(&(buf->data[buf->size]), contents, realsize);
-  buf->size += realsize;
-  buf->data[buf->size] = 0;
+/* Attempts for an API request answered with 429 Too Many Requests */
+#define SCRAPE_MAX_ATTEMPTS 4
+
+/* Most seasons TMDB appends to one show request */
+#define SCRAPE_BATCH_SEASONS 20
+
+/* Scrape queue: jobs claimed at a time, how long a claim holds, and the
+   first wait after a failure, which doubles per attempt. A network error
+   is retried sooner than a film TMDB has no match for. */
+#define SCRAPE_CLAIM_JOBS 100
+#define SCRAPE_LEASE_SECONDS 600
+#define SCRAPE_RETRY_TRANSIENT (10 * 60)
+#define SCRAPE_RETRY_NO_MATCH (24 * 3600)
+#define SCRAPE_RETRY_MAX (30 * 24 * 3600)
+
+/* Curl write callback: API replies are parsed as they arrive. A reply that
+   is not JSON is still read to the end, so its status is reported. */
+static size_t json_write_callback(void *contents, size_t size, size_t nmemb,
+                                  void *userp) {
+  size_t realsize = size * nmemb;
+  tmdb_json_parser_feed((TmdbJsonParser *)userp, contents, realsize);
+  return realsize;
+}
 
+/* Posters are kept in memory until they have been decoded */
+static size_t bytes_write_callback(void *contents, size_t size, size_t nmemb,
+                                   void *userp) {
+  size_t realsize = size * nmemb;
+  g_byte_array_append((GByteArray *)userp, contents, (guint)realsize);
   return realsize;
 }
 
-static char *http_get(const char *url) {
-  CURL *curl = curl_easy_init();
-  if (!curl)
+/* Connections
+
+   DNS answers and TLS sessions are shared by every handle in the process, so
+   a new connection to a host seen before skips the lookup and resumes TLS
+   instead of a full handshake. Synchronous requests reuse one easy handle
+   per thread, which keeps its connections open between calls; the
+   background scraper's multi handle keeps its own and multiplexes requests
+   over HTTP/2 where the server allows. */
+
+static CURLSH *curl_share;
+static GMutex curl_share_locks[CURL_LOCK_DATA_LAST];
+static GOnce curl_share_once = G_ONCE_INIT;
+
+static void curl_share_lock(CURL *curl, curl_lock_data data,
+                            curl_lock_access access, void *userptr) {
+  (void)curl;
+  (void)access;
+  (void)userptr;
+  g_mutex_lock(&curl_share_locks[data]);
+}
+
+static void curl_share_unlock(CURL *curl, curl_lock_data data, void *userptr) {
+  (void)curl;
+  (void)userptr;
+  g_mutex_unlock(&curl_share_locks[data]);
+}
+
+static gpointer curl_share_create(gpointer data) {
+  (void)data;
+  CURLSH *share = curl_share_init();
+  if (!share)
     return NULL;
 
-  CurlBuffer buf = {NULL, 0};
+  curl_share_setopt(share, CURLSHOPT_LOCKFUNC, curl_share_lock);
+  curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, curl_share_unlock);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  return share;
+}
+
+/* Per-thread handle for synchronous requests, freed when the thread exits */
+static GPrivate thread_curl = G_PRIVATE_INIT((GDestroyNotify)curl_easy_cleanup);
+
+/* Counters since startup */
+static gint net_requests;
+static gint net_connections;
+static gint net_tls_connections;
+static GMutex net_tls_lock;
+static gint64 net_tls_setup_us; /* Under net_tls_lock */
+static gint net_searches_skipped;
+static gint net_local_matches;
+static gint net_local_rejected;
+
+static void curl_request_setup(CURL *curl, const char *url, long timeout) {
+  CURLSH *share = g_once(&curl_share_once, curl_share_create, NULL);
 
   curl_easy_setopt(curl, CURLOPT_URL, url);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, my_write_callback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buf);
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout);
   curl_easy_setopt(curl, CURLOPT_USERAGENT, "ReelVault/1.0");
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  if (share)
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+}
 
-  CURLcode res = curl_easy_perform(curl);
-  curl_easy_cleanup(curl);
-
-  if (res != CURLE_OK) {
-    g_free(buf.data);
+/* Handle for the background pipeline; waits to multiplex on an existing
+   HTTP/2 connection rather than opening another one */
+static CURL *curl_request_new(const char *url, long timeout) {
+  CURL *curl = curl_easy_init();
+  if (!curl)
     return NULL;
+
+  curl_request_setup(curl, url, timeout);
+  curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+  return curl;
+}
+
+static CURL *curl_thread_request(const char *url, long timeout) {
+  CURL *curl = g_private_get(&thread_curl);
+  if (curl) {
+    /* Options go back to defaults; open connections stay */
+    curl_easy_reset(curl);
+  } else {
+    curl = curl_easy_init();
+    if (!curl)
+      return NULL;
+    g_private_set(&thread_curl, curl);
   }
 
-  return buf.data;
+  curl_request_setup(curl, url, timeout);
+  return curl;
 }
 
-static gboolean download_file(const char *url, const char *dest_path) {
-  CURL *curl = curl_easy_init();
-  if (!curl)
-    return FALSE;
+/* Count a finished transfer and the connections it had to open. libcurl
+   doesn't say whether a TLS handshake resumed the shared session, so the
+   time spent in handshakes is kept instead: resumed ones are much shorter. */
+static void curl_request_account(CURL *curl) {
+  long connects = 0;
+  curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
 
-  FILE *fp = fopen(dest_path, "wb");
-  if (!fp) {
-    curl_easy_cleanup(curl);
-    return FALSE;
+  g_atomic_int_inc(&net_requests);
+  if (connects <= 0)
+    return;
+  g_atomic_int_add(&net_connections, (gint)connects);
+
+  curl_off_t tcp_us = 0;
+  curl_off_t tls_us = 0;
+  curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &tcp_us);
+  curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls_us);
+  if (tls_us > 0) {
+    g_atomic_int_inc(&net_tls_connections);
+    g_mutex_lock(&net_tls_lock);
+    net_tls_setup_us += MAX(tls_us - tcp_us, 0);
+    g_mutex_unlock(&net_tls_lock);
   }
+}
 
-  curl_easy_setopt(curl, CURLOPT_URL, url);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
-  curl_easy_setopt(curl, CURLOPT_USERAGENT, "ReelVault/1.0");
+void scraper_net_stats(ScraperNetStats *stats) {
+  stats->requests = g_atomic_int_get(&net_requests);
+  stats->connections = g_atomic_int_get(&net_connections);
+  stats->tls_connections = g_atomic_int_get(&net_tls_connections);
+  g_mutex_lock(&net_tls_lock);
+  stats->tls_setup_us = net_tls_setup_us;
+  g_mutex_unlock(&net_tls_lock);
+  stats->searches_skipped = g_atomic_int_get(&net_searches_skipped);
+  stats->local_matches = g_atomic_int_get(&net_local_matches);
+  stats->local_rejected = g_atomic_int_get(&net_local_rejected);
+}
+
+/* Keep the ETag of a reply for cache revalidation */
+static size_t etag_header_callback(char *buffer, size_t size, size_t nitems,
+                                   void *userp) {
+  size_t len = size * nitems;
+  gchar **etag = (gchar **)userp;
+  if (len > 5 && g_ascii_strncasecmp(buffer, "etag:", 5) == 0) {
+    g_free(*etag);
+    *etag = g_strstrip(g_strndup(buffer + 5, len - 5));
+  }
+  return len;
+}
+
+/* Ask for url only if it no longer matches etag, and note the new ETag */
+static struct curl_slist *curl_request_conditional(CURL *curl,
+                                                   const gchar *etag,
+                                                   gchar **etag_out) {
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, etag_header_callback);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, etag_out);
+  if (!etag)
+    return NULL;
+
+  gchar *header = g_strconcat("If-None-Match: ", etag, NULL);
+  struct curl_slist *headers = curl_slist_append(NULL, header);
+  g_free(header);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  return headers;
+}
+
+static struct json_object *http_get_json(const char *url, const gchar *etag,
+                                         long *status, gchar **etag_out) {
+  CURL *curl = curl_thread_request(url, 30L);
+  if (!curl)
+    return NULL;
+
+  TmdbJsonParser *parser = tmdb_json_parser_new(tmdb_json_schema_for_url(url));
+
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, json_write_callback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, parser);
+  struct curl_slist *headers = curl_request_conditional(curl, etag, etag_out);
 
   CURLcode res = curl_easy_perform(curl);
+  curl_request_account(curl);
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, status);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+  curl_slist_free_all(headers);
+
+  struct json_object *root =
+      res == CURLE_OK ? tmdb_json_parser_finish(parser, NULL) : NULL;
+  tmdb_json_parser_free(parser);
+  return root;
+}
 
-  fclose(fp);
-  curl_easy_cleanup(curl);
+static GByteArray *http_get_bytes(const char *url) {
+  CURL *curl = curl_thread_request(url, 60L);
+  if (!curl)
+    return NULL;
 
-  if (res != CURLE_OK) {
-    unlink(dest_path);
-    return FALSE;
+  GByteArray *body = g_byte_array_new();
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, bytes_write_callback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, body);
+
+  CURLcode res = curl_easy_perform(curl);
+  curl_request_account(curl);
+  long status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+  if (res != CURLE_OK || status >= 400 || body->len == 0) {
+    g_byte_array_unref(body);
+    return NULL;
   }
+  return body;
+}
 
-  return TRUE;
+/* Rate limiting
+
+   Every API request in the process, from the background scraper or the
+   match dialog, takes a token from one bucket. It refills at the configured
+   rate and holds at most one second's worth, so bursts stay within what
+   TMDB allows. Image downloads come from a CDN and are not counted. */
+
+typedef struct {
+  GMutex lock;
+  gdouble tokens;
+  gint64 last_us;
+  gint64 blocked_until_us; /* Set after a 429 reply */
+} TokenBucket;
+
+static TokenBucket api_bucket;
+
+/* Take a token, or return how many microseconds until one is available */
+static gint64 rate_limit_try(gint rate) {
+  if (rate <= 0)
+    return 0;
+
+  g_mutex_lock(&api_bucket.lock);
+  gint64 now = g_get_monotonic_time();
+  gint64 wait = 0;
+
+  if (api_bucket.last_us == 0) {
+    api_bucket.tokens = rate;
+  } else {
+    api_bucket.tokens += (now - api_bucket.last_us) * rate / 1e6;
+    if (api_bucket.tokens > rate)
+      api_bucket.tokens = rate;
+  }
+  api_bucket.last_us = now;
+
+  if (api_bucket.blocked_until_us > now) {
+    wait = api_bucket.blocked_until_us - now;
+  } else if (api_bucket.tokens >= 1.0) {
+    api_bucket.tokens -= 1.0;
+  } else {
+    wait = (gint64)((1.0 - api_bucket.tokens) * 1e6 / rate) + 1;
+  }
+
+  g_mutex_unlock(&api_bucket.lock);
+  return wait;
+}
+
+static void rate_limit_wait(gint rate) {
+  gint64 wait;
+  while ((wait = rate_limit_try(rate)) > 0)
+    g_usleep(wait);
+}
+
+/* Hold every API request for a while after TMDB said to slow down */
+static void rate_limit_backoff(gint64 seconds) {
+  g_mutex_lock(&api_bucket.lock);
+  gint64 until = g_get_monotonic_time() + seconds * G_USEC_PER_SEC;
+  if (until > api_bucket.blocked_until_us)
+    api_bucket.blocked_until_us = until;
+  api_bucket.tokens = 0;
+  g_mutex_unlock(&api_bucket.lock);
+}
+
+/* Only the members the scraper reads are parsed, and only they are cached.
+   Entries holding a whole reply are pruned the same way when read. */
+static struct json_object *reply_parse(const gchar *url, const gchar *body,
+                                       gsize length) {
+  return tmdb_json_parse(tmdb_json_schema_for_url(url), body, length);
+}
+
+static void reply_cache_store(ReelApp *app, const gchar *url,
+                              struct json_object *root, const gchar *etag) {
+  const char *body =
+      json_object_to_json_string_ext(root, JSON_C_TO_STRING_PLAIN);
+  tmdb_cache_store(app, url, body, strlen(body), etag);
+}
+
+/* An API reply, from the response cache when it is fresh enough */
+static struct json_object *api_get_json(ReelApp *app, const char *url) {
+  TmdbCacheEntry cached;
+  gboolean have_cached = tmdb_cache_lookup(app, url, &cached);
+  if (have_cached && cached.fresh) {
+    struct json_object *root = reply_parse(url, cached.body, cached.length);
+    tmdb_cache_entry_clear(&cached);
+    return root;
+  }
+
+  rate_limit_wait(app->scrape_rate);
+  long status = 0;
+  gchar *etag = NULL;
+  struct json_object *root =
+      http_get_json(url, have_cached ? cached.etag : NULL, &status, &etag);
+
+  if (have_cached && status == 304) {
+    tmdb_cache_revalidated(app, url, &cached);
+    if (root)
+      json_object_put(root);
+    root = reply_parse(url, cached.body, cached.length);
+  } else {
+    tmdb_cache_miss();
+    if (root && status == 200)
+      reply_cache_store(app, url, root, etag);
+  }
+
+  g_free(etag);
+  if (have_cached)
+    tmdb_cache_entry_clear(&cached);
+  return root;
 }
 
 static gchar *clean_tmdb_query(const gchar *query) {
@@ -162,53 +448,76 @@ static gchar *clean_tmdb_query(const gchar *query) {
   return normalized;
 }
 
-GList *scraper_search_tmdb(ReelApp *app, const gchar *query, gint year) {
-  if (!app->tmdb_api_key || strlen(app->tmdb_api_key) == 0) {
-    g_printerr("No TMDB API key configured\n");
+/* A film's key in the miss cache: its query as sent, folded so case and
+   Unicode forms don't matter. NULL when there is nothing to search. */
+static gchar *miss_query(const gchar *title) {
+  gchar *clean = clean_tmdb_query(title);
+  if (!clean || !*clean) {
+    g_free(clean);
     return NULL;
   }
+  gchar *normalized = g_utf8_normalize(clean, -1, G_NORMALIZE_ALL_COMPOSE);
+  gchar *folded = g_utf8_casefold(normalized ? normalized : clean, -1);
+  g_free(normalized);
+  g_free(clean);
+  return folded;
+}
 
-  /* URL encode query */
+gboolean scraper_find_miss(ReelApp *app, const Film *film, TmdbMiss *miss) {
+  gchar *query = miss_query(film->title);
+  gboolean found =
+      query && db_tmdb_miss_get(app, query, film->year,
+                                film->media_type == MEDIA_TV_SEASON, miss);
+  g_free(query);
+  return found;
+}
+
+void scraper_forget_miss(ReelApp *app, const Film *film) {
+  gchar *query = miss_query(film->title);
+  if (query)
+    db_tmdb_miss_clear(app, query, film->year,
+                       film->media_type == MEDIA_TV_SEASON);
+  g_free(query);
+}
+
+/* Search URL for a film or TV query, NULL when nothing is left to search */
+static gchar *search_url(ReelApp *app, const gchar *query, gint year,
+                         gboolean tv) {
   gchar *clean_query = clean_tmdb_query(query);
   if (!clean_query || strlen(clean_query) == 0) {
     g_free(clean_query);
     return NULL;
   }
+
+  /* URL encode query */
   CURL *curl = curl_easy_init();
   char *encoded_query = curl_easy_escape(curl, clean_query, 0);
   curl_easy_cleanup(curl);
   g_free(clean_query);
 
-  /* Build URL */
+  const gchar *base = tmdb_api_base();
   gchar *url;
-  if (year > 0) {
-    url =
-        g_strdup_printf("%s/search/movie?api_key=%s&query=%s&year=%d",
-                        TMDB_API_BASE, app->tmdb_api_key, encoded_query, year);
+  if (tv && year > 0) {
+    url = g_strdup_printf(
+        "%s/search/tv?api_key=%s&query=%s&first_air_date_year=%d", base,
+        app->tmdb_api_key, encoded_query, year);
+  } else if (tv) {
+    url = g_strdup_printf("%s/search/tv?api_key=%s&query=%s", base,
+                          app->tmdb_api_key, encoded_query);
+  } else if (year > 0) {
+    url = g_strdup_printf("%s/search/movie?api_key=%s&query=%s&year=%d", base,
+                          app->tmdb_api_key, encoded_query, year);
   } else {
-    url = g_strdup_printf("%s/search/movie?api_key=%s&query=%s", TMDB_API_BASE,
+    url = g_strdup_printf("%s/search/movie?api_key=%s&query=%s", base,
                           app->tmdb_api_key, encoded_query);
   }
   curl_free(encoded_query);
+  return url;
+}
 
-  /* Fetch results */
-  char *json_str = http_get(url);
-  g_free(url);
-
-  if (!json_str) {
-    g_printerr("Failed to search TMDB\n");
-    return NULL;
-  }
-
-  /* Parse JSON */
-  struct json_object *root = json_tokener_parse(json_str);
-  g_free(json_str);
-
-  if (!root) {
-    g_printerr("Failed to parse TMDB response\n");
-    return NULL;
-  }
-
+/* Up to ten results from a search reply; TV results use name and
+   first_air_date in place of title and release_date */
+static GList *parse_search_results(struct json_object *root, gboolean tv) {
   GList *results = NULL;
 
   struct json_object *results_array;
@@ -223,10 +532,11 @@ GList *scraper_search_tmdb(ReelApp *app, const gchar *query, gint year) {
       if (json_object_object_get_ex(item, "id", &val)) {
         result->tmdb_id = json_object_get_int(val);
       }
-      if (json_object_object_get_ex(item, "title", &val)) {
+      if (json_object_object_get_ex(item, tv ? "name" : "title", &val)) {
         result->title = g_strdup(json_object_get_string(val));
       }
-      if (json_object_object_get_ex(item, "release_date", &val)) {
+      if (json_object_object_get_ex(item, tv ? "first_air_date" : "release_date",
+                                    &val)) {
         const char *date = json_object_get_string(val);
         if (date && strlen(date) >= 4) {
           result->year = atoi(date);
@@ -249,6 +559,28 @@ GList *scraper_search_tmdb(ReelApp *app, const gchar *query, gint year) {
     }
   }
 
+  return results;
+}
+
+GList *scraper_search_tmdb(ReelApp *app, const gchar *query, gint year) {
+  if (!app->tmdb_api_key || strlen(app->tmdb_api_key) == 0) {
+    g_printerr("No TMDB API key configured\n");
+    return NULL;
+  }
+
+  gchar *url = search_url(app, query, year, FALSE);
+  if (!url)
+    return NULL;
+
+  struct json_object *root = api_get_json(app, url);
+  g_free(url);
+
+  if (!root) {
+    g_printerr("Failed to search TMDB\n");
+    return NULL;
+  }
+
+  GList *results = parse_search_results(root, FALSE);
   json_object_put(root);
   return results;
 }
@@ -258,90 +590,133 @@ GList *scraper_search_tv(ReelApp *app, const gchar *query, gint year) {
   if (!app->tmdb_api_key || strlen(app->tmdb_api_key) == 0)
     return NULL;
 
-  gchar *clean_query = clean_tmdb_query(query);
-  if (!clean_query || strlen(clean_query) == 0) {
-    g_free(clean_query);
+  gchar *url = search_url(app, query, year, TRUE);
+  if (!url)
     return NULL;
-  }
-
-  CURL *curl = curl_easy_init();
-  char *encoded_query = curl_easy_escape(curl, clean_query, 0);
-  curl_easy_cleanup(curl);
-  g_free(clean_query);
 
-  gchar *url;
-  if (year > 0) {
-    url = g_strdup_printf(
-        "%s/search/tv?api_key=%s&query=%s&first_air_date_year=%d",
-        TMDB_API_BASE, app->tmdb_api_key, encoded_query, year);
-  } else {
-    url = g_strdup_printf("%s/search/tv?api_key=%s&query=%s", TMDB_API_BASE,
-                          app->tmdb_api_key, encoded_query);
-  }
-  curl_free(encoded_query);
-
-  char *json_str = http_get(url);
+  struct json_object *root = api_get_json(app, url);
   g_free(url);
 
-  if (!json_str)
+  if (!root)
     return NULL;
 
-  struct json_object *root = json_tokener_parse(json_str);
-  g_free(json_str);
+  GList *results = parse_search_results(root, TRUE);
+  json_object_put(root);
+  return results;
+}
 
-  if (!root)
+/* Posters */
+
+/* TMDB serves each poster in a few fixed widths. Each use takes the
+   smallest that covers the pixels it draws; every size is cached as its own
+   file. */
+const gchar *scraper_poster_size(ScraperPosterUse use, gint width) {
+  if (use == SCRAPER_POSTER_GRID)
+    return width <= 185 ? "w185" : "w342";
+  return width <= 500 ? "w500" : "w780";
+}
+
+/* Cache file for a poster size, e.g. "603_w185.jpg" or
+   "tv_1399_s1_w342.jpg" */
+static gchar *poster_cache_file(ReelApp *app, const gchar *stem,
+                                const gchar *size) {
+  gchar *name = g_strdup_printf("%s_%s.jpg", stem, size);
+  gchar *path = g_build_filename(app->poster_cache_path, name, NULL);
+  g_free(name);
+  return path;
+}
+
+gchar *scraper_poster_variant_path(const gchar *poster_file,
+                                   const gchar *size) {
+  if (!poster_file || !g_str_has_suffix(poster_file, ".jpg"))
     return NULL;
+  gsize stem_len = strlen(poster_file) - strlen(".jpg");
+
+  /* Drop the size of the file we have, if it has one */
+  const gchar *sep = g_strrstr_len(poster_file, stem_len, "_w");
+  if (sep && sep + 2 < poster_file + stem_len) {
+    const gchar *c = sep + 2;
+    while (c < poster_file + stem_len && g_ascii_isdigit(*c))
+      c++;
+    if (c == poster_file + stem_len)
+      stem_len = sep - poster_file;
+  }
+  return g_strdup_printf("%.*s_%s.jpg", (int)stem_len, poster_file, size);
+}
 
-  GList *results = NULL;
-  struct json_object *results_array;
-  if (json_object_object_get_ex(root, "results", &results_array)) {
-    int len = json_object_array_length(results_array);
-    for (int i = 0; i < len && i < 10; i++) {
-      struct json_object *item = json_object_array_get_idx(results_array, i);
-      TmdbSearchResult *result = g_new0(TmdbSearchResult, 1);
-      struct json_object *val;
+static gchar *poster_url(const gchar *poster_path, const gchar *size) {
+  return g_strdup_printf("%s/%s%s", tmdb_image_base(), size, poster_path);
+}
 
-      if (json_object_object_get_ex(item, "id", &val))
-        result->tmdb_id = json_object_get_int(val);
-      if (json_object_object_get_ex(item, "name", &val))
-        result->title = g_strdup(json_object_get_string(val));
-      if (json_object_object_get_ex(item, "first_air_date", &val)) {
-        const char *date = json_object_get_string(val);
-        if (date && strlen(date) >= 4)
-          result->year = atoi(date);
-      }
-      if (json_object_object_get_ex(item, "poster_path", &val)) {
-        const char *path = json_object_get_string(val);
-        if (path)
-          result->poster_path = g_strdup(path);
-      }
-      if (json_object_object_get_ex(item, "overview", &val))
-        result->overview = g_strdup(json_object_get_string(val));
-      if (json_object_object_get_ex(item, "vote_average", &val))
-        result->vote_average = json_object_get_double(val);
+/* Size of poster to download for the grid */
+static const gchar *poster_grid_size(ReelApp *app) {
+  gdouble scale = app->scale_factor > 0 ? app->scale_factor : 1.0;
+  return scraper_poster_size(SCRAPER_POSTER_GRID,
+                             (gint)(POSTER_BASE_WIDTH * scale));
+}
 
-      results = g_list_append(results, result);
-    }
+/* Save a downloaded poster, replacing the file atomically. The grid
+   decodes it at cell size, so no thumb is made. */
+static gboolean poster_write(const gchar *path, GByteArray *jpeg) {
+  GError *error = NULL;
+  if (!g_file_set_contents(path, (const gchar *)jpeg->data, jpeg->len,
+                           &error)) {
+    g_printerr("Failed to save poster: %s\n", error->message);
+    g_error_free(error);
+    return FALSE;
   }
-  json_object_put(root);
-  return results;
+  return TRUE;
 }
 
-static gboolean fetch_tv_season_details(ReelApp *app, Film *film,
-                                        gint show_id) {
-  gchar *url = g_strdup_printf("%s/tv/%d/season/%d?api_key=%s", TMDB_API_BASE,
-                               show_id, film->season_number, app->tmdb_api_key);
+/* Returns the poster file or NULL */
+static gchar *poster_store(ReelApp *app, const gchar *stem, const gchar *size,
+                           GByteArray *jpeg) {
+  gchar *path = poster_cache_file(app, stem, size);
+  if (!poster_write(path, jpeg))
+    g_clear_pointer(&path, g_free);
+  return path;
+}
+
+gchar *scraper_fetch_poster_variant(const gchar *poster_file,
+                                    const gchar *remote, const gchar *size) {
+  gchar *path = scraper_poster_variant_path(poster_file, size);
+  if (!path || !remote)
+    return path;
+  if (g_file_test(path, G_FILE_TEST_EXISTS))
+    return path;
 
-  char *json_str = http_get(url);
+  gchar *url = poster_url(remote, size);
+  GByteArray *jpeg = http_get_bytes(url);
   g_free(url);
-  if (!json_str)
-    return FALSE;
+  gboolean ok = jpeg && poster_write(path, jpeg);
+  if (jpeg)
+    g_byte_array_unref(jpeg);
+  if (!ok)
+    g_clear_pointer(&path, g_free);
+  return path;
+}
 
-  struct json_object *root = json_tokener_parse(json_str);
-  g_free(json_str);
-  if (!root)
-    return FALSE;
+static const char *json_poster_path(struct json_object *root) {
+  struct json_object *val;
+  if (json_object_object_get_ex(root, "poster_path", &val))
+    return json_object_get_string(val);
+  return NULL;
+}
+
+/* TV seasons use a namespaced poster to avoid collisions with movie IDs and
+   between seasons of the same show. */
+static gchar *poster_stem(Film *film, gint tmdb_id) {
+  if (film->media_type == MEDIA_TV_SEASON)
+    return g_strdup_printf("tv_%d_s%d", tmdb_id, film->season_number);
+  return g_strdup_printf("%d", tmdb_id);
+}
+
+/* Storing results
 
+   Each reply is applied to the film once everything it needs has arrived,
+   so the synchronous calls and the background pipeline share this code. */
+
+static const char *tv_season_apply(Film *film, struct json_object *root) {
   struct json_object *val;
   const char *season_name = NULL;
   if (json_object_object_get_ex(root, "name", &val)) {
@@ -362,188 +737,159 @@ static gboolean fetch_tv_season_details(ReelApp *app, Film *film,
       film->year = atoi(date);
   }
 
-  /* Prefer a stable "Show Name - Season X" title. Season endpoint doesn't
-     include the show name, so fetch it separately. */
-  if (app->tmdb_api_key) {
-    gchar *show_url =
-        g_strdup_printf("%s/tv/%d?api_key=%s", TMDB_API_BASE, show_id,
-                        app->tmdb_api_key);
-    char *show_json = http_get(show_url);
-    g_free(show_url);
-
-    if (show_json) {
-      struct json_object *show_root = json_tokener_parse(show_json);
-      g_free(show_json);
-      if (show_root) {
-        const char *show_name = NULL;
-        if (json_object_object_get_ex(show_root, "name", &val)) {
-          show_name = json_object_get_string(val);
-        }
-
-        /* Copy show-level genres onto this season so genre filtering works for TV. */
-        struct json_object *show_genres = NULL;
-        if (json_object_object_get_ex(show_root, "genres", &show_genres) &&
-            show_genres) {
-          int glen = json_object_array_length(show_genres);
-          for (int i = 0; i < glen; i++) {
-            struct json_object *genre =
-                json_object_array_get_idx(show_genres, i);
-            if (!genre)
-              continue;
-            struct json_object *name_val = NULL;
-            if (json_object_object_get_ex(genre, "name", &name_val)) {
-              const char *gname = json_object_get_string(name_val);
-              if (gname && *gname) {
-                db_genre_add_to_film(app, film->id, gname);
-                app->genres_dirty = TRUE;
-              }
-            }
-          }
-        }
+  return season_name;
+}
 
-        if (show_name && *show_name) {
-          const char *sn = (season_name && *season_name) ? season_name : NULL;
-          gchar *fallback = NULL;
-          if (!sn) {
-            if (film->season_number == 0) {
-              sn = "Specials";
-            } else {
-              fallback = g_strdup_printf("Season %d", film->season_number);
-              sn = fallback;
-            }
-          }
+/* Store a series' show-level metadata, shared by all of its seasons.
+   Returns the show's row id, or 0. */
+static gint64 tv_show_store(ReelApp *app, gint tmdb_id,
+                            struct json_object *show_root) {
+  struct json_object *val;
+  Show show = {0};
+  show.tmdb_id = tmdb_id;
+  if (json_object_object_get_ex(show_root, "name", &val))
+    show.name = (gchar *)json_object_get_string(val);
+  if (json_object_object_get_ex(show_root, "overview", &val))
+    show.overview = (gchar *)json_object_get_string(val);
+  show.poster_path = (gchar *)json_poster_path(show_root);
+  if (json_object_object_get_ex(show_root, "first_air_date", &val)) {
+    const char *date = json_object_get_string(val);
+    if (date && strlen(date) >= 4)
+      show.year = atoi(date);
+  }
 
-          g_free(film->title);
-          film->title = g_strdup_printf("%s - %s", show_name, sn);
-          g_free(fallback);
+  gint64 show_id = db_show_upsert(app, &show);
+  if (show_id == 0)
+    return 0;
+
+  /* Genres live on the show so genre filtering covers every season */
+  db_show_clear_genres(app, show_id);
+  struct json_object *show_genres = NULL;
+  if (json_object_object_get_ex(show_root, "genres", &show_genres) &&
+      show_genres) {
+    int glen = json_object_array_length(show_genres);
+    for (int i = 0; i < glen; i++) {
+      struct json_object *genre = json_object_array_get_idx(show_genres, i);
+      if (!genre)
+        continue;
+      struct json_object *name_val = NULL;
+      if (json_object_object_get_ex(genre, "name", &name_val)) {
+        const char *gname = json_object_get_string(name_val);
+        if (gname && *gname) {
+          db_genre_add_to_show(app, show_id, gname);
+          app->genres_dirty = TRUE;
         }
-        json_object_put(show_root);
       }
     }
   }
+  return show_id;
+}
 
-  /* Poster */
-  if (json_object_object_get_ex(root, "poster_path", &val)) {
-    const char *poster_path = json_object_get_string(val);
-    /* Use a namespaced filename to avoid collisions with movie IDs and between
-     * seasons of the same show. */
-    if (poster_path) {
-      gchar *url = g_strdup_printf("%s/w500%s", TMDB_IMAGE_BASE, poster_path);
-      gchar *dest = g_build_filename(
-          app->poster_cache_path,
-          g_strdup_printf("tv_%d_s%d.jpg", show_id, film->season_number), NULL);
-      gboolean ok = download_file(url, dest);
-      g_free(url);
-
-      if (ok) {
-        g_free(film->poster_path);
-        film->poster_path = dest; /* Takes ownership */
-        gchar *thumb = g_build_filename(
-            app->poster_cache_path,
-            g_strdup_printf("tv_%d_s%d_thumb.jpg", show_id, film->season_number),
-            NULL);
-        /* Always refresh thumb to avoid stale/wrong grid posters. */
-        GError *thumb_err = NULL;
-        GdkPixbuf *pixbuf = utils_pixbuf_new_from_file_at_scale_safe(
-            dest, POSTER_THUMB_WIDTH, POSTER_THUMB_HEIGHT, TRUE, &thumb_err);
-        if (pixbuf) {
-          gdk_pixbuf_save(pixbuf, thumb, "jpeg", &thumb_err, "quality", "85",
-                          NULL);
-          g_object_unref(pixbuf);
-        }
-        if (thumb_err)
-          g_error_free(thumb_err);
-        g_free(thumb);
+/* Prefer a stable "Show Name - Season X" title. The season endpoint doesn't
+   include the show name, so it comes from the stored show. */
+static void tv_show_apply(Film *film, const Show *show,
+                          const char *season_name) {
+  film->show_id = show->id;
+
+  if (!film->plot && show->overview && *show->overview)
+    film->plot = g_strdup(show->overview);
+
+  if (show->name && *show->name) {
+    const char *sn = (season_name && *season_name) ? season_name : NULL;
+    gchar *fallback = NULL;
+    if (!sn) {
+      if (film->season_number == 0) {
+        sn = "Specials";
       } else {
-        g_free(dest);
+        fallback = g_strdup_printf("Season %d", film->season_number);
+        sn = fallback;
       }
     }
-  }
-
-  film->tmdb_id = show_id;
-  film->match_status = MATCH_STATUS_AUTO;
 
-  db_film_update(app, film);
+    g_free(film->title);
+    film->title = g_strdup_printf("%s - %s", show->name, sn);
+    g_free(fallback);
+  }
+}
 
-  /* Episodes */
+static void tv_episodes_apply(ReelApp *app, Film *film,
+                              struct json_object *root) {
+  struct json_object *val;
   struct json_object *episodes;
-  if (json_object_object_get_ex(root, "episodes", &episodes)) {
-    int len = json_object_array_length(episodes);
-    GList *local_episodes = db_episodes_get_for_season(app, film->id);
+  if (!json_object_object_get_ex(root, "episodes", &episodes))
+    return;
 
-    for (int i = 0; i < len; i++) {
-      struct json_object *ep_json = json_object_array_get_idx(episodes, i);
-      int ep_num = 0;
-      if (json_object_object_get_ex(ep_json, "episode_number", &val))
-        ep_num = json_object_get_int(val);
-
-      for (GList *l = local_episodes; l != NULL; l = l->next) {
-        Episode *local_ep = (Episode *)l->data;
-        if (local_ep->episode_number == ep_num) {
-          if (json_object_object_get_ex(ep_json, "name", &val)) {
-            g_free(local_ep->title);
-            local_ep->title = g_strdup(json_object_get_string(val));
-          }
-          if (json_object_object_get_ex(ep_json, "overview", &val)) {
-            g_free(local_ep->plot);
-            local_ep->plot = g_strdup(json_object_get_string(val));
-          }
-          if (json_object_object_get_ex(ep_json, "runtime", &val))
-            local_ep->runtime_minutes = json_object_get_int(val);
-          if (json_object_object_get_ex(ep_json, "id", &val))
-            local_ep->tmdb_id = json_object_get_int(val);
-          if (json_object_object_get_ex(ep_json, "air_date", &val)) {
-            g_free(local_ep->air_date);
-            local_ep->air_date = g_strdup(json_object_get_string(val));
-          }
-          db_episode_update(app, local_ep);
-          break;
+  int len = json_object_array_length(episodes);
+  GList *local_episodes = db_episodes_get_for_season(app, film->id);
+
+  for (int i = 0; i < len; i++) {
+    struct json_object *ep_json = json_object_array_get_idx(episodes, i);
+    int ep_num = 0;
+    if (json_object_object_get_ex(ep_json, "episode_number", &val))
+      ep_num = json_object_get_int(val);
+
+    for (GList *l = local_episodes; l != NULL; l = l->next) {
+      Episode *local_ep = (Episode *)l->data;
+      if (local_ep->episode_number == ep_num) {
+        if (json_object_object_get_ex(ep_json, "name", &val)) {
+          g_free(local_ep->title);
+          local_ep->title = g_strdup(json_object_get_string(val));
+        }
+        if (json_object_object_get_ex(ep_json, "overview", &val)) {
+          g_free(local_ep->plot);
+          local_ep->plot = g_strdup(json_object_get_string(val));
+        }
+        if (json_object_object_get_ex(ep_json, "runtime", &val))
+          local_ep->runtime_minutes = json_object_get_int(val);
+        if (json_object_object_get_ex(ep_json, "id", &val))
+          local_ep->tmdb_id = json_object_get_int(val);
+        if (json_object_object_get_ex(ep_json, "air_date", &val)) {
+          g_free(local_ep->air_date);
+          local_ep->air_date = g_strdup(json_object_get_string(val));
         }
+        db_episode_update(app, local_ep);
+        break;
       }
     }
-    g_list_free_full(local_episodes, (GDestroyNotify)episode_free);
   }
-
-  json_object_put(root);
-  return TRUE;
+  g_list_free_full(local_episodes, (GDestroyNotify)episode_free);
 }
 
-gboolean scraper_fetch_and_update(ReelApp *app, gint64 film_id, gint tmdb_id) {
-  if (!app->tmdb_api_key)
-    return FALSE;
-
-  Film *film = db_film_get_by_id(app, film_id);
-  if (!film)
-    return FALSE;
-
-  if (film->media_type == MEDIA_TV_SEASON) {
-    gboolean ret = fetch_tv_season_details(app, film, tmdb_id);
-    film_free(film);
-    return ret;
+/* Store a matched season. Its show should have been stored first; if that
+   failed the season keeps its own title. poster is the downloaded poster
+   file or NULL. */
+static void tv_season_store(ReelApp *app, Film *film, gint show_id,
+                            struct json_object *root, const gchar *poster) {
+  const char *season_name = tv_season_apply(film, root);
+  Show *show = db_show_get_by_tmdb(app, show_id);
+  gint64 old_show_id = film->show_id;
+  film->show_id = 0;
+  if (show)
+    tv_show_apply(film, show, season_name);
+  show_free(show);
+
+  if (poster) {
+    g_free(film->poster_path);
+    film->poster_path = g_strdup(poster);
+    g_free(film->poster_remote);
+    film->poster_remote = g_strdup(json_poster_path(root));
   }
 
-  /* Fetch movie details with credits */
-  gchar *url =
-      g_strdup_printf("%s/movie/%d?api_key=%s&append_to_response=credits",
-                      TMDB_API_BASE, tmdb_id, app->tmdb_api_key);
+  film->tmdb_id = show_id;
+  film->match_status = MATCH_STATUS_AUTO;
 
-  char *json_str = http_get(url);
-  g_free(url);
+  db_film_update(app, film);
+  db_scrape_job_done(app, film->id);
+  /* Matched to another show: the old one may have no seasons left */
+  if (old_show_id > 0 && old_show_id != film->show_id)
+    db_shows_delete_orphans(app);
 
-  if (!json_str) {
-    film_free(film);
-    return FALSE;
-  }
-
-  struct json_object *root = json_tokener_parse(json_str);
-  g_free(json_str);
-
-  if (!root) {
-    film_free(film);
-    return FALSE;
-  }
+  tv_episodes_apply(app, film, root);
+}
 
-  /* Update film fields */
+static void movie_store(ReelApp *app, Film *film, gint tmdb_id,
+                        struct json_object *root, const gchar *poster) {
+  gint64 film_id = film->id;
 
   /* Update film fields */
   struct json_object *val;
@@ -581,18 +927,16 @@ gboolean scraper_fetch_and_update(ReelApp *app, gint64 film_id, gint tmdb_id) {
   film->tmdb_id = tmdb_id;
   film->match_status = MATCH_STATUS_AUTO;
 
-  /* Download poster */
-  if (json_object_object_get_ex(root, "poster_path", &val)) {
-    const char *poster_path = json_object_get_string(val);
-    if (poster_path && scraper_download_poster(app, poster_path, tmdb_id)) {
-      g_free(film->poster_path);
-      film->poster_path = g_build_filename(
-          app->poster_cache_path, g_strdup_printf("%d.jpg", tmdb_id), NULL);
-    }
+  if (poster) {
+    g_free(film->poster_path);
+    film->poster_path = g_strdup(poster);
+    g_free(film->poster_remote);
+    film->poster_remote = g_strdup(json_poster_path(root));
   }
 
   /* Update film in database */
   db_film_update(app, film);
+  db_scrape_job_done(app, film_id);
 
   /* Process genres */
   struct json_object *genres;
@@ -665,42 +1009,134 @@ gboolean scraper_fetch_and_update(ReelApp *app, gint64 film_id, gint tmdb_id) {
     }
   }
 
-  film_free(film);
-  json_object_put(root);
-
   g_print("Updated film from TMDB: %d\n", tmdb_id);
+}
+
+/* The show with the given seasons appended, as "season/N" members of the
+   reply. TMDB appends at most SCRAPE_BATCH_SEASONS. */
+static gchar *show_url(ReelApp *app, gint show_id, const gint *seasons,
+                       gint n_seasons) {
+  GString *url = g_string_new(NULL);
+  g_string_printf(url, "%s/tv/%d?api_key=%s", tmdb_api_base(), show_id,
+                  app->tmdb_api_key);
+  for (gint i = 0; i < n_seasons; i++)
+    g_string_append_printf(url, "%sseason/%d",
+                           i == 0 ? "&append_to_response=" : ",",
+                           seasons[i]);
+  return g_string_free(url, FALSE);
+}
+
+/* An appended season in a show reply, or NULL */
+static struct json_object *show_season(struct json_object *show_root,
+                                       gint season) {
+  gchar *key = g_strdup_printf("season/%d", season);
+  struct json_object *val = NULL;
+  if (!json_object_object_get_ex(show_root, key, &val) ||
+      !json_object_is_type(val, json_type_object))
+    val = NULL;
+  g_free(key);
+  return val;
+}
+
+static gchar *movie_url(ReelApp *app, gint tmdb_id) {
+  return g_strdup_printf("%s/movie/%d?api_key=%s&append_to_response=credits",
+                         tmdb_api_base(), tmdb_id, app->tmdb_api_key);
+}
+
+/* Download a poster at grid size into the cache; returns the poster file
+   or NULL */
+static gchar *poster_fetch(ReelApp *app, Film *film, gint tmdb_id,
+                           const char *poster_path) {
+  if (!poster_path)
+    return NULL;
+
+  const gchar *size = poster_grid_size(app);
+  gchar *url = poster_url(poster_path, size);
+  GByteArray *jpeg = http_get_bytes(url);
+  g_free(url);
+  if (!jpeg)
+    return NULL;
+
+  gchar *stem = poster_stem(film, tmdb_id);
+  gchar *dest = poster_store(app, stem, size, jpeg);
+  g_byte_array_unref(jpeg);
+  g_free(stem);
+  return dest;
+}
+
+static gboolean fetch_tv_season_details(ReelApp *app, Film *film,
+                                        gint show_id) {
+  gchar *url = show_url(app, show_id, &film->season_number, 1);
+  struct json_object *show_root = api_get_json(app, url);
+  g_free(url);
+  if (!show_root)
+    return FALSE;
+
+  struct json_object *root = show_season(show_root, film->season_number);
+  if (!root) {
+    json_object_put(show_root);
+    return FALSE;
+  }
+
+  /* A manual match refreshes the show for all of its seasons */
+  tv_show_store(app, show_id, show_root);
+
+  gchar *poster = poster_fetch(app, film, show_id, json_poster_path(root));
+  tv_season_store(app, film, show_id, root, poster);
+  g_free(poster);
+
+  json_object_put(show_root);
   return TRUE;
 }
 
-gboolean scraper_download_poster(ReelApp *app, const gchar *poster_path,
-                                 gint tmdb_id) {
-  gchar *url = g_strdup_printf("%s/w500%s", TMDB_IMAGE_BASE, poster_path);
-  gchar *dest = g_build_filename(app->poster_cache_path,
-                                 g_strdup_printf("%d.jpg", tmdb_id), NULL);
-
-  gboolean success = download_file(url, dest);
-
-  if (success) {
-    gchar *thumb =
-        g_build_filename(app->poster_cache_path,
-                         g_strdup_printf("%d_thumb.jpg", tmdb_id), NULL);
-
-    /* Always refresh thumb so grid never shows a stale poster. */
-    GError *error = NULL;
-    GdkPixbuf *pixbuf = utils_pixbuf_new_from_file_at_scale_safe(
-        dest, POSTER_THUMB_WIDTH, POSTER_THUMB_HEIGHT, TRUE, &error);
-    if (pixbuf) {
-      gdk_pixbuf_save(pixbuf, thumb, "jpeg", &error, "quality", "85", NULL);
-      g_object_unref(pixbuf);
-    }
-    if (error)
-      g_error_free(error);
+gboolean scraper_fetch_and_update(ReelApp *app, gint64 film_id, gint tmdb_id) {
+  if (!app->tmdb_api_key)
+    return FALSE;
+
+  Film *film = db_film_get_by_id(app, film_id);
+  if (!film)
+    return FALSE;
 
-    g_free(thumb);
+  if (film->media_type == MEDIA_TV_SEASON) {
+    gboolean ret = fetch_tv_season_details(app, film, tmdb_id);
+    film_free(film);
+    return ret;
   }
 
+  /* Fetch movie details with credits */
+  gchar *url = movie_url(app, tmdb_id);
+  struct json_object *root = api_get_json(app, url);
+  g_free(url);
+
+  if (!root) {
+    film_free(film);
+    return FALSE;
+  }
+
+  gchar *poster = poster_fetch(app, film, tmdb_id, json_poster_path(root));
+  movie_store(app, film, tmdb_id, root, poster);
+  g_free(poster);
+
+  film_free(film);
+  json_object_put(root);
+  return TRUE;
+}
+
+gboolean scraper_download_poster(ReelApp *app, const gchar *poster_path,
+                                 gint tmdb_id) {
+  const gchar *size = poster_grid_size(app);
+  gchar *url = poster_url(poster_path, size);
+  GByteArray *jpeg = http_get_bytes(url);
   g_free(url);
+  if (!jpeg)
+    return FALSE;
+
+  gchar *stem = g_strdup_printf("%d", tmdb_id);
+  gchar *dest = poster_store(app, stem, size, jpeg);
+  gboolean success = dest != NULL;
+  g_byte_array_unref(jpeg);
   g_free(dest);
+  g_free(stem);
 
   return success;
 }
@@ -714,6 +1150,26 @@ void tmdb_search_result_free(TmdbSearchResult *result) {
   }
 }
 
+/* Pick the search result to match automatically, or NULL when unsure.
+   Simple heuristic: the top result's year matches, or it is the only one. */
+static TmdbSearchResult *scraper_pick_match(Film *film, GList *results) {
+  if (!results)
+    return NULL;
+
+  TmdbSearchResult *first = (TmdbSearchResult *)results->data;
+
+  /* Season markers were already dropped from the query, so the first show
+     is usually the right one. */
+  if (film->media_type == MEDIA_TV_SEASON)
+    return first;
+
+  if (first->year == film->year)
+    return first;
+  if (film->year == 0 && results->next == NULL)
+    return first;
+  return NULL;
+}
+
 /* Background scraping */
 
 typedef struct {
@@ -766,82 +1222,988 @@ static gboolean scraper_done_idle(gpointer data) {
   return G_SOURCE_REMOVE;
 }
 
-static gpointer scraper_thread_func(gpointer data) {
-  ScraperContext *ctx = (ScraperContext *)data;
-  ReelApp *app = ctx->app;
+/* Pipeline
 
-  sqlite3 *db = NULL;
-  if (sqlite3_open(app->db_path, &db) != SQLITE_OK) {
-    if (db)
-      sqlite3_close(db);
-    g_idle_add(scraper_done_idle, ctx);
-    return NULL;
+   Films move through search, details and poster stages independently, with
+   up to scrape_concurrency transfers in flight on one curl multi handle.
+   Films with the same search share one request. Seasons of a show are
+   fetched together with the show, up to SCRAPE_BATCH_SEASONS per request,
+   and stored in one transaction. Replies are parsed and stored on the
+   scraper thread as they complete, while later films' transfers
+   continue. */
+
+typedef enum {
+  SCRAPE_SEARCH,
+  SCRAPE_DETAILS,
+  SCRAPE_POSTER
+} ScrapeStage;
+
+typedef struct _ScrapeBatch ScrapeBatch;
+
+typedef struct {
+  Film *film;
+  ScrapeStage stage;
+  gint tmdb_id;
+  gint pending;                /* Requests not yet completed */
+  struct json_object *search;
+  struct json_object *details; /* Movie details, or the TV season */
+  gchar *poster;               /* Downloaded poster file */
+  ScrapeBatch *batch;          /* TV only */
+  gchar *error;                /* Why a request failed */
+  gboolean transient;          /* Worth retrying soon */
+  gchar *miss_query;           /* Miss cache key; set on the first of a
+                                  search's films only */
+  gboolean had_miss;           /* Missed before, now due for a re-check */
+  gboolean check_year;         /* Found in the title index; the details
+                                  must show the film's year */
+  gint show_year;              /* TV only: the show's first air year */
+} ScrapeItem;
+
+/* Seasons of one show fetched by a single request */
+struct _ScrapeBatch {
+  gint tmdb_id;
+  GList *items;                /* ScrapeItem* still in progress */
+  GList *ready;                /* ScrapeItem* waiting to be stored */
+  struct json_object *root;
+};
+
+typedef struct {
+  ScrapeItem *item;
+  GList *shared;               /* More ScrapeItem* waiting on a search */
+  ScrapeBatch *batch;          /* Set instead of item for a show request */
+  gchar *url;
+  gboolean api;                /* Counts against the rate limit */
+  gint attempts;
+  struct json_object **reply;  /* Parsed JSON goes here */
+  gboolean cache_checked;
+  gboolean have_cached;        /* A stale reply to revalidate */
+  TmdbCacheEntry cached;
+  gchar *etag;                 /* ETag of the new reply */
+  struct curl_slist *headers;
+  CURL *curl;
+  TmdbJsonParser *parser;      /* Parses the reply as it arrives */
+  GByteArray *body;            /* Poster bytes as they arrive */
+} ScrapeRequest;
+
+typedef struct {
+  ScraperContext *ctx;
+  ReelApp *app;
+  CURLM *multi;
+  GQueue queue;                /* ScrapeRequest* waiting to start */
+  GHashTable *active;          /* ScrapeRequest* on the multi handle */
+  GHashTable *items;           /* Every ScrapeItem* in progress */
+  GHashTable *searches;        /* URL -> unfinished search ScrapeRequest* */
+  GHashTable *batches;         /* Every ScrapeBatch* in progress */
+  GHashTable *open_batches;    /* TMDB id -> ScrapeBatch* not yet sent */
+  gint in_flight;
+  gint api_requests;
+  gint cache_hits;
+  gint posters;
+  gint searches_skipped;       /* Known misses not searched again */
+  gchar *owner;                /* Holder of this run's job leases */
+  GList *claimed;              /* Film* of the last claim */
+  GList *next_film;
+  gboolean exhausted;          /* No more jobs are due */
+  gint64 lease_renewed;        /* Monotonic time of the last renewal */
+  GThreadPool *writers;        /* Saves downloaded posters */
+  GAsyncQueue *written;        /* PosterWrite* back from the writers */
+  gint writing;                /* Posters handed to the writers */
+} ScrapePipeline;
+
+/* A downloaded poster saved off the transfer loop, so a slow disk doesn't
+   hold up the replies of every other transfer */
+typedef struct {
+  ScrapeItem *item;
+  gchar *path;
+  GByteArray *jpeg;
+  gboolean ok;
+  GAsyncQueue *written;
+  CURLM *multi;
+} PosterWrite;
+
+#define SCRAPE_POSTER_WRITERS 2
+
+static void scrape_item_free(ScrapeItem *item) {
+  film_free(item->film);
+  if (item->search)
+    json_object_put(item->search);
+  if (item->details)
+    json_object_put(item->details);
+  g_free(item->poster);
+  g_free(item->error);
+  g_free(item->miss_query);
+  g_free(item);
+}
+
+static void scrape_batch_free(ScrapeBatch *batch) {
+  if (batch->root)
+    json_object_put(batch->root);
+  g_list_free(batch->items);
+  g_list_free(batch->ready);
+  g_free(batch);
+}
+
+static void scrape_request_free(ScrapeRequest *req) {
+  if (req->curl)
+    curl_easy_cleanup(req->curl);
+  if (req->body)
+    g_byte_array_unref(req->body);
+  curl_slist_free_all(req->headers);
+  tmdb_cache_entry_clear(&req->cached);
+  g_list_free(req->shared);
+  g_free(req->etag);
+  tmdb_json_parser_free(req->parser);
+  g_free(req->url);
+  g_free(req);
+}
+
+/* Queue a request for item. Later stages go first so films in flight finish
+   before new ones start. */
+static void scrape_queue(ScrapePipeline *p, ScrapeItem *item, gchar *url,
+                         struct json_object **reply) {
+  ScrapeRequest *req = g_new0(ScrapeRequest, 1);
+  req->item = item;
+  req->url = url;
+  req->api = reply != NULL;
+  req->reply = reply;
+  item->pending++;
+  if (item->stage == SCRAPE_SEARCH)
+    g_queue_push_tail(&p->queue, req);
+  else
+    g_queue_push_head(&p->queue, req);
+}
+
+/* Search for item, joining an unfinished identical search if there is one,
+   so all seasons of a show resolve together */
+static void scrape_queue_search(ScrapePipeline *p, ScrapeItem *item,
+                                gchar *url) {
+  ScrapeRequest *req = g_hash_table_lookup(p->searches, url);
+  if (req) {
+    req->shared = g_list_prepend(req->shared, item);
+    item->pending++;
+    g_free(url);
+    return;
   }
-  sqlite3_exec(db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
 
-  ReelApp thread_app = *app;
-  thread_app.db = db;
+  scrape_queue(p, item, url, &item->search);
+  req = g_queue_peek_tail(&p->queue);
+  g_hash_table_insert(p->searches, req->url, req);
+}
 
-  GList *unmatched = db_films_get_unmatched(&thread_app);
-  ctx->total = g_list_length(unmatched);
-  ctx->done = 0;
+/* Add item's season to its show's next request. The URL is only built when
+   the request starts, so seasons resolved meanwhile ride along. */
+static void scrape_queue_season(ScrapePipeline *p, ScrapeItem *item) {
+  ScrapeBatch *batch =
+      g_hash_table_lookup(p->open_batches, GINT_TO_POINTER(item->tmdb_id));
+  if (!batch) {
+    batch = g_new0(ScrapeBatch, 1);
+    batch->tmdb_id = item->tmdb_id;
+    g_hash_table_add(p->batches, batch);
+    g_hash_table_insert(p->open_batches, GINT_TO_POINTER(item->tmdb_id),
+                        batch);
+
+    ScrapeRequest *req = g_new0(ScrapeRequest, 1);
+    req->batch = batch;
+    req->api = TRUE;
+    req->reply = &batch->root;
+    g_queue_push_head(&p->queue, req);
+  }
+
+  batch->items = g_list_append(batch->items, item);
+  item->batch = batch;
+  item->pending++;
+  if (g_list_length(batch->items) >= SCRAPE_BATCH_SEASONS)
+    g_hash_table_remove(p->open_batches, GINT_TO_POINTER(item->tmdb_id));
+}
+
+/* Close a batch to new seasons and build its URL */
+static void scrape_batch_seal(ScrapePipeline *p, ScrapeRequest *req) {
+  ScrapeBatch *batch = req->batch;
+  if (g_hash_table_lookup(p->open_batches, GINT_TO_POINTER(batch->tmdb_id)) ==
+      batch)
+    g_hash_table_remove(p->open_batches, GINT_TO_POINTER(batch->tmdb_id));
+
+  gint n = 0;
+  gint seasons[SCRAPE_BATCH_SEASONS];
+  for (GList *l = batch->items; l != NULL && n < SCRAPE_BATCH_SEASONS;
+       l = l->next)
+    seasons[n++] = ((ScrapeItem *)l->data)->film->season_number;
+  req->url = show_url(p->app, batch->tmdb_id, seasons, n);
+}
+
+static gboolean scrape_request_start(ScrapePipeline *p, ScrapeRequest *req) {
+  req->curl = curl_request_new(req->url, req->api ? 30L : 60L);
+  if (!req->curl)
+    return FALSE;
 
-  for (GList *l = unmatched; l != NULL && ctx->running; l = l->next) {
-    Film *film = (Film *)l->data;
+  if (req->api) {
+    req->parser = tmdb_json_parser_new(tmdb_json_schema_for_url(req->url));
+    curl_easy_setopt(req->curl, CURLOPT_WRITEFUNCTION, json_write_callback);
+    curl_easy_setopt(req->curl, CURLOPT_WRITEDATA, req->parser);
+    req->headers = curl_request_conditional(
+        req->curl, req->have_cached ? req->cached.etag : NULL, &req->etag);
+  } else {
+    /* Nothing is written until the whole poster is in, so a failed
+       download keeps the old file */
+    req->body = g_byte_array_new();
+    curl_easy_setopt(req->curl, CURLOPT_WRITEFUNCTION, bytes_write_callback);
+    curl_easy_setopt(req->curl, CURLOPT_WRITEDATA, req->body);
+  }
 
-    if (!film->title)
-      continue;
+  curl_easy_setopt(req->curl, CURLOPT_PRIVATE, req);
+  if (curl_multi_add_handle(p->multi, req->curl) != CURLM_OK)
+    return FALSE;
+
+  g_hash_table_add(p->active, req);
+  p->in_flight++;
+  if (req->api)
+    p->api_requests++;
+  else
+    p->posters++;
+  return TRUE;
+}
 
-    g_print("Searching TMDB for: %s (%d)\n", film->title, film->year);
+static void scrape_item_done(ScrapePipeline *p, ScrapeItem *item) {
+  ScraperContext *ctx = p->ctx;
 
-    GList *results;
-    if (film->media_type == MEDIA_TV_SEASON) {
-      results = scraper_search_tv(&thread_app, film->title, film->year);
+  ctx->done++;
+  if (ctx->progress_cb) {
+    ctx->pending_callbacks++;
+    ScraperProgressPayload *payload = g_new0(ScraperProgressPayload, 1);
+    payload->ctx = ctx;
+    payload->title = g_strdup(item->film->title ? item->film->title : "");
+    g_idle_add(scraper_progress_idle, payload);
+  }
+  g_hash_table_remove(p->items, item);
+  scrape_item_free(item);
+}
+
+static void scrape_item_store(ScrapePipeline *p, ScrapeItem *item) {
+  if (item->film->media_type == MEDIA_TV_SEASON) {
+    tv_season_store(p->app, item->film, item->tmdb_id, item->details,
+                    item->poster);
+  } else {
+    movie_store(p->app, item->film, item->tmdb_id, item->details,
+                item->poster);
+  }
+  p->ctx->genres_updated = TRUE;
+}
+
+/* Note why a film failed; the first reason sticks */
+static void scrape_item_error(ScrapeItem *item, const gchar *error,
+                              gboolean transient) {
+  if (item->error)
+    return;
+  item->error = g_strdup(error);
+  item->transient = transient;
+}
+
+/* Put a failed film's job back with its error, to be retried later */
+static void scrape_item_failed(ScrapePipeline *p, ScrapeItem *item) {
+  db_scrape_job_failed(p->app, item->film->id,
+                       item->error ? item->error : "No match on TMDB",
+                       g_get_real_time() / G_USEC_PER_SEC,
+                       item->transient ? SCRAPE_RETRY_TRANSIENT
+                                       : SCRAPE_RETRY_NO_MATCH,
+                       SCRAPE_RETRY_MAX);
+}
+
+/* Take a season out of its batch, keeping it for the batch's transaction
+   if store. The last season out writes the batch and frees it. */
+static void scrape_batch_leave(ScrapePipeline *p, ScrapeItem *item,
+                               gboolean store) {
+  ScrapeBatch *batch = item->batch;
+  item->batch = NULL;
+  batch->items = g_list_remove(batch->items, item);
+  if (store)
+    batch->ready = g_list_append(batch->ready, item);
+  if (batch->items)
+    return;
+
+  if (batch->ready) {
+    db_begin(p->app);
+    for (GList *l = batch->ready; l != NULL; l = l->next)
+      scrape_item_store(p, l->data);
+    db_commit(p->app);
+  }
+
+  GList *ready = batch->ready;
+  batch->ready = NULL;
+  g_hash_table_remove(p->batches, batch);
+  for (GList *l = ready; l != NULL; l = l->next)
+    scrape_item_done(p, l->data);
+  g_list_free(ready);
+}
+
+/* A film has everything it needs, or failed (store FALSE). Seasons wait for
+   the rest of their batch and are written in one transaction. */
+static void scrape_item_finish(ScrapePipeline *p, ScrapeItem *item,
+                               gboolean store) {
+  if (!store)
+    scrape_item_failed(p, item);
+  if (!item->batch) {
+    if (store)
+      scrape_item_store(p, item);
+    scrape_item_done(p, item);
+    return;
+  }
+
+  scrape_batch_leave(p, item, store);
+  if (!store)
+    scrape_item_done(p, item);
+}
+
+/* Fetch the details of a film whose tmdb_id is known */
+static void scrape_item_resolved(ScrapePipeline *p, ScrapeItem *item) {
+  item->stage = SCRAPE_DETAILS;
+  if (item->film->media_type == MEDIA_TV_SEASON)
+    scrape_queue_season(p, item);
+  else
+    scrape_queue(p, item, movie_url(p->app, item->tmdb_id), &item->details);
+}
+
+/* The title index picked the wrong film: search for it after all */
+static void scrape_item_search(ScrapePipeline *p, ScrapeItem *item) {
+  Film *film = item->film;
+  gchar *url = search_url(p->app, film->title, film->year,
+                          film->media_type == MEDIA_TV_SEASON);
+  item->stage = SCRAPE_SEARCH;
+  item->tmdb_id = 0;
+  item->check_year = FALSE;
+  if (item->batch)
+    scrape_batch_leave(p, item, FALSE);
+  if (item->details) {
+    json_object_put(item->details);
+    item->details = NULL;
+  }
+  g_clear_pointer(&item->error, g_free);
+  if (!url) {
+    scrape_item_error(item, "No title to search for", FALSE);
+    scrape_item_finish(p, item, FALSE);
+    return;
+  }
+  scrape_queue_search(p, item, url);
+}
+
+/* Year of a date field in a reply ("release_date" or "first_air_date"),
+   0 if unknown */
+static gint details_year(struct json_object *details, const char *field) {
+  struct json_object *val;
+  if (!json_object_object_get_ex(details, field, &val))
+    return 0;
+  const char *date = json_object_get_string(val);
+  return date && strlen(date) >= 4 ? atoi(date) : 0;
+}
+
+/* Move a film to its next stage once all of its requests have completed */
+static void scrape_item_advance(ScrapePipeline *p, ScrapeItem *item) {
+  Film *film = item->film;
+
+  switch (item->stage) {
+  case SCRAPE_SEARCH: {
+    gboolean tv = film->media_type == MEDIA_TV_SEASON;
+    GList *results = item->search ? parse_search_results(item->search, tv)
+                                  : NULL;
+    TmdbSearchResult *match = scraper_pick_match(film, results);
+    if (match)
+      item->tmdb_id = match->tmdb_id;
+    g_list_free_full(results, (GDestroyNotify)tmdb_search_result_free);
+
+    /* Remember a search that was answered but gave nothing to match */
+    if (item->miss_query && !match && item->search)
+      db_tmdb_miss_put(p->app, item->miss_query, film->year, tv,
+                       g_get_real_time() / G_USEC_PER_SEC,
+                       SCRAPE_RETRY_NO_MATCH, SCRAPE_RETRY_MAX);
+    else if (item->miss_query && match && item->had_miss)
+      db_tmdb_miss_clear(p->app, item->miss_query, film->year, tv);
+
+    if (!match) {
+      scrape_item_finish(p, item, FALSE);
+      return;
+    }
+    scrape_item_resolved(p, item);
+    return;
+  }
+
+  case SCRAPE_DETAILS: {
+    gboolean tv = film->media_type == MEDIA_TV_SEASON;
+    gint year = item->show_year;
+    if (!tv && item->details)
+      year = details_year(item->details, "release_date");
+    /* Teach the title index the year its export left out */
+    if (year > 0)
+      db_tmdb_title_set_year(p->app, tv, item->tmdb_id, year);
+    if (item->check_year && !item->transient && year != film->year) {
+      g_atomic_int_inc(&net_local_rejected);
+      scrape_item_search(p, item);
+      return;
+    }
+
+    if (!item->details) {
+      scrape_item_error(item, "No details on TMDB", FALSE);
+      scrape_item_finish(p, item, FALSE);
+      return;
+    }
+    const char *poster_path = json_poster_path(item->details);
+    if (poster_path) {
+      item->stage = SCRAPE_POSTER;
+      scrape_queue(p, item, poster_url(poster_path, poster_grid_size(p->app)),
+                   NULL);
+      return;
+    }
+    scrape_item_finish(p, item, TRUE);
+    return;
+  }
+
+  case SCRAPE_POSTER:
+    scrape_item_finish(p, item, TRUE);
+    return;
+  }
+}
+
+/* Store a show that has arrived and hand each season its part */
+static void scrape_batch_fetched(ScrapePipeline *p, ScrapeBatch *batch) {
+  GList *items = g_list_copy(batch->items);
+  if (batch->root) {
+    tv_show_store(p->app, batch->tmdb_id, batch->root);
+    gint show_year = details_year(batch->root, "first_air_date");
+    for (GList *l = items; l != NULL; l = l->next) {
+      ScrapeItem *item = (ScrapeItem *)l->data;
+      struct json_object *season =
+          show_season(batch->root, item->film->season_number);
+      if (season)
+        item->details = json_object_get(season);
+      item->show_year = show_year;
+    }
+    json_object_put(batch->root);
+    batch->root = NULL;
+  }
+
+  /* The batch is freed once its last season is stored */
+  for (GList *l = items; l != NULL; l = l->next) {
+    ScrapeItem *item = (ScrapeItem *)l->data;
+    if (--item->pending == 0)
+      scrape_item_advance(p, item);
+  }
+  g_list_free(items);
+}
+
+/* Free a finished request, answered or not, and move on whatever waited
+   for it */
+static void scrape_request_finish(ScrapePipeline *p, ScrapeRequest *req) {
+  ScrapeItem *item = req->item;
+  ScrapeBatch *batch = req->batch;
+  GList *shared = req->shared;
+  req->shared = NULL;
+
+  if (item && item->stage == SCRAPE_SEARCH &&
+      g_hash_table_lookup(p->searches, req->url) == req)
+    g_hash_table_remove(p->searches, req->url);
+  for (GList *l = shared; l != NULL; l = l->next) {
+    ScrapeItem *other = (ScrapeItem *)l->data;
+    if (item->search)
+      other->search = json_object_get(item->search);
+  }
+  scrape_request_free(req);
+
+  if (batch) {
+    scrape_batch_fetched(p, batch);
+  } else {
+    if (--item->pending == 0)
+      scrape_item_advance(p, item);
+    for (GList *l = shared; l != NULL; l = l->next) {
+      ScrapeItem *other = (ScrapeItem *)l->data;
+      if (--other->pending == 0)
+        scrape_item_advance(p, other);
+    }
+  }
+  g_list_free(shared);
+}
+
+/* An API request came back without a usable reply: tell every film that
+   waited for it */
+static void scrape_request_failed(ScrapeRequest *req, CURLcode res,
+                                  long status) {
+  gchar *error;
+  gboolean transient = TRUE;
+  if (res != CURLE_OK) {
+    error = g_strdup(curl_easy_strerror(res));
+  } else if (status >= 400) {
+    error = g_strdup_printf("HTTP %ld", status);
+    transient = status == 429 || status >= 500;
+  } else {
+    error = g_strdup("Invalid reply from TMDB");
+  }
+
+  if (req->item)
+    scrape_item_error(req->item, error, transient);
+  for (GList *l = req->shared; l != NULL; l = l->next)
+    scrape_item_error(l->data, error, transient);
+  if (req->batch) {
+    for (GList *l = req->batch->items; l != NULL; l = l->next)
+      scrape_item_error(l->data, error, transient);
+  }
+  g_free(error);
+}
+
+static void poster_write_worker(gpointer data, gpointer user_data) {
+  (void)user_data;
+  PosterWrite *write = (PosterWrite *)data;
+  write->ok = poster_write(write->path, write->jpeg);
+  CURLM *multi = write->multi;
+  g_async_queue_push(write->written, write);
+  curl_multi_wakeup(multi);
+}
+
+/* The item waits for its poster like for a request */
+static void scrape_poster_save(ScrapePipeline *p, ScrapeItem *item,
+                               GByteArray *jpeg) {
+  gchar *stem = poster_stem(item->film, item->tmdb_id);
+  PosterWrite *write = g_new0(PosterWrite, 1);
+  write->item = item;
+  write->path = poster_cache_file(p->app, stem, poster_grid_size(p->app));
+  write->jpeg = g_byte_array_ref(jpeg);
+  write->written = p->written;
+  write->multi = p->multi;
+  g_free(stem);
+
+  item->pending++;
+  p->writing++;
+  g_thread_pool_push(p->writers, write, NULL);
+}
+
+static void poster_write_free(PosterWrite *write) {
+  g_byte_array_unref(write->jpeg);
+  g_free(write->path);
+  g_free(write);
+}
+
+static void scrape_poster_saved(ScrapePipeline *p, PosterWrite *write) {
+  ScrapeItem *item = write->item;
+  p->writing--;
+  if (write->ok) {
+    g_free(item->poster);
+    item->poster = g_steal_pointer(&write->path);
+  }
+  poster_write_free(write);
+  if (--item->pending == 0)
+    scrape_item_advance(p, item);
+}
+
+static void scrape_request_complete(ScrapePipeline *p, ScrapeRequest *req,
+                                    CURLcode res) {
+  ScrapeItem *item = req->item;
+  long status = 0;
+  curl_easy_getinfo(req->curl, CURLINFO_RESPONSE_CODE, &status);
+
+  curl_request_account(req->curl);
+  curl_multi_remove_handle(p->multi, req->curl);
+  g_hash_table_remove(p->active, req);
+  p->in_flight--;
+
+  if (res == CURLE_OK && status == 429 && req->api &&
+      ++req->attempts < SCRAPE_MAX_ATTEMPTS) {
+    curl_off_t retry_after = 0;
+    curl_easy_getinfo(req->curl, CURLINFO_RETRY_AFTER, &retry_after);
+    rate_limit_backoff(retry_after > 0 ? (gint64)retry_after : 1);
+
+    curl_easy_cleanup(req->curl);
+    req->curl = NULL;
+    curl_slist_free_all(req->headers);
+    req->headers = NULL;
+    g_clear_pointer(&req->etag, g_free);
+    g_clear_pointer(&req->parser, tmdb_json_parser_free);
+    g_queue_push_head(&p->queue, req);
+    return;
+  }
+
+  if (req->api) {
+    if (res == CURLE_OK && status == 304 && req->have_cached) {
+      tmdb_cache_revalidated(p->app, req->url, &req->cached);
+      *req->reply =
+          reply_parse(req->url, req->cached.body, req->cached.length);
     } else {
-      results = scraper_search_tmdb(&thread_app, film->title, film->year);
+      tmdb_cache_miss();
+      if (res == CURLE_OK)
+        *req->reply = tmdb_json_parser_finish(req->parser, NULL);
+      if (*req->reply && status == 200)
+        reply_cache_store(p->app, req->url, *req->reply, req->etag);
     }
+    if (!*req->reply)
+      scrape_request_failed(req, res, status);
+  } else if (res == CURLE_OK && status < 400 && req->body->len > 0) {
+    scrape_poster_save(p, item, req->body);
+  }
+
+  scrape_request_finish(p, req);
+}
+
+/* Start queued requests while there is room; returns microseconds until the
+   rate limit allows the next API request, or 0 */
+static gint64 scrape_start_queued(ScrapePipeline *p) {
+  gint concurrency = MAX(p->app->scrape_concurrency, 1);
+  gint64 wait = 0;
+  GList *l = p->queue.head;
+
+  while (l && p->in_flight < concurrency) {
+    ScrapeRequest *req = (ScrapeRequest *)l->data;
+    GList *next = l->next;
+
+    if (req->batch && !req->url)
+      scrape_batch_seal(p, req);
+
+    if (req->api && !req->cache_checked) {
+      req->cache_checked = TRUE;
+      req->have_cached = tmdb_cache_lookup(p->app, req->url, &req->cached);
+      if (req->have_cached && req->cached.fresh) {
+        /* Answered from disk: no token, no transfer */
+        *req->reply =
+            reply_parse(req->url, req->cached.body, req->cached.length);
+        g_queue_delete_link(&p->queue, l);
+        p->cache_hits++;
+        scrape_request_finish(p, req);
+        l = next;
+        continue;
+      }
+    }
+
+    if (req->api) {
+      gint64 w = rate_limit_try(p->app->scrape_rate);
+      if (w > 0) {
+        /* Posters further down the queue may still start */
+        if (wait == 0 || w < wait)
+          wait = w;
+        l = next;
+        continue;
+      }
+    }
+
+    g_queue_delete_link(&p->queue, l);
+    if (!scrape_request_start(p, req)) {
+      if (req->api)
+        scrape_request_failed(req, CURLE_FAILED_INIT, 0);
+      scrape_request_finish(p, req);
+    }
+    l = next;
+  }
+  return wait;
+}
 
-    if (results) {
-      TmdbSearchResult *first = (TmdbSearchResult *)results->data;
+/* Lease the next due jobs once the last claim has been admitted; FALSE
+   when none are left */
+static gboolean scrape_claim(ScrapePipeline *p) {
+  if (p->next_film)
+    return TRUE;
+  if (p->exhausted)
+    return FALSE;
 
-      /* Auto-match if good confidence */
-      /* Simple heuristic: if top result title is similar and year matches */
-      gboolean good_match = FALSE;
+  g_list_free_full(p->claimed, (GDestroyNotify)film_free);
+  gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+  p->claimed = db_scrape_jobs_claim(p->app, p->owner, now,
+                                    now + SCRAPE_LEASE_SECONDS,
+                                    SCRAPE_CLAIM_JOBS);
+  p->next_film = p->claimed;
+  p->lease_renewed = g_get_monotonic_time();
+  if (!p->claimed) {
+    p->exhausted = TRUE;
+    return FALSE;
+  }
 
-      if (first->year == film->year) {
-        good_match = TRUE;
-      } else if (film->year == 0 && g_list_length(results) == 1) {
-        good_match = TRUE;
+  /* Jobs queued by a scan since the run started count too */
+  ScraperContext *ctx = p->ctx;
+  ctx->total = MAX(ctx->total, ctx->done + (gint)g_hash_table_size(p->items) +
+                                   (gint)g_list_length(p->claimed));
+  return TRUE;
+}
+
+/* Keep this run's leases from running out while it works on them */
+static void scrape_lease_renew(ScrapePipeline *p) {
+  gint64 now = g_get_monotonic_time();
+  if (now - p->lease_renewed < SCRAPE_LEASE_SECONDS / 4 * G_USEC_PER_SEC)
+    return;
+  p->lease_renewed = now;
+  db_scrape_jobs_renew(p->app, p->owner,
+                       g_get_real_time() / G_USEC_PER_SEC +
+                           SCRAPE_LEASE_SECONDS);
+}
+
+/* Jobs are claimed sorted by path, so a show's seasons follow each other.
+   Admit them along with item to share its search (url), or the tmdb_id it
+   was resolved to, and then the show request. */
+static void scrape_admit_seasons(ScrapePipeline *p, ScrapeItem *item,
+                                 const gchar *url) {
+  Film *film = item->film;
+  while (p->next_film) {
+    Film *other = (Film *)p->next_film->data;
+    if (other->media_type != film->media_type || other->year != film->year ||
+        g_strcmp0(other->title, film->title))
+      break;
+    p->next_film->data = NULL;
+    p->next_film = p->next_film->next;
+
+    ScrapeItem *sibling = g_new0(ScrapeItem, 1);
+    sibling->film = other;
+    sibling->stage = SCRAPE_SEARCH;
+    g_hash_table_add(p->items, sibling);
+    if (url) {
+      scrape_queue_search(p, sibling, g_strdup(url));
+    } else {
+      sibling->tmdb_id = item->tmdb_id;
+      sibling->check_year = item->check_year;
+      scrape_item_resolved(p, sibling);
+    }
+  }
+}
+
+static void scrape_pipeline_run(ScrapePipeline *p) {
+  ScraperContext *ctx = p->ctx;
+  gint concurrency = MAX(p->app->scrape_concurrency, 1);
+
+  while (ctx->running) {
+    /* Admit new films only while nothing else is waiting to start */
+    while (g_queue_is_empty(&p->queue) && p->in_flight < concurrency &&
+           scrape_claim(p)) {
+      GList *next_film = p->next_film;
+      Film *film = (Film *)next_film->data;
+      next_film->data = NULL;
+      p->next_film = next_film->next;
+
+      if (!film->title) {
+        db_scrape_job_failed(p->app, film->id, "No title to search for",
+                             g_get_real_time() / G_USEC_PER_SEC,
+                             SCRAPE_RETRY_NO_MATCH, SCRAPE_RETRY_MAX);
+        film_free(film);
+        continue;
       }
 
-      if (film->media_type == MEDIA_TV_SEASON && g_list_length(results) > 0) {
-        /* Check if title matches reasonably well ignoring "Season X" part
-         * handled in search */
-        good_match = TRUE; /* Let's assume the first match is decent for now */
+      gboolean tv = film->media_type == MEDIA_TV_SEASON;
+      gchar *url = search_url(p->app, film->title, film->year, tv);
+      ScrapeItem *item = g_new0(ScrapeItem, 1);
+      item->film = film;
+      item->stage = SCRAPE_SEARCH;
+      g_hash_table_add(p->items, item);
+      if (!url) {
+        scrape_item_error(item, "No title to search for", FALSE);
+        scrape_item_failed(p, item);
+        scrape_item_done(p, item);
+        continue;
       }
 
-      if (good_match) {
-        scraper_fetch_and_update(&thread_app, film->id, first->tmdb_id);
-        ctx->genres_updated = TRUE;
+      /* A title in the local index needs no search */
+      item->miss_query = miss_query(film->title);
+      if (item->miss_query)
+        item->tmdb_id = title_index_resolve(p->app, item->miss_query,
+                                            film->year, tv, &item->check_year);
+      if (item->tmdb_id) {
+        g_atomic_int_inc(&net_local_matches);
+        g_free(url);
+        scrape_item_resolved(p, item);
+        scrape_admit_seasons(p, item, NULL);
+        continue;
       }
 
-      g_list_free_full(results, (GDestroyNotify)tmdb_search_result_free);
+      /* Don't repeat a search that found nothing until it is due again.
+         The show's other seasons come next and are skipped the same way. */
+      TmdbMiss miss;
+      item->had_miss = item->miss_query &&
+                       db_tmdb_miss_get(p->app, item->miss_query, film->year,
+                                        tv, &miss);
+      if (item->had_miss &&
+          miss.recheck_at > g_get_real_time() / G_USEC_PER_SEC) {
+        db_tmdb_miss_saved(p->app, item->miss_query, film->year, tv);
+        g_atomic_int_inc(&net_searches_skipped);
+        p->searches_skipped++;
+        scrape_item_error(item, "No match on TMDB at the last check", FALSE);
+        scrape_item_failed(p, item);
+        scrape_item_done(p, item);
+        g_free(url);
+        continue;
+      }
+      g_print("Searching TMDB for: %s (%d)\n", film->title, film->year);
+      gchar *shared_url = g_strdup(url);
+      scrape_queue_search(p, item, url);
+      scrape_admit_seasons(p, item, shared_url);
+      g_free(shared_url);
     }
 
-    ctx->done++;
-    if (ctx->progress_cb) {
-      ctx->pending_callbacks++;
-      ScraperProgressPayload *p = g_new0(ScraperProgressPayload, 1);
-      p->ctx = ctx;
-      p->title = g_strdup(film->title ? film->title : "");
-      g_idle_add(scraper_progress_idle, p);
+    gint64 wait = scrape_start_queued(p);
+
+    if (p->in_flight == 0 && p->writing == 0 && g_queue_is_empty(&p->queue) &&
+        p->exhausted)
+      break;
+    scrape_lease_renew(p);
+
+    int still_running = 0;
+    curl_multi_perform(p->multi, &still_running);
+
+    CURLMsg *msg;
+    int msgs_left;
+    while ((msg = curl_multi_info_read(p->multi, &msgs_left))) {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+      ScrapeRequest *req = NULL;
+      CURL *curl = msg->easy_handle;
+      CURLcode res = msg->data.result;
+      curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&req);
+      scrape_request_complete(p, req, res);
     }
+    PosterWrite *write;
+    while ((write = g_async_queue_try_pop(p->written)))
+      scrape_poster_saved(p, write);
+
+    /* Wake for network activity, the next token, or a cancel request.
+       Requests queued by cache hits can start right away. */
+    int timeout_ms = 100;
+    if (wait > 0 && wait / 1000 + 1 < timeout_ms)
+      timeout_ms = (int)(wait / 1000) + 1;
+    if (wait == 0 && !g_queue_is_empty(&p->queue) &&
+        p->in_flight < concurrency)
+      timeout_ms = 0;
+    if (p->in_flight > 0 || p->writing > 0)
+      curl_multi_poll(p->multi, NULL, 0, timeout_ms, NULL);
+    else if (!g_queue_is_empty(&p->queue) && timeout_ms > 0)
+      g_usleep(timeout_ms * 1000);
+  }
 
-    /* Rate limiting */
-    g_usleep(250000); /* 250ms between requests */
+  /* Canceled: let the posters being saved finish, then drop whatever is
+     still in flight, queued or waiting */
+  g_thread_pool_free(p->writers, FALSE, TRUE);
+  p->writers = NULL;
+  PosterWrite *write;
+  while ((write = g_async_queue_try_pop(p->written)))
+    poster_write_free(write);
+  p->writing = 0;
+  g_hash_table_remove_all(p->searches);
+  g_hash_table_remove_all(p->open_batches);
+  ScrapeRequest *req;
+  while ((req = g_queue_pop_head(&p->queue)))
+    scrape_request_free(req);
+  GHashTableIter iter;
+  g_hash_table_iter_init(&iter, p->active);
+  while (g_hash_table_iter_next(&iter, (gpointer *)&req, NULL)) {
+    curl_multi_remove_handle(p->multi, req->curl);
+    scrape_request_free(req);
   }
+  g_hash_table_remove_all(p->active);
+  g_hash_table_remove_all(p->batches);
+  p->in_flight = 0;
+
+  ScrapeItem *item;
+  g_hash_table_iter_init(&iter, p->items);
+  while (g_hash_table_iter_next(&iter, (gpointer *)&item, NULL))
+    scrape_item_free(item);
+  g_hash_table_remove_all(p->items);
+}
+
+/* Owners are "host:pid:start", so a run can tell a lease left behind by a
+   process on this machine that has since exited */
+static gchar *scrape_owner_new(void) {
+  return g_strdup_printf("%s:%d:%" G_GINT64_FORMAT, g_get_host_name(),
+                         (int)getpid(), g_get_real_time());
+}
+
+static gboolean scrape_owner_gone(const gchar *owner) {
+  gchar **parts = g_strsplit(owner, ":", 3);
+  gboolean gone = FALSE;
+  if (g_strv_length(parts) == 3 &&
+      g_strcmp0(parts[0], g_get_host_name()) == 0) {
+    pid_t pid = (pid_t)g_ascii_strtoll(parts[1], NULL, 10);
+    gone = pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+  }
+  g_strfreev(parts);
+  return gone;
+}
+
+/* Free the jobs of runs that were cut off, so they resume right away
+   rather than when their lease runs out */
+static void scrape_release_stale(ReelApp *app) {
+  GList *owners = db_scrape_jobs_owners(app);
+  for (GList *l = owners; l != NULL; l = l->next) {
+    if (scrape_owner_gone(l->data)) {
+      g_print("Resuming scrape jobs of an interrupted run\n");
+      db_scrape_jobs_release(app, l->data);
+    }
+  }
+  g_list_free_full(owners, g_free);
+}
+
+static gpointer scraper_thread_func(gpointer data) {
+  ScraperContext *ctx = (ScraperContext *)data;
+  ReelApp *app = ctx->app;
+
+  sqlite3 *db = NULL;
+  if (sqlite3_open(app->db_path, &db) != SQLITE_OK) {
+    if (db)
+      sqlite3_close(db);
+    g_idle_add(scraper_done_idle, ctx);
+    return NULL;
+  }
+  sqlite3_exec(db, "PRAGMA foreign_keys = ON;", NULL, NULL, NULL);
+  sqlite3_busy_timeout(db, 5000);
+
+  ReelApp thread_app = *app;
+  thread_app.db = db;
+
+  scrape_release_stale(&thread_app);
+  ScrapeQueueStats queue;
+  db_scrape_queue_stats(&thread_app, g_get_real_time() / G_USEC_PER_SEC,
+                        &queue);
+  ctx->total = queue.due;
+  ctx->done = 0;
+
+  ScrapePipeline pipeline = {0};
+  pipeline.ctx = ctx;
+  pipeline.app = &thread_app;
+  pipeline.owner = scrape_owner_new();
+  pipeline.multi = curl_multi_init();
+  pipeline.active = g_hash_table_new(g_direct_hash, g_direct_equal);
+  pipeline.items = g_hash_table_new(g_direct_hash, g_direct_equal);
+  pipeline.searches = g_hash_table_new(g_str_hash, g_str_equal);
+  pipeline.batches = g_hash_table_new_full(
+      g_direct_hash, g_direct_equal, (GDestroyNotify)scrape_batch_free, NULL);
+  pipeline.open_batches = g_hash_table_new(g_direct_hash, g_direct_equal);
+  g_queue_init(&pipeline.queue);
+  pipeline.written = g_async_queue_new();
+  pipeline.writers = g_thread_pool_new(poster_write_worker, NULL,
+                                       SCRAPE_POSTER_WRITERS, FALSE, NULL);
+
+  ScraperNetStats before;
+  scraper_net_stats(&before);
+  gint64 start = g_get_monotonic_time();
+  if (pipeline.multi) {
+    curl_multi_setopt(pipeline.multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                      (long)MAX(app->scrape_concurrency, 1));
+    curl_multi_setopt(pipeline.multi, CURLMOPT_PIPELINING,
+                      (long)CURLPIPE_MULTIPLEX);
+    scrape_pipeline_run(&pipeline);
+    curl_multi_cleanup(pipeline.multi);
+  }
+  /* Jobs not finished when canceled go back to the queue as they were */
+  db_scrape_jobs_release(&thread_app, pipeline.owner);
+  g_list_free_full(pipeline.claimed, (GDestroyNotify)film_free);
+  g_free(pipeline.owner);
+  g_hash_table_destroy(pipeline.active);
+  g_hash_table_destroy(pipeline.items);
+  g_hash_table_destroy(pipeline.searches);
+  g_hash_table_destroy(pipeline.batches);
+  g_hash_table_destroy(pipeline.open_batches);
+  if (pipeline.writers)
+    g_thread_pool_free(pipeline.writers, FALSE, TRUE);
+  g_async_queue_unref(pipeline.written);
+  gdouble seconds = (g_get_monotonic_time() - start) / 1e6;
+  ScraperNetStats after;
+  scraper_net_stats(&after);
+
+  g_print("Scraped %d films in %.1fs (%.0f films/min, %d API requests, "
+          "%d cached, %d known misses skipped, %d posters, %d connections, "
+          "%d over TLS, %.0f ms in handshakes)\n",
+          ctx->done, seconds, seconds > 0 ? ctx->done * 60.0 / seconds : 0.0,
+          pipeline.api_requests, pipeline.cache_hits,
+          pipeline.searches_skipped, pipeline.posters,
+          after.connections - before.connections,
+          after.tls_connections - before.tls_connections,
+          (after.tls_setup_us - before.tls_setup_us) / 1000.0);
 
-  g_list_free_full(unmatched, (GDestroyNotify)film_free);
   sqlite3_close(db);
   g_idle_add(scraper_done_idle, ctx);
 
@@ -862,13 +2224,13 @@ void scraper_start_background(ReelApp *app) {
   g_thread_new("scraper", scraper_thread_func, ctx);
 }
 
-void scraper_start_background_with_progress(ReelApp *app,
-                                            ScraperProgressFunc progress_cb,
-                                            ScraperDoneFunc done_cb,
-                                            gpointer user_data) {
+gboolean scraper_start_background_with_progress(ReelApp *app,
+                                                ScraperProgressFunc progress_cb,
+                                                ScraperDoneFunc done_cb,
+                                                gpointer user_data) {
   if (active_scraper && active_scraper->running) {
     g_print("Scraper already running\n");
-    return;
+    return FALSE;
   }
 
   ScraperContext *ctx = g_new0(ScraperContext, 1);
@@ -880,6 +2242,7 @@ void scraper_start_background_with_progress(ReelApp *app,
   active_scraper = ctx;
 
   g_thread_new("scraper", scraper_thread_func, ctx);
+  return TRUE;
 }
 
 void scraper_stop(ReelApp *app) {
@@ -2,6 +2,7 @@
 #define REELGTK_SCRAPER_H
 
 #include "app.h"
+#include "db.h"
 
 /* Search result from TMDB */
 typedef struct {
@@ -25,8 +26,9 @@ typedef void (*ScraperProgressFunc)(ReelApp *app, gint done, gint total,
 typedef void (*ScraperDoneFunc)(ReelApp *app, gboolean canceled,
                                 gpointer user_data);
 
-/* Start background scraping of unmatched films with progress callbacks */
-void scraper_start_background_with_progress(ReelApp *app,
+/* Start background scraping of unmatched films with progress callbacks.
+   Returns FALSE, without calling done_cb, if a scrape is already running. */
+gboolean scraper_start_background_with_progress(ReelApp *app,
                                             ScraperProgressFunc progress_cb,
                                             ScraperDoneFunc done_cb,
                                             gpointer user_data);
@@ -40,10 +42,47 @@ GList *scraper_search_tv(ReelApp *app, const gchar *query, gint year);
 /* Fetch full details and update film in database */
 gboolean scraper_fetch_and_update(ReelApp *app, gint64 film_id, gint tmdb_id);
 
-/* Download poster image */
+/* The remembered failed lookup of film, if its automatic search found no
+   match; forgetting it lets the next scrape search again */
+gboolean scraper_find_miss(ReelApp *app, const Film *film, TmdbMiss *miss);
+void scraper_forget_miss(ReelApp *app, const Film *film);
+
+/* Download poster image at grid size */
 gboolean scraper_download_poster(ReelApp *app, const gchar *poster_path,
                                  gint tmdb_id);
 
+typedef enum {
+  SCRAPER_POSTER_GRID,
+  SCRAPER_POSTER_DETAIL
+} ScraperPosterUse;
+
+/* TMDB poster size ("w185", "w342", "w500" or "w780") for drawing one
+   width pixels wide */
+const gchar *scraper_poster_size(ScraperPosterUse use, gint width);
+
+/* Cache file of another size of a cached poster, e.g. "603_w185.jpg" to
+   "603_w500.jpg" */
+gchar *scraper_poster_variant_path(const gchar *poster_file,
+                                   const gchar *size);
+
+/* The cache file of poster_file at size, downloaded from its TMDB image
+   path remote first if needed. Blocks; NULL if it could not be fetched. */
+gchar *scraper_fetch_poster_variant(const gchar *poster_file,
+                                    const gchar *remote, const gchar *size);
+
+/* Network counters since startup, for comparing runs */
+typedef struct {
+  gint requests;         /* Transfers completed, API and posters */
+  gint connections;      /* New connections opened for them */
+  gint tls_connections;  /* Of those, TLS ones: full or resumed handshakes */
+  gint64 tls_setup_us;   /* Time spent in their handshakes */
+  gint searches_skipped; /* Not sent: TMDB had no match at the last check */
+  gint local_matches;    /* Found in the title index without a search */
+  gint local_rejected;   /* Of those, details showed another year */
+} ScraperNetStats;
+
+void scraper_net_stats(ScraperNetStats *stats);
+
 /* Free search result */
 void tmdb_search_result_free(TmdbSearchResult *result);
 
@@ -0,0 +1,248 @@
+/*
+ * ReelGTK - TMDB Title Index
+ * Matches films against TMDB's daily ID exports without a search request
+ */
+
+#include "titleindex.h"
+#include "db.h"
+#include <gio/gio.h>
+#include <json-c/json.h>
+#include <string.h>
+
+/* Read buffer for the export file */
+#define TITLE_INDEX_BUFFER (64 * 1024)
+
+/* Lines between progress reports */
+#define TITLE_INDEX_PROGRESS_LINES 100000
+
+/* Titles sharing a key considered for one lookup */
+#define TITLE_INDEX_CANDIDATES 20
+
+gchar *title_index_key(const gchar *title) {
+  if (!title)
+    return NULL;
+
+  /* Decompose so accents become separate marks that can be dropped */
+  gchar *decomposed = g_utf8_normalize(title, -1, G_NORMALIZE_ALL);
+  if (!decomposed)
+    return NULL;
+  gchar *folded = g_utf8_casefold(decomposed, -1);
+  g_free(decomposed);
+
+  GString *key = g_string_sized_new(strlen(folded));
+  gboolean gap = FALSE;
+  for (const gchar *c = folded; *c; c = g_utf8_next_char(c)) {
+    gunichar ch = g_utf8_get_char(c);
+    if (g_unichar_ismark(ch) || ch == '\'' || ch == 0x2019)
+      continue;
+    if (ch == '&') {
+      g_string_append(key, key->len ? " and" : "and");
+      gap = TRUE;
+      continue;
+    }
+    if (!g_unichar_isalnum(ch)) {
+      gap = TRUE;
+      continue;
+    }
+    if (gap && key->len)
+      g_string_append_c(key, ' ');
+    gap = FALSE;
+    g_string_append_unichar(key, ch);
+  }
+  g_free(folded);
+
+  if (g_str_has_prefix(key->str, "the ") && key->len > 4)
+    g_string_erase(key, 0, 4);
+  if (key->len == 0) {
+    g_string_free(key, TRUE);
+    return NULL;
+  }
+  return g_string_free(key, FALSE);
+}
+
+/* Add one line of an export: {"id":550,"original_title":"Fight Club",
+   "popularity":61.4,"adult":false,...}, or original_name for shows.
+   FALSE only when the index could not be written. */
+static gboolean title_index_import_line(TmdbTitleImport *import,
+                                        json_tokener *tok, const gchar *line,
+                                        gsize length,
+                                        TitleIndexImportStats *stats) {
+  json_tokener_reset(tok);
+  struct json_object *root = json_tokener_parse_ex(tok, line, (int)length);
+  struct json_object *val;
+  gboolean tv = FALSE;
+  const char *title = NULL;
+
+  if (root && json_object_is_type(root, json_type_object)) {
+    if (json_object_object_get_ex(root, "original_title", &val)) {
+      title = json_object_get_string(val);
+    } else if (json_object_object_get_ex(root, "original_name", &val)) {
+      title = json_object_get_string(val);
+      tv = TRUE;
+    }
+  }
+  gint tmdb_id = 0;
+  if (title && json_object_object_get_ex(root, "id", &val))
+    tmdb_id = json_object_get_int(val);
+  if (tmdb_id > 0 && json_object_object_get_ex(root, "adult", &val) &&
+      json_object_get_boolean(val))
+    tmdb_id = 0;
+
+  gchar *key = tmdb_id > 0 ? title_index_key(title) : NULL;
+  gboolean ok = TRUE;
+  if (key) {
+    gdouble popularity = 0;
+    if (json_object_object_get_ex(root, "popularity", &val))
+      popularity = json_object_get_double(val);
+    ok = db_tmdb_titles_import_add(import, tv, tmdb_id, key, popularity);
+    if (ok && tv)
+      stats->shows++;
+    else if (ok)
+      stats->films++;
+  } else {
+    stats->skipped++;
+  }
+
+  g_free(key);
+  if (root)
+    json_object_put(root);
+  return ok;
+}
+
+/* The file as a stream of text, unpacked as it is read if it is gzipped */
+static GInputStream *title_index_open(const gchar *path, GError **error) {
+  GFile *file = g_file_new_for_path(path);
+  GFileInputStream *raw = g_file_read(file, NULL, error);
+  g_object_unref(file);
+  if (!raw)
+    return NULL;
+
+  GInputStream *buffered =
+      g_buffered_input_stream_new_sized(G_INPUT_STREAM(raw), TITLE_INDEX_BUFFER);
+  g_object_unref(raw);
+  if (g_buffered_input_stream_fill(G_BUFFERED_INPUT_STREAM(buffered), -1,
+                                   NULL, error) < 0) {
+    g_object_unref(buffered);
+    return NULL;
+  }
+
+  gsize available = 0;
+  const guchar *head = g_buffered_input_stream_peek_buffer(
+      G_BUFFERED_INPUT_STREAM(buffered), &available);
+  if (available < 2 || head[0] != 0x1f || head[1] != 0x8b)
+    return buffered;
+
+  GZlibDecompressor *gunzip =
+      g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+  GInputStream *input =
+      g_converter_input_stream_new(buffered, G_CONVERTER(gunzip));
+  g_object_unref(gunzip);
+  g_object_unref(buffered);
+  return input;
+}
+
+gboolean title_index_import(ReelApp *app, const gchar *path,
+                            TitleIndexProgressFunc progress_cb,
+                            gpointer user_data, TitleIndexImportStats *stats,
+                            GError **error) {
+  memset(stats, 0, sizeof(*stats));
+
+  GInputStream *input = title_index_open(path, error);
+  if (!input)
+    return FALSE;
+  GDataInputStream *lines = g_data_input_stream_new(input);
+  g_object_unref(input);
+
+  TmdbTitleImport *import = db_tmdb_titles_import_begin(app);
+  if (!import) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                "Could not write the title index");
+    g_object_unref(lines);
+    return FALSE;
+  }
+
+  /* Only one line is held at a time, whatever the size of the export */
+  json_tokener *tok = json_tokener_new();
+  gboolean written = TRUE;
+  GError *read_error = NULL;
+  gchar *line;
+  gsize length;
+  while (written && (line = g_data_input_stream_read_line(
+                         lines, &length, NULL, &read_error))) {
+    stats->lines++;
+    written = title_index_import_line(import, tok, line, length, stats);
+    g_free(line);
+    if (progress_cb && stats->lines % TITLE_INDEX_PROGRESS_LINES == 0)
+      progress_cb(stats, user_data);
+  }
+  json_tokener_free(tok);
+  g_object_unref(lines);
+
+  /* Titles missing from a file that was cut short may still exist */
+  gboolean complete = written && !read_error;
+  stats->removed = db_tmdb_titles_import_end(import, complete);
+  if (read_error) {
+    g_propagate_error(error, read_error);
+    return FALSE;
+  }
+  if (!written || stats->removed < 0) {
+    g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                "Could not write the title index");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Pick from titles sharing a key, most popular first */
+static gint title_index_pick(GList *titles, gint year, gboolean tv,
+                             gboolean *check_year) {
+  *check_year = FALSE;
+  if (!titles)
+    return 0;
+
+  /* Like a search without a year, the most popular show wins. A season's
+     year is its show's first air date, checked like a film's. */
+  TmdbTitle *first = (TmdbTitle *)titles->data;
+  if (year == 0)
+    return tv || !titles->next ? first->tmdb_id : 0;
+
+  for (GList *l = titles; l != NULL; l = l->next) {
+    TmdbTitle *title = (TmdbTitle *)l->data;
+    if (title->year == year)
+      return title->tmdb_id;
+  }
+  for (GList *l = titles; l != NULL; l = l->next) {
+    TmdbTitle *title = (TmdbTitle *)l->data;
+    if (title->year == 0) {
+      *check_year = TRUE;
+      return title->tmdb_id;
+    }
+  }
+  return 0;
+}
+
+gint title_index_resolve(ReelApp *app, const gchar *query, gint year,
+                         gboolean tv, gboolean *check_year) {
+  *check_year = FALSE;
+  gchar *key = title_index_key(query);
+  if (!key)
+    return 0;
+
+  /* A film with a year may have words left over from its file name
+     ("Alien Directors Cut"): drop them from the end until a title matches.
+     Its year still has to match, so this can't pick a stranger. */
+  gint tmdb_id = 0;
+  for (;;) {
+    GList *titles =
+        db_tmdb_titles_find(app, key, tv, TITLE_INDEX_CANDIDATES);
+    tmdb_id = title_index_pick(titles, year, tv, check_year);
+    g_list_free_full(titles, g_free);
+
+    gchar *space = strrchr(key, ' ');
+    if (tmdb_id || tv || year == 0 || !space)
+      break;
+    *space = '\0';
+  }
+  g_free(key);
+  return tmdb_id;
+}
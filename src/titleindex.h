@@ -0,0 +1,40 @@
+#ifndef REELGTK_TITLEINDEX_H
+#define REELGTK_TITLEINDEX_H
+
+#include "app.h"
+
+/* Local index of TMDB titles, filled from TMDB's daily ID exports
+   (movie_ids_MM_DD_YYYY.json.gz, tv_series_ids_MM_DD_YYYY.json.gz), so the
+   scraper can find a film's tmdb_id without a search */
+
+typedef struct {
+  gint lines;   /* Read from the file */
+  gint films;   /* Imported */
+  gint shows;
+  gint skipped; /* Adult titles, and lines that weren't a title */
+  gint removed; /* Titles no longer in the export */
+} TitleIndexImportStats;
+
+typedef void (*TitleIndexProgressFunc)(const TitleIndexImportStats *stats,
+                                       gpointer user_data);
+
+/* A title folded for lookup: accents and punctuation dropped, case folded,
+   "&" read as "and" and a leading "the" ignored. NULL if nothing is left. */
+gchar *title_index_key(const gchar *title);
+
+/* Import an export, gzipped or not, one line at a time. Titles of each kind
+   in the file replace the ones imported before, once the whole file has been
+   read. */
+gboolean title_index_import(ReelApp *app, const gchar *path,
+                            TitleIndexProgressFunc progress_cb,
+                            gpointer user_data, TitleIndexImportStats *stats,
+                            GError **error);
+
+/* tmdb_id of the title for a search query, or 0. The exports have no
+   years, so a film's year is only known once its details have been
+   fetched; until then *check_year asks for the details to be compared with
+   year before trusting the match. */
+gint title_index_resolve(ReelApp *app, const gchar *query, gint year,
+                         gboolean tv, gboolean *check_year);
+
+#endif /* REELGTK_TITLEINDEX_H */
@@ -0,0 +1,267 @@
+/*
+ * ReelGTK - TMDB Response Cache
+ * Keeps API replies on disk so repeated searches and detail lookups skip
+ * the network
+ */
+
+#include "tmdbcache.h"
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define TMDB_CACHE_DIR "tmdb"
+
+/* Evict down to this share of the cap, so stores don't evict one by one */
+#define TMDB_CACHE_LOW_WATER 0.9
+
+/* How long a reply is used without asking TMDB. Search results and shows
+   change as titles are added and seasons air; film details rarely do. */
+#define TTL_SEARCH (1 * 24 * 3600)
+#define TTL_SHOW (1 * 24 * 3600)
+#define TTL_SEASON (3 * 24 * 3600)
+#define TTL_MOVIE (7 * 24 * 3600)
+
+/* Each file is one line of "<fetched unix time>\t<etag>" and the body */
+
+static GMutex cache_lock;
+static gint64 cache_bytes = -1; /* Total file size, -1 until counted */
+
+static gint stat_hits;
+static gint stat_revalidated;
+static gint stat_misses;
+
+static gint64 cache_max_bytes(ReelApp *app) {
+  return (gint64)app->tmdb_cache_mb * 1024 * 1024;
+}
+
+static gchar *cache_dir(ReelApp *app) {
+  return g_build_filename(app->cache_path, TMDB_CACHE_DIR, NULL);
+}
+
+/* The URL without its api_key parameter, so a changed key keeps the cache */
+static gchar *cache_key(const gchar *url) {
+  GString *key = g_string_new(NULL);
+  const gchar *query = strchr(url, '?');
+  if (!query)
+    return g_string_free(g_string_append(key, url), FALSE);
+
+  g_string_append_len(key, url, query - url);
+  gchar **params = g_strsplit(query + 1, "&", -1);
+  gchar sep = '?';
+  for (gint i = 0; params[i]; i++) {
+    if (g_str_has_prefix(params[i], "api_key="))
+      continue;
+    g_string_append_c(key, sep);
+    g_string_append(key, params[i]);
+    sep = '&';
+  }
+  g_strfreev(params);
+  return g_string_free(key, FALSE);
+}
+
+static gchar *cache_file(ReelApp *app, const gchar *url) {
+  gchar *key = cache_key(url);
+  gchar *sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, key, -1);
+  gchar *name = g_strconcat(sum, ".json", NULL);
+  gchar *dir = cache_dir(app);
+  gchar *path = g_build_filename(dir, name, NULL);
+  g_free(dir);
+  g_free(name);
+  g_free(sum);
+  g_free(key);
+  return path;
+}
+
+static gint64 cache_ttl(const gchar *url) {
+  if (strstr(url, "/search/"))
+    return TTL_SEARCH;
+  if (strstr(url, "/season/"))
+    return TTL_SEASON;
+  if (strstr(url, "/tv/"))
+    return TTL_SHOW;
+  if (strstr(url, "/movie/"))
+    return TTL_MOVIE;
+  return TTL_SEARCH;
+}
+
+typedef struct {
+  gchar *path;
+  gint64 size;
+  gint64 used; /* mtime, bumped on every hit */
+} CacheFile;
+
+static gint cache_file_compare(gconstpointer a, gconstpointer b) {
+  const CacheFile *fa = a;
+  const CacheFile *fb = b;
+  if (fa->used != fb->used)
+    return fa->used < fb->used ? -1 : 1;
+  return 0;
+}
+
+/* List the cache files; called with cache_lock held */
+static GArray *cache_list(ReelApp *app, gint64 *total) {
+  GArray *files = g_array_new(FALSE, FALSE, sizeof(CacheFile));
+  *total = 0;
+
+  gchar *dir_path = cache_dir(app);
+  GDir *dir = g_dir_open(dir_path, 0, NULL);
+  if (dir) {
+    const gchar *name;
+    while ((name = g_dir_read_name(dir))) {
+      if (!g_str_has_suffix(name, ".json"))
+        continue;
+      gchar *path = g_build_filename(dir_path, name, NULL);
+      GStatBuf st;
+      if (g_stat(path, &st) != 0) {
+        g_free(path);
+        continue;
+      }
+      CacheFile f = {path, st.st_size, st.st_mtime};
+      g_array_append_val(files, f);
+      *total += st.st_size;
+    }
+    g_dir_close(dir);
+  }
+  g_free(dir_path);
+  return files;
+}
+
+static void cache_list_free(GArray *files) {
+  for (guint i = 0; i < files->len; i++)
+    g_free(g_array_index(files, CacheFile, i).path);
+  g_array_free(files, TRUE);
+}
+
+/* Drop least recently used files until the cache fits; cache_lock held */
+static void cache_evict(ReelApp *app) {
+  gint64 max = cache_max_bytes(app);
+  if (cache_bytes >= 0 && cache_bytes <= max)
+    return;
+
+  gint64 total;
+  GArray *files = cache_list(app, &total);
+  cache_bytes = total;
+
+  if (total > max) {
+    gint64 target = (gint64)(max * TMDB_CACHE_LOW_WATER);
+    g_array_sort(files, cache_file_compare);
+    for (guint i = 0; i < files->len && cache_bytes > target; i++) {
+      CacheFile *f = &g_array_index(files, CacheFile, i);
+      if (g_unlink(f->path) == 0)
+        cache_bytes -= f->size;
+    }
+  }
+  cache_list_free(files);
+}
+
+static gboolean cache_parse(gchar *contents, gsize length,
+                            TmdbCacheEntry *entry, gint64 *fetched) {
+  gchar *nl = memchr(contents, '\n', length);
+  if (!nl)
+    return FALSE;
+  *nl = '\0';
+
+  gchar *tab = strchr(contents, '\t');
+  if (!tab)
+    return FALSE;
+  *tab = '\0';
+
+  *fetched = g_ascii_strtoll(contents, NULL, 10);
+  entry->etag = *(tab + 1) ? g_strdup(tab + 1) : NULL;
+  entry->length = length - (nl + 1 - contents);
+  entry->body = g_malloc(entry->length + 1);
+  memcpy(entry->body, nl + 1, entry->length);
+  entry->body[entry->length] = '\0';
+  return TRUE;
+}
+
+gboolean tmdb_cache_lookup(ReelApp *app, const gchar *url,
+                           TmdbCacheEntry *entry) {
+  memset(entry, 0, sizeof(*entry));
+  if (app->tmdb_cache_mb <= 0 || !app->cache_path)
+    return FALSE;
+
+  gchar *path = cache_file(app, url);
+  gchar *contents = NULL;
+  gsize length = 0;
+  gint64 fetched = 0;
+  gboolean found = g_file_get_contents(path, &contents, &length, NULL) &&
+                   cache_parse(contents, length, entry, &fetched);
+  g_free(contents);
+
+  if (found) {
+    gint64 age = g_get_real_time() / G_USEC_PER_SEC - fetched;
+    entry->fresh = age >= 0 && age < cache_ttl(url);
+    if (entry->fresh) {
+      g_atomic_int_inc(&stat_hits);
+      /* Mark as recently used for eviction */
+      g_utime(path, NULL);
+    }
+  } else {
+    tmdb_cache_entry_clear(entry);
+  }
+
+  g_free(path);
+  return found;
+}
+
+static void cache_write(ReelApp *app, const gchar *url, const gchar *body,
+                        gsize length, const gchar *etag) {
+  gchar *dir = cache_dir(app);
+  if (g_mkdir_with_parents(dir, 0755) != 0) {
+    g_printerr("Failed to create TMDB cache: %s\n", dir);
+    g_free(dir);
+    return;
+  }
+  g_free(dir);
+
+  GString *data = g_string_sized_new(length + 64);
+  g_string_append_printf(data, "%" G_GINT64_FORMAT "\t%s\n",
+                         g_get_real_time() / G_USEC_PER_SEC,
+                         etag ? etag : "");
+  g_string_append_len(data, body, length);
+
+  gchar *path = cache_file(app, url);
+
+  g_mutex_lock(&cache_lock);
+  GStatBuf old;
+  gint64 old_size = g_stat(path, &old) == 0 ? old.st_size : 0;
+  if (g_file_set_contents(path, data->str, data->len, NULL)) {
+    if (cache_bytes >= 0)
+      cache_bytes += (gint64)data->len - old_size;
+    cache_evict(app);
+  }
+  g_mutex_unlock(&cache_lock);
+
+  g_free(path);
+  g_string_free(data, TRUE);
+}
+
+void tmdb_cache_store(ReelApp *app, const gchar *url, const gchar *body,
+                      gsize length, const gchar *etag) {
+  if (app->tmdb_cache_mb <= 0 || !app->cache_path || !body)
+    return;
+  cache_write(app, url, body, length, etag);
+}
+
+void tmdb_cache_revalidated(ReelApp *app, const gchar *url,
+                            const TmdbCacheEntry *entry) {
+  g_atomic_int_inc(&stat_revalidated);
+  if (app->tmdb_cache_mb <= 0 || !app->cache_path)
+    return;
+  cache_write(app, url, entry->body, entry->length, entry->etag);
+}
+
+void tmdb_cache_miss(void) { g_atomic_int_inc(&stat_misses); }
+
+void tmdb_cache_entry_clear(TmdbCacheEntry *entry) {
+  g_free(entry->body);
+  g_free(entry->etag);
+  memset(entry, 0, sizeof(*entry));
+}
+
+void tmdb_cache_stats(TmdbCacheStats *stats) {
+  stats->hits = g_atomic_int_get(&stat_hits);
+  stats->revalidated = g_atomic_int_get(&stat_revalidated);
+  stats->misses = g_atomic_int_get(&stat_misses);
+}
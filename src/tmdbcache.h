@@ -0,0 +1,43 @@
+#ifndef REELGTK_TMDBCACHE_H
+#define REELGTK_TMDBCACHE_H
+
+#include "app.h"
+
+/* A cached TMDB API reply */
+typedef struct {
+  gchar *body;
+  gsize length;
+  gchar *etag;    /* NULL if the server sent none */
+  gboolean fresh; /* Still within the TTL for its endpoint */
+} TmdbCacheEntry;
+
+typedef struct {
+  gint hits;        /* Fresh entries served without a request */
+  gint revalidated; /* Stale entries confirmed with 304 Not Modified */
+  gint misses;      /* Requests that had to fetch a full reply */
+} TmdbCacheStats;
+
+/* Look up the reply to url, keyed without its api_key. Returns FALSE when
+   nothing is cached or caching is off; otherwise entry is filled and must be
+   cleared. A fresh hit also counts as most recently used. */
+gboolean tmdb_cache_lookup(ReelApp *app, const gchar *url,
+                           TmdbCacheEntry *entry);
+
+/* Store a full reply, evicting least recently used entries over the size
+   cap */
+void tmdb_cache_store(ReelApp *app, const gchar *url, const gchar *body,
+                      gsize length, const gchar *etag);
+
+/* A stale entry was confirmed unchanged: restart its TTL */
+void tmdb_cache_revalidated(ReelApp *app, const gchar *url,
+                            const TmdbCacheEntry *entry);
+
+/* Count a request that found no usable entry */
+void tmdb_cache_miss(void);
+
+void tmdb_cache_entry_clear(TmdbCacheEntry *entry);
+
+/* Counters since startup */
+void tmdb_cache_stats(TmdbCacheStats *stats);
+
+#endif /* REELGTK_TMDBCACHE_H */
@@ -0,0 +1,716 @@
+/*
+ * ReelGTK - Streaming TMDB Reply Parser
+ * Parses API replies as they download and builds JSON objects only for the
+ * members the scraper reads
+ */
+
+#include "tmdbjson.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Schemas
+
+   A schema is a list of member paths. Segments are separated by '.', a
+   trailing '*' matches every member starting with the rest, and a segment
+   naming an array says which elements to keep: "[]" all of them, "[N]" the
+   first N, "[key=value]" those whose key member is the string value. The
+   last segment of a path is kept whole. */
+
+typedef struct _FieldNode FieldNode;
+struct _FieldNode {
+  gchar *key;
+  gboolean prefix;      /* key matches as a prefix */
+  GPtrArray *members;   /* FieldNode* kept when the value is an object */
+  FieldNode *element;   /* Kept elements when the value is an array */
+  gint limit;           /* Only the first limit elements, 0 for all */
+  gchar *match_key;     /* Only elements whose match_key member */
+  gchar *match_value;   /* is this string */
+};
+
+struct _TmdbJsonSchema {
+  const gchar *const *paths;
+  GOnce once;
+};
+
+/* Keep these in step with what scraper.c reads from each reply */
+
+/* TV results use name and first_air_date */
+static const gchar *const SEARCH_FIELDS[] = {
+    "results[10].id",
+    "results[10].title",
+    "results[10].name",
+    "results[10].release_date",
+    "results[10].first_air_date",
+    "results[10].poster_path",
+    "results[10].overview",
+    "results[10].vote_average",
+    NULL};
+
+static const gchar *const MOVIE_FIELDS[] = {
+    "title",
+    "release_date",
+    "runtime",
+    "overview",
+    "vote_average",
+    "imdb_id",
+    "poster_path",
+    "genres[].name",
+    "credits.cast[10].name",
+    "credits.cast[10].character",
+    "credits.cast[10].id",
+    "credits.crew[job=Director].name",
+    "credits.crew[job=Director].id",
+    NULL};
+
+/* A show with its seasons appended as "season/N" members */
+static const gchar *const SHOW_FIELDS[] = {
+    "name",
+    "overview",
+    "poster_path",
+    "first_air_date",
+    "genres[].name",
+    "season/*.name",
+    "season/*.overview",
+    "season/*.air_date",
+    "season/*.poster_path",
+    "season/*.episodes[].episode_number",
+    "season/*.episodes[].name",
+    "season/*.episodes[].overview",
+    "season/*.episodes[].runtime",
+    "season/*.episodes[].id",
+    "season/*.episodes[].air_date",
+    NULL};
+
+static TmdbJsonSchema search_schema = {SEARCH_FIELDS, G_ONCE_INIT};
+static TmdbJsonSchema movie_schema = {MOVIE_FIELDS, G_ONCE_INIT};
+static TmdbJsonSchema show_schema = {SHOW_FIELDS, G_ONCE_INIT};
+
+const TmdbJsonSchema *tmdb_json_schema_for_url(const gchar *url) {
+  if (strstr(url, "/search/"))
+    return &search_schema;
+  if (strstr(url, "/movie/"))
+    return &movie_schema;
+  if (strstr(url, "/tv/"))
+    return &show_schema;
+  return NULL;
+}
+
+static FieldNode *field_member(FieldNode *node, const gchar *key, gsize len) {
+  gboolean prefix = len > 0 && key[len - 1] == '*';
+  if (prefix)
+    len--;
+
+  if (!node->members)
+    node->members = g_ptr_array_new();
+  for (guint i = 0; i < node->members->len; i++) {
+    FieldNode *member = g_ptr_array_index(node->members, i);
+    if (member->prefix == prefix && strlen(member->key) == len &&
+        strncmp(member->key, key, len) == 0)
+      return member;
+  }
+
+  FieldNode *member = g_new0(FieldNode, 1);
+  member->key = g_strndup(key, len);
+  member->prefix = prefix;
+  g_ptr_array_add(node->members, member);
+  return member;
+}
+
+static void schema_add_path(FieldNode *root, const gchar *path) {
+  gchar **segments = g_strsplit(path, ".", -1);
+  FieldNode *node = root;
+
+  for (gint i = 0; segments[i]; i++) {
+    const gchar *segment = segments[i];
+    const gchar *bracket = strchr(segment, '[');
+    node = field_member(node, segment,
+                        bracket ? (gsize)(bracket - segment) : strlen(segment));
+    if (!bracket)
+      continue;
+
+    gchar *spec = g_strndup(bracket + 1, strcspn(bracket + 1, "]"));
+    gchar *eq = strchr(spec, '=');
+    if (eq) {
+      g_free(node->match_key);
+      g_free(node->match_value);
+      node->match_key = g_strndup(spec, eq - spec);
+      node->match_value = g_strdup(eq + 1);
+    } else if (*spec) {
+      node->limit = atoi(spec);
+    }
+    g_free(spec);
+
+    if (!node->element)
+      node->element = g_new0(FieldNode, 1);
+    /* The filter needs the member it looks at */
+    if (node->match_key)
+      field_member(node->element, node->match_key, strlen(node->match_key));
+    node = node->element;
+  }
+  g_strfreev(segments);
+}
+
+/* Schemas live for the whole process, so the tree is built once */
+static gpointer schema_compile(gpointer data) {
+  const TmdbJsonSchema *schema = data;
+  FieldNode *root = g_new0(FieldNode, 1);
+  for (gint i = 0; schema->paths[i]; i++)
+    schema_add_path(root, schema->paths[i]);
+  return root;
+}
+
+static const FieldNode *schema_root(const TmdbJsonSchema *schema) {
+  if (!schema)
+    return NULL;
+  TmdbJsonSchema *s = (TmdbJsonSchema *)schema;
+  return g_once(&s->once, schema_compile, s);
+}
+
+/* NULL, or a node with nothing below it, keeps the whole value */
+static gboolean field_is_leaf(const FieldNode *node) {
+  return !node || (!node->members && !node->element);
+}
+
+static const FieldNode *field_lookup(const FieldNode *node, const gchar *key) {
+  if (!node->members)
+    return NULL;
+  for (guint i = 0; i < node->members->len; i++) {
+    const FieldNode *member = g_ptr_array_index(node->members, i);
+    if (member->prefix ? g_str_has_prefix(key, member->key)
+                       : strcmp(key, member->key) == 0)
+      return member;
+  }
+  return NULL;
+}
+
+static gboolean field_element_matches(const FieldNode *array,
+                                      struct json_object *element) {
+  struct json_object *val = NULL;
+  if (!json_object_is_type(element, json_type_object) ||
+      !json_object_object_get_ex(element, array->match_key, &val))
+    return FALSE;
+  return g_strcmp0(json_object_get_string(val), array->match_value) == 0;
+}
+
+/* Parser
+
+   The tokenizer keeps a token that is split between two pieces in text and
+   carries on with the next piece. Skipped containers are only counted
+   through, without tracking their members. */
+
+typedef enum {
+  EXPECT_VALUE,
+  EXPECT_FIRST_VALUE, /* After '[': a value or ']' */
+  EXPECT_FIRST_KEY,   /* After '{': a key or '}' */
+  EXPECT_KEY,
+  EXPECT_COLON,
+  EXPECT_NEXT,        /* ',' or the end of the container */
+  EXPECT_END          /* The reply is complete */
+} Expect;
+
+typedef enum {
+  TOKEN_NONE,
+  TOKEN_STRING,
+  TOKEN_NUMBER,
+  TOKEN_LITERAL
+} Token;
+
+/* A container being built */
+typedef struct {
+  const FieldNode *node;     /* NULL keeps everything below */
+  struct json_object *value;
+  gboolean array;
+  gint count;                /* Elements seen so far */
+  gchar *key;                /* Member whose value comes next */
+} Frame;
+
+struct _TmdbJsonParser {
+  const FieldNode *root;
+  GArray *frames;            /* Frame */
+  Expect expect;
+  gboolean failed;
+  struct json_object *result;
+
+  /* The value about to be read */
+  gboolean keep;
+  const FieldNode *target;
+  gint skip_depth;           /* Inside a skipped container */
+
+  /* The token in progress */
+  Token token;
+  gboolean key_token;
+  gboolean store;            /* Its text is needed */
+  GString *text;
+  gint escape;               /* 1 after '\', 2-5 reading \u digits */
+  gunichar unicode;
+  gunichar high_surrogate;
+
+  TmdbJsonStats stats;
+};
+
+TmdbJsonParser *tmdb_json_parser_new(const TmdbJsonSchema *schema) {
+  TmdbJsonParser *p = g_new0(TmdbJsonParser, 1);
+  p->root = schema_root(schema);
+  p->frames = g_array_new(FALSE, FALSE, sizeof(Frame));
+  p->expect = EXPECT_VALUE;
+  p->text = g_string_sized_new(64);
+  return p;
+}
+
+void tmdb_json_parser_free(TmdbJsonParser *p) {
+  if (!p)
+    return;
+  for (guint i = 0; i < p->frames->len; i++) {
+    Frame *frame = &g_array_index(p->frames, Frame, i);
+    json_object_put(frame->value);
+    g_free(frame->key);
+  }
+  g_array_free(p->frames, TRUE);
+  if (p->result)
+    json_object_put(p->result);
+  g_string_free(p->text, TRUE);
+  g_free(p);
+}
+
+static Frame *frame_top(TmdbJsonParser *p) {
+  if (p->frames->len == 0)
+    return NULL;
+  return &g_array_index(p->frames, Frame, p->frames->len - 1);
+}
+
+/* A value is complete; kept values are added to their container */
+static void value_done(TmdbJsonParser *p, struct json_object *value,
+                       gboolean kept) {
+  Frame *parent = frame_top(p);
+  if (!parent) {
+    p->result = value;
+    p->expect = EXPECT_END;
+    return;
+  }
+
+  if (kept) {
+    if (!parent->array)
+      json_object_object_add(parent->value, parent->key, value);
+    else if (parent->node && parent->node->match_key &&
+             !field_element_matches(parent->node, value))
+      json_object_put(value);
+    else
+      json_object_array_add(parent->value, value);
+  }
+  g_clear_pointer(&parent->key, g_free);
+  p->expect = EXPECT_NEXT;
+}
+
+/* Decide whether the next array element or the reply itself is kept; object
+   members were decided by their key */
+static void value_target(TmdbJsonParser *p) {
+  Frame *top = frame_top(p);
+  if (!top) {
+    p->keep = TRUE;
+    p->target = p->root;
+    return;
+  }
+  if (!top->array)
+    return;
+
+  gint index = top->count++;
+  if (!top->node) {
+    p->keep = TRUE;
+    p->target = NULL;
+    return;
+  }
+  p->keep = top->node->limit == 0 || index < top->node->limit;
+  p->target = top->node->element;
+}
+
+static void key_done(TmdbJsonParser *p) {
+  Frame *top = frame_top(p);
+  top->key = g_strndup(p->text->str, p->text->len);
+  if (!top->node) {
+    p->keep = TRUE;
+    p->target = NULL;
+  } else {
+    p->target = field_lookup(top->node, top->key);
+    p->keep = p->target != NULL;
+  }
+  p->expect = EXPECT_COLON;
+}
+
+static void token_begin(TmdbJsonParser *p, Token token, gboolean store) {
+  p->token = token;
+  p->key_token = FALSE;
+  p->store = store;
+  p->escape = 0;
+  p->high_surrogate = 0;
+  g_string_truncate(p->text, 0);
+}
+
+static void string_done(TmdbJsonParser *p) {
+  p->token = TOKEN_NONE;
+  if (p->store && p->high_surrogate)
+    g_string_append_unichar(p->text, 0xFFFD);
+  if (p->skip_depth > 0)
+    return;
+  if (p->key_token) {
+    key_done(p);
+    return;
+  }
+
+  struct json_object *value = NULL;
+  if (p->keep) {
+    value = json_object_new_string_len(p->text->str, (int)p->text->len);
+    p->stats.values++;
+  }
+  value_done(p, value, p->keep);
+}
+
+static void number_done(TmdbJsonParser *p) {
+  p->token = TOKEN_NONE;
+  if (!p->keep) {
+    value_done(p, NULL, FALSE);
+    return;
+  }
+
+  const gchar *text = p->text->str;
+  gchar *end = NULL;
+  struct json_object *value;
+  if (strpbrk(text, ".eE"))
+    value = json_object_new_double_s(g_ascii_strtod(text, &end), text);
+  else
+    value = json_object_new_int64(g_ascii_strtoll(text, &end, 10));
+  if (end == text || *end != '\0') {
+    json_object_put(value);
+    p->failed = TRUE;
+    return;
+  }
+  p->stats.values++;
+  value_done(p, value, TRUE);
+}
+
+static void literal_done(TmdbJsonParser *p) {
+  p->token = TOKEN_NONE;
+  struct json_object *value = NULL;
+  if (strcmp(p->text->str, "true") == 0) {
+    if (p->keep)
+      value = json_object_new_boolean(TRUE);
+  } else if (strcmp(p->text->str, "false") == 0) {
+    if (p->keep)
+      value = json_object_new_boolean(FALSE);
+  } else if (strcmp(p->text->str, "null") != 0) {
+    p->failed = TRUE;
+    return;
+  }
+  if (value)
+    p->stats.values++;
+  value_done(p, value, p->keep);
+}
+
+static void string_append_unicode(TmdbJsonParser *p) {
+  gunichar c = p->unicode;
+  if (c >= 0xD800 && c <= 0xDBFF) {
+    if (p->store && p->high_surrogate)
+      g_string_append_unichar(p->text, 0xFFFD);
+    p->high_surrogate = c;
+    return;
+  }
+  if (!p->store) {
+    p->high_surrogate = 0;
+    return;
+  }
+  if (c >= 0xDC00 && c <= 0xDFFF) {
+    if (p->high_surrogate)
+      c = 0x10000 + ((p->high_surrogate - 0xD800) << 10) + (c - 0xDC00);
+    else
+      c = 0xFFFD;
+  } else if (p->high_surrogate) {
+    g_string_append_unichar(p->text, 0xFFFD);
+  }
+  p->high_surrogate = 0;
+  g_string_append_unichar(p->text, c);
+}
+
+static gsize lex_string(TmdbJsonParser *p, const gchar *data, gsize i,
+                        gsize length) {
+  while (i < length) {
+    if (p->escape == 0) {
+      gsize start = i;
+      while (i < length && data[i] != '"' && data[i] != '\\')
+        i++;
+      if (p->store && i > start) {
+        if (p->high_surrogate) {
+          g_string_append_unichar(p->text, 0xFFFD);
+          p->high_surrogate = 0;
+        }
+        g_string_append_len(p->text, data + start, i - start);
+      }
+      if (i == length)
+        return i;
+      if (data[i++] == '"') {
+        string_done(p);
+        return i;
+      }
+      p->escape = 1;
+      continue;
+    }
+
+    gchar c = data[i++];
+    if (p->escape == 1) {
+      gchar unescaped;
+      switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        unescaped = c;
+        break;
+      case 'b':
+        unescaped = '\b';
+        break;
+      case 'f':
+        unescaped = '\f';
+        break;
+      case 'n':
+        unescaped = '\n';
+        break;
+      case 'r':
+        unescaped = '\r';
+        break;
+      case 't':
+        unescaped = '\t';
+        break;
+      case 'u':
+        p->escape = 2;
+        p->unicode = 0;
+        continue;
+      default:
+        p->failed = TRUE;
+        return length;
+      }
+      if (p->store) {
+        if (p->high_surrogate) {
+          g_string_append_unichar(p->text, 0xFFFD);
+          p->high_surrogate = 0;
+        }
+        g_string_append_c(p->text, unescaped);
+      }
+      p->escape = 0;
+      continue;
+    }
+
+    gint digit = g_ascii_xdigit_value(c);
+    if (digit < 0) {
+      p->failed = TRUE;
+      return length;
+    }
+    p->unicode = (p->unicode << 4) | (gunichar)digit;
+    if (++p->escape < 6)
+      continue;
+    p->escape = 0;
+    string_append_unicode(p);
+  }
+  return i;
+}
+
+static gboolean is_number_char(gchar c) {
+  return g_ascii_isdigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' ||
+         c == 'E';
+}
+
+/* Numbers and literals end at the first character not in them, which is
+   left for the parser */
+static gsize lex_number(TmdbJsonParser *p, const gchar *data, gsize i,
+                        gsize length) {
+  gsize start = i;
+  while (i < length && is_number_char(data[i]))
+    i++;
+  if (p->store)
+    g_string_append_len(p->text, data + start, i - start);
+  if (i < length)
+    number_done(p);
+  return i;
+}
+
+static gsize lex_literal(TmdbJsonParser *p, const gchar *data, gsize i,
+                         gsize length) {
+  gsize start = i;
+  while (i < length && g_ascii_isalpha(data[i]))
+    i++;
+  g_string_append_len(p->text, data + start, i - start);
+  if (p->text->len > 5) {
+    p->failed = TRUE;
+    return length;
+  }
+  if (i < length)
+    literal_done(p);
+  return i;
+}
+
+static void value_begin(TmdbJsonParser *p, gchar c) {
+  value_target(p);
+
+  if (c == '{' || c == '[') {
+    gboolean array = c == '[';
+    const FieldNode *node = field_is_leaf(p->target) ? NULL : p->target;
+    /* A container where the schema expects the other kind is dropped */
+    if (node && !(array ? node->element != NULL : node->members != NULL))
+      p->keep = FALSE;
+    if (!p->keep) {
+      p->skip_depth = 1;
+      p->stats.skipped++;
+      return;
+    }
+
+    Frame frame = {node,
+                   array ? json_object_new_array() : json_object_new_object(),
+                   array, 0, NULL};
+    p->stats.values++;
+    g_array_append_val(p->frames, frame);
+    p->expect = array ? EXPECT_FIRST_VALUE : EXPECT_FIRST_KEY;
+    return;
+  }
+
+  if (!p->keep)
+    p->stats.skipped++;
+  if (c == '"') {
+    token_begin(p, TOKEN_STRING, p->keep);
+  } else if (c == '-' || g_ascii_isdigit(c)) {
+    token_begin(p, TOKEN_NUMBER, p->keep);
+    if (p->store)
+      g_string_append_c(p->text, c);
+  } else if (c == 't' || c == 'f' || c == 'n') {
+    token_begin(p, TOKEN_LITERAL, TRUE);
+    g_string_append_c(p->text, c);
+  } else {
+    p->failed = TRUE;
+  }
+}
+
+static void container_end(TmdbJsonParser *p) {
+  Frame frame = *frame_top(p);
+  g_array_set_size(p->frames, p->frames->len - 1);
+  g_free(frame.key);
+  value_done(p, frame.value, TRUE);
+}
+
+static void parse_char(TmdbJsonParser *p, gchar c) {
+  if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+    return;
+
+  switch (p->expect) {
+  case EXPECT_FIRST_VALUE:
+    if (c == ']') {
+      container_end(p);
+      return;
+    }
+    /* fall through */
+  case EXPECT_VALUE:
+    value_begin(p, c);
+    return;
+
+  case EXPECT_FIRST_KEY:
+    if (c == '}') {
+      container_end(p);
+      return;
+    }
+    /* fall through */
+  case EXPECT_KEY:
+    if (c != '"')
+      break;
+    token_begin(p, TOKEN_STRING, TRUE);
+    p->key_token = TRUE;
+    return;
+
+  case EXPECT_COLON:
+    if (c != ':')
+      break;
+    p->expect = EXPECT_VALUE;
+    return;
+
+  case EXPECT_NEXT: {
+    Frame *top = frame_top(p);
+    if (c == ',') {
+      p->expect = top->array ? EXPECT_VALUE : EXPECT_KEY;
+      return;
+    }
+    if (c == (top->array ? ']' : '}')) {
+      container_end(p);
+      return;
+    }
+    break;
+  }
+
+  case EXPECT_END:
+    break;
+  }
+  p->failed = TRUE;
+}
+
+gboolean tmdb_json_parser_feed(TmdbJsonParser *p, const gchar *data,
+                               gsize length) {
+  gsize i = 0;
+  while (i < length && !p->failed) {
+    switch (p->token) {
+    case TOKEN_STRING:
+      i = lex_string(p, data, i, length);
+      continue;
+    case TOKEN_NUMBER:
+      i = lex_number(p, data, i, length);
+      continue;
+    case TOKEN_LITERAL:
+      i = lex_literal(p, data, i, length);
+      continue;
+    case TOKEN_NONE:
+      break;
+    }
+
+    if (p->skip_depth == 0) {
+      parse_char(p, data[i++]);
+      continue;
+    }
+
+    /* Inside a skipped container only strings and brackets matter */
+    while (i < length && data[i] != '"' && data[i] != '{' && data[i] != '}' &&
+           data[i] != '[' && data[i] != ']')
+      i++;
+    if (i == length)
+      break;
+    gchar c = data[i++];
+    if (c == '"') {
+      token_begin(p, TOKEN_STRING, FALSE);
+    } else if (c == '{' || c == '[') {
+      p->skip_depth++;
+    } else if (--p->skip_depth == 0) {
+      value_done(p, NULL, FALSE);
+    }
+  }
+  return !p->failed;
+}
+
+struct json_object *tmdb_json_parser_finish(TmdbJsonParser *p,
+                                            TmdbJsonStats *stats) {
+  /* A bare number or literal only ends with the input */
+  if (!p->failed && p->frames->len == 0) {
+    if (p->token == TOKEN_NUMBER)
+      number_done(p);
+    else if (p->token == TOKEN_LITERAL)
+      literal_done(p);
+  }
+
+  struct json_object *result = NULL;
+  if (!p->failed && p->expect == EXPECT_END && p->token == TOKEN_NONE) {
+    result = p->result;
+    p->result = NULL;
+  }
+  if (stats)
+    *stats = p->stats;
+  p->failed = TRUE;
+  return result;
+}
+
+struct json_object *tmdb_json_parse(const TmdbJsonSchema *schema,
+                                    const gchar *data, gsize length) {
+  TmdbJsonParser *p = tmdb_json_parser_new(schema);
+  tmdb_json_parser_feed(p, data, length);
+  struct json_object *root = tmdb_json_parser_finish(p, NULL);
+  tmdb_json_parser_free(p);
+  return root;
+}
@@ -0,0 +1,40 @@
+#ifndef REELGTK_TMDBJSON_H
+#define REELGTK_TMDBJSON_H
+
+#include <glib.h>
+#include <json-c/json.h>
+
+/* Which members of a TMDB reply to keep */
+typedef struct _TmdbJsonSchema TmdbJsonSchema;
+
+/* Incremental parser, fed a reply in pieces as it arrives */
+typedef struct _TmdbJsonParser TmdbJsonParser;
+
+typedef struct {
+  gint values;  /* JSON objects built for kept values */
+  gint skipped; /* Values passed over without building anything */
+} TmdbJsonStats;
+
+/* The fields the scraper reads from a reply to url, or NULL to keep
+   everything for endpoints it does not know */
+const TmdbJsonSchema *tmdb_json_schema_for_url(const gchar *url);
+
+TmdbJsonParser *tmdb_json_parser_new(const TmdbJsonSchema *schema);
+
+/* Parse the next piece of the reply. Returns FALSE once the input is not
+   valid JSON; later pieces are then ignored. */
+gboolean tmdb_json_parser_feed(TmdbJsonParser *parser, const gchar *data,
+                               gsize length);
+
+/* The kept part of a complete reply, or NULL if it was incomplete or
+   invalid. The parser can not be fed again afterwards. */
+struct json_object *tmdb_json_parser_finish(TmdbJsonParser *parser,
+                                            TmdbJsonStats *stats);
+
+void tmdb_json_parser_free(TmdbJsonParser *parser);
+
+/* Parse a whole reply at once */
+struct json_object *tmdb_json_parse(const TmdbJsonSchema *schema,
+                                    const gchar *data, gsize length);
+
+#endif /* REELGTK_TMDBJSON_H */
@@ -0,0 +1,698 @@
+/*
+ * ReelGTK - Mock TMDB Server
+ * Answers the scraper's API and poster requests on localhost, so scraping
+ * can be tested and timed without an API key or network access
+ */
+
+#include "tmdbmock.h"
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gio/gio.h>
+#include <json-c/json.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Connections served at once; curl keeps about one per transfer */
+#define MOCK_THREADS 64
+
+/* Generated replies are about the size of a typical film or season */
+#define MOCK_CAST 20
+#define MOCK_CREW 40
+#define MOCK_EPISODES 24
+#define MOCK_POSTER_WIDTH 500
+#define MOCK_POSTER_HEIGHT 750
+
+static const gchar *MOCK_GENRES[] = {"Action",  "Comedy",   "Drama",
+                                     "Thriller", "Science Fiction",
+                                     "Horror",  "Romance",  "Animation",
+                                     "Crime",   "Documentary"};
+
+static const gchar *MOCK_JOBS[] = {"Producer", "Screenplay", "Editor",
+                                   "Original Music Composer",
+                                   "Director of Photography", "Casting"};
+
+/* What a search answered, so the details agree with it */
+typedef struct {
+  gchar *title;
+  gint year;
+} MockTitle;
+
+struct _TmdbMock {
+  TmdbMockOptions opts;
+  gchar *fixtures;
+  GSocketService *service;
+  GCancellable *cancellable;
+  gchar *api_base;
+  gchar *image_base;
+  GBytes *poster;
+
+  GMutex lock;
+  GHashTable *titles; /* TMDB id -> MockTitle* */
+
+  gint active; /* Connections being served */
+  gint requests;
+  gint images;
+  gint errors;
+  gint throttled;
+  gint not_modified;
+  gint recorded;
+};
+
+typedef struct {
+  guint status;
+  const gchar *content_type;
+  GBytes *body;
+  gboolean retry_after;
+} MockReply;
+
+static void mock_title_free(MockTitle *title) {
+  g_free(title->title);
+  g_free(title);
+}
+
+static const gchar *mock_status_text(guint status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 304:
+    return "Not Modified";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 429:
+    return "Too Many Requests";
+  default:
+    return "Internal Server Error";
+  }
+}
+
+/* Injected failures are spread evenly, and the same on every run */
+static gboolean mock_roll(gint request, guint32 salt, gint percent) {
+  if (percent <= 0)
+    return FALSE;
+  guint32 h = (guint32)request * 2654435761u ^ salt;
+  h ^= h >> 16;
+  h *= 0x45d9f3bu;
+  h ^= h >> 16;
+  return (gint)(h % 100) < percent;
+}
+
+static GBytes *mock_json_bytes(json_object *root) {
+  const char *text = json_object_to_json_string_ext(
+      root, JSON_C_TO_STRING_PLAIN | JSON_C_TO_STRING_NOSLASHESCAPE);
+  GBytes *bytes = g_bytes_new(text, strlen(text));
+  json_object_put(root);
+  return bytes;
+}
+
+static void mock_reply_error(MockReply *reply, guint status, gint code,
+                             const gchar *message) {
+  json_object *root = json_object_new_object();
+  json_object_object_add(root, "success", json_object_new_boolean(FALSE));
+  json_object_object_add(root, "status_code", json_object_new_int(code));
+  json_object_object_add(root, "status_message",
+                         json_object_new_string(message));
+  reply->status = status;
+  reply->content_type = "application/json;charset=utf-8";
+  reply->body = mock_json_bytes(root);
+}
+
+static void mock_add_string(json_object *obj, const gchar *key,
+                            const gchar *value) {
+  json_object_object_add(obj, key, json_object_new_string(value));
+}
+
+static void mock_add_printf(json_object *obj, const gchar *key,
+                            const gchar *format, ...) G_GNUC_PRINTF(3, 4);
+
+static void mock_add_printf(json_object *obj, const gchar *key,
+                            const gchar *format, ...) {
+  va_list args;
+  va_start(args, format);
+  gchar *value = g_strdup_vprintf(format, args);
+  va_end(args);
+  mock_add_string(obj, key, value);
+  g_free(value);
+}
+
+static json_object *mock_genres(gint id) {
+  json_object *genres = json_object_new_array();
+  for (gint i = 0; i < 2; i++) {
+    gint pick = (id / (i + 1) + i * 3) % (gint)G_N_ELEMENTS(MOCK_GENRES);
+    json_object *genre = json_object_new_object();
+    json_object_object_add(genre, "id", json_object_new_int(pick + 1));
+    mock_add_string(genre, "name", MOCK_GENRES[pick]);
+    json_object_array_add(genres, genre);
+  }
+  return genres;
+}
+
+static void mock_remember(TmdbMock *mock, gint id, const gchar *title,
+                          gint year) {
+  MockTitle *entry = g_new0(MockTitle, 1);
+  entry->title = g_strdup(title);
+  entry->year = year;
+  g_mutex_lock(&mock->lock);
+  g_hash_table_replace(mock->titles, GINT_TO_POINTER(id), entry);
+  g_mutex_unlock(&mock->lock);
+}
+
+/* The title and year a search gave for id; made up if it was never
+   searched for */
+static gchar *mock_recall(TmdbMock *mock, gint id, const gchar *fallback,
+                          gint *year) {
+  gchar *title = NULL;
+  g_mutex_lock(&mock->lock);
+  MockTitle *entry = g_hash_table_lookup(mock->titles, GINT_TO_POINTER(id));
+  if (entry) {
+    title = g_strdup(entry->title);
+    *year = entry->year;
+  }
+  g_mutex_unlock(&mock->lock);
+  if (!title) {
+    title = g_strdup_printf("%s %d", fallback, id);
+    *year = 1950 + id % 75;
+  }
+  return title;
+}
+
+/* One result per query, or none for the share set by miss_percent */
+static json_object *mock_search(TmdbMock *mock, const gchar *query,
+                                gint year, gboolean tv) {
+  json_object *root = json_object_new_object();
+  json_object *results = json_object_new_array();
+
+  gchar *key = g_utf8_strdown(query, -1);
+  guint hash = g_str_hash(key);
+  g_free(key);
+
+  if ((gint)((hash >> 20) % 100) >= mock->opts.miss_percent) {
+    gint id = (gint)(hash % 900000) + 1000;
+    if (year <= 0)
+      year = 1950 + (gint)(hash % 75);
+    mock_remember(mock, id, query, year);
+
+    json_object *item = json_object_new_object();
+    json_object_object_add(item, "id", json_object_new_int(id));
+    mock_add_string(item, tv ? "name" : "title", query);
+    mock_add_string(item, tv ? "original_name" : "original_title", query);
+    mock_add_printf(item, tv ? "first_air_date" : "release_date",
+                    "%04d-%02d-%02d", year, 1 + id % 12, 1 + id % 28);
+    mock_add_printf(item, "poster_path", "/%c%d.jpg", tv ? 't' : 'm', id);
+    mock_add_printf(item, "overview", "Generated %s result for \"%s\".",
+                    tv ? "TV" : "film", query);
+    json_object_object_add(item, "vote_average",
+                           json_object_new_double((id % 90) / 10.0));
+    json_object_object_add(item, "popularity",
+                           json_object_new_double((id % 1000) / 7.0));
+    json_object_array_add(results, item);
+  }
+
+  json_object_object_add(root, "page", json_object_new_int(1));
+  json_object_object_add(
+      root, "total_results",
+      json_object_new_int((gint)json_object_array_length(results)));
+  json_object_object_add(root, "total_pages", json_object_new_int(1));
+  json_object_object_add(root, "results", results);
+  return root;
+}
+
+static json_object *mock_movie(TmdbMock *mock, gint id) {
+  gint year = 0;
+  gchar *title = mock_recall(mock, id, "Film", &year);
+
+  json_object *root = json_object_new_object();
+  json_object_object_add(root, "id", json_object_new_int(id));
+  mock_add_string(root, "title", title);
+  mock_add_string(root, "original_title", title);
+  mock_add_printf(root, "release_date", "%04d-%02d-%02d", year, 1 + id % 12,
+                  1 + id % 28);
+  json_object_object_add(root, "runtime", json_object_new_int(80 + id % 70));
+  mock_add_printf(root, "overview", "Generated details for %s.", title);
+  json_object_object_add(root, "vote_average",
+                         json_object_new_double((id % 90) / 10.0));
+  mock_add_printf(root, "imdb_id", "tt%07d", id);
+  mock_add_printf(root, "poster_path", "/m%d.jpg", id);
+  json_object_object_add(root, "genres", mock_genres(id));
+  g_free(title);
+
+  json_object *cast = json_object_new_array();
+  for (gint i = 0; i < MOCK_CAST; i++) {
+    json_object *person = json_object_new_object();
+    json_object_object_add(person, "id", json_object_new_int(id + i));
+    mock_add_printf(person, "name", "Actor %d", (id + i) % 5000);
+    mock_add_printf(person, "character", "Role %d", i + 1);
+    json_object_object_add(person, "order", json_object_new_int(i));
+    json_object_array_add(cast, person);
+  }
+
+  /* Real crew lists are long and mostly not directors */
+  json_object *crew = json_object_new_array();
+  for (gint i = 0; i < MOCK_CREW; i++) {
+    json_object *person = json_object_new_object();
+    json_object_object_add(person, "id", json_object_new_int(id + 1000 + i));
+    mock_add_printf(person, "name", "Crew %d", (id + i) % 5000);
+    mock_add_string(person, "job",
+                    i == MOCK_CREW / 2
+                        ? "Director"
+                        : MOCK_JOBS[i % (gint)G_N_ELEMENTS(MOCK_JOBS)]);
+    mock_add_string(person, "department",
+                    i == MOCK_CREW / 2 ? "Directing" : "Production");
+    json_object_array_add(crew, person);
+  }
+
+  json_object *credits = json_object_new_object();
+  json_object_object_add(credits, "cast", cast);
+  json_object_object_add(credits, "crew", crew);
+  json_object_object_add(root, "credits", credits);
+  return root;
+}
+
+static json_object *mock_season(gint show_id, gint season, gint year) {
+  json_object *root = json_object_new_object();
+  json_object_object_add(root, "id", json_object_new_int(show_id + season));
+  if (season == 0)
+    mock_add_string(root, "name", "Specials");
+  else
+    mock_add_printf(root, "name", "Season %d", season);
+  mock_add_printf(root, "overview", "Generated season %d.", season);
+  mock_add_printf(root, "air_date", "%04d-09-01", year + MAX(season - 1, 0));
+  json_object_object_add(root, "season_number", json_object_new_int(season));
+  mock_add_printf(root, "poster_path", "/t%d-%d.jpg", show_id, season);
+
+  json_object *episodes = json_object_new_array();
+  for (gint ep = 1; ep <= MOCK_EPISODES; ep++) {
+    json_object *episode = json_object_new_object();
+    json_object_object_add(episode, "id",
+                           json_object_new_int(show_id * 10 + season * 100 +
+                                               ep));
+    json_object_object_add(episode, "episode_number",
+                           json_object_new_int(ep));
+    json_object_object_add(episode, "season_number",
+                           json_object_new_int(season));
+    mock_add_printf(episode, "name", "Episode %d", ep);
+    mock_add_printf(episode, "overview", "Generated episode %d of season %d.",
+                    ep, season);
+    json_object_object_add(episode, "runtime", json_object_new_int(45));
+    mock_add_printf(episode, "air_date", "%04d-09-%02d",
+                    year + MAX(season - 1, 0), MIN(ep, 28));
+    json_object_array_add(episodes, episode);
+  }
+  json_object_object_add(root, "episodes", episodes);
+  return root;
+}
+
+/* A show with its seasons appended as "season/N" members, like
+   append_to_response=season/1,season/2 */
+static json_object *mock_show(TmdbMock *mock, gint id, const gchar *append) {
+  gint year = 0;
+  gchar *name = mock_recall(mock, id, "Show", &year);
+
+  json_object *root = json_object_new_object();
+  json_object_object_add(root, "id", json_object_new_int(id));
+  mock_add_string(root, "name", name);
+  mock_add_string(root, "original_name", name);
+  mock_add_printf(root, "overview", "Generated show %s.", name);
+  mock_add_printf(root, "first_air_date", "%04d-09-01", year);
+  mock_add_printf(root, "poster_path", "/t%d.jpg", id);
+  json_object_object_add(root, "genres", mock_genres(id));
+  json_object_object_add(root, "number_of_seasons", json_object_new_int(10));
+  g_free(name);
+
+  gchar **parts = g_strsplit(append ? append : "", ",", -1);
+  for (gint i = 0; parts[i]; i++) {
+    gint season = 0;
+    if (sscanf(parts[i], "season/%d", &season) == 1)
+      json_object_object_add(root, parts[i], mock_season(id, season, year));
+  }
+  g_strfreev(parts);
+  return root;
+}
+
+static GHashTable *mock_params(const gchar *query) {
+  GHashTable *params =
+      g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+  gchar **pairs = g_strsplit(query ? query : "", "&", -1);
+  for (gint i = 0; pairs[i]; i++) {
+    gchar *eq = strchr(pairs[i], '=');
+    if (!eq)
+      continue;
+    *eq = '\0';
+    gchar *value = g_uri_unescape_string(eq + 1, NULL);
+    if (value)
+      g_hash_table_replace(params, g_strdup(pairs[i]), value);
+  }
+  g_strfreev(pairs);
+  return params;
+}
+
+/* path is below /3/, e.g. "movie/550" */
+static void mock_api_reply(TmdbMock *mock, const gchar *path,
+                           GHashTable *params, MockReply *reply) {
+  gchar **parts = g_strsplit(path, "/", -1);
+  guint n = g_strv_length(parts);
+  json_object *root = NULL;
+
+  if (n == 2 && strcmp(parts[0], "search") == 0 &&
+      (strcmp(parts[1], "movie") == 0 || strcmp(parts[1], "tv") == 0)) {
+    gboolean search_tv = strcmp(parts[1], "tv") == 0;
+    const gchar *query = g_hash_table_lookup(params, "query");
+    const gchar *year = g_hash_table_lookup(
+        params, search_tv ? "first_air_date_year" : "year");
+    root = mock_search(mock, query ? query : "", year ? atoi(year) : 0,
+                       search_tv);
+  } else if (n == 2 && strcmp(parts[0], "movie") == 0) {
+    root = mock_movie(mock, atoi(parts[1]));
+  } else if (n == 2 && strcmp(parts[0], "tv") == 0) {
+    root = mock_show(mock, atoi(parts[1]),
+                     g_hash_table_lookup(params, "append_to_response"));
+  } else if (n == 4 && strcmp(parts[0], "tv") == 0 &&
+             strcmp(parts[2], "season") == 0) {
+    gint year = 0;
+    g_free(mock_recall(mock, atoi(parts[1]), "Show", &year));
+    root = mock_season(atoi(parts[1]), atoi(parts[3]), year);
+  }
+  g_strfreev(parts);
+
+  if (!root) {
+    mock_reply_error(reply, 404, 34,
+                     "The resource you requested could not be found.");
+    return;
+  }
+  reply->status = 200;
+  reply->content_type = "application/json;charset=utf-8";
+  reply->body = mock_json_bytes(root);
+}
+
+/* The recorded reply for a request: "movie-550.json", "tv-1399.json",
+   "tv-1399-season-1.json", "search-movie-alien.json", or an image's own
+   file name */
+static gchar *mock_fixture_name(const gchar *path, GHashTable *params,
+                                gboolean image) {
+  if (image)
+    return g_path_get_basename(path);
+
+  GString *name = g_string_new(path);
+  g_strdelimit(name->str, "/", '-');
+  const gchar *query = g_hash_table_lookup(params, "query");
+  if (g_str_has_prefix(name->str, "search-") && query) {
+    gchar *slug = g_ascii_strdown(query, -1);
+    g_strcanon(slug, "abcdefghijklmnopqrstuvwxyz0123456789", '-');
+    g_string_append_printf(name, "-%s", slug);
+    g_free(slug);
+  }
+  g_string_append(name, ".json");
+  return g_string_free(name, FALSE);
+}
+
+static gboolean mock_fixture(TmdbMock *mock, const gchar *path,
+                             GHashTable *params, gboolean image,
+                             MockReply *reply) {
+  if (!mock->fixtures)
+    return FALSE;
+
+  gchar *name = mock_fixture_name(path, params, image);
+  gchar *file = g_build_filename(mock->fixtures, name, NULL);
+  g_free(name);
+  gchar *data = NULL;
+  gsize length = 0;
+  gboolean found = g_file_get_contents(file, &data, &length, NULL);
+  g_free(file);
+  if (!found)
+    return FALSE;
+
+  g_atomic_int_inc(&mock->recorded);
+  reply->status = 200;
+  reply->content_type =
+      image ? "image/jpeg" : "application/json;charset=utf-8";
+  reply->body = g_bytes_new_take(data, length);
+  return TRUE;
+}
+
+static void mock_reply(TmdbMock *mock, const gchar *target,
+                       MockReply *reply) {
+  gint request = g_atomic_int_add(&mock->requests, 1) + 1;
+  if (mock->opts.latency_ms > 0)
+    g_usleep((gulong)mock->opts.latency_ms * 1000);
+
+  const gchar *query = strchr(target, '?');
+  gchar *path = query ? g_strndup(target, query - target) : g_strdup(target);
+  GHashTable *params = mock_params(query ? query + 1 : NULL);
+  gboolean image = g_str_has_prefix(path, "/t/p/");
+  gboolean api = g_str_has_prefix(path, "/3/");
+  if (image)
+    g_atomic_int_inc(&mock->images);
+
+  if (mock_roll(request, 0x5e11u, mock->opts.error_percent)) {
+    g_atomic_int_inc(&mock->errors);
+    mock_reply_error(reply, 500, 11,
+                     "Internal error: Something went wrong, contact TMDb.");
+  } else if (api && mock_roll(request, 0x429u, mock->opts.throttle_percent)) {
+    g_atomic_int_inc(&mock->throttled);
+    mock_reply_error(reply, 429, 25,
+                     "Your request count (#) is over the allowed limit.");
+    reply->retry_after = TRUE;
+  } else if (mock_fixture(mock, api ? path + 3 : path, params, image,
+                          reply)) {
+    /* Recorded reply */
+  } else if (image && mock->poster) {
+    reply->status = 200;
+    reply->content_type = "image/jpeg";
+    reply->body = g_bytes_ref(mock->poster);
+  } else if (api) {
+    mock_api_reply(mock, path + 3, params, reply);
+  } else {
+    mock_reply_error(reply, 404, 34,
+                     "The resource you requested could not be found.");
+  }
+
+  g_hash_table_unref(params);
+  g_free(path);
+}
+
+static gboolean mock_write(TmdbMock *mock, GOutputStream *out,
+                           const void *data, gsize length) {
+  return g_output_stream_write_all(out, data, length, NULL, mock->cancellable,
+                                   NULL);
+}
+
+/* Answer one request on a kept-alive connection. FALSE once it is closed. */
+static gboolean mock_serve_one(TmdbMock *mock, GDataInputStream *in,
+                               GOutputStream *out) {
+  gchar *request =
+      g_data_input_stream_read_line(in, NULL, mock->cancellable, NULL);
+  if (!request)
+    return FALSE;
+  gchar **words = g_strsplit(request, " ", 3);
+  g_free(request);
+
+  gboolean keep_alive = TRUE;
+  gchar *if_none_match = NULL;
+  gchar *line;
+  while ((line = g_data_input_stream_read_line(in, NULL, mock->cancellable,
+                                               NULL)) != NULL &&
+         *line) {
+    gchar *colon = strchr(line, ':');
+    if (colon) {
+      *colon = '\0';
+      gchar *value = g_strstrip(colon + 1);
+      if (g_ascii_strcasecmp(line, "If-None-Match") == 0) {
+        g_free(if_none_match);
+        if_none_match = g_strdup(value);
+      } else if (g_ascii_strcasecmp(line, "Connection") == 0 &&
+                 g_ascii_strcasecmp(value, "close") == 0) {
+        keep_alive = FALSE;
+      }
+    }
+    g_free(line);
+  }
+
+  if (!line) {
+    g_free(if_none_match);
+    g_strfreev(words);
+    return FALSE;
+  }
+  g_free(line);
+
+  MockReply reply = {0};
+  if (g_strv_length(words) < 2 || strcmp(words[0], "GET") != 0)
+    mock_reply_error(&reply, 405, 3, "Only GET is supported.");
+  else
+    mock_reply(mock, words[1], &reply);
+  g_strfreev(words);
+
+  /* ETags let the response cache revalidate instead of refetching */
+  gchar *etag = NULL;
+  if (reply.status == 200 && reply.body &&
+      g_str_has_prefix(reply.content_type, "application/json")) {
+    gchar *sum = g_compute_checksum_for_bytes(G_CHECKSUM_MD5, reply.body);
+    etag = g_strdup_printf("\"%s\"", sum);
+    g_free(sum);
+    if (g_strcmp0(if_none_match, etag) == 0) {
+      g_atomic_int_inc(&mock->not_modified);
+      reply.status = 304;
+      g_clear_pointer(&reply.body, g_bytes_unref);
+    }
+  }
+  g_free(if_none_match);
+
+  gsize length = 0;
+  const void *data = reply.body ? g_bytes_get_data(reply.body, &length) : NULL;
+  GString *head = g_string_new(NULL);
+  g_string_append_printf(head, "HTTP/1.1 %u %s\r\n", reply.status,
+                         mock_status_text(reply.status));
+  if (reply.body)
+    g_string_append_printf(head, "Content-Type: %s\r\n", reply.content_type);
+  g_string_append_printf(head, "Content-Length: %" G_GSIZE_FORMAT "\r\n",
+                         length);
+  if (etag)
+    g_string_append_printf(head, "ETag: %s\r\n", etag);
+  if (reply.retry_after)
+    g_string_append(head, "Retry-After: 1\r\n");
+  if (!keep_alive)
+    g_string_append(head, "Connection: close\r\n");
+  g_string_append(head, "\r\n");
+
+  gboolean ok = mock_write(mock, out, head->str, head->len) &&
+                (length == 0 || mock_write(mock, out, data, length));
+  g_string_free(head, TRUE);
+  g_free(etag);
+  if (reply.body)
+    g_bytes_unref(reply.body);
+  return ok && keep_alive;
+}
+
+/* Runs on a thread of the service for each connection */
+static gboolean mock_run(GThreadedSocketService *service,
+                         GSocketConnection *connection, GObject *source,
+                         gpointer user_data) {
+  (void)service;
+  (void)source;
+  TmdbMock *mock = (TmdbMock *)user_data;
+  g_atomic_int_inc(&mock->active);
+
+  GDataInputStream *in = g_data_input_stream_new(
+      g_io_stream_get_input_stream(G_IO_STREAM(connection)));
+  g_data_input_stream_set_newline_type(in, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+  GOutputStream *out = g_io_stream_get_output_stream(G_IO_STREAM(connection));
+  while (!g_cancellable_is_cancelled(mock->cancellable) &&
+         mock_serve_one(mock, in, out))
+    ;
+  g_object_unref(in);
+
+  g_atomic_int_add(&mock->active, -1);
+  return TRUE;
+}
+
+/* One poster for every image request, encoded once. The noise keeps it
+   close to a real poster's size. */
+static GBytes *mock_poster_new(void) {
+  GdkPixbuf *pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8,
+                                     MOCK_POSTER_WIDTH, MOCK_POSTER_HEIGHT);
+  if (!pixbuf)
+    return NULL;
+
+  guchar *pixels = gdk_pixbuf_get_pixels(pixbuf);
+  gint rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  guint32 seed = 1;
+  for (gint y = 0; y < MOCK_POSTER_HEIGHT; y++) {
+    guchar *row = pixels + y * rowstride;
+    for (gint x = 0; x < MOCK_POSTER_WIDTH; x++) {
+      seed = seed * 1103515245u + 12345u;
+      guchar noise = (guchar)(seed >> 26);
+      row[x * 3] = (guchar)(40 + y / 6 + noise);
+      row[x * 3 + 1] = (guchar)(60 + x / 8 + noise);
+      row[x * 3 + 2] = (guchar)(120 + noise);
+    }
+  }
+
+  gchar *data = NULL;
+  gsize length = 0;
+  GBytes *poster = NULL;
+  if (gdk_pixbuf_save_to_buffer(pixbuf, &data, &length, "jpeg", NULL,
+                                "quality", "85", NULL))
+    poster = g_bytes_new_take(data, length);
+  g_object_unref(pixbuf);
+  return poster;
+}
+
+TmdbMock *tmdb_mock_start(const TmdbMockOptions *opts) {
+  TmdbMock *mock = g_new0(TmdbMock, 1);
+  mock->opts = *opts;
+  mock->fixtures = g_strdup(opts->fixtures);
+  mock->opts.fixtures = mock->fixtures;
+  mock->cancellable = g_cancellable_new();
+  mock->titles = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                       (GDestroyNotify)mock_title_free);
+  g_mutex_init(&mock->lock);
+  mock->poster = mock_poster_new();
+  mock->service = g_threaded_socket_service_new(MOCK_THREADS);
+
+  GInetAddress *loopback = g_inet_address_new_loopback(G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *address =
+      g_inet_socket_address_new(loopback, (guint16)CLAMP(opts->port, 0, 65535));
+  GSocketAddress *bound = NULL;
+  GError *error = NULL;
+  gboolean ok = g_socket_listener_add_address(
+      G_SOCKET_LISTENER(mock->service), address, G_SOCKET_TYPE_STREAM,
+      G_SOCKET_PROTOCOL_TCP, NULL, &bound, &error);
+  g_object_unref(address);
+  g_object_unref(loopback);
+  if (!ok) {
+    g_printerr("Cannot open the mock TMDB server: %s\n", error->message);
+    g_error_free(error);
+    tmdb_mock_stop(mock);
+    return NULL;
+  }
+
+  guint16 port = g_inet_socket_address_get_port(G_INET_SOCKET_ADDRESS(bound));
+  g_object_unref(bound);
+  mock->api_base = g_strdup_printf("http://127.0.0.1:%u/3", port);
+  mock->image_base = g_strdup_printf("http://127.0.0.1:%u/t/p", port);
+
+  g_signal_connect(mock->service, "run", G_CALLBACK(mock_run), mock);
+  g_socket_service_start(mock->service);
+  return mock;
+}
+
+const gchar *tmdb_mock_api_base(const TmdbMock *mock) {
+  return mock->api_base;
+}
+
+const gchar *tmdb_mock_image_base(const TmdbMock *mock) {
+  return mock->image_base;
+}
+
+void tmdb_mock_stats(TmdbMock *mock, TmdbMockStats *stats) {
+  stats->requests = g_atomic_int_get(&mock->requests);
+  stats->images = g_atomic_int_get(&mock->images);
+  stats->errors = g_atomic_int_get(&mock->errors);
+  stats->throttled = g_atomic_int_get(&mock->throttled);
+  stats->not_modified = g_atomic_int_get(&mock->not_modified);
+  stats->recorded = g_atomic_int_get(&mock->recorded);
+}
+
+void tmdb_mock_stop(TmdbMock *mock) {
+  if (!mock)
+    return;
+
+  /* Wake connections idling in a read, then wait for their threads */
+  g_socket_service_stop(mock->service);
+  g_socket_listener_close(G_SOCKET_LISTENER(mock->service));
+  g_cancellable_cancel(mock->cancellable);
+  while (g_atomic_int_get(&mock->active) > 0)
+    g_usleep(1000);
+
+  g_object_unref(mock->service);
+  g_object_unref(mock->cancellable);
+  if (mock->poster)
+    g_bytes_unref(mock->poster);
+  g_hash_table_destroy(mock->titles);
+  g_mutex_clear(&mock->lock);
+  g_free(mock->api_base);
+  g_free(mock->image_base);
+  g_free(mock->fixtures);
+  g_free(mock);
+}
@@ -0,0 +1,43 @@
+#ifndef REELGTK_TMDBMOCK_H
+#define REELGTK_TMDBMOCK_H
+
+#include <glib.h>
+
+/* A stand-in for the TMDB API and image server on 127.0.0.1, for running
+   the scraper offline. Replies are generated in TMDB's shapes; recorded
+   ones can be served in their place. */
+typedef struct _TmdbMock TmdbMock;
+
+typedef struct {
+  gint port;             /* 0 picks a free one */
+  gint latency_ms;       /* Added before every reply */
+  gint error_percent;    /* Replies failed with 500 Internal Server Error */
+  gint throttle_percent; /* API replies refused with 429 and Retry-After */
+  gint miss_percent;     /* Searches that find nothing */
+  const gchar *fixtures; /* Directory of recorded replies, or NULL */
+} TmdbMockOptions;
+
+typedef struct {
+  gint requests;     /* Everything answered */
+  gint images;       /* Poster downloads among them */
+  gint errors;       /* Injected 500s */
+  gint throttled;    /* Injected 429s */
+  gint not_modified; /* 304s for a matching ETag */
+  gint recorded;     /* Replies served from the fixtures */
+} TmdbMockStats;
+
+/* Start listening. Connections are accepted from the default main context,
+   so a main loop must be running there. Returns NULL if the port can not
+   be opened. */
+TmdbMock *tmdb_mock_start(const TmdbMockOptions *opts);
+
+/* What REELVAULT_TMDB_API_BASE and REELVAULT_TMDB_IMAGE_BASE should be set
+   to for the scraper to use the mock */
+const gchar *tmdb_mock_api_base(const TmdbMock *mock);
+const gchar *tmdb_mock_image_base(const TmdbMock *mock);
+
+void tmdb_mock_stats(TmdbMock *mock, TmdbMockStats *stats);
+
+void tmdb_mock_stop(TmdbMock *mock);
+
+#endif /* REELGTK_TMDBMOCK_H */
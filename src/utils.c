@@ -27,7 +27,148 @@ static const char *STRIP_TAGS[] = {
     "extended", "unrated", "directors cut", "theatrical", "imax",   "yify",
     "yts",      "rarbg",   "ettv",          "eztv",       NULL};
 
-gchar *utils_normalize_title(const gchar *raw) {
+/* Aho-Corasick automaton over the strip tags, matched case-insensitively in
+   one pass. Only bytes that occur in some tag get their own column, which
+   keeps the transition table small. */
+struct _UtilsTagMatcher {
+  guint8 classes[256]; /* byte -> column; 0 for bytes in no tag */
+  gint columns;
+  gint states;
+  gint max_len;
+  gint *next;     /* states x columns */
+  gint *out_len;  /* length of the tag ending in this state, or 0 */
+  gint *out_link; /* nearest suffix state that ends a tag, or -1 */
+};
+
+static UtilsTagMatcher *strip_matcher = NULL;
+
+UtilsTagMatcher *utils_tag_matcher_new(const gchar *const *tags) {
+  UtilsTagMatcher *m = g_new0(UtilsTagMatcher, 1);
+  gint total_len = 0;
+
+  m->columns = 1;
+  for (gint t = 0; tags && tags[t]; t++) {
+    for (const gchar *p = tags[t]; *p; p++) {
+      guchar c = (guchar)g_ascii_tolower(*p);
+      if (!m->classes[c]) {
+        m->classes[c] = (guint8)m->columns;
+        m->classes[(guchar)g_ascii_toupper(c)] = (guint8)m->columns;
+        m->columns++;
+      }
+    }
+    gint len = (gint)strlen(tags[t]);
+    total_len += len;
+    m->max_len = MAX(m->max_len, len);
+  }
+
+  /* Build the trie */
+  gint capacity = total_len + 1;
+  m->next = g_new(gint, (gsize)capacity * m->columns);
+  for (gint i = 0; i < capacity * m->columns; i++)
+    m->next[i] = -1;
+  m->out_len = g_new0(gint, capacity);
+  m->out_link = g_new(gint, capacity);
+  m->states = 1;
+
+  for (gint t = 0; tags && tags[t]; t++) {
+    gint state = 0;
+    for (const gchar *p = tags[t]; *p; p++) {
+      gint *slot = &m->next[state * m->columns + m->classes[(guchar)*p]];
+      if (*slot < 0)
+        *slot = m->states++;
+      state = *slot;
+    }
+    if (state > 0)
+      m->out_len[state] = (gint)strlen(tags[t]);
+  }
+
+  /* Breadth-first: failure links become plain transitions */
+  gint *fail = g_new0(gint, m->states);
+  gint *queue = g_new(gint, m->states);
+  gint head = 0, tail = 0;
+  m->out_link[0] = -1;
+
+  for (gint c = 0; c < m->columns; c++) {
+    gint *slot = &m->next[c];
+    if (*slot < 0) {
+      *slot = 0;
+    } else {
+      fail[*slot] = 0;
+      m->out_link[*slot] = -1;
+      queue[tail++] = *slot;
+    }
+  }
+
+  while (head < tail) {
+    gint s = queue[head++];
+    for (gint c = 0; c < m->columns; c++) {
+      gint *slot = &m->next[s * m->columns + c];
+      gint via_fail = m->next[fail[s] * m->columns + c];
+      if (*slot < 0) {
+        *slot = via_fail;
+        continue;
+      }
+      gint t = *slot;
+      fail[t] = via_fail;
+      m->out_link[t] = m->out_len[via_fail] ? via_fail : m->out_link[via_fail];
+      queue[tail++] = t;
+    }
+  }
+
+  g_free(queue);
+  g_free(fail);
+  return m;
+}
+
+void utils_tag_matcher_free(UtilsTagMatcher *m) {
+  if (!m)
+    return;
+  g_free(m->next);
+  g_free(m->out_len);
+  g_free(m->out_link);
+  g_free(m);
+}
+
+/* Tags only match whole tokens, so "avc" in "Havoc" is left alone */
+static gboolean tag_boundary(gchar c) {
+  return c == '\0' || !(g_ascii_isalnum(c) || (guchar)c >= 0x80);
+}
+
+gssize utils_tag_matcher_find(const UtilsTagMatcher *m, const gchar *text) {
+  gssize best = -1;
+  gint state = 0;
+
+  for (gssize i = 0; text[i]; i++) {
+    /* Anything ending from here on starts after the best match */
+    if (best >= 0 && i >= best + m->max_len)
+      break;
+
+    state = m->next[state * m->columns + m->classes[(guchar)text[i]]];
+    gint s = m->out_len[state] ? state : m->out_link[state];
+    for (; s > 0; s = m->out_link[s]) {
+      gssize start = i - m->out_len[s] + 1;
+      if ((best < 0 || start < best) &&
+          (start == 0 || tag_boundary(text[start - 1])) &&
+          tag_boundary(text[i + 1]))
+        best = start;
+    }
+  }
+  return best;
+}
+
+void utils_set_strip_tags(const gchar *const *tags) {
+  UtilsTagMatcher *old = strip_matcher;
+  strip_matcher =
+      utils_tag_matcher_new(tags ? tags : (const gchar *const *)STRIP_TAGS);
+  utils_tag_matcher_free(old);
+}
+
+const gchar *const *utils_default_strip_tags(void) {
+  return (const gchar *const *)STRIP_TAGS;
+}
+
+gchar *utils_normalize_title_with(const UtilsTagMatcher *matcher,
+                                  const gchar *raw) {
   if (!raw)
     return NULL;
 
@@ -39,30 +180,18 @@ gchar *utils_normalize_title(const gchar *raw) {
     }
   }
 
-  /* Convert to lowercase for tag matching */
-  gchar *lower = g_ascii_strdown(result, -1);
-
-  /* Remove quality tags */
-  for (int i = 0; STRIP_TAGS[i] != NULL; i++) {
-    gchar *pos = strstr(lower, STRIP_TAGS[i]);
-    if (pos) {
-      /* Find corresponding position in result */
-      gsize offset = pos - lower;
-      if (offset < strlen(result)) {
-        result[offset] = '\0';
-      }
-      lower[offset] = '\0';
-    }
-  }
-
-  g_free(lower);
+  /* Cut at the first release tag */
+  gssize tag = utils_tag_matcher_find(matcher, result);
+  if (tag >= 0)
+    result[tag] = '\0';
 
   /* Trim whitespace */
   g_strstrip(result);
 
-  /* Remove trailing dashes/spaces */
+  /* Remove trailing dashes/spaces and brackets left open by the cut */
   gsize len = strlen(result);
-  while (len > 0 && (result[len - 1] == '-' || result[len - 1] == ' ')) {
+  while (len > 0 && (result[len - 1] == '-' || result[len - 1] == ' ' ||
+                     result[len - 1] == '[' || result[len - 1] == '(')) {
     result[--len] = '\0';
   }
 
@@ -78,6 +207,16 @@ gchar *utils_normalize_title(const gchar *raw) {
   return result;
 }
 
+gchar *utils_normalize_title(const gchar *raw) {
+  static gsize defaults_ready = 0;
+  if (g_once_init_enter(&defaults_ready)) {
+    if (!strip_matcher)
+      utils_set_strip_tags(NULL);
+    g_once_init_leave(&defaults_ready, 1);
+  }
+  return utils_normalize_title_with(strip_matcher, raw);
+}
+
 gchar *utils_format_runtime(gint minutes) {
   if (minutes <= 0)
     return g_strdup("Unknown");
@@ -136,25 +275,74 @@ static gboolean utils_path_is_jpeg(const gchar *path) {
          g_str_has_suffix(path, ".jpeg") || g_str_has_suffix(path, ".JPEG");
 }
 
-static GdkPixbuf *utils_pixbuf_new_from_jpeg_turbo(const gchar *path,
-                                                   GError **error) {
+static gboolean utils_data_is_jpeg(const guchar *data, gsize length) {
+  return length >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+#if REELVAULT_HAVE_TURBOJPEG
+static void utils_tj_destroy(gpointer handle) { tjDestroy(handle); }
+
+/* Handles are kept per thread; making one allocates its tables */
+static GPrivate tj_decompressor = G_PRIVATE_INIT(utils_tj_destroy);
+static GPrivate tj_compressor = G_PRIVATE_INIT(utils_tj_destroy);
+
+static tjhandle utils_tj_handle(GPrivate *key, gboolean compress) {
+  tjhandle handle = g_private_get(key);
+  if (!handle) {
+    handle = compress ? tjInitCompress() : tjInitDecompress();
+    if (handle)
+      g_private_set(key, handle);
+  }
+  return handle;
+}
+
+/* The largest reduction (1/8, 1/4 or 1/2) that still decodes to at least
+   the size the image will be scaled to. These are done inside the IDCT, so
+   a thumbnail never decodes the full-size image. */
+static tjscalingfactor utils_jpeg_scale_for(int src_w, int src_h, gint width,
+                                            gint height,
+                                            gboolean preserve_aspect) {
+  tjscalingfactor full = {1, 1};
+  if (width <= 0 || height <= 0)
+    return full;
+
+  gint tw = width;
+  gint th = height;
+  if (preserve_aspect) {
+    gdouble sx = (gdouble)width / (gdouble)src_w;
+    gdouble sy = (gdouble)height / (gdouble)src_h;
+    gdouble s = (sx < sy) ? sx : sy;
+    tw = (gint)(src_w * s + 0.5);
+    th = (gint)(src_h * s + 0.5);
+  }
+
+  for (int denom = 8; denom > 1; denom /= 2) {
+    tjscalingfactor f = {1, denom};
+    if (TJSCALED(src_w, f) >= tw && TJSCALED(src_h, f) >= th)
+      return f;
+  }
+  return full;
+}
+#endif
+
+/* Decode at the smallest size that still covers width x height (0 for full
+   size); the caller scales the rest of the way */
+static GdkPixbuf *utils_pixbuf_decode_jpeg_turbo(const guchar *jpeg_buf,
+                                                 gsize jpeg_len, gint target_w,
+                                                 gint target_h,
+                                                 gboolean preserve_aspect,
+                                                 GError **error) {
 #if !REELVAULT_HAVE_TURBOJPEG
-  (void)path;
+  (void)jpeg_buf;
+  (void)jpeg_len;
+  (void)target_w;
+  (void)target_h;
+  (void)preserve_aspect;
   (void)error;
   return NULL;
 #else
-  if (!path)
-    return NULL;
-
-  guchar *jpeg_buf = NULL;
-  gsize jpeg_len = 0;
-  if (!g_file_get_contents(path, (gchar **)&jpeg_buf, &jpeg_len, error)) {
-    return NULL;
-  }
-
-  tjhandle handle = tjInitDecompress();
+  tjhandle handle = utils_tj_handle(&tj_decompressor, FALSE);
   if (!handle) {
-    g_free(jpeg_buf);
     g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
                 "turbojpeg init failed");
     return NULL;
@@ -164,45 +352,72 @@ static GdkPixbuf *utils_pixbuf_new_from_jpeg_turbo(const gchar *path,
   if (tjDecompressHeader3(handle, jpeg_buf, (unsigned long)jpeg_len, &width,
                           &height, &subsamp, &cs) != 0) {
     const char *msg = tjGetErrorStr2(handle);
-    tjDestroy(handle);
-    g_free(jpeg_buf);
     g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
                 "turbojpeg header failed: %s", msg ? msg : "unknown");
     return NULL;
   }
 
   if (width <= 0 || height <= 0) {
-    tjDestroy(handle);
-    g_free(jpeg_buf);
     g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
                 "turbojpeg invalid dimensions");
     return NULL;
   }
 
+  /* A reduced decode is only ever scaled down further, where the fast
+     DCT's error doesn't show */
+  tjscalingfactor scale =
+      utils_jpeg_scale_for(width, height, target_w, target_h, preserve_aspect);
+  int flags = scale.denom > 1 ? TJFLAG_FASTDCT : TJFLAG_ACCURATEDCT;
+  width = TJSCALED(width, scale);
+  height = TJSCALED(height, scale);
+
   gsize stride = (gsize)width * 3;
   gsize buf_sz = (gsize)height * stride;
   guchar *rgb = g_malloc(buf_sz);
 
   if (tjDecompress2(handle, jpeg_buf, (unsigned long)jpeg_len, rgb, width,
-                    (int)stride, height, TJPF_RGB, TJFLAG_ACCURATEDCT) != 0) {
+                    (int)stride, height, TJPF_RGB, flags) != 0) {
     const char *msg = tjGetErrorStr2(handle);
-    tjDestroy(handle);
-    g_free(jpeg_buf);
-    g_free(rgb);
     g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
                 "turbojpeg decompress failed: %s", msg ? msg : "unknown");
+    g_free(rgb);
     return NULL;
   }
 
-  tjDestroy(handle);
-  g_free(jpeg_buf);
-
   return gdk_pixbuf_new_from_data(rgb, GDK_COLORSPACE_RGB, FALSE, 8, width,
                                  height, (int)stride, utils_pixbuf_free_pixels,
                                  NULL);
 #endif
 }
 
+static GdkPixbuf *utils_pixbuf_new_from_jpeg_turbo(const gchar *path,
+                                                   gint target_w, gint target_h,
+                                                   gboolean preserve_aspect,
+                                                   GError **error) {
+#if !REELVAULT_HAVE_TURBOJPEG
+  (void)path;
+  (void)target_w;
+  (void)target_h;
+  (void)preserve_aspect;
+  (void)error;
+  return NULL;
+#else
+  if (!path)
+    return NULL;
+
+  guchar *jpeg_buf = NULL;
+  gsize jpeg_len = 0;
+  if (!g_file_get_contents(path, (gchar **)&jpeg_buf, &jpeg_len, error)) {
+    return NULL;
+  }
+
+  GdkPixbuf *pixbuf = utils_pixbuf_decode_jpeg_turbo(
+      jpeg_buf, jpeg_len, target_w, target_h, preserve_aspect, error);
+  g_free(jpeg_buf);
+  return pixbuf;
+#endif
+}
+
 GdkPixbuf *utils_pixbuf_new_from_file_at_scale_safe(const gchar *path, gint width,
                                                     gint height,
                                                     gboolean preserve_aspect,
@@ -214,7 +429,8 @@ GdkPixbuf *utils_pixbuf_new_from_file_at_scale_safe(const gchar *path, gint widt
   GdkPixbuf *full = NULL;
   if (utils_path_is_jpeg(path)) {
     GError *tj_err = NULL;
-    full = utils_pixbuf_new_from_jpeg_turbo(path, &tj_err);
+    full = utils_pixbuf_new_from_jpeg_turbo(path, width, height,
+                                            preserve_aspect, &tj_err);
     if (!full && tj_err) {
       g_error_free(tj_err);
     }
@@ -233,3 +449,88 @@ GdkPixbuf *utils_pixbuf_new_from_file_at_scale_safe(const gchar *path, gint widt
   g_object_unref(full);
   return scaled;
 }
+
+GdkPixbuf *utils_pixbuf_new_from_data_at_scale(const guchar *data, gsize length,
+                                               gint width, gint height,
+                                               gboolean preserve_aspect,
+                                               GError **error) {
+  if (!data || length == 0)
+    return NULL;
+
+  GdkPixbuf *full = NULL;
+  if (utils_data_is_jpeg(data, length)) {
+    GError *tj_err = NULL;
+    full = utils_pixbuf_decode_jpeg_turbo(data, length, width, height,
+                                          preserve_aspect, &tj_err);
+    if (!full && tj_err) {
+      g_error_free(tj_err);
+    }
+  }
+
+  if (!full) {
+    GdkPixbufLoader *loader = gdk_pixbuf_loader_new();
+    gboolean ok = gdk_pixbuf_loader_write(loader, data, length, error);
+    /* Close even after a failed write, but keep the first error */
+    ok = gdk_pixbuf_loader_close(loader, ok ? error : NULL) && ok;
+    if (ok) {
+      full = gdk_pixbuf_loader_get_pixbuf(loader);
+      if (full)
+        g_object_ref(full);
+    }
+    g_object_unref(loader);
+  }
+  if (!full)
+    return NULL;
+
+  if (width <= 0 || height <= 0)
+    return full;
+
+  GdkPixbuf *scaled = pixbuf_scale_fit(full, width, height, preserve_aspect);
+  g_object_unref(full);
+  return scaled;
+}
+
+gboolean utils_pixbuf_save_jpeg_to_buffer(GdkPixbuf *pixbuf, gint quality,
+                                          gchar **buffer, gsize *length,
+                                          GError **error) {
+#if REELVAULT_HAVE_TURBOJPEG
+  gint channels = gdk_pixbuf_get_n_channels(pixbuf);
+  tjhandle handle = utils_tj_handle(&tj_compressor, TRUE);
+  if (handle && gdk_pixbuf_get_bits_per_sample(pixbuf) == 8 &&
+      (channels == 3 || channels == 4)) {
+    unsigned char *jpeg = NULL;
+    unsigned long jpeg_len = 0;
+    if (tjCompress2(handle, gdk_pixbuf_get_pixels(pixbuf),
+                    gdk_pixbuf_get_width(pixbuf),
+                    gdk_pixbuf_get_rowstride(pixbuf),
+                    gdk_pixbuf_get_height(pixbuf),
+                    channels == 4 ? TJPF_RGBA : TJPF_RGB, &jpeg, &jpeg_len,
+                    TJSAMP_420, quality, TJFLAG_FASTDCT) == 0) {
+      *buffer = g_malloc(jpeg_len);
+      memcpy(*buffer, jpeg, jpeg_len);
+      *length = jpeg_len;
+      tjFree(jpeg);
+      return TRUE;
+    }
+    tjFree(jpeg);
+  }
+#endif
+
+  gchar *q = g_strdup_printf("%d", quality);
+  gboolean ok = gdk_pixbuf_save_to_buffer(pixbuf, buffer, length, "jpeg", error,
+                                          "quality", q, NULL);
+  g_free(q);
+  return ok;
+}
+
+gboolean utils_pixbuf_save_jpeg(GdkPixbuf *pixbuf, const gchar *path,
+                                gint quality, GError **error) {
+  gchar *jpeg = NULL;
+  gsize length = 0;
+  if (!utils_pixbuf_save_jpeg_to_buffer(pixbuf, quality, &jpeg, &length,
+                                        error))
+    return FALSE;
+  gboolean ok = g_file_set_contents(path, jpeg, length, error);
+  g_free(jpeg);
+  return ok;
+}
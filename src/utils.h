@@ -8,6 +8,25 @@
  * trim) */
 gchar *utils_normalize_title(const gchar *raw);
 
+/* Compiled set of release tags ("1080p", "x264", ...) */
+typedef struct _UtilsTagMatcher UtilsTagMatcher;
+
+UtilsTagMatcher *utils_tag_matcher_new(const gchar *const *tags);
+void utils_tag_matcher_free(UtilsTagMatcher *matcher);
+
+/* Offset of the earliest tag that is a whole token of text, or -1 */
+gssize utils_tag_matcher_find(const UtilsTagMatcher *matcher,
+                              const gchar *text);
+
+/* utils_normalize_title() with an explicit tag set */
+gchar *utils_normalize_title_with(const UtilsTagMatcher *matcher,
+                                  const gchar *raw);
+
+/* Replace the tags utils_normalize_title() strips (NULL restores the
+ * built-in list). Not thread-safe: call before any scan starts. */
+void utils_set_strip_tags(const gchar *const *tags);
+const gchar *const *utils_default_strip_tags(void);
+
 /* Format runtime as "Xh Ym" */
 gchar *utils_format_runtime(gint minutes);
 
@@ -18,4 +37,21 @@ GdkPixbuf *utils_pixbuf_new_from_file_at_scale_safe(const gchar *path,
                                                     gboolean preserve_aspect,
                                                     GError **error);
 
+/* The same for an image already in memory, such as a download, so it is
+ * decoded without writing it out and reading it back. */
+GdkPixbuf *utils_pixbuf_new_from_data_at_scale(const guchar *data, gsize length,
+                                               gint width, gint height,
+                                               gboolean preserve_aspect,
+                                               GError **error);
+
+/* Encode as JPEG with libjpeg-turbo, falling back to gdk-pixbuf. Meant for
+ * thumbnails: it trades a little accuracy for speed. */
+gboolean utils_pixbuf_save_jpeg_to_buffer(GdkPixbuf *pixbuf, gint quality,
+                                          gchar **buffer, gsize *length,
+                                          GError **error);
+
+/* The same, written to path atomically */
+gboolean utils_pixbuf_save_jpeg(GdkPixbuf *pixbuf, const gchar *path,
+                                gint quality, GError **error);
+
 #endif /* REELGTK_UTILS_H */
@@ -8,6 +8,8 @@
 #include "db.h"
 #include "filter.h"
 #include "grid.h"
+#include "hasher.h"
+#include "postercache.h"
 #include "scanner.h"
 #include "scraper.h"
 #include <stdarg.h>
@@ -59,9 +61,15 @@ static gboolean mem_debug_tick(gpointer data) {
   ReelApp *app = (ReelApp *)data;
   if (!app)
     return G_SOURCE_REMOVE;
-  g_printerr("[mem] rss=%lukB films_loaded=%d posters_loaded=%d\n",
+  PosterCacheStats posters;
+  poster_cache_stats(&posters);
+  g_printerr("[mem] rss=%lukB films_loaded=%d posters_loaded=%d "
+             "poster_cache=%" G_GINT64_FORMAT "kB/%d entries=%d hits=%d "
+             "misses=%d evictions=%d\n",
              (unsigned long)read_rss_kb(), app->films_next_offset,
-             app->grid_posters_loaded);
+             app->grid_posters_loaded, posters.bytes / 1024,
+             app->poster_memory_mb * 1024, posters.entries, posters.hits,
+             posters.misses, posters.evictions);
   return G_SOURCE_CONTINUE;
 }
 
@@ -175,6 +183,8 @@ static void filter_state_clone(FilterState *dst, const FilterState *src) {
   dst->plot_text = g_strdup(src->plot_text);
   dst->sort_by = g_strdup(src->sort_by);
   dst->sort_ascending = src->sort_ascending;
+  dst->duplicates_only = src->duplicates_only;
+  dst->group_seasons = src->group_seasons;
 }
 
 static void filter_state_free_members(FilterState *f) {
@@ -188,6 +198,39 @@ static void filter_state_free_members(FilterState *f) {
   memset(f, 0, sizeof(*f));
 }
 
+static void hasher_done_cb(ReelApp *app, gint hashed, gpointer user_data) {
+  (void)user_data;
+  /* New hashes can change which films count as duplicates. */
+  if (hashed > 0 && app->filter.duplicates_only)
+    window_refresh_films(app);
+}
+
+static gboolean start_hasher_idle(gpointer data) {
+  ReelApp *app = (ReelApp *)data;
+  hasher_start_background(app, hasher_done_cb, NULL);
+  return G_SOURCE_REMOVE;
+}
+
+static void resume_scrape_done_cb(ReelApp *app, gboolean canceled,
+                                  gpointer user_data) {
+  (void)canceled;
+  (void)user_data;
+  window_refresh_films(app);
+}
+
+/* Pick up a scrape that was cut off by closing the app */
+static gboolean resume_scrape_idle(gpointer data) {
+  ReelApp *app = (ReelApp *)data;
+  ScrapeQueueStats queue;
+  if (app->tmdb_api_key && *app->tmdb_api_key &&
+      db_scrape_queue_stats(app, g_get_real_time() / G_USEC_PER_SEC,
+                            &queue) &&
+      queue.leased > 0)
+    scraper_start_background_with_progress(app, NULL, resume_scrape_done_cb,
+                                           NULL);
+  return G_SOURCE_REMOVE;
+}
+
 static gboolean films_counts_idle(gpointer data) {
   FilmsCountsPayload *p = (FilmsCountsPayload *)data;
   if (p->gen != p->app->films_refresh_gen) {
@@ -394,6 +437,11 @@ void window_create(ReelApp *app) {
 
   /* Apply theme CSS */
   apply_theme_css(app);
+
+  /* Catch up on content hashes and unfinished scrapes once startup has
+     settled. */
+  g_timeout_add_seconds(10, start_hasher_idle, app);
+  g_timeout_add_seconds(10, resume_scrape_idle, app);
   startup_log("window_create: done");
 }
 
@@ -525,17 +573,15 @@ static void apply_theme_css(ReelApp *app) {
       /* ===== LIGHT/DARK ADAPTIVE THEME ===== */
 
       /* Poster grid items - tight spacing */
-      "flowbox > flowboxchild {"
-      "    margin: 1px;"
-      "    padding: 3px;"
+      ".poster-cell {"
       "    border-radius: 6px;"
       "    transition: all 200ms ease;"
       "}"
-      "flowbox > flowboxchild:hover {"
+      ".poster-cell:hover {"
       "    background-color: alpha(@theme_selected_bg_color, 0.15);"
       "    box-shadow: 0 2px 8px alpha(black, 0.15);"
       "}"
-      "flowbox > flowboxchild:selected {"
+      ".poster-cell:selected {"
       "    background-color: alpha(@theme_selected_bg_color, 0.3);"
       "}"
 
@@ -740,7 +786,9 @@ typedef struct {
   GtkWidget *dialog;
   GtkWidget *label;
   GtkWidget *progress;
+  ScanJob *scan_job; /* Set while the library scan is running */
   gboolean canceled;
+  gboolean needs_refresh; /* Some scan results could not be placed live */
 } ImportProgressUi;
 
 static void import_progress_destroy(ImportProgressUi *ui) {
@@ -757,7 +805,10 @@ static void on_import_dialog_response(GtkDialog *dialog, gint response_id,
   ImportProgressUi *ui = (ImportProgressUi *)user_data;
   if (response_id == GTK_RESPONSE_CANCEL) {
     ui->canceled = TRUE;
-    scraper_stop(ui->app);
+    if (ui->scan_job)
+      scanner_job_cancel(ui->scan_job);
+    else
+      scraper_stop(ui->app);
   }
 }
 
@@ -796,6 +847,172 @@ static void scraper_done_cb(ReelApp *app, gboolean canceled,
   import_progress_destroy(ui);
 }
 
+/* Whether a film the scanner just inserted passes the filter, mirroring
+   build_films_query(). New films have no genres, cast, plot or content hash
+   yet. LIKE wildcards in the search text are left to a full refresh. */
+static gboolean scanned_film_matches_filter(const FilterState *f,
+                                            const Film *film,
+                                            gboolean *needs_refresh) {
+  if ((f->genre && *f->genre) || (f->actor && *f->actor) ||
+      (f->plot_text && *f->plot_text) || f->duplicates_only)
+    return FALSE;
+  if (f->year_from > 0 && film->year < f->year_from)
+    return FALSE;
+  if (f->year_to > 0 && film->year > f->year_to)
+    return FALSE;
+
+  if (f->search_text && *f->search_text) {
+    if (strpbrk(f->search_text, "%_")) {
+      *needs_refresh = TRUE;
+      return FALSE;
+    }
+    if (!film->title)
+      return FALSE;
+    gchar *title = g_ascii_strdown(film->title, -1);
+    gchar *needle = g_ascii_strdown(f->search_text, -1);
+    gboolean found = strstr(title, needle) != NULL;
+    g_free(title);
+    g_free(needle);
+    return found;
+  }
+  return TRUE;
+}
+
+/* Relative order of two films under the current sort, as in
+   build_films_query() (titles compare like COLLATE NOCASE). */
+static gint film_sort_cmp(const FilterState *f, const Film *a, const Film *b) {
+  gint cmp;
+  if (g_strcmp0(f->sort_by, "year") == 0) {
+    cmp = (a->year > b->year) - (a->year < b->year);
+  } else if (g_strcmp0(f->sort_by, "rating") == 0) {
+    cmp = (a->rating > b->rating) - (a->rating < b->rating);
+  } else if (g_strcmp0(f->sort_by, "added") == 0) {
+    cmp = (a->added_date > b->added_date) - (a->added_date < b->added_date);
+  } else if (!a->title || !b->title) {
+    cmp = (a->title != NULL) - (b->title != NULL);
+  } else {
+    cmp = g_ascii_strcasecmp(a->title, b->title);
+  }
+  return (!f->sort_by || f->sort_ascending) ? cmp : -cmp;
+}
+
+static void scan_progress_cb(ReelApp *app, const gchar *current_dir,
+                             gint dirs_scanned, gint films_found,
+                             gpointer user_data) {
+  (void)app;
+  ImportProgressUi *ui = (ImportProgressUi *)user_data;
+  if (!ui || ui->canceled)
+    return;
+
+  gchar *text = g_strdup_printf("Scanning (%d folders, %d new): %s",
+                                dirs_scanned, films_found,
+                                current_dir ? current_dir : "");
+  gtk_label_set_text(GTK_LABEL(ui->label), text);
+  g_free(text);
+
+  gtk_progress_bar_pulse(GTK_PROGRESS_BAR(ui->progress));
+}
+
+/* Place newly scanned films straight into the loaded part of the grid */
+static void scan_films_cb(ReelApp *app, GList *films, gpointer user_data) {
+  ImportProgressUi *ui = (ImportProgressUi *)user_data;
+
+  for (GList *l = films; l != NULL; l = l->next) {
+    Film *film = (Film *)l->data;
+    app->total_films++;
+    app->unmatched_films++;
+
+    /* A page load in flight uses an offset taken before this insert. */
+    if (app->films_loading) {
+      ui->needs_refresh = TRUE;
+      film_free(film);
+      continue;
+    }
+    if (!scanned_film_matches_filter(&app->filter, film, &ui->needs_refresh)) {
+      film_free(film);
+      continue;
+    }
+
+    gint position = 0;
+    GList *next = app->films;
+    while (next && film_sort_cmp(&app->filter, next->data, film) <= 0) {
+      next = next->next;
+      position++;
+    }
+
+    /* Sorts after everything loaded so far: a later page will bring it. */
+    if (!next && !app->films_end_reached) {
+      film_free(film);
+      continue;
+    }
+
+    app->films = g_list_insert_before(app->films, next, film);
+    app->films_next_offset++;
+    grid_insert_film(app, film, position);
+  }
+
+  g_list_free(films);
+  window_update_status_bar(app);
+}
+
+/* Tell the user which library folders were skipped, without blocking */
+static void scan_warn_offline(ReelApp *app, const gchar *const *roots) {
+  if (!roots || !roots[0] || !app->window)
+    return;
+
+  gchar *list = g_strjoinv("\n", (gchar **)roots);
+  GtkWidget *warn = gtk_message_dialog_new(
+      GTK_WINDOW(app->window), GTK_DIALOG_DESTROY_WITH_PARENT,
+      GTK_MESSAGE_WARNING, GTK_BUTTONS_OK,
+      "Some library folders could not be scanned.");
+  gtk_message_dialog_format_secondary_text(
+      GTK_MESSAGE_DIALOG(warn),
+      "%s\n\nThey are unreadable or not responding. Their films are kept "
+      "until they can be scanned again.",
+      list);
+  g_signal_connect(warn, "response", G_CALLBACK(gtk_widget_destroy), NULL);
+  gtk_widget_show(warn);
+  g_free(list);
+}
+
+static void scan_done_cb(ReelApp *app, gint added, gint removed,
+                         gboolean canceled, gpointer user_data) {
+  ImportProgressUi *ui = (ImportProgressUi *)user_data;
+  (void)added;
+  if (!canceled)
+    scan_warn_offline(app, scanner_job_offline_roots(ui->scan_job));
+  ui->scan_job = NULL;
+
+  if (removed > 0 || ui->needs_refresh)
+    window_refresh_films(app);
+  hasher_start_background(app, hasher_done_cb, NULL);
+
+  if (canceled || ui->canceled) {
+    gtk_label_set_text(GTK_LABEL(ui->label), "Import canceled.");
+    import_progress_destroy(ui);
+    return;
+  }
+
+  /* New films are queued by the scan; earlier failures may be due again */
+  ScrapeQueueStats queue;
+  if (app->tmdb_api_key && strlen(app->tmdb_api_key) > 0 &&
+      db_scrape_queue_stats(app, g_get_real_time() / G_USEC_PER_SEC,
+                            &queue) &&
+      queue.due > 0) {
+    gtk_label_set_text(GTK_LABEL(ui->label), "Fetching metadata from TMDB...");
+    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(ui->progress), 0.0);
+    if (scraper_start_background_with_progress(app, scraper_progress_cb,
+                                               scraper_done_cb, ui))
+      return;
+    /* A scrape resumed at startup is still running; it refreshes the films
+       when it is done */
+  }
+
+  gtk_label_set_text(GTK_LABEL(ui->label), "Import complete.");
+  gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(ui->progress), 1.0);
+  import_progress_destroy(ui);
+}
+
 static void window_scan_paths(ReelApp *app, gchar **paths, gint paths_count) {
   if (!app || !paths || paths_count <= 0)
     return;
@@ -816,6 +1033,7 @@ static void window_scan_paths(ReelApp *app, gchar **paths, gint paths_count) {
 
   ui->label = gtk_label_new("Scanning library...");
   gtk_label_set_xalign(GTK_LABEL(ui->label), 0);
+  gtk_label_set_ellipsize(GTK_LABEL(ui->label), PANGO_ELLIPSIZE_MIDDLE);
   gtk_box_pack_start(GTK_BOX(content), ui->label, FALSE, FALSE, 0);
 
   ui->progress = gtk_progress_bar_new();
@@ -827,46 +1045,11 @@ static void window_scan_paths(ReelApp *app, gchar **paths, gint paths_count) {
 
   gtk_widget_show_all(ui->dialog);
 
-  while (gtk_events_pending())
-    gtk_main_iteration();
-
-  int new_films = 0;
-  for (int i = 0; i < paths_count; i++) {
-    if (ui->canceled)
-      break;
-    if (!paths[i] || !*paths[i])
-      continue;
-
-    gchar *text = g_strdup_printf("Scanning: %s", paths[i]);
-    gtk_label_set_text(GTK_LABEL(ui->label), text);
-    g_free(text);
-
-    gtk_progress_bar_pulse(GTK_PROGRESS_BAR(ui->progress));
-    while (gtk_events_pending())
-      gtk_main_iteration();
-
-    new_films += scanner_scan_directory(app, paths[i]);
-  }
-
-  window_refresh_films(app);
-
-  if (ui->canceled) {
-    gtk_label_set_text(GTK_LABEL(ui->label), "Import canceled.");
+  ui->scan_job = scanner_start_background(app, paths, paths_count,
+                                          scan_progress_cb, scan_films_cb,
+                                          scan_done_cb, ui);
+  if (!ui->scan_job)
     import_progress_destroy(ui);
-    return;
-  }
-
-  if (app->tmdb_api_key && strlen(app->tmdb_api_key) > 0 && new_films > 0) {
-    gtk_label_set_text(GTK_LABEL(ui->label), "Fetching metadata from TMDB...");
-    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(ui->progress), 0.0);
-    scraper_start_background_with_progress(app, scraper_progress_cb,
-                                          scraper_done_cb, ui);
-    return;
-  }
-
-  gtk_label_set_text(GTK_LABEL(ui->label), "Import complete.");
-  gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(ui->progress), 1.0);
-  import_progress_destroy(ui);
 }
 
 typedef struct {